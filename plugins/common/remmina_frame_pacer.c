@@ -0,0 +1,160 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+#include "common/remmina_plugin.h"
+#include "remmina_frame_pacer.h"
+
+struct _RemminaPluginFramePacer {
+	gint				framerate_max;
+	gint64				last_frame_time;
+	gboolean			frame_requested;
+	GdkFrameClock *			frame_clock;
+	gulong				frame_clock_handler;
+	RemminaPluginFramePacerFunc	present;
+	gpointer			user_data;
+};
+
+RemminaPluginFramePacer *remmina_plugin_frame_pacer_new(gint framerate_max, RemminaPluginFramePacerFunc present,
+							 gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginFramePacer *pacer;
+
+	pacer = g_new0(RemminaPluginFramePacer, 1);
+	pacer->framerate_max = framerate_max;
+	pacer->present = present;
+	pacer->user_data = user_data;
+	return pacer;
+}
+
+static void remmina_plugin_frame_pacer_release(RemminaPluginFramePacer *pacer)
+{
+	TRACE_CALL(__func__);
+
+	if (!pacer->frame_clock)
+		return;
+	g_signal_handler_disconnect(pacer->frame_clock, pacer->frame_clock_handler);
+	g_object_unref(pacer->frame_clock);
+	pacer->frame_clock = NULL;
+	pacer->frame_clock_handler = 0;
+}
+
+void remmina_plugin_frame_pacer_free(RemminaPluginFramePacer *pacer)
+{
+	TRACE_CALL(__func__);
+
+	if (!pacer)
+		return;
+	remmina_plugin_frame_pacer_release(pacer);
+	g_free(pacer);
+}
+
+static void remmina_plugin_frame_pacer_on_update(GdkFrameClock *frame_clock, RemminaPluginFramePacer *pacer)
+{
+	TRACE_CALL(__func__);
+
+	if (pacer->frame_requested)
+		pacer->present(pacer->user_data);
+}
+
+void remmina_plugin_frame_pacer_attach(RemminaPluginFramePacer *pacer, GtkWidget *widget)
+{
+	TRACE_CALL(__func__);
+
+	if (pacer->frame_clock)
+		return;
+
+	pacer->frame_clock = gtk_widget_get_frame_clock(widget);
+	if (pacer->frame_clock) {
+		g_object_ref(pacer->frame_clock);
+		pacer->frame_clock_handler = g_signal_connect(pacer->frame_clock, "update",
+							      G_CALLBACK(remmina_plugin_frame_pacer_on_update), pacer);
+	}
+}
+
+void remmina_plugin_frame_pacer_detach(RemminaPluginFramePacer *pacer)
+{
+	TRACE_CALL(__func__);
+
+	remmina_plugin_frame_pacer_release(pacer);
+	if (pacer->frame_requested)
+		pacer->present(pacer->user_data);
+}
+
+gint64 remmina_plugin_frame_pacer_get_delay(RemminaPluginFramePacer *pacer, GtkWidget *widget, gboolean hidden)
+{
+	TRACE_CALL(__func__);
+	GtkWidget *toplevel;
+	GdkWindow *window;
+	gint fps;
+
+	fps = pacer->framerate_max;
+
+	toplevel = gtk_widget_get_toplevel(widget);
+	window = gtk_widget_get_window(toplevel);
+	if (hidden || !gtk_widget_get_mapped(widget) || !window
+	    || (gdk_window_get_state(window) & GDK_WINDOW_STATE_ICONIFIED))
+		fps = REMMINA_PLUGIN_FRAME_PACER_HIDDEN_FRAMERATE;
+	else if (GTK_IS_WINDOW(toplevel) && !gtk_window_is_active(GTK_WINDOW(toplevel))
+		 && (fps <= 0 || fps > REMMINA_PLUGIN_FRAME_PACER_UNFOCUSED_FRAMERATE))
+		fps = REMMINA_PLUGIN_FRAME_PACER_UNFOCUSED_FRAMERATE;
+
+	if (fps <= 0)
+		return 0;
+
+	return MAX(0, pacer->last_frame_time + G_USEC_PER_SEC / fps - g_get_monotonic_time());
+}
+
+void remmina_plugin_frame_pacer_request(RemminaPluginFramePacer *pacer)
+{
+	TRACE_CALL(__func__);
+
+	if (pacer->frame_clock) {
+		/* Present the update in step with the monitor refresh */
+		if (!pacer->frame_requested) {
+			pacer->frame_requested = TRUE;
+			gdk_frame_clock_request_phase(pacer->frame_clock, GDK_FRAME_CLOCK_PHASE_UPDATE);
+		}
+	} else {
+		pacer->present(pacer->user_data);
+	}
+}
+
+void remmina_plugin_frame_pacer_presented(RemminaPluginFramePacer *pacer)
+{
+	TRACE_CALL(__func__);
+
+	pacer->frame_requested = FALSE;
+	pacer->last_frame_time = g_get_monotonic_time();
+}
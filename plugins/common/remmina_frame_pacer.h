@@ -0,0 +1,70 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* Frame rate used when the window is not focused, or hidden */
+#define REMMINA_PLUGIN_FRAME_PACER_UNFOCUSED_FRAMERATE 10
+#define REMMINA_PLUGIN_FRAME_PACER_HIDDEN_FRAMERATE 1
+
+/* Paces the presentation of screen updates: no faster than the frame rate
+ * limit of the profile, and in step with the monitor refresh when the
+ * widget has a frame clock. GTK thread only. */
+typedef struct _RemminaPluginFramePacer RemminaPluginFramePacer;
+
+/* Presents the pending update, and calls remmina_plugin_frame_pacer_presented() */
+typedef void (*RemminaPluginFramePacerFunc)(gpointer user_data);
+
+/* framerate_max is in frames per second, 0 for no limit */
+RemminaPluginFramePacer *remmina_plugin_frame_pacer_new(gint framerate_max, RemminaPluginFramePacerFunc present,
+							 gpointer user_data);
+void remmina_plugin_frame_pacer_free(RemminaPluginFramePacer *pacer);
+/* Follow the frame clock of widget, from its "realize" handler */
+void remmina_plugin_frame_pacer_attach(RemminaPluginFramePacer *pacer, GtkWidget *widget);
+/* Stop following it, from the "unrealize" handler. A frame already
+ * requested would never come, so it is presented right away */
+void remmina_plugin_frame_pacer_detach(RemminaPluginFramePacer *pacer);
+/* Returns how long (in microseconds) the next frame has to wait. Unfocused
+ * and hidden windows are refreshed at a lower rate */
+gint64 remmina_plugin_frame_pacer_get_delay(RemminaPluginFramePacer *pacer, GtkWidget *widget, gboolean hidden);
+/* Present at the next frame clock update, or now without a frame clock */
+void remmina_plugin_frame_pacer_request(RemminaPluginFramePacer *pacer);
+/* The update has been presented, whoever asked for it */
+void remmina_plugin_frame_pacer_presented(RemminaPluginFramePacer *pacer);
+
+G_END_DECLS
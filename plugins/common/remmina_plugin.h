@@ -74,6 +74,16 @@ typedef void (*PThreadCleanupFunc)(void *);
 #define CANCEL_ASYNC    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL); pthread_testcancel();
 #define CANCEL_DEFER    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
 
+/* Debug message through the service table of the plugin, formatted only
+ * when debug logging is enabled */
+#define REMMINA_PLUGIN_SERVICE_DEBUG(service, fmt, ...) G_STMT_START { \
+		if ((service)->log_enabled(G_LOG_LEVEL_DEBUG)) \
+			(service)->_remmina_debug(__func__, fmt, ##__VA_ARGS__); \
+	} G_STMT_END
+
+/* The plugins keep their service table in remmina_plugin_service */
+#define REMMINA_PLUGIN_DEBUG(fmt, ...) REMMINA_PLUGIN_SERVICE_DEBUG(remmina_plugin_service, fmt, ##__VA_ARGS__)
+
 #define THREADS_ENTER _Pragma("GCC error \"THREADS_ENTER has been deprecated in Remmina 1.2\"")
 #define THREADS_LEAVE _Pragma("GCC error \"THREADS_LEAVE has been deprecated in Remmina 1.2\"")
 
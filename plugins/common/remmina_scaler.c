@@ -0,0 +1,431 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+/* Resampling of the damaged areas of a framebuffer into its scaled copy.
+ * 32 bpp framebuffers use the kernels below, with SSE2 or NEON when the
+ * build enables them; other formats are resampled by cairo. The kernels
+ * treat the 4 bytes of a pixel alike, so they work for premultiplied
+ * ARGB32 as well as RGB24. */
+
+#include "common/remmina_plugin.h"
+#include "remmina_scaler.h"
+
+#if defined(WITH_SSE2) && defined(__SSE2__)
+#define REMMINA_SCALER_SSE2 1
+#include <emmintrin.h>
+#elif defined(WITH_NEON) && defined(__ARM_NEON)
+#define REMMINA_SCALER_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Bilinear weights are in 1/128 units, so that every step fits 16 bits */
+#define REMMINA_SCALER_WEIGHT_BITS 7
+#define REMMINA_SCALER_WEIGHT_ONE (1 << REMMINA_SCALER_WEIGHT_BITS)
+
+typedef enum {
+	REMMINA_SCALER_NEAREST,
+	REMMINA_SCALER_BILINEAR,
+	REMMINA_SCALER_BOX
+} RemminaPluginScalerKernel;
+
+struct _RemminaPluginScaler {
+	cairo_surface_t *		surface;
+	/* Referenced, so that a new framebuffer never has the same address */
+	cairo_surface_t *		source;
+	gint				source_width;
+	gint				source_height;
+	gint				quality;
+	RemminaPluginScalerKernel	kernel;
+	cairo_region_t *		damage;
+
+	/* Per scaled column and row: first source pixel, then the bilinear
+	 * weight of the next one, or the end of the box */
+	gint *				xmap;
+	gint *				xarg;
+	gint *				ymap;
+	gint *				yarg;
+};
+
+RemminaPluginScaler *remmina_plugin_scaler_new(void)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginScaler *scaler;
+
+	scaler = g_new0(RemminaPluginScaler, 1);
+	scaler->damage = cairo_region_create();
+	return scaler;
+}
+
+void remmina_plugin_scaler_invalidate(RemminaPluginScaler *scaler)
+{
+	TRACE_CALL(__func__);
+	if (scaler->surface) {
+		cairo_surface_destroy(scaler->surface);
+		scaler->surface = NULL;
+	}
+	if (scaler->source) {
+		cairo_surface_destroy(scaler->source);
+		scaler->source = NULL;
+	}
+	g_clear_pointer(&scaler->xmap, g_free);
+	g_clear_pointer(&scaler->xarg, g_free);
+	g_clear_pointer(&scaler->ymap, g_free);
+	g_clear_pointer(&scaler->yarg, g_free);
+	cairo_region_destroy(scaler->damage);
+	scaler->damage = cairo_region_create();
+}
+
+void remmina_plugin_scaler_free(RemminaPluginScaler *scaler)
+{
+	TRACE_CALL(__func__);
+	if (!scaler)
+		return;
+	remmina_plugin_scaler_invalidate(scaler);
+	cairo_region_destroy(scaler->damage);
+	g_free(scaler);
+}
+
+void remmina_plugin_scaler_damage(RemminaPluginScaler *scaler, gint x, gint y, gint w, gint h)
+{
+	TRACE_CALL(__func__);
+	cairo_rectangle_int_t rect = { x, y, w, h };
+
+	if (scaler->surface && w > 0 && h > 0)
+		cairo_region_union_rectangle(scaler->damage, &rect);
+}
+
+static void remmina_plugin_scaler_build_map(RemminaPluginScalerKernel kernel, gint src, gint dst, gint *map, gint *arg)
+{
+	gint64 pos;
+	gint i;
+
+	for (i = 0; i < dst; i++) {
+		switch (kernel) {
+		case REMMINA_SCALER_NEAREST:
+			map[i] = MIN((gint)(((gint64)i * 2 + 1) * src / (dst * 2)), src - 1);
+			arg[i] = 0;
+			break;
+		case REMMINA_SCALER_BOX:
+			map[i] = (gint)((gint64)i * src / dst);
+			arg[i] = MAX(map[i] + 1, (gint)((gint64)(i + 1) * src / dst));
+			break;
+		case REMMINA_SCALER_BILINEAR:
+			/* Center of the scaled pixel, in source pixels */
+			pos = (((gint64)i * 2 + 1) * src - dst) * REMMINA_SCALER_WEIGHT_ONE / (dst * 2);
+			pos = MAX(pos, 0);
+			map[i] = (gint)(pos >> REMMINA_SCALER_WEIGHT_BITS);
+			arg[i] = (gint)(pos & (REMMINA_SCALER_WEIGHT_ONE - 1));
+			/* Never read past the last pixel */
+			if (map[i] >= src - 1) {
+				map[i] = MAX(src - 2, 0);
+				arg[i] = src > 1 ? REMMINA_SCALER_WEIGHT_ONE : 0;
+			}
+			break;
+		}
+	}
+}
+
+static void remmina_plugin_scaler_nearest_row(guint32 *dest, const guint32 *src, const gint *xmap, gint x, gint w)
+{
+	gint i;
+
+	for (i = x; i < x + w; i++)
+		dest[i] = src[xmap[i]];
+}
+
+static inline guint32 remmina_plugin_scaler_bilinear_pixel(const guint32 *row0, const guint32 *row1, gint x0, gint x1, gint fx, gint fy)
+{
+	guint32 p00 = row0[x0], p01 = row0[x1], p10 = row1[x0], p11 = row1[x1];
+	guint32 t, b, out;
+	gint c;
+
+	out = 0;
+	for (c = 0; c < 32; c += 8) {
+		t = (((p00 >> c) & 0xff) * (REMMINA_SCALER_WEIGHT_ONE - fx) + ((p01 >> c) & 0xff) * fx) >> REMMINA_SCALER_WEIGHT_BITS;
+		b = (((p10 >> c) & 0xff) * (REMMINA_SCALER_WEIGHT_ONE - fx) + ((p11 >> c) & 0xff) * fx) >> REMMINA_SCALER_WEIGHT_BITS;
+		out |= ((t * (REMMINA_SCALER_WEIGHT_ONE - fy) + b * fy) >> REMMINA_SCALER_WEIGHT_BITS) << c;
+	}
+	return out;
+}
+
+static void remmina_plugin_scaler_bilinear_row(guint32 *dest, const guint32 *row0, const guint32 *row1, gint fy,
+					       const gint *xmap, const gint *xfrac, gint src_width, gint x, gint w)
+{
+	gint i;
+
+	if (src_width < 2) {
+		for (i = x; i < x + w; i++)
+			dest[i] = remmina_plugin_scaler_bilinear_pixel(row0, row1, xmap[i], xmap[i], 0, fy);
+		return;
+	}
+
+#if defined(REMMINA_SCALER_SSE2)
+	__m128i zero = _mm_setzero_si128();
+	__m128i wy0 = _mm_set1_epi16(REMMINA_SCALER_WEIGHT_ONE - fy);
+	__m128i wy1 = _mm_set1_epi16(fy);
+	__m128i wx, t, b;
+
+	for (i = x; i < x + w; i++) {
+		/* The 2 neighbour pixels of each row, one channel per 16 bit lane */
+		wx = _mm_unpacklo_epi64(_mm_set1_epi16(REMMINA_SCALER_WEIGHT_ONE - xfrac[i]), _mm_set1_epi16(xfrac[i]));
+		t = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row0 + xmap[i])), zero), wx);
+		b = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(row1 + xmap[i])), zero), wx);
+		t = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_si128(t, 8)), REMMINA_SCALER_WEIGHT_BITS);
+		b = _mm_srli_epi16(_mm_add_epi16(b, _mm_srli_si128(b, 8)), REMMINA_SCALER_WEIGHT_BITS);
+		t = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(t, wy0), _mm_mullo_epi16(b, wy1)), REMMINA_SCALER_WEIGHT_BITS);
+		dest[i] = (guint32)_mm_cvtsi128_si32(_mm_packus_epi16(t, t));
+	}
+#elif defined(REMMINA_SCALER_NEON)
+	uint8x8_t wx;
+	uint16x8_t tt, bb;
+	uint16x4_t t, b;
+
+	for (i = x; i < x + w; i++) {
+		wx = vreinterpret_u8_u32(vset_lane_u32((guint32)xfrac[i] * 0x01010101u,
+						       vdup_n_u32((guint32)(REMMINA_SCALER_WEIGHT_ONE - xfrac[i]) * 0x01010101u), 1));
+		tt = vmull_u8(vld1_u8((const uint8_t *)(row0 + xmap[i])), wx);
+		bb = vmull_u8(vld1_u8((const uint8_t *)(row1 + xmap[i])), wx);
+		t = vshr_n_u16(vadd_u16(vget_low_u16(tt), vget_high_u16(tt)), REMMINA_SCALER_WEIGHT_BITS);
+		b = vshr_n_u16(vadd_u16(vget_low_u16(bb), vget_high_u16(bb)), REMMINA_SCALER_WEIGHT_BITS);
+		t = vshr_n_u16(vmla_n_u16(vmul_n_u16(t, REMMINA_SCALER_WEIGHT_ONE - fy), b, fy), REMMINA_SCALER_WEIGHT_BITS);
+		dest[i] = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(t, t))), 0);
+	}
+#else
+	for (i = x; i < x + w; i++)
+		dest[i] = remmina_plugin_scaler_bilinear_pixel(row0, row1, xmap[i], xmap[i] + 1, xfrac[i], fy);
+#endif
+}
+
+/* Average of the source pixels covered by each scaled pixel */
+static void remmina_plugin_scaler_box_row(guint32 *dest, const guchar *src, gint src_stride, gint y0, gint y1,
+					  const gint *xmap, const gint *xend, gint x, gint w)
+{
+	const guint32 *row;
+	guint32 sum[4];
+	guint32 recip, out;
+	gint i, sx, sy, c;
+
+	for (i = x; i < x + w; i++) {
+#if defined(REMMINA_SCALER_SSE2)
+		__m128i zero = _mm_setzero_si128();
+		__m128i acc = zero;
+		for (sy = y0; sy < y1; sy++) {
+			row = (const guint32 *)(src + sy * src_stride);
+			for (sx = xmap[i]; sx < xend[i]; sx++)
+				acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((gint)row[sx]), zero), zero));
+		}
+		_mm_storeu_si128((__m128i *)sum, acc);
+#elif defined(REMMINA_SCALER_NEON)
+		uint32x4_t acc = vdupq_n_u32(0);
+		for (sy = y0; sy < y1; sy++) {
+			row = (const guint32 *)(src + sy * src_stride);
+			for (sx = xmap[i]; sx < xend[i]; sx++)
+				acc = vaddw_u16(acc, vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(row[sx])))));
+		}
+		vst1q_u32(sum, acc);
+#else
+		sum[0] = sum[1] = sum[2] = sum[3] = 0;
+		for (sy = y0; sy < y1; sy++) {
+			row = (const guint32 *)(src + sy * src_stride);
+			for (sx = xmap[i]; sx < xend[i]; sx++)
+				for (c = 0; c < 4; c++)
+					sum[c] += (row[sx] >> (c * 8)) & 0xff;
+		}
+#endif
+		/* Division by the pixel count, as a 16.16 reciprocal */
+		recip = 65536 / ((xend[i] - xmap[i]) * (y1 - y0));
+		out = 0;
+		for (c = 0; c < 4; c++)
+			out |= MIN((sum[c] * recip + 32768) >> 16, 255) << (c * 8);
+		dest[i] = out;
+	}
+}
+
+static void remmina_plugin_scaler_resample(RemminaPluginScaler *scaler, const guchar *src, gint src_stride,
+					   guchar *dest, gint dest_stride, const cairo_rectangle_int_t *r)
+{
+	const guint32 *row0, *row1;
+	guint32 *out;
+	gint dy, sy;
+
+	for (dy = r->y; dy < r->y + r->height; dy++) {
+		out = (guint32 *)(dest + dy * dest_stride);
+		sy = scaler->ymap[dy];
+		row0 = (const guint32 *)(src + sy * src_stride);
+		switch (scaler->kernel) {
+		case REMMINA_SCALER_NEAREST:
+			remmina_plugin_scaler_nearest_row(out, row0, scaler->xmap, r->x, r->width);
+			break;
+		case REMMINA_SCALER_BILINEAR:
+			row1 = (const guint32 *)(src + MIN(sy + 1, scaler->source_height - 1) * src_stride);
+			remmina_plugin_scaler_bilinear_row(out, row0, row1, scaler->yarg[dy], scaler->xmap, scaler->xarg,
+							   scaler->source_width, r->x, r->width);
+			break;
+		case REMMINA_SCALER_BOX:
+			remmina_plugin_scaler_box_row(out, src, src_stride, sy, scaler->yarg[dy],
+						      scaler->xmap, scaler->xarg, r->x, r->width);
+			break;
+		}
+	}
+}
+
+/* Formats without a kernel are resampled by cairo, still only where damaged */
+static void remmina_plugin_scaler_resample_cairo(RemminaPluginScaler *scaler, cairo_surface_t *source, gint width, gint height)
+{
+	cairo_rectangle_int_t r;
+	cairo_filter_t filter;
+	cairo_t *cr;
+	gint i;
+
+	switch (scaler->quality) {
+	case GDK_INTERP_NEAREST:
+		filter = CAIRO_FILTER_NEAREST;
+		break;
+	case GDK_INTERP_HYPER:
+		filter = CAIRO_FILTER_BEST;
+		break;
+	default:
+		filter = CAIRO_FILTER_BILINEAR;
+		break;
+	}
+
+	cr = cairo_create(scaler->surface);
+	for (i = 0; i < cairo_region_num_rectangles(scaler->damage); i++) {
+		cairo_region_get_rectangle(scaler->damage, i, &r);
+		cairo_rectangle(cr, r.x, r.y, r.width, r.height);
+	}
+	cairo_clip(cr);
+	cairo_scale(cr, (gdouble)width / scaler->source_width, (gdouble)height / scaler->source_height);
+	cairo_set_source_surface(cr, source, 0, 0);
+	cairo_pattern_set_filter(cairo_get_source(cr), filter);
+	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	cairo_paint(cr);
+	cairo_destroy(cr);
+}
+
+static gboolean remmina_plugin_scaler_setup(RemminaPluginScaler *scaler, cairo_surface_t *source, gint width, gint height, gint quality)
+{
+	TRACE_CALL(__func__);
+	cairo_format_t format;
+	cairo_rectangle_int_t all = { 0, 0, width, height };
+
+	remmina_plugin_scaler_invalidate(scaler);
+
+	format = cairo_image_surface_get_format(source);
+	if (format != CAIRO_FORMAT_ARGB32)
+		format = CAIRO_FORMAT_RGB24;
+	scaler->surface = cairo_image_surface_create(format, width, height);
+	if (cairo_surface_status(scaler->surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(scaler->surface);
+		scaler->surface = NULL;
+		return FALSE;
+	}
+
+	scaler->source = cairo_surface_reference(source);
+	scaler->source_width = cairo_image_surface_get_width(source);
+	scaler->source_height = cairo_image_surface_get_height(source);
+	scaler->quality = quality;
+
+	switch (quality) {
+	case GDK_INTERP_NEAREST:
+		scaler->kernel = REMMINA_SCALER_NEAREST;
+		break;
+	case GDK_INTERP_HYPER:
+		/* The box filter only makes sense when shrinking */
+		scaler->kernel = (scaler->source_width > width && scaler->source_height > height) ?
+				 REMMINA_SCALER_BOX : REMMINA_SCALER_BILINEAR;
+		break;
+	default:
+		scaler->kernel = REMMINA_SCALER_BILINEAR;
+		break;
+	}
+
+	scaler->xmap = g_new(gint, width);
+	scaler->xarg = g_new(gint, width);
+	scaler->ymap = g_new(gint, height);
+	scaler->yarg = g_new(gint, height);
+	remmina_plugin_scaler_build_map(scaler->kernel, scaler->source_width, width, scaler->xmap, scaler->xarg);
+	remmina_plugin_scaler_build_map(scaler->kernel, scaler->source_height, height, scaler->ymap, scaler->yarg);
+
+	cairo_region_union_rectangle(scaler->damage, &all);
+	return TRUE;
+}
+
+cairo_surface_t *remmina_plugin_scaler_update(RemminaPluginScaler *scaler, cairo_surface_t *source,
+					      gint width, gint height, gint quality)
+{
+	TRACE_CALL(__func__);
+	cairo_rectangle_int_t all = { 0, 0, width, height };
+	cairo_rectangle_int_t r;
+	cairo_format_t format;
+	gint i;
+
+	if (width < 1 || height < 1)
+		return NULL;
+
+	if (!scaler->surface || scaler->source != source || scaler->quality != quality ||
+	    cairo_image_surface_get_width(scaler->surface) != width ||
+	    cairo_image_surface_get_height(scaler->surface) != height ||
+	    cairo_image_surface_get_width(source) != scaler->source_width ||
+	    cairo_image_surface_get_height(source) != scaler->source_height) {
+		if (!remmina_plugin_scaler_setup(scaler, source, width, height, quality))
+			return NULL;
+	}
+
+	cairo_region_intersect_rectangle(scaler->damage, &all);
+	if (cairo_region_is_empty(scaler->damage))
+		return scaler->surface;
+
+	cairo_surface_flush(source);
+	cairo_surface_flush(scaler->surface);
+
+	format = cairo_image_surface_get_format(source);
+	if (format == CAIRO_FORMAT_ARGB32 || format == CAIRO_FORMAT_RGB24) {
+		for (i = 0; i < cairo_region_num_rectangles(scaler->damage); i++) {
+			cairo_region_get_rectangle(scaler->damage, i, &r);
+			remmina_plugin_scaler_resample(scaler,
+						       cairo_image_surface_get_data(source), cairo_image_surface_get_stride(source),
+						       cairo_image_surface_get_data(scaler->surface), cairo_image_surface_get_stride(scaler->surface),
+						       &r);
+		}
+		cairo_surface_mark_dirty(scaler->surface);
+	} else {
+		remmina_plugin_scaler_resample_cairo(scaler, source, width, height);
+	}
+
+	cairo_region_destroy(scaler->damage);
+	scaler->damage = cairo_region_create();
+
+	return scaler->surface;
+}
@@ -0,0 +1,58 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* Scaled copy of a remote framebuffer, for the scaled display mode.
+ * Only the damaged areas are resampled, the draw handler then paints
+ * the copy 1:1. Not thread safe: the caller serializes the calls with
+ * the framebuffer updates. */
+typedef struct _RemminaPluginScaler RemminaPluginScaler;
+
+RemminaPluginScaler *remmina_plugin_scaler_new(void);
+void remmina_plugin_scaler_free(RemminaPluginScaler *scaler);
+/* Drop the scaled copy, it is rebuilt at the next update */
+void remmina_plugin_scaler_invalidate(RemminaPluginScaler *scaler);
+/* Area of the scaled copy to resample, in scaled coordinates */
+void remmina_plugin_scaler_damage(RemminaPluginScaler *scaler, gint x, gint y, gint w, gint h);
+/* Resample the damaged areas of source, quality is a GdkInterpType.
+ * Returns the scaled copy, owned by the scaler */
+cairo_surface_t *remmina_plugin_scaler_update(RemminaPluginScaler *scaler, cairo_surface_t *source,
+					      gint width, gint height, gint quality);
+
+G_END_DECLS
@@ -56,8 +56,6 @@ typedef struct _RemminaPluginExecData {
 } RemminaPluginExecData;
 
 static RemminaPluginService *remmina_plugin_service = NULL;
-#define REMMINA_PLUGIN_DEBUG(fmt, ...) remmina_plugin_service->_remmina_debug(__func__, fmt, ##__VA_ARGS__)
-
 
 	static void
 cb_child_watch( GPid pid, gint status)
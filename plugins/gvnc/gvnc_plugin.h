@@ -87,8 +87,6 @@
 #endif
 
 #define GET_PLUGIN_DATA(gp) (GVncPluginData *)g_object_get_data(G_OBJECT(gp), "plugin-data")
-#define REMMINA_PLUGIN_DEBUG(fmt, ...) remmina_plugin_service->_remmina_debug(__func__, fmt, ## __VA_ARGS__)
-
 typedef struct _GVncPluginData {
 	GtkWidget *	box;
 	GtkWidget *	vnc;
@@ -42,8 +42,21 @@
 #include <freerdp/channels/channels.h>
 #include <freerdp/client/cliprdr.h>
 #include <sys/time.h>
+#include <time.h>
 
 #define CLIPBOARD_TRANSFER_WAIT_TIME 6
+/* Largest clipboard content transferred in either direction, in bytes */
+#define CLIPBOARD_MAX_SIZE (64 * 1024 * 1024)
+
+/* Local clipboard content being converted for the server */
+typedef struct rf_clipboard_conversion {
+	RemminaProtocolWidget * gp;
+	UINT32			format;
+	gchar *			text;
+	GdkPixbuf *		image;
+	UINT8 *			outbuf;
+	int			size;
+} rfClipboardConversion;
 
 UINT32 remmina_rdp_cliprdr_get_format_from_gdkatom(GdkAtom atom)
 {
@@ -219,21 +232,25 @@ static UINT remmina_rdp_cliprdr_server_capabilities(CliprdrClientContext *contex
 }
 
 
-void remmina_rdp_cliprdr_cached_clipboard_free(rfClipboard *clipboard)
+static void remmina_rdp_cliprdr_free_data(UINT32 fmt, gpointer data)
 {
 	TRACE_CALL(__func__);
-	guint fmt;
-
 
-	if (clipboard->srv_data == NULL)
+	if (data == NULL)
 		return;
 
-	fmt = clipboard->format;
-	if (fmt == CB_FORMAT_PNG || fmt == CF_DIB || fmt == CF_DIBV5 || fmt == CB_FORMAT_JPEG) {
-		g_object_unref(clipboard->srv_data);
-	} else {
-		free(clipboard->srv_data);
-	}
+	if (fmt == CB_FORMAT_PNG || fmt == CF_DIB || fmt == CF_DIBV5 || fmt == CB_FORMAT_JPEG)
+		g_object_unref(data);
+	else
+		free(data);
+}
+
+/* Called with transfer_clip_mutex held */
+void remmina_rdp_cliprdr_cached_clipboard_free(rfClipboard *clipboard)
+{
+	TRACE_CALL(__func__);
+
+	remmina_rdp_cliprdr_free_data(clipboard->format, clipboard->srv_data);
 	clipboard->srv_data = NULL;
 }
 
@@ -267,12 +284,17 @@ static UINT remmina_rdp_cliprdr_server_format_list(CliprdrClientContext *context
 
 	GtkTargetList *list = gtk_target_list_new(NULL, 0);
 
-	if (clipboard->srv_clip_data_wait == SCDW_BUSY_WAIT) {
-		REMMINA_PLUGIN_DEBUG("gp=%p: we already have a FormatDataRequest in progress to the server, aborting", gp);
-		remmina_rdp_clipboard_abort_client_format_data_request(clipboard->rfi);
+	pthread_mutex_lock(&clipboard->transfer_clip_mutex);
+	if (clipboard->srv_request_pending) {
+		REMMINA_PLUGIN_DEBUG("gp=%p: we already have a FormatDataRequest in progress to the server, its data will be discarded", gp);
+		clipboard->srv_request_stale = TRUE;
 	}
+	pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
+	remmina_rdp_clipboard_abort_client_format_data_request(clipboard->rfi);
 
+	pthread_mutex_lock(&clipboard->transfer_clip_mutex);
 	remmina_rdp_cliprdr_cached_clipboard_free(clipboard);
+	pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
 
 	REMMINA_PLUGIN_DEBUG("gp=%p: format list from the server:", gp);
 	for (i = 0; i < formatList->numFormats; i++) {
@@ -351,9 +373,11 @@ static UINT remmina_rdp_cliprdr_server_format_list(CliprdrClientContext *context
 		REMMINA_PLUGIN_DEBUG("gp=%p adding a dummy text target (empty text) for local clipboard, because we have no interesting targets from the server. Putting it in the local clipboard cache.");
 		GdkAtom atom = gdk_atom_intern("UTF8_STRING", TRUE);
 		gtk_target_list_add(list, atom, 0, CF_UNICODETEXT);
+		pthread_mutex_lock(&clipboard->transfer_clip_mutex);
 		clipboard->srv_data = malloc(1);
 		((char *)(clipboard->srv_data))[0] = 0;
 		clipboard->format = CF_UNICODETEXT;
+		pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
 	}
 
 
@@ -385,12 +409,14 @@ static UINT remmina_rdp_cliprdr_server_format_data_request(CliprdrClientContext
 	clipboard = (rfClipboard *)context->custom;
 	gp = clipboard->rfi->protocol_widget;
 
+	/* The response is sent once the GTK thread got the local data and a
+	 * worker converted it, the channel thread does not wait for it */
 	ui = g_new0(RemminaPluginRdpUiObject, 1);
 	ui->type = REMMINA_RDP_UI_CLIPBOARD;
 	ui->clipboard.clipboard = clipboard;
 	ui->clipboard.type = REMMINA_RDP_UI_CLIPBOARD_GET_DATA;
 	ui->clipboard.format = formatDataRequest->requestedFormatId;
-	remmina_rdp_event_queue_ui_sync_retint(gp, ui);
+	remmina_rdp_event_queue_ui_async(gp, ui);
 
 	return CHANNEL_RC_OK;
 }
@@ -409,33 +435,51 @@ static UINT remmina_rdp_cliprdr_server_format_data_response(CliprdrClientContext
 {
 	TRACE_CALL(__func__);
 
+	/* Called in the channel thread, where the data is also converted: the
+	 * GTK thread only has to hand the result to the local application */
+
 	const UINT8 *data;
 	size_t size;
-	rfContext *rfi;
 	RemminaProtocolWidget *gp;
 	rfClipboard *clipboard;
 	gpointer output = NULL;
 	struct timeval now;
 	int mstrans;
+	UINT32 format;
 
 	clipboard = (rfClipboard *)context->custom;
 	gp = clipboard->rfi->protocol_widget;
-	rfi = GET_PLUGIN_DATA(gp);
 
 	data = formatDataResponse->requestedFormatData;
 	size = formatDataResponse->dataLen;
 
 	REMMINA_PLUGIN_DEBUG("gp=%p server FormatDataResponse received: clipboard data arrived form server.", gp);
 	gettimeofday(&now, NULL);
-	remmina_rdp_cliprdr_cached_clipboard_free(clipboard);
+
+	pthread_mutex_lock(&clipboard->transfer_clip_mutex);
+	if (clipboard->srv_request_abandoned > 0) {
+		/* Late response to a request whose paste has already given up,
+		 * srv_request_format may belong to a newer request by now */
+		clipboard->srv_request_abandoned--;
+		pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
+		REMMINA_PLUGIN_DEBUG("gp=%p: late clipboard data from server for an abandoned request, discarding it", gp);
+		return CHANNEL_RC_OK;
+	}
+	format = clipboard->srv_request_format;
+	pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
 
 	/* Calculate stats */
 	mstrans = timeval_diff(&(clipboard->clientformatdatarequest_tv), &now);
 	REMMINA_PLUGIN_DEBUG("gp=%p %zu bytes transferred from server in %d ms. Speed is %d bytes/sec",
-		gp, (size_t)size, mstrans, (int)((int64_t)size * 1000 / mstrans));
+		gp, (size_t)size, mstrans, mstrans > 0 ? (int)((int64_t)size * 1000 / mstrans) : 0);
+
+	if (size > CLIPBOARD_MAX_SIZE) {
+		REMMINA_PLUGIN_DEBUG("gp=%p: %zu bytes of clipboard data exceed the limit of %d, discarding them", gp, size, CLIPBOARD_MAX_SIZE);
+		size = 0;
+	}
 
 	if (size > 0) {
-		switch (rfi->clipboard.format) {
+		switch (format) {
 		case CF_UNICODETEXT:
 		{
 			size = ConvertFromUnicode(CP_UTF8, 0, (WCHAR *)data, size / 2, (CHAR **)&output, 0, NULL, NULL);
@@ -463,6 +507,8 @@ static UINT remmina_rdp_cliprdr_server_format_data_response(CliprdrClientContext
 			BITMAPINFOHEADER *pbi;
 			BITMAPV5HEADER *pbi5;
 
+			if (size < sizeof(BITMAPINFOHEADER))
+				break;
 			pbi = (BITMAPINFOHEADER *)data;
 
 			// offset calculation inspired by http://downloads.poolelan.com/MSDN/MSDNLibrary6/Disk1/Samples/VC/OS/WindowsXP/GetImage/BitmapUtil.cpp
@@ -520,30 +566,82 @@ static UINT remmina_rdp_cliprdr_server_format_data_response(CliprdrClientContext
 		}
 	}
 
-	clipboard->srv_data = output;
-	if (output != NULL)
-		REMMINA_PLUGIN_DEBUG("gp=%p: clipboard local cache data has been loaded", gp);
-	else
-		REMMINA_PLUGIN_DEBUG("gp=%p: data from server is not valid (size=%zu format=%d), cannot load into cache", gp, size, rfi->clipboard.format);
-
-
-	REMMINA_PLUGIN_DEBUG("gp=%p: signalling main GTK thread that we have some clipboard data.", gp);
-
 	pthread_mutex_lock(&clipboard->transfer_clip_mutex);
-	pthread_cond_signal(&clipboard->transfer_clip_cond);
+	if (clipboard->srv_request_stale) {
+		/* The server clipboard changed after the request */
+		REMMINA_PLUGIN_DEBUG("gp=%p: clipboard data from server is stale, discarding it", gp);
+		remmina_rdp_cliprdr_free_data(format, output);
+	} else {
+		remmina_rdp_cliprdr_cached_clipboard_free(clipboard);
+		clipboard->srv_data = output;
+		clipboard->format = format;
+		if (output != NULL)
+			REMMINA_PLUGIN_DEBUG("gp=%p: clipboard local cache data has been loaded", gp);
+		else
+			REMMINA_PLUGIN_DEBUG("gp=%p: data from server is not valid (size=%zu format=%d), cannot load into cache", gp, size, format);
+	}
+	clipboard->srv_request_pending = FALSE;
+	clipboard->srv_request_stale = FALSE;
+
 	if (clipboard->srv_clip_data_wait == SCDW_BUSY_WAIT) {
-		REMMINA_PLUGIN_DEBUG("gp=%p: clipboard transfer from server completed.", gp);
+		REMMINA_PLUGIN_DEBUG("gp=%p: clipboard transfer from server completed, signalling main GTK thread.", gp);
 	} else {
-		// Clipboard data arrived from server when we are not busy waiting on main loop
-		// Unfortunately, we must discard it
+		// Clipboard data arrived from server when we are not waiting on main loop
 		REMMINA_PLUGIN_DEBUG("gp=%p: clipboard transfer from server completed, but no local application is requesting it. Data is on local cache now, try to paste later.", gp);
 	}
 	clipboard->srv_clip_data_wait = SCDW_NONE;
+	pthread_cond_signal(&clipboard->transfer_clip_cond);
 	pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
 
 	return CHANNEL_RC_OK;
 }
 
+/* Wait for the ServerFormatDataResponse, with transfer_clip_mutex held.
+ * The libfreerdp thread may need the GTK thread meanwhile (i.e. for pointer
+ * updates): the UI objects it queues wake us up and are processed here, but
+ * nothing else of the main loop runs until the data is here */
+static void remmina_rdp_cliprdr_wait_data(RemminaProtocolWidget *gp, rfClipboard *clipboard)
+{
+	TRACE_CALL(__func__);
+	struct timespec deadline;
+	int rc = 0;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += CLIPBOARD_TRANSFER_WAIT_TIME;
+
+	/* Objects queued before we started waiting */
+	clipboard->srv_clip_ui_wake = TRUE;
+
+	while (clipboard->srv_clip_data_wait == SCDW_BUSY_WAIT) {
+		if (clipboard->srv_clip_ui_wake) {
+			clipboard->srv_clip_ui_wake = FALSE;
+			pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
+			while (remmina_rdp_event_process_ui_pending(gp)) {
+			}
+			pthread_mutex_lock(&clipboard->transfer_clip_mutex);
+			continue;
+		}
+		rc = pthread_cond_timedwait(&clipboard->transfer_clip_cond, &clipboard->transfer_clip_mutex, &deadline);
+		if (rc != 0)
+			break;
+	}
+
+	if (clipboard->srv_clip_data_wait == SCDW_ABORTING) {
+		g_warning("[RDP] gp=%p Clipboard data wait aborted.", gp);
+	} else if (rc == ETIMEDOUT) {
+		g_warning("[RDP] gp=%p Clipboard data from the server is not available in %d seconds. No data will be available to user.",
+			  gp, CLIPBOARD_TRANSFER_WAIT_TIME);
+	} else if (rc != 0) {
+		g_warning("[RDP] gp=%p internal error: pthread_cond_timedwait() returned %d\n", gp, rc);
+	}
+	if (clipboard->srv_request_pending) {
+		/* Whatever made us stop waiting, the response is of no use any
+		 * more. Do not keep refusing new pastes until it arrives. */
+		clipboard->srv_request_pending = FALSE;
+		clipboard->srv_request_abandoned++;
+	}
+	clipboard->srv_clip_data_wait = SCDW_NONE;
+}
 
 void remmina_rdp_cliprdr_request_data(GtkClipboard *gtkClipboard, GtkSelectionData *selection_data, guint info, RemminaProtocolWidget *gp)
 {
@@ -556,15 +654,14 @@ void remmina_rdp_cliprdr_request_data(GtkClipboard *gtkClipboard, GtkSelectionDa
 	rfClipboard *clipboard;
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
 	RemminaPluginRdpEvent rdp_event = { 0 };
-	struct timespec to;
-	struct timeval tv;
-	int rc;
-	time_t tlimit, tlimit1s, tnow, tstart;
 
 	REMMINA_PLUGIN_DEBUG("gp=%p: A local application has requested remote clipboard data for remote format id %d", gp, info);
 
 	clipboard = &(rfi->clipboard);
-	if (clipboard->srv_clip_data_wait != SCDW_NONE) {
+	pthread_mutex_lock(&clipboard->transfer_clip_mutex);
+
+	if (clipboard->srv_clip_data_wait != SCDW_NONE || clipboard->srv_request_pending) {
+		pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
 		g_message("[RDP] Cannot paste now, I’m already transferring clipboard data from server. Try again later\n");
 		return;
 	}
@@ -573,67 +670,24 @@ void remmina_rdp_cliprdr_request_data(GtkClipboard *gtkClipboard, GtkSelectionDa
 		/* We do not have a local cached clipoard, so we have to start a remote request */
 		remmina_rdp_cliprdr_cached_clipboard_free(clipboard);
 
-		clipboard->format = info;
-
-		pthread_mutex_lock(&clipboard->transfer_clip_mutex);
-
 		pFormatDataRequest = (CLIPRDR_FORMAT_DATA_REQUEST *)malloc(sizeof(CLIPRDR_FORMAT_DATA_REQUEST));
 		ZeroMemory(pFormatDataRequest, sizeof(CLIPRDR_FORMAT_DATA_REQUEST));
-		pFormatDataRequest->requestedFormatId = clipboard->format;
+		pFormatDataRequest->requestedFormatId = info;
 
+		clipboard->srv_request_pending = TRUE;
+		clipboard->srv_request_stale = FALSE;
+		clipboard->srv_request_format = info;
 		clipboard->srv_clip_data_wait = SCDW_BUSY_WAIT;	// Annotate that we are waiting for ServerFormatDataResponse
 
-		REMMINA_PLUGIN_DEBUG("gp=%p Requesting clipboard data with format %d from the server via ServerFormatDataRequest", gp, clipboard->format);
+		REMMINA_PLUGIN_DEBUG("gp=%p Requesting clipboard data with format %d from the server via ServerFormatDataRequest", gp, info);
 		rdp_event.type = REMMINA_RDP_EVENT_TYPE_CLIPBOARD_SEND_CLIENT_FORMAT_DATA_REQUEST;
 		rdp_event.clipboard_formatdatarequest.pFormatDataRequest = pFormatDataRequest;
 		remmina_rdp_event_event_push(gp, &rdp_event);
 
-		/* Busy wait clipboard data for CLIPBOARD_TRANSFER_WAIT_TIME seconds.
-		*      In the meanwhile allow GTK event loop to proceed */
-
-		tstart = time(NULL);
-		tlimit = tstart + CLIPBOARD_TRANSFER_WAIT_TIME;
-		rc = 100000;
-		tlimit1s = tstart + 1;
-		while ((tnow = time(NULL)) < tlimit && rc != 0 && clipboard->srv_clip_data_wait == SCDW_BUSY_WAIT) {
-
-			if (tnow >= tlimit1s) {
-				REMMINA_PLUGIN_DEBUG("gp=%p, clipboard data is still not here after %u seconds", gp, (unsigned)(tnow - tstart));
-				tlimit1s = time(NULL) + 1;
-			}
-
-			gettimeofday(&tv, NULL);
-			to.tv_sec = tv.tv_sec;
-			to.tv_nsec = tv.tv_usec * 1000 + 5000000;      // wait for data for 5ms
-			if (to.tv_nsec >= 1000000000) {
-				to.tv_nsec -= 1000000000;
-				to.tv_sec++;
-			}
-			rc = pthread_cond_timedwait(&clipboard->transfer_clip_cond, &clipboard->transfer_clip_mutex, &to);
-			if (rc == 0)
-				break;
-
-			gtk_main_iteration_do(FALSE);
-		}
-
-		if (rc != 0) {
-			/* Timeout, just log it and hope that data will arrive later */
-			if (clipboard->srv_clip_data_wait == SCDW_ABORTING) {
-				g_warning("[RDP] gp=%p Clipboard data wait aborted.",gp);
-			} else {
-				if (rc == ETIMEDOUT)
-					g_warning("[RDP] gp=%p Clipboard data from the server is not available in %d seconds. No data will be available to user.",
-						gp, CLIPBOARD_TRANSFER_WAIT_TIME);
-				else
-					g_warning("[RDP] gp=%p internal error: pthread_cond_timedwait() returned %d\n", gp, rc);
-			}
-		}
-
-		pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
-
+		remmina_rdp_cliprdr_wait_data(gp, clipboard);
 	}
 
-	if (clipboard->srv_data != NULL) {
+	if (clipboard->srv_data != NULL && clipboard->format == info) {
 		REMMINA_PLUGIN_DEBUG("gp=%p pasting data to local application", gp);
 		/* We have data in cache, just paste it */
 		if (info == CB_FORMAT_PNG || info == CF_DIB || info == CF_DIBV5 || info == CB_FORMAT_JPEG) {
@@ -642,11 +696,11 @@ void remmina_rdp_cliprdr_request_data(GtkClipboard *gtkClipboard, GtkSelectionDa
 			REMMINA_PLUGIN_DEBUG("gp=%p returning %zu bytes of text in clipboard to requesting application", gp, strlen(clipboard->srv_data));
 			gtk_selection_data_set_text(selection_data, clipboard->srv_data, -1);
 		}
-		clipboard->srv_clip_data_wait = SCDW_NONE;
 	} else {
 		REMMINA_PLUGIN_DEBUG("gp=%p cannot paste data to local application because ->srv_data is NULL", gp);
 	}
 
+	pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
 }
 
 void remmina_rdp_cliprdr_empty_clipboard(GtkClipboard *gtkClipboard, rfClipboard *clipboard)
@@ -725,98 +779,189 @@ static void remmina_rdp_cliprdr_mt_get_format_list(RemminaProtocolWidget *gp, Re
 	ui->retptr = (void *)remmina_rdp_cliprdr_get_client_format_list(gp);
 }
 
+static void remmina_rdp_cliprdr_send_data_response(RemminaProtocolWidget *gp, UINT8 *data, int size)
+{
+	TRACE_CALL(__func__);
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+	RemminaPluginRdpEvent rdp_event = { 0 };
+
+	if (!rfi || !rfi->connected || rfi->is_reconnecting) {
+		free(data);
+		return;
+	}
+
+	rdp_event.type = REMMINA_RDP_EVENT_TYPE_CLIPBOARD_SEND_CLIENT_FORMAT_DATA_RESPONSE;
+	rdp_event.clipboard_formatdataresponse.data = data;
+	rdp_event.clipboard_formatdataresponse.size = size;
+	remmina_rdp_event_event_push(gp, &rdp_event);
+}
+
+static void remmina_rdp_cliprdr_conversion_free(rfClipboardConversion *conv)
+{
+	TRACE_CALL(__func__);
+	g_object_unref(conv->gp);
+	g_free(conv->text);
+	if (conv->image)
+		g_object_unref(conv->image);
+	free(conv->outbuf);
+	g_free(conv);
+}
+
+/* Encode the image in the format requested by the server only */
+static UINT8 *remmina_rdp_cliprdr_encode_image(GdkPixbuf *image, const gchar *type, gsize skip, int *size)
+{
+	TRACE_CALL(__func__);
+	gchar *data;
+	gsize buffersize;
+	UINT8 *outbuf;
+
+	if (!gdk_pixbuf_save_to_buffer(image, &data, &buffersize, type, NULL, NULL))
+		return NULL;
+	if (buffersize <= skip) {
+		g_free(data);
+		return NULL;
+	}
+	*size = buffersize - skip;
+	outbuf = (UINT8 *)malloc(*size);
+	if (outbuf)
+		memcpy(outbuf, data + skip, *size);
+	g_free(data);
+
+	return outbuf;
+}
+
+static void remmina_rdp_cliprdr_conversion_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	TRACE_CALL(__func__);
+	rfClipboardConversion *conv = task_data;
+	UINT8 *inbuf;
+	int size = 0;
+
+	switch (conv->format) {
+	case CF_TEXT:
+	case CB_FORMAT_HTML:
+	{
+		size = strlen(conv->text);
+		conv->outbuf = lf2crlf((UINT8 *)conv->text, &size);
+		break;
+	}
+	case CF_UNICODETEXT:
+	{
+		size = strlen(conv->text);
+		inbuf = lf2crlf((UINT8 *)conv->text, &size);
+		size = (ConvertToUnicode(CP_UTF8, 0, (CHAR *)inbuf, -1, (WCHAR **)&conv->outbuf, 0)) * sizeof(WCHAR);
+		free(inbuf);
+		break;
+	}
+	case CB_FORMAT_PNG:
+		conv->outbuf = remmina_rdp_cliprdr_encode_image(conv->image, "png", 0, &size);
+		break;
+	case CB_FORMAT_JPEG:
+		conv->outbuf = remmina_rdp_cliprdr_encode_image(conv->image, "jpeg", 0, &size);
+		break;
+	case CF_DIB:
+	case CF_DIBV5:
+		/* Without the BITMAPFILEHEADER */
+		conv->outbuf = remmina_rdp_cliprdr_encode_image(conv->image, "bmp", 14, &size);
+		break;
+	}
+	conv->size = conv->outbuf ? size : 0;
+
+	g_task_return_boolean(task, TRUE);
+}
+
+static void remmina_rdp_cliprdr_conversion_done(GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	rfClipboardConversion *conv = g_task_get_task_data(G_TASK(result));
+
+	REMMINA_PLUGIN_DEBUG("gp=%p: sending %d bytes of local clipboard data with format %d to the server", conv->gp, conv->size, conv->format);
+	remmina_rdp_cliprdr_send_data_response(conv->gp, conv->outbuf, conv->size);
+	conv->outbuf = NULL;
+}
+
+/* The local clipboard content arrived, convert it in a worker */
+static void remmina_rdp_cliprdr_convert(rfClipboardConversion *conv)
+{
+	TRACE_CALL(__func__);
+	GTask *task;
+	gsize size;
+
+	size = 0;
+	if (conv->text)
+		size = strlen(conv->text);
+	else if (conv->image)
+		size = (gsize)gdk_pixbuf_get_rowstride(conv->image) * gdk_pixbuf_get_height(conv->image);
+
+	if (size == 0 || size > CLIPBOARD_MAX_SIZE) {
+		if (size > CLIPBOARD_MAX_SIZE)
+			REMMINA_PLUGIN_DEBUG("gp=%p: %zu bytes of local clipboard data exceed the limit of %d, not sending them", conv->gp, size, CLIPBOARD_MAX_SIZE);
+		/* No data, send nothing */
+		remmina_rdp_cliprdr_send_data_response(conv->gp, NULL, 0);
+		remmina_rdp_cliprdr_conversion_free(conv);
+		return;
+	}
+
+	task = g_task_new(NULL, NULL, remmina_rdp_cliprdr_conversion_done, NULL);
+	g_task_set_task_data(task, conv, (GDestroyNotify)remmina_rdp_cliprdr_conversion_free);
+	g_task_run_in_thread(task, remmina_rdp_cliprdr_conversion_thread);
+	g_object_unref(task);
+}
+
+static void remmina_rdp_cliprdr_text_received(GtkClipboard *gtkClipboard, const gchar *text, gpointer data)
+{
+	TRACE_CALL(__func__);
+	rfClipboardConversion *conv = data;
+
+	conv->text = g_strdup(text);
+	remmina_rdp_cliprdr_convert(conv);
+}
+
+static void remmina_rdp_cliprdr_image_received(GtkClipboard *gtkClipboard, GdkPixbuf *pixbuf, gpointer data)
+{
+	TRACE_CALL(__func__);
+	rfClipboardConversion *conv = data;
+
+	if (pixbuf)
+		conv->image = g_object_ref(pixbuf);
+	remmina_rdp_cliprdr_convert(conv);
+}
+
 void remmina_rdp_cliprdr_get_clipboard_data(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *ui)
 {
 	TRACE_CALL(__func__);
+
+	/* The server asked for the local clipboard content: request it from
+	 * the local owner without blocking, the response is sent when it
+	 * arrives and is converted */
+
 	GtkClipboard *gtkClipboard;
-	UINT8 *inbuf = NULL;
-	UINT8 *outbuf = NULL;
-	GdkPixbuf *image = NULL;
-	int size = 0;
+	rfClipboardConversion *conv;
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
-	RemminaPluginRdpEvent rdp_event = { 0 };
+
+	conv = g_new0(rfClipboardConversion, 1);
+	conv->gp = g_object_ref(gp);
+	conv->format = ui->clipboard.format;
 
 	gtkClipboard = gtk_widget_get_clipboard(rfi->drawing_area, GDK_SELECTION_CLIPBOARD);
 	if (gtkClipboard) {
-		switch (ui->clipboard.format) {
+		switch (conv->format) {
 		case CF_TEXT:
 		case CF_UNICODETEXT:
 		case CB_FORMAT_HTML:
-		{
-			inbuf = (UINT8 *)gtk_clipboard_wait_for_text(gtkClipboard);
-			break;
-		}
+			gtk_clipboard_request_text(gtkClipboard, remmina_rdp_cliprdr_text_received, conv);
+			return;
 
 		case CB_FORMAT_PNG:
 		case CB_FORMAT_JPEG:
 		case CF_DIB:
 		case CF_DIBV5:
-		{
-			image = gtk_clipboard_wait_for_image(gtkClipboard);
-			break;
-		}
+			gtk_clipboard_request_image(gtkClipboard, remmina_rdp_cliprdr_image_received, conv);
+			return;
 		}
 	}
 
-	/* No data received, send nothing */
-	if (inbuf != NULL || image != NULL) {
-		switch (ui->clipboard.format) {
-		case CF_TEXT:
-		case CB_FORMAT_HTML:
-		{
-			size = strlen((char *)inbuf);
-			outbuf = lf2crlf(inbuf, &size);
-			break;
-		}
-		case CF_UNICODETEXT:
-		{
-			size = strlen((char *)inbuf);
-			inbuf = lf2crlf(inbuf, &size);
-			size = (ConvertToUnicode(CP_UTF8, 0, (CHAR *)inbuf, -1, (WCHAR **)&outbuf, 0)) * sizeof(WCHAR);
-			g_free(inbuf);
-			break;
-		}
-		case CB_FORMAT_PNG:
-		{
-			gchar *data;
-			gsize buffersize;
-			gdk_pixbuf_save_to_buffer(image, &data, &buffersize, "png", NULL, NULL);
-			outbuf = (UINT8 *)malloc(buffersize);
-			memcpy(outbuf, data, buffersize);
-			size = buffersize;
-			g_object_unref(image);
-			break;
-		}
-		case CB_FORMAT_JPEG:
-		{
-			gchar *data;
-			gsize buffersize;
-			gdk_pixbuf_save_to_buffer(image, &data, &buffersize, "jpeg", NULL, NULL);
-			outbuf = (UINT8 *)malloc(buffersize);
-			memcpy(outbuf, data, buffersize);
-			size = buffersize;
-			g_object_unref(image);
-			break;
-		}
-		case CF_DIB:
-		case CF_DIBV5:
-		{
-			gchar *data;
-			gsize buffersize;
-			gdk_pixbuf_save_to_buffer(image, &data, &buffersize, "bmp", NULL, NULL);
-			size = buffersize - 14;
-			outbuf = (UINT8 *)malloc(size);
-			memcpy(outbuf, data + 14, size);
-			g_object_unref(image);
-			break;
-		}
-		}
-	}
-
-	rdp_event.type = REMMINA_RDP_EVENT_TYPE_CLIPBOARD_SEND_CLIENT_FORMAT_DATA_RESPONSE;
-	rdp_event.clipboard_formatdataresponse.data = outbuf;
-	rdp_event.clipboard_formatdataresponse.size = size;
-	remmina_rdp_event_event_push(gp, &rdp_event);
+	remmina_rdp_cliprdr_convert(conv);
 }
 
 void remmina_rdp_cliprdr_set_clipboard_content(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *ui)
@@ -908,19 +1053,43 @@ void remmina_rdp_clipboard_free(rfContext *rfi)
 {
 	TRACE_CALL(__func__);
 
+	pthread_mutex_lock(&rfi->clipboard.transfer_clip_mutex);
 	remmina_rdp_cliprdr_cached_clipboard_free(&(rfi->clipboard));
+	pthread_mutex_unlock(&rfi->clipboard.transfer_clip_mutex);
 
 }
 
 void remmina_rdp_clipboard_abort_client_format_data_request(rfContext *rfi)
 {
 	TRACE_CALL(__func__);
-	if (rfi && rfi->clipboard.srv_clip_data_wait == SCDW_BUSY_WAIT) {
-		REMMINA_PLUGIN_DEBUG("requesting clipboard data transfer from server to be ignored and busywait loop to exit");
-		/* Allow clipboard transfer from server to terminate */
-		rfi->clipboard.srv_clip_data_wait = SCDW_ABORTING;
-		usleep(100000);
+	rfClipboard *clipboard;
+
+	if (!rfi || !rfi->clipboard.context)
+		return;
+
+	clipboard = &(rfi->clipboard);
+	pthread_mutex_lock(&clipboard->transfer_clip_mutex);
+	if (clipboard->srv_clip_data_wait == SCDW_BUSY_WAIT) {
+		REMMINA_PLUGIN_DEBUG("requesting the paste waiting for clipboard data from server to give up");
+		clipboard->srv_clip_data_wait = SCDW_ABORTING;
+		pthread_cond_signal(&clipboard->transfer_clip_cond);
 	}
+	pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
+}
+
+/* Called by the threads queueing UI objects, which a paste blocking the
+ * GTK thread has to process */
+void remmina_rdp_cliprdr_wake(rfClipboard *clipboard)
+{
+	TRACE_CALL(__func__);
+
+	if (!clipboard->context || clipboard->srv_clip_data_wait != SCDW_BUSY_WAIT)
+		return;
+
+	pthread_mutex_lock(&clipboard->transfer_clip_mutex);
+	clipboard->srv_clip_ui_wake = TRUE;
+	pthread_cond_signal(&clipboard->transfer_clip_cond);
+	pthread_mutex_unlock(&clipboard->transfer_clip_mutex);
 }
 
 void remmina_rdp_cliprdr_init(rfContext *rfi, CliprdrClientContext *cliprdr)
@@ -937,6 +1106,10 @@ void remmina_rdp_cliprdr_init(rfContext *rfi, CliprdrClientContext *cliprdr)
 	pthread_mutex_init(&clipboard->transfer_clip_mutex, NULL);
 	pthread_cond_init(&clipboard->transfer_clip_cond, NULL);
 	clipboard->srv_clip_data_wait = SCDW_NONE;
+	clipboard->srv_clip_ui_wake = FALSE;
+	clipboard->srv_request_pending = FALSE;
+	clipboard->srv_request_stale = FALSE;
+	clipboard->srv_request_abandoned = 0;
 
 	cliprdr->MonitorReady = remmina_rdp_cliprdr_monitor_ready;
 	cliprdr->ServerCapabilities = remmina_rdp_cliprdr_server_capabilities;
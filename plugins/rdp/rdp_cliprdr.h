@@ -49,3 +49,4 @@ void remmina_rdp_event_process_clipboard(RemminaProtocolWidget *gp, RemminaPlugi
 CLIPRDR_FORMAT_LIST *remmina_rdp_cliprdr_get_client_format_list(RemminaProtocolWidget *gp);
 void remmina_rdp_cliprdr_detach_owner(RemminaProtocolWidget *gp);
 void remmina_rdp_clipboard_abort_client_format_data_request(rfContext *rfi);
+void remmina_rdp_cliprdr_wake(rfClipboard *clipboard);
@@ -44,47 +44,34 @@
 #include <gdk/gdkkeysyms.h>
 #include <cairo/cairo-xlib.h>
 #include <freerdp/locale/keyboard.h>
+#include <errno.h>
+#include <time.h>
 
-gboolean remmina_rdp_event_on_map(RemminaProtocolWidget *gp)
+/* Stop the server from sending screen updates while the session is hidden,
+ * it sends a full refresh when output is enabled again */
+static void remmina_rdp_event_suppress_output(RemminaProtocolWidget *gp, gboolean suppress)
 {
 	TRACE_CALL(__func__);
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
-	rdpGdi *gdi;
-
-	if (rfi == NULL)
-		return false;
+	GdkWindow *window;
 
-	gdi = ((rdpContext *)rfi)->gdi;
+	if (rfi == NULL || !rfi->connected || rfi->is_reconnecting)
+		return;
 
-	REMMINA_PLUGIN_DEBUG("Map event received, disabling TS_SUPPRESS_OUTPUT_PDU ");
-	gdi_send_suppress_output(gdi, FALSE);
+	window = gtk_widget_get_window(gtk_widget_get_toplevel(GTK_WIDGET(gp)));
+	if (suppress && window && gdk_window_get_fullscreen_mode(window) == GDK_FULLSCREEN_ON_ALL_MONITORS) {
+		REMMINA_PLUGIN_DEBUG("Cannot enable TS_SUPPRESS_OUTPUT_PDU when in fullscreen");
+		return;
+	}
 
-	return FALSE;
+	REMMINA_PLUGIN_DEBUG("%s TS_SUPPRESS_OUTPUT_PDU", suppress ? "Enabling" : "Disabling");
+	gdi_send_suppress_output(((rdpContext *)rfi)->gdi, suppress);
 }
 
-gboolean remmina_rdp_event_on_unmap(RemminaProtocolWidget *gp)
+static void remmina_rdp_event_on_visibility_changed(RemminaProtocolWidget *gp, gpointer data)
 {
 	TRACE_CALL(__func__);
-	rfContext *rfi = GET_PLUGIN_DATA(gp);
-	rdpGdi *gdi;
-
-	if (rfi == NULL)
-		return false;
-
-	GtkWidget *toplevel = gtk_widget_get_toplevel(GTK_WIDGET(gp));
-	GdkWindow *window = gtk_widget_get_window(toplevel);
-
-	if (gdk_window_get_fullscreen_mode(window) == GDK_FULLSCREEN_ON_ALL_MONITORS) {
-		REMMINA_PLUGIN_DEBUG("Unmap event received, but cannot enable TS_SUPPRESS_OUTPUT_PDU when in fullscreen");
-		return FALSE;
-	}
-
-	gdi = ((rdpContext *)rfi)->gdi;
-
-	REMMINA_PLUGIN_DEBUG("Unmap event received, enabling TS_SUPPRESS_OUTPUT_PDU ");
-	gdi_send_suppress_output(gdi, TRUE);
-
-	return FALSE;
+	remmina_rdp_event_suppress_output(gp, !remmina_plugin_service->protocol_plugin_get_visibility(gp));
 }
 
 static gboolean remmina_rdp_event_on_focus_in(GtkWidget *widget, GdkEventKey *event, RemminaProtocolWidget *gp)
@@ -133,24 +120,159 @@ static gboolean remmina_rdp_event_on_focus_in(GtkWidget *widget, GdkEventKey *ev
 	return FALSE;
 }
 
+static gboolean remmina_rdp_event_ring_put(rfContext *rfi, const RemminaPluginRdpEvent *e)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginRdpEventRing *ring = rfi->event_ring;
+	guint head, tail;
+
+	head = (guint)g_atomic_int_get(&ring->head);
+	tail = (guint)g_atomic_int_get(&ring->tail);
+
+	if (head - tail >= REMMINA_RDP_EVENT_RING_SIZE)
+		return FALSE;
+
+	ring->events[head & (REMMINA_RDP_EVENT_RING_SIZE - 1)] = *e;
+	/* Publish the slot to the consumer */
+	g_atomic_int_set(&ring->head, (gint)(head + 1));
+
+	return TRUE;
+}
+
+static void remmina_rdp_event_ring_wakeup(rfContext *rfi)
+{
+	TRACE_CALL(__func__);
+
+	/* Only the first event of a batch wakes up the libfreerdp thread */
+	if (g_atomic_int_compare_and_exchange(&rfi->event_ring->wakeup_pending, 0, 1))
+		SetEvent(rfi->event_handle);
+}
+
+static gboolean remmina_rdp_event_ring_flush_overflow(rfContext *rfi)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginRdpEventRing *ring = rfi->event_ring;
+	RemminaPluginRdpEvent *event;
+	gboolean pushed = FALSE;
+
+	while ((event = g_queue_peek_head(ring->overflow)) != NULL) {
+		if (!remmina_rdp_event_ring_put(rfi, event))
+			break;
+		g_free(g_queue_pop_head(ring->overflow));
+		pushed = TRUE;
+	}
+	if (pushed)
+		remmina_rdp_event_ring_wakeup(rfi);
+
+	return g_queue_is_empty(ring->overflow) ? FALSE : TRUE;
+}
+
+static gboolean remmina_rdp_event_ring_overflow_retry(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+
+	if (!rfi || !rfi->event_ring)
+		return FALSE;
+
+	if (remmina_rdp_event_ring_flush_overflow(rfi))
+		return TRUE;
+
+	rfi->event_ring->overflow_handler = 0;
+	return FALSE;
+}
+
+typedef struct {
+	RemminaProtocolWidget *	gp;
+	RemminaPluginRdpEvent	event;
+} RemminaPluginRdpEventPushData;
+
+static gboolean remmina_rdp_event_event_push_on_main_thread(gpointer data)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginRdpEventPushData *d = (RemminaPluginRdpEventPushData *)data;
+
+	remmina_rdp_event_event_push(d->gp, &d->event);
+	g_object_unref(d->gp);
+	g_free(d);
+	return FALSE;
+}
+
 void remmina_rdp_event_event_push(RemminaProtocolWidget *gp, const RemminaPluginRdpEvent *e)
 {
 	TRACE_CALL(__func__);
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
-	RemminaPluginRdpEvent *event;
+	RemminaPluginRdpEventRing *ring;
+	RemminaPluginRdpEventPushData *d;
 
 	/* Called by the main GTK thread to send an event to the libfreerdp thread */
 
 	if (!rfi || !rfi->connected || rfi->is_reconnecting)
 		return;
 
-	if (rfi->event_queue) {
-		event = g_memdup(e, sizeof(RemminaPluginRdpEvent));
-		g_async_queue_push(rfi->event_queue, event);
+	if (!rfi->event_ring || !rfi->event_handle)
+		return;
 
-		if (write(rfi->event_pipe[1], "\0", 1)) {
-		}
+	if (!remmina_plugin_service->is_main_thread()) {
+		/* The ring has a single producer: the few events generated by
+		 * other threads (i.e. clipboard channel callbacks) are forwarded
+		 * to the GTK thread */
+		d = g_new(RemminaPluginRdpEventPushData, 1);
+		d->gp = g_object_ref(gp);
+		d->event = *e;
+		IDLE_ADD(remmina_rdp_event_event_push_on_main_thread, d);
+		return;
+	}
+
+	ring = rfi->event_ring;
+
+	/* Keep events ordered: when a backlog exists, the new event goes after it */
+	if (g_queue_is_empty(ring->overflow) && remmina_rdp_event_ring_put(rfi, e)) {
+		remmina_rdp_event_ring_wakeup(rfi);
+		return;
 	}
+
+	g_queue_push_tail(ring->overflow, g_memdup(e, sizeof(RemminaPluginRdpEvent)));
+	if (remmina_rdp_event_ring_flush_overflow(rfi) && !ring->overflow_handler)
+		ring->overflow_handler = g_timeout_add(10, (GSourceFunc)remmina_rdp_event_ring_overflow_retry, gp);
+}
+
+gboolean remmina_rdp_event_event_pop(rfContext *rfi, RemminaPluginRdpEvent *e)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginRdpEventRing *ring = rfi->event_ring;
+	guint head, tail;
+
+	/* Called by the libfreerdp thread, the only consumer of the ring */
+
+	if (!ring)
+		return FALSE;
+
+	tail = (guint)g_atomic_int_get(&ring->tail);
+	head = (guint)g_atomic_int_get(&ring->head);
+
+	if (tail == head)
+		return FALSE;
+
+	*e = ring->events[tail & (REMMINA_RDP_EVENT_RING_SIZE - 1)];
+	/* Give the slot back to the producer */
+	g_atomic_int_set(&ring->tail, (gint)(tail + 1));
+
+	return TRUE;
+}
+
+void remmina_rdp_event_event_ack(rfContext *rfi)
+{
+	TRACE_CALL(__func__);
+
+	/* Called by the libfreerdp thread before draining the ring. Events
+	 * pushed after this point will signal event_handle again */
+
+	if (!rfi->event_ring)
+		return;
+
+	ResetEvent(rfi->event_handle);
+	g_atomic_int_set(&rfi->event_ring->wakeup_pending, 0);
 }
 
 static void remmina_rdp_event_release_all_keys(RemminaProtocolWidget *gp)
@@ -260,33 +382,200 @@ static void remmina_rdp_event_scale_area(RemminaProtocolWidget *gp, gint *x, gin
 	*h = sh;
 }
 
-void remmina_rdp_event_update_regions(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *ui)
+static inline void remmina_rdp_event_region_union(region *dst, const region *src)
+{
+	gint x2, y2;
+
+	x2 = MAX(dst->x + dst->w, src->x + src->w);
+	y2 = MAX(dst->y + dst->h, src->y + src->h);
+	dst->x = MIN(dst->x, src->x);
+	dst->y = MIN(dst->y, src->y);
+	dst->w = x2 - dst->x;
+	dst->h = y2 - dst->y;
+}
+
+static inline gboolean remmina_rdp_event_region_touches(const region *a, const region *b)
+{
+	return a->x <= b->x + b->w && b->x <= a->x + a->w &&
+	       a->y <= b->y + b->h && b->y <= a->y + a->h;
+}
+
+static void remmina_rdp_event_damage_add(RemminaPluginRdpDamage *damage, const region *r)
+{
+	region cur, u;
+	gint i, best;
+	gint64 cost, best_cost;
+
+	if (r->w <= 0 || r->h <= 0)
+		return;
+
+	/* Absorb all the rectangles touching the new one. The union can
+	 * touch rectangles which were disjoint before, so restart the scan */
+	cur = *r;
+	i = 0;
+	while (i < damage->nrects) {
+		if (remmina_rdp_event_region_touches(&damage->rects[i], &cur)) {
+			remmina_rdp_event_region_union(&cur, &damage->rects[i]);
+			damage->rects[i] = damage->rects[--damage->nrects];
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+
+	if (damage->nrects < REMMINA_RDP_DAMAGE_MAX_RECTS) {
+		damage->rects[damage->nrects++] = cur;
+		return;
+	}
+
+	/* The set is full, grow the rectangle which adds the smallest area */
+	best = 0;
+	best_cost = G_MAXINT64;
+	for (i = 0; i < damage->nrects; i++) {
+		u = damage->rects[i];
+		remmina_rdp_event_region_union(&u, &cur);
+		cost = (gint64)u.w * u.h - (gint64)damage->rects[i].w * damage->rects[i].h;
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = i;
+		}
+	}
+	remmina_rdp_event_region_union(&damage->rects[best], &cur);
+}
+
+void remmina_rdp_event_queue_damage(RemminaProtocolWidget *gp, const GDI_RGN *cinvalid, gint ninvalid)
+{
+	TRACE_CALL(__func__);
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+	RemminaPluginRdpDamage *damage;
+	region r;
+	gint i;
+
+	/* Called by the libfreerdp thread at the end of each paint */
+
+	if (!rfi || rfi->thread_cancelled)
+		return;
+
+	pthread_mutex_lock(&rfi->damage_mutex);
+	damage = &rfi->damage[rfi->damage_write];
+	for (i = 0; i < ninvalid; i++) {
+		r.x = cinvalid[i].x;
+		r.y = cinvalid[i].y;
+		r.w = cinvalid[i].w;
+		r.h = cinvalid[i].h;
+		remmina_rdp_event_damage_add(damage, &r);
+	}
+	/* Wake up the GTK thread, without allocating a new idle source.
+	 * If the damage is already waiting for its frame, it will be
+	 * presented together with the previous one */
+	if (rfi->damage_source && damage->nrects > 0 && !rfi->damage_armed) {
+		rfi->damage_armed = TRUE;
+		g_source_set_ready_time(rfi->damage_source, 0);
+	}
+	pthread_mutex_unlock(&rfi->damage_mutex);
+}
+
+static void remmina_rdp_event_flush_damage(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
+	RemminaPluginRdpDamage *damage;
 	gint x, y, w, h, i;
 
-	for (i = 0; i < ui->reg.ninvalid; i++) {
-		x = ui->reg.ureg[i].x;
-		y = ui->reg.ureg[i].y;
-		w = ui->reg.ureg[i].w;
-		h = ui->reg.ureg[i].h;
+	if (!rfi)
+		return;
+
+	if (rfi->pacer)
+		remmina_plugin_frame_pacer_presented(rfi->pacer);
+
+	/* Take the accumulated damage and let the libfreerdp thread continue
+	 * on the other (empty) buffer */
+	pthread_mutex_lock(&rfi->damage_mutex);
+	damage = &rfi->damage[rfi->damage_write];
+	rfi->damage_write ^= 1;
+	rfi->damage_armed = FALSE;
+	pthread_mutex_unlock(&rfi->damage_mutex);
+
+	if (!rfi->thread_cancelled && rfi->drawing_area) {
+		for (i = 0; i < damage->nrects; i++) {
+			x = damage->rects[i].x;
+			y = damage->rects[i].y;
+			w = damage->rects[i].w;
+			h = damage->rects[i].h;
+
+			if (rfi->scale == REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED) {
+				remmina_rdp_event_scale_area(gp, &x, &y, &w, &h);
+				remmina_plugin_scaler_damage(rfi->scaler, x, y, w, h);
+			}
+
+			gtk_widget_queue_draw_area(rfi->drawing_area, x, y, w, h);
+		}
+	}
+	damage->nrects = 0;
+}
 
-		if (rfi->scale == REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED)
-			remmina_rdp_event_scale_area(gp, &x, &y, &w, &h);
+static gboolean remmina_rdp_event_damage_ready(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+	gint64 delay;
 
-		gtk_widget_queue_draw_area(rfi->drawing_area, x, y, w, h);
+	if (!rfi)
+		return G_SOURCE_CONTINUE;
+
+	if (rfi->thread_cancelled || !rfi->drawing_area) {
+		remmina_rdp_event_flush_damage(gp);
+		return G_SOURCE_CONTINUE;
 	}
-	g_free(ui->reg.ureg);
+
+	delay = remmina_plugin_frame_pacer_get_delay(rfi->pacer, rfi->drawing_area, FALSE);
+	if (delay > 0)
+		/* Too early, come back when the frame is due */
+		g_source_set_ready_time(rfi->damage_source, g_get_monotonic_time() + delay);
+	else
+		remmina_plugin_frame_pacer_request(rfi->pacer);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void remmina_rdp_event_on_realize(GtkWidget *widget, RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+
+	if (rfi && rfi->pacer)
+		remmina_plugin_frame_pacer_attach(rfi->pacer, widget);
+}
+
+static void remmina_rdp_event_on_unrealize(GtkWidget *widget, RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+
+	if (rfi && rfi->pacer)
+		remmina_plugin_frame_pacer_detach(rfi->pacer);
 }
 
+static gboolean remmina_rdp_event_damage_source_dispatch(GSource *source, GSourceFunc callback, gpointer user_data)
+{
+	/* Rearm: the source is ready again only when new damage is queued */
+	g_source_set_ready_time(source, -1);
+	return callback(user_data);
+}
+
+static GSourceFuncs remmina_rdp_event_damage_source_funcs = {
+	NULL, NULL, remmina_rdp_event_damage_source_dispatch, NULL
+};
+
 void remmina_rdp_event_update_rect(RemminaProtocolWidget *gp, gint x, gint y, gint w, gint h)
 {
 	TRACE_CALL(__func__);
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
 
-	if (rfi->scale == REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED)
+	if (rfi->scale == REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED) {
 		remmina_rdp_event_scale_area(gp, &x, &y, &w, &h);
+		remmina_plugin_scaler_damage(rfi->scaler, x, y, w, h);
+	}
 
 	gtk_widget_queue_draw_area(rfi->drawing_area, x, y, w, h);
 }
@@ -303,6 +592,10 @@ static void remmina_rdp_event_update_scale_factor(RemminaProtocolWidget *gp)
 	gpwidth = a.width;
 	gpheight = a.height;
 
+	/* The scaled copy is rebuilt at the next draw */
+	if (rfi->scale != REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED || rfi->scale_width != gpwidth || rfi->scale_height != gpheight)
+		remmina_plugin_scaler_invalidate(rfi->scaler);
+
 	if (rfi->scale == REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED) {
 		if ((gpwidth > 1) && (gpheight > 1)) {
 			rdwidth = remmina_plugin_service->protocol_plugin_get_width(gp);
@@ -329,6 +622,7 @@ static gboolean remmina_rdp_event_on_draw(GtkWidget *widget, cairo_t *context, R
 	guint width, height;
 	gchar *msg;
 	cairo_text_extents_t extents;
+	cairo_surface_t *surface;
 
 	if (!rfi || !rfi->connected)
 		return FALSE;
@@ -357,10 +651,20 @@ static gboolean remmina_rdp_event_on_draw(GtkWidget *widget, cairo_t *context, R
 		if (!rfi->surface)
 			return FALSE;
 
-		if (rfi->scale == REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED)
-			cairo_scale(context, rfi->scale_x, rfi->scale_y);
+		surface = rfi->surface;
+		if (rfi->scale == REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED &&
+		    (rfi->scale_width != cairo_image_surface_get_width(rfi->surface) ||
+		     rfi->scale_height != cairo_image_surface_get_height(rfi->surface))) {
+			/* Only the damaged areas are resampled, then painted 1:1 */
+			surface = remmina_plugin_scaler_update(rfi->scaler, rfi->surface, rfi->scale_width, rfi->scale_height,
+							       remmina_plugin_service->pref_get_scale_quality());
+			if (!surface) {
+				surface = rfi->surface;
+				cairo_scale(context, rfi->scale_x, rfi->scale_y);
+			}
+		}
 
-		cairo_set_source_surface(context, rfi->surface, 0, 0);
+		cairo_set_source_surface(context, surface, 0, 0);
 
 		cairo_set_operator(context, CAIRO_OPERATOR_SOURCE);     // Ignore alpha channel from FreeRDP
 		cairo_paint(context);
@@ -852,7 +1156,6 @@ void remmina_rdp_event_init(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
 	gchar *s;
-	gint flags;
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
 	GtkClipboard *clipboard;
 	RemminaFile *remminafile;
@@ -917,16 +1220,13 @@ void remmina_rdp_event_init(RemminaProtocolWidget *gp)
 			 G_CALLBACK(remmina_rdp_event_on_key), gp);
 	g_signal_connect(G_OBJECT(rfi->drawing_area), "focus-in-event",
 			 G_CALLBACK(remmina_rdp_event_on_focus_in), gp);
-	/** Fixme: This comment
-	 * needed for TS_SUPPRESS_OUTPUT_PDU
-	 * But it works only when we stay in the same window mode, if we switch to
-	 * fullscreen, for instance, the object refernce is lost, so we loose these
-	 * events.
-	 */
-	//g_signal_connect(G_OBJECT(gtk_widget_get_toplevel(rfi->drawing_area)), "map-event",
-	// G_CALLBACK(remmina_rdp_event_on_map), gp);
-	//g_signal_connect(G_OBJECT(gtk_widget_get_toplevel(rfi->drawing_area)), "unmap-event",
-	// G_CALLBACK(remmina_rdp_event_on_unmap), gp);
+	g_signal_connect(G_OBJECT(rfi->drawing_area), "realize",
+			 G_CALLBACK(remmina_rdp_event_on_realize), gp);
+	g_signal_connect(G_OBJECT(rfi->drawing_area), "unrealize",
+			 G_CALLBACK(remmina_rdp_event_on_unrealize), gp);
+	/* The connection window tracks tabs, iconify and fullscreen switches for us */
+	g_signal_connect(G_OBJECT(gp), "visibility-changed",
+			 G_CALLBACK(remmina_rdp_event_on_visibility_changed), NULL);
 
 	if (!remmina_plugin_service->file_get_int(remminafile, "disableclipboard", FALSE)) {
 		clipboard = gtk_widget_get_clipboard(rfi->drawing_area, GDK_SELECTION_CLIPBOARD);
@@ -934,22 +1234,36 @@ void remmina_rdp_event_init(RemminaProtocolWidget *gp)
 	}
 
 	rfi->pressed_keys = g_array_new(FALSE, TRUE, sizeof(RemminaPluginRdpEvent));
-	rfi->event_queue = g_async_queue_new_full(g_free);
+	rfi->event_ring = g_new0(RemminaPluginRdpEventRing, 1);
+	rfi->event_ring->overflow = g_queue_new();
 	rfi->ui_queue = g_async_queue_new();
 	pthread_mutex_init(&rfi->ui_queue_mutex, NULL);
 
-	if (pipe(rfi->event_pipe)) {
-		g_print("Error creating pipes.\n");
-		rfi->event_pipe[0] = -1;
-		rfi->event_pipe[1] = -1;
-		rfi->event_handle = NULL;
-	} else {
-		flags = fcntl(rfi->event_pipe[0], F_GETFL, 0);
-		fcntl(rfi->event_pipe[0], F_SETFL, flags | O_NONBLOCK);
-		rfi->event_handle = CreateFileDescriptorEvent(NULL, FALSE, FALSE, rfi->event_pipe[0], WINPR_FD_READ);
-		if (!rfi->event_handle)
-			g_print("CreateFileDescriptorEvent() failed\n");
-	}
+	pthread_mutex_init(&rfi->damage_mutex, NULL);
+	pthread_mutex_init(&rfi->framebuffer_mutex, NULL);
+	pthread_mutex_init(&rfi->framebuffer_wait_mutex, NULL);
+	pthread_cond_init(&rfi->framebuffer_wait_cond, NULL);
+	rfi->framebuffer_wake = 0;
+	rfi->scaler = remmina_plugin_scaler_new();
+	rfi->damage[0].nrects = 0;
+	rfi->damage[1].nrects = 0;
+	rfi->damage_write = 0;
+	rfi->damage_armed = FALSE;
+	rfi->pacer = remmina_plugin_frame_pacer_new(remmina_plugin_service->file_get_int(remminafile, "framerate_max", 0),
+						    (RemminaPluginFramePacerFunc)remmina_rdp_event_flush_damage, gp);
+	rfi->damage_source = g_source_new(&remmina_rdp_event_damage_source_funcs, sizeof(GSource));
+	g_source_set_priority(rfi->damage_source, G_PRIORITY_DEFAULT_IDLE);
+	g_source_set_callback(rfi->damage_source, (GSourceFunc)remmina_rdp_event_damage_ready, gp, NULL);
+	g_source_set_ready_time(rfi->damage_source, -1);
+	g_source_attach(rfi->damage_source, NULL);
+
+	/* Manual reset event, signaled once per batch of input events */
+	rfi->event_handle = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!rfi->event_handle)
+		g_print("CreateEvent() failed\n");
+	rfi->update_drained_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (!rfi->update_drained_event)
+		g_print("CreateEvent() failed\n");
 
 	rfi->object_table = g_hash_table_new_full(NULL, NULL, NULL, g_free);
 
@@ -1003,10 +1317,21 @@ void remmina_rdp_event_uninit(RemminaProtocolWidget *gp)
 	}
 	while ((ui = (RemminaPluginRdpUiObject *)g_async_queue_try_pop(rfi->ui_queue)) != NULL)
 		remmina_rdp_event_free_event(gp, ui);
+	remmina_plugin_frame_pacer_free(rfi->pacer);
+	rfi->pacer = NULL;
+	if (rfi->damage_source) {
+		pthread_mutex_lock(&rfi->damage_mutex);
+		g_source_destroy(rfi->damage_source);
+		g_source_unref(rfi->damage_source);
+		rfi->damage_source = NULL;
+		pthread_mutex_unlock(&rfi->damage_mutex);
+	}
 	if (rfi->surface) {
 		cairo_surface_destroy(rfi->surface);
 		rfi->surface = NULL;
 	}
+	remmina_plugin_scaler_free(rfi->scaler);
+	rfi->scaler = NULL;
 
 	g_hash_table_destroy(rfi->object_table);
 
@@ -1015,19 +1340,27 @@ void remmina_rdp_event_uninit(RemminaProtocolWidget *gp)
 		g_array_free(rfi->keymap, TRUE);
 		rfi->keymap = NULL;
 	}
-	g_async_queue_unref(rfi->event_queue);
-	rfi->event_queue = NULL;
+	if (rfi->event_ring->overflow_handler)
+		g_source_remove(rfi->event_ring->overflow_handler);
+	g_queue_free_full(rfi->event_ring->overflow, g_free);
+	g_free(rfi->event_ring);
+	rfi->event_ring = NULL;
 	g_async_queue_unref(rfi->ui_queue);
 	rfi->ui_queue = NULL;
 	pthread_mutex_destroy(&rfi->ui_queue_mutex);
+	pthread_mutex_destroy(&rfi->damage_mutex);
+	pthread_mutex_destroy(&rfi->framebuffer_mutex);
+	pthread_cond_destroy(&rfi->framebuffer_wait_cond);
+	pthread_mutex_destroy(&rfi->framebuffer_wait_mutex);
 
 	if (rfi->event_handle) {
 		CloseHandle(rfi->event_handle);
 		rfi->event_handle = NULL;
 	}
-
-	close(rfi->event_pipe[0]);
-	close(rfi->event_pipe[1]);
+	if (rfi->update_drained_event) {
+		CloseHandle(rfi->update_drained_event);
+		rfi->update_drained_event = NULL;
+	}
 }
 
 static void remmina_rdp_event_create_cairo_surface(rfContext *rfi)
@@ -1111,6 +1444,10 @@ static void remmina_rdp_event_connected(RemminaProtocolWidget *gp, RemminaPlugin
 
 	remmina_rdp_event_update_scale(gp);
 
+	/* Connected in a background tab or an iconified window */
+	if (!remmina_plugin_service->protocol_plugin_get_visibility(gp))
+		remmina_rdp_event_suppress_output(gp, TRUE);
+
 	remmina_plugin_service->protocol_plugin_signal_connection_opened(gp);
 }
 
@@ -1275,10 +1612,6 @@ static void remmina_rdp_event_process_ui_event(RemminaProtocolWidget *gp, Remmin
 {
 	TRACE_CALL(__func__);
 	switch (ui->type) {
-	case REMMINA_RDP_UI_UPDATE_REGIONS:
-		remmina_rdp_event_update_regions(gp, ui);
-		break;
-
 	case REMMINA_RDP_UI_CONNECTED:
 		remmina_rdp_event_connected(gp, ui);
 		break;
@@ -1304,6 +1637,26 @@ static void remmina_rdp_event_process_ui_event(RemminaProtocolWidget *gp, Remmin
 	}
 }
 
+/* Process an object popped from ui_queue, with ui_queue_mutex held */
+static void remmina_rdp_event_process_ui_object(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *ui)
+{
+	TRACE_CALL(__func__);
+
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+
+	pthread_mutex_lock(&ui->sync_wait_mutex);
+	if (!rfi->thread_cancelled)
+		remmina_rdp_event_process_ui_event(gp, ui);
+	// Should we signal the caller thread to unlock ?
+	if (ui->sync) {
+		ui->complete = TRUE;
+		pthread_cond_signal(&ui->sync_wait_cond);
+		pthread_mutex_unlock(&ui->sync_wait_mutex);
+	} else {
+		remmina_rdp_event_free_event(gp, ui);
+	}
+}
+
 static gboolean remmina_rdp_event_process_ui_queue(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
@@ -1314,18 +1667,7 @@ static gboolean remmina_rdp_event_process_ui_queue(RemminaProtocolWidget *gp)
 	pthread_mutex_lock(&rfi->ui_queue_mutex);
 	ui = (RemminaPluginRdpUiObject *)g_async_queue_try_pop(rfi->ui_queue);
 	if (ui) {
-		pthread_mutex_lock(&ui->sync_wait_mutex);
-		if (!rfi->thread_cancelled)
-			remmina_rdp_event_process_ui_event(gp, ui);
-		// Should we signal the caller thread to unlock ?
-		if (ui->sync) {
-			ui->complete = TRUE;
-			pthread_cond_signal(&ui->sync_wait_cond);
-			pthread_mutex_unlock(&ui->sync_wait_mutex);
-		} else {
-			remmina_rdp_event_free_event(gp, ui);
-		}
-
+		remmina_rdp_event_process_ui_object(gp, ui);
 		pthread_mutex_unlock(&rfi->ui_queue_mutex);
 		return TRUE;
 	} else {
@@ -1335,6 +1677,94 @@ static gboolean remmina_rdp_event_process_ui_queue(RemminaProtocolWidget *gp)
 	}
 }
 
+/* Process one queued UI object, if any, outside of the idle handler. Used by
+ * the main thread when it has to wait for the libfreerdp thread */
+gboolean remmina_rdp_event_process_ui_pending(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+	RemminaPluginRdpUiObject *ui;
+
+	pthread_mutex_lock(&rfi->ui_queue_mutex);
+	ui = (RemminaPluginRdpUiObject *)g_async_queue_try_pop(rfi->ui_queue);
+	if (ui)
+		remmina_rdp_event_process_ui_object(gp, ui);
+	pthread_mutex_unlock(&rfi->ui_queue_mutex);
+
+	return ui != NULL;
+}
+
+/* Lock the framebuffer from the main thread. The libfreerdp thread may hold
+ * the lock while waiting for the main thread (pointer updates are
+ * synchronous), so the UI queue is served meanwhile. Between attempts we
+ * sleep on framebuffer_wait_cond, signaled by rf_framebuffer_unlock() and
+ * by every queued UI object. Gives up after
+ * REMMINA_RDP_FRAMEBUFFER_LOCK_TIMEOUT, when the thread is stuck */
+gboolean remmina_rdp_event_framebuffer_lock(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+	struct timespec deadline;
+	guint wake;
+	int rc = 0;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += REMMINA_RDP_FRAMEBUFFER_LOCK_TIMEOUT / G_USEC_PER_SEC;
+	deadline.tv_nsec += (REMMINA_RDP_FRAMEBUFFER_LOCK_TIMEOUT % G_USEC_PER_SEC) * 1000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	for (;;) {
+		/* Sample the wake counter first, so a release between the
+		 * trylock and the wait is not missed */
+		pthread_mutex_lock(&rfi->framebuffer_wait_mutex);
+		wake = rfi->framebuffer_wake;
+		pthread_mutex_unlock(&rfi->framebuffer_wait_mutex);
+
+		if (pthread_mutex_trylock(&rfi->framebuffer_mutex) == 0)
+			return TRUE;
+		if (remmina_rdp_event_process_ui_pending(gp))
+			continue;
+
+		pthread_mutex_lock(&rfi->framebuffer_wait_mutex);
+		while (rfi->framebuffer_wake == wake && rc == 0)
+			rc = pthread_cond_timedwait(&rfi->framebuffer_wait_cond, &rfi->framebuffer_wait_mutex, &deadline);
+		pthread_mutex_unlock(&rfi->framebuffer_wait_mutex);
+
+		if (rc == ETIMEDOUT) {
+			REMMINA_PLUGIN_DEBUG("timeout while waiting for the framebuffer lock");
+			return FALSE;
+		}
+		if (rc != 0) {
+			g_warning("[RDP] gp=%p internal error: pthread_cond_timedwait() returned %d", gp, rc);
+			return FALSE;
+		}
+	}
+}
+
+void remmina_rdp_event_framebuffer_unlock(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+
+	rfContext *rfi = GET_PLUGIN_DATA(gp);
+
+	pthread_mutex_unlock(&rfi->framebuffer_mutex);
+}
+
+void remmina_rdp_event_framebuffer_wake(rfContext *rfi)
+{
+	TRACE_CALL(__func__);
+
+	pthread_mutex_lock(&rfi->framebuffer_wait_mutex);
+	rfi->framebuffer_wake++;
+	pthread_cond_broadcast(&rfi->framebuffer_wait_cond);
+	pthread_mutex_unlock(&rfi->framebuffer_wait_mutex);
+}
+
 static void remmina_rdp_event_queue_ui(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *ui)
 {
 	TRACE_CALL(__func__);
@@ -1373,12 +1803,17 @@ static void remmina_rdp_event_queue_ui(RemminaProtocolWidget *gp, RemminaPluginR
 		/* Wait for main thread function completion before returning */
 		pthread_mutex_lock(&ui->sync_wait_mutex);
 		pthread_mutex_unlock(&rfi->ui_queue_mutex);
+		/* A paste or a framebuffer lock may be blocking the main thread */
+		remmina_rdp_cliprdr_wake(&rfi->clipboard);
+		remmina_rdp_event_framebuffer_wake(rfi);
 		while (!ui->complete)
 			pthread_cond_wait(&ui->sync_wait_cond, &ui->sync_wait_mutex);
 		pthread_cond_destroy(&ui->sync_wait_cond);
 		pthread_mutex_destroy(&ui->sync_wait_mutex);
 	} else {
 		pthread_mutex_unlock(&rfi->ui_queue_mutex);
+		remmina_rdp_cliprdr_wake(&rfi->clipboard);
+		remmina_rdp_event_framebuffer_wake(rfi);
 	}
 	pthread_setcanceltype(oldcanceltype, NULL);
 }
@@ -40,14 +40,17 @@ G_BEGIN_DECLS
 
 void remmina_rdp_event_init(RemminaProtocolWidget *gp);
 void remmina_rdp_event_uninit(RemminaProtocolWidget *gp);
+gboolean remmina_rdp_event_process_ui_pending(RemminaProtocolWidget *gp);
+gboolean remmina_rdp_event_framebuffer_lock(RemminaProtocolWidget *gp);
+void remmina_rdp_event_framebuffer_unlock(RemminaProtocolWidget *gp);
+void remmina_rdp_event_framebuffer_wake(rfContext *rfi);
 void remmina_rdp_event_update_scale(RemminaProtocolWidget *gp);
 void remmina_rdp_event_unfocus(RemminaProtocolWidget *gp);
 void remmina_rdp_event_send_delayed_monitor_layout(RemminaProtocolWidget *gp);
 void remmina_rdp_event_update_rect(RemminaProtocolWidget *gp, gint x, gint y, gint w, gint h);
+void remmina_rdp_event_queue_damage(RemminaProtocolWidget *gp, const GDI_RGN *cinvalid, gint ninvalid);
 void remmina_rdp_event_queue_ui_async(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *ui);
 int remmina_rdp_event_queue_ui_sync_retint(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *ui);
 void *remmina_rdp_event_queue_ui_sync_retptr(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *ui);
-gboolean remmina_rdp_event_on_map(RemminaProtocolWidget *gp);
-gboolean remmina_rdp_event_on_unmap(RemminaProtocolWidget *gp);
 
 G_END_DECLS
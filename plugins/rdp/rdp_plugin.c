@@ -188,66 +188,100 @@ static char **remmina_rdp_CommandLineParseCommaSeparatedValues(const char *list,
 /*
  * End of CommandLineParseCommaSeparatedValuesEx() compatibility and copyright
  */
+
+static inline gboolean rf_is_pure_motion_event(const RemminaPluginRdpEvent *event)
+{
+	return event->type == REMMINA_RDP_EVENT_TYPE_MOUSE &&
+	       !event->mouse_event.extended &&
+	       event->mouse_event.flags == PTR_FLAGS_MOVE;
+}
+
+static void rf_flush_pending_motion(rdpInput *input, RemminaPluginRdpEvent *motion, gboolean *pending)
+{
+	TRACE_CALL(__func__);
+
+	if (!*pending)
+		return;
+
+	input->MouseEvent(input, PTR_FLAGS_MOVE, motion->mouse_event.x, motion->mouse_event.y);
+	*pending = FALSE;
+}
+
 static BOOL rf_process_event_queue(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
 	UINT16 flags;
 	rdpInput *input;
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
-	RemminaPluginRdpEvent *event;
+	RemminaPluginRdpEvent event;
+	RemminaPluginRdpEvent motion;
+	gboolean motion_pending = FALSE;
 	DISPLAY_CONTROL_MONITOR_LAYOUT *dcml;
 	CLIPRDR_FORMAT_DATA_RESPONSE response = { 0 };
 	RemminaFile *remminafile;
 
-	if (rfi->event_queue == NULL)
+	if (rfi->event_ring == NULL)
 		return True;
 
 	input = rfi->instance->input;
 
 	remminafile = remmina_plugin_service->protocol_plugin_get_file(gp);
 
-	while ((event = (RemminaPluginRdpEvent *)g_async_queue_try_pop(rfi->event_queue)) != NULL) {
-		switch (event->type) {
+	remmina_rdp_event_event_ack(rfi);
+
+	while (remmina_rdp_event_event_pop(rfi, &event)) {
+		/* Consecutive pointer motions are collapsed to the latest position,
+		 * which is sent before the next non-motion event or at the end
+		 * of this batch, so button, wheel and key ordering is preserved */
+		if (rf_is_pure_motion_event(&event)) {
+			motion = event;
+			motion_pending = TRUE;
+			continue;
+		}
+		rf_flush_pending_motion(input, &motion, &motion_pending);
+
+		switch (event.type) {
 		case REMMINA_RDP_EVENT_TYPE_SCANCODE:
-			flags = event->key_event.extended ? KBD_FLAGS_EXTENDED : 0;
-			flags |= event->key_event.up ? KBD_FLAGS_RELEASE : KBD_FLAGS_DOWN;
-			input->KeyboardEvent(input, flags, event->key_event.key_code);
+			flags = event.key_event.extended ? KBD_FLAGS_EXTENDED : 0;
+			flags |= event.key_event.up ? KBD_FLAGS_RELEASE : KBD_FLAGS_DOWN;
+			input->KeyboardEvent(input, flags, event.key_event.key_code);
 			break;
 
 		case REMMINA_RDP_EVENT_TYPE_SCANCODE_UNICODE:
 			/*
 			 * TS_UNICODE_KEYBOARD_EVENT RDP message, see https://msdn.microsoft.com/en-us/library/cc240585.aspx
 			 */
-			flags = event->key_event.up ? KBD_FLAGS_RELEASE : KBD_FLAGS_DOWN;
-			input->UnicodeKeyboardEvent(input, flags, event->key_event.unicode_code);
+			flags = event.key_event.up ? KBD_FLAGS_RELEASE : KBD_FLAGS_DOWN;
+			input->UnicodeKeyboardEvent(input, flags, event.key_event.unicode_code);
 			break;
 
 		case REMMINA_RDP_EVENT_TYPE_MOUSE:
-			if (event->mouse_event.extended)
-				input->ExtendedMouseEvent(input, event->mouse_event.flags,
-							  event->mouse_event.x, event->mouse_event.y);
+			if (event.mouse_event.extended)
+				input->ExtendedMouseEvent(input, event.mouse_event.flags,
+							  event.mouse_event.x, event.mouse_event.y);
 			else
-				input->MouseEvent(input, event->mouse_event.flags,
-						  event->mouse_event.x, event->mouse_event.y);
+				input->MouseEvent(input, event.mouse_event.flags,
+						  event.mouse_event.x, event.mouse_event.y);
 			break;
 
 		case REMMINA_RDP_EVENT_TYPE_CLIPBOARD_SEND_CLIENT_FORMAT_LIST:
-			rfi->clipboard.context->ClientFormatList(rfi->clipboard.context, event->clipboard_formatlist.pFormatList);
-			free(event->clipboard_formatlist.pFormatList);
+			rfi->clipboard.context->ClientFormatList(rfi->clipboard.context, event.clipboard_formatlist.pFormatList);
+			free(event.clipboard_formatlist.pFormatList);
 			break;
 
 		case REMMINA_RDP_EVENT_TYPE_CLIPBOARD_SEND_CLIENT_FORMAT_DATA_RESPONSE:
-			response.msgFlags = (event->clipboard_formatdataresponse.data) ? CB_RESPONSE_OK : CB_RESPONSE_FAIL;
-			response.dataLen = event->clipboard_formatdataresponse.size;
-			response.requestedFormatData = event->clipboard_formatdataresponse.data;
+			response.msgFlags = (event.clipboard_formatdataresponse.data) ? CB_RESPONSE_OK : CB_RESPONSE_FAIL;
+			response.dataLen = event.clipboard_formatdataresponse.size;
+			response.requestedFormatData = event.clipboard_formatdataresponse.data;
 			rfi->clipboard.context->ClientFormatDataResponse(rfi->clipboard.context, &response);
+			free(event.clipboard_formatdataresponse.data);
 			break;
 
 		case REMMINA_RDP_EVENT_TYPE_CLIPBOARD_SEND_CLIENT_FORMAT_DATA_REQUEST:
 			REMMINA_PLUGIN_DEBUG("Sending client FormatDataRequest to server");
 			gettimeofday(&(rfi->clipboard.clientformatdatarequest_tv), NULL);
-			rfi->clipboard.context->ClientFormatDataRequest(rfi->clipboard.context, event->clipboard_formatdatarequest.pFormatDataRequest);
-			free(event->clipboard_formatdatarequest.pFormatDataRequest);
+			rfi->clipboard.context->ClientFormatDataRequest(rfi->clipboard.context, event.clipboard_formatdatarequest.pFormatDataRequest);
+			free(event.clipboard_formatdatarequest.pFormatDataRequest);
 			break;
 
 		case REMMINA_RDP_EVENT_TYPE_SEND_MONITOR_LAYOUT:
@@ -283,10 +317,10 @@ static BOOL rf_process_event_queue(RemminaProtocolWidget *gp)
 					if (current->attributes.orientation)
 						dcml[i].Orientation = current->attributes.orientation;
 					else
-						dcml[i].Orientation = event->monitor_layout.desktopOrientation;
+						dcml[i].Orientation = event.monitor_layout.desktopOrientation;
 					REMMINA_PLUGIN_DEBUG("Monitor %d orientation: %d", i, dcml[i].Orientation);
-					dcml[i].DesktopScaleFactor = event->monitor_layout.desktopScaleFactor;
-					dcml[i].DeviceScaleFactor = event->monitor_layout.deviceScaleFactor;
+					dcml[i].DesktopScaleFactor = event.monitor_layout.desktopScaleFactor;
+					dcml[i].DeviceScaleFactor = event.monitor_layout.deviceScaleFactor;
 				}
 				rfi->dispcontext->SendMonitorLayout(rfi->dispcontext, freerdp_settings_get_uint32(rfi->settings, FreeRDP_MonitorCount), dcml);
 				g_free(dcml);
@@ -294,11 +328,11 @@ static BOOL rf_process_event_queue(RemminaProtocolWidget *gp)
 				dcml = g_malloc0(sizeof(DISPLAY_CONTROL_MONITOR_LAYOUT));
 				if (dcml) {
 					dcml->Flags = DISPLAY_CONTROL_MONITOR_PRIMARY;
-					dcml->Width = event->monitor_layout.width;
-					dcml->Height = event->monitor_layout.height;
-					dcml->Orientation = event->monitor_layout.desktopOrientation;
-					dcml->DesktopScaleFactor = event->monitor_layout.desktopScaleFactor;
-					dcml->DeviceScaleFactor = event->monitor_layout.deviceScaleFactor;
+					dcml->Width = event.monitor_layout.width;
+					dcml->Height = event.monitor_layout.height;
+					dcml->Orientation = event.monitor_layout.desktopOrientation;
+					dcml->DesktopScaleFactor = event.monitor_layout.desktopScaleFactor;
+					dcml->DeviceScaleFactor = event.monitor_layout.deviceScaleFactor;
 					rfi->dispcontext->SendMonitorLayout(rfi->dispcontext, 1, dcml);
 					g_free(dcml); \
 				}
@@ -309,10 +343,10 @@ static BOOL rf_process_event_queue(RemminaProtocolWidget *gp)
 			freerdp_abort_connect(rfi->instance);
 			break;
 		}
-
-		g_free(event);
 	}
 
+	rf_flush_pending_motion(input, &motion, &motion_pending);
+
 	return True;
 }
 
@@ -380,7 +414,6 @@ BOOL rf_auto_reconnect(rfContext *rfi)
 	TRACE_CALL(__func__);
 	rdpSettings *settings = rfi->instance->settings;
 	RemminaPluginRdpUiObject *ui;
-	time_t treconn;
 	gchar *cval;
 	gint maxattempts;
 
@@ -426,22 +459,21 @@ BOOL rf_auto_reconnect(rfContext *rfi)
 	ui->type = REMMINA_RDP_UI_RECONNECT_PROGRESS;
 	remmina_rdp_event_queue_ui_async(rfi->protocol_widget, ui);
 
-	/* Sleep half a second to allow:
-	 *  - processing of the UI event we just pushed on the queue
-	 *  - better network conditions
-	 *  Remember: We hare on a thread, so the main gui won’t lock */
-
-	usleep(500000);
-
-	/* Perform an auto-reconnect. */
+	/* Perform an auto-reconnect. The delay between attempts grows after
+	 * each failure and is cut short when the network configuration changes.
+	 * Remember: We are on a thread, so the main gui won’t lock */
 	while (TRUE) {
 		/* Quit retrying if max retries has been exceeded */
-		if (rfi->reconnect_nattempt++ >= rfi->reconnect_maxattempts) {
+		if (rfi->reconnect_nattempt >= rfi->reconnect_maxattempts) {
 			REMMINA_PLUGIN_DEBUG("[%s] maximum number of reconnection attempts exceeded.",
 					     freerdp_settings_get_string(rfi->settings, FreeRDP_ServerHostname));
 			break;
 		}
 
+		if (!remmina_plugin_service->protocol_plugin_reconnect_wait(gp, rfi->reconnect_nattempt))
+			break;
+		rfi->reconnect_nattempt++;
+
 		if (rfi->stop_reconnecting_requested) {
 			REMMINA_PLUGIN_DEBUG("[%s] reconnect request loop interrupted by user.",
 					     freerdp_settings_get_string(rfi->settings, FreeRDP_ServerHostname));
@@ -456,9 +488,7 @@ BOOL rf_auto_reconnect(rfContext *rfi)
 		ui->type = REMMINA_RDP_UI_RECONNECT_PROGRESS;
 		remmina_rdp_event_queue_ui_async(rfi->protocol_widget, ui);
 
-		treconn = time(NULL);
-
-		/* Reconnect the SSH tunnel, if needed */
+		/* Reopen the SSH tunnel, if it died with the connection */
 		if (!remmina_rdp_tunnel_init(rfi->protocol_widget)) {
 			REMMINA_PLUGIN_DEBUG("[%s] unable to recreate tunnel with remmina_rdp_tunnel_init.",
 					     freerdp_settings_get_string(rfi->settings, FreeRDP_ServerHostname));
@@ -470,19 +500,48 @@ BOOL rf_auto_reconnect(rfContext *rfi)
 				return TRUE;
 			}
 		}
-
-		/* Wait until 5 secs have elapsed from last reconnect attempt, while checking for rfi->stop_reconnecting_requested */
-		while (time(NULL) - treconn < 5) {
-			if (rfi->stop_reconnecting_requested)
-				break;
-			usleep(200000); // 200ms sleep
-		}
 	}
 
 	rfi->is_reconnecting = FALSE;
 	return FALSE;
 }
 
+/* TRUE while the update thread is more than update_queue_depth screen
+ * updates behind: the connection thread then pauses the network reads,
+ * and TCP flow control slows down the server */
+static gboolean remmina_rdp_update_queue_full(rfContext *rfi)
+{
+#ifndef WITH_FREERDP3
+	wMessageQueue *queue;
+
+	if (rfi->update_queue_depth <= 0)
+		return FALSE;
+	queue = freerdp_get_message_queue(rfi->instance, FREERDP_UPDATE_MESSAGE_QUEUE);
+	return queue && MessageQueue_Size(queue) >= rfi->update_queue_depth;
+#else
+	return FALSE;
+#endif
+}
+
+/* The lock is taken by the libfreerdp thread only, the flag makes unmatched
+ * or nested BeginPaint/EndPaint calls harmless */
+static void rf_framebuffer_lock(rfContext *rfi)
+{
+	if (!rfi->framebuffer_locked) {
+		pthread_mutex_lock(&rfi->framebuffer_mutex);
+		rfi->framebuffer_locked = TRUE;
+	}
+}
+
+static void rf_framebuffer_unlock(rfContext *rfi)
+{
+	if (rfi->framebuffer_locked) {
+		rfi->framebuffer_locked = FALSE;
+		pthread_mutex_unlock(&rfi->framebuffer_mutex);
+		remmina_rdp_event_framebuffer_wake(rfi);
+	}
+}
+
 BOOL rf_begin_paint(rdpContext *context)
 {
 	TRACE_CALL(__func__);
@@ -495,6 +554,9 @@ BOOL rf_begin_paint(rdpContext *context)
 	if (!gdi || !gdi->primary || !gdi->primary->hdc || !gdi->primary->hdc->hwnd)
 		return FALSE;
 
+	/* Keep gdi->primary_buffer consistent for screenshots until EndPaint */
+	rf_framebuffer_lock((rfContext *)context);
+
 	return TRUE;
 }
 
@@ -503,41 +565,29 @@ BOOL rf_end_paint(rdpContext *context)
 	TRACE_CALL(__func__);
 	rdpGdi *gdi;
 	rfContext *rfi;
-	RemminaPluginRdpUiObject *ui;
-	int i, ninvalid;
-	region *reg;
-	HGDI_RGN cinvalid;
+	HGDI_WND hwnd;
 
 	gdi = context->gdi;
 	rfi = (rfContext *)context;
+	rf_framebuffer_unlock(rfi);
+	hwnd = gdi->primary->hdc->hwnd;
 
-	if (gdi->primary->hdc->hwnd->invalid->null)
-		return TRUE;
+	/* Resume the network reads of a throttled connection thread */
+	if (g_atomic_int_get(&rfi->update_throttled) && !remmina_rdp_update_queue_full(rfi))
+		SetEvent(rfi->update_drained_event);
 
-	if (gdi->primary->hdc->hwnd->ninvalid < 1)
+	if (hwnd->invalid->null)
 		return TRUE;
 
-	ninvalid = gdi->primary->hdc->hwnd->ninvalid;
-	cinvalid = gdi->primary->hdc->hwnd->cinvalid;
-	reg = (region *)g_malloc(sizeof(region) * ninvalid);
-	for (i = 0; i < ninvalid; i++) {
-		reg[i].x = cinvalid[i].x;
-		reg[i].y = cinvalid[i].y;
-		reg[i].w = cinvalid[i].w;
-		reg[i].h = cinvalid[i].h;
-	}
-
-	ui = g_new0(RemminaPluginRdpUiObject, 1);
-	ui->type = REMMINA_RDP_UI_UPDATE_REGIONS;
-	ui->reg.ninvalid = ninvalid;
-	ui->reg.ureg = reg;
-
-	remmina_rdp_event_queue_ui_async(rfi->protocol_widget, ui);
-
+	if (hwnd->ninvalid < 1)
+		return TRUE;
 
-	gdi->primary->hdc->hwnd->invalid->null = TRUE;
-	gdi->primary->hdc->hwnd->ninvalid = 0;
+	/* Merge the invalid rectangles into the damage accumulator, no
+	 * allocation is needed here */
+	remmina_rdp_event_queue_damage(rfi->protocol_widget, hwnd->cinvalid, hwnd->ninvalid);
 
+	hwnd->invalid->null = TRUE;
+	hwnd->ninvalid = 0;
 
 	return TRUE;
 }
@@ -565,7 +615,13 @@ static BOOL rf_desktop_resize(rdpContext *context)
 
 	/* Tell libfreerdp to change its internal GDI bitmap width and heigt,
 	 * this will also destroy gdi->primary_buffer, making our rfi->surface invalid */
-	gdi_resize(((rdpContext *)rfi)->gdi, w, h);
+	if (rfi->framebuffer_locked) {
+		gdi_resize(((rdpContext *)rfi)->gdi, w, h);
+	} else {
+		rf_framebuffer_lock(rfi);
+		gdi_resize(((rdpContext *)rfi)->gdi, w, h);
+		rf_framebuffer_unlock(rfi);
+	}
 
 	/* Call to remmina_rdp_event_update_scale(gp) on the main UI thread,
 	 * this will recreate rfi->surface from gdi->primary_buffer */
@@ -962,12 +1018,36 @@ static void remmina_rdp_main_loop(RemminaProtocolWidget *gp)
 	DWORD nCount;
 	DWORD status;
 	HANDLE handles[64];
-	gchar buf[100];
+	gboolean throttled;
+	gint64 throttle_start = 0, now;
+	DWORD timeout;
 	rfContext *rfi = GET_PLUGIN_DATA(gp);
 
 
 	while (!freerdp_shall_disconnect(rfi->instance)) {
-		nCount = freerdp_get_event_handles(rfi->instance->context, &handles[0], 64);
+		/* Local input is still sent while throttled, and the network is
+		 * read when the update thread catches up, or at least every
+		 * REMMINA_RDP_UPDATE_THROTTLE_MAX. The flag is raised before
+		 * the check, so that a drain right after it is not missed */
+		g_atomic_int_set(&rfi->update_throttled, TRUE);
+		throttled = remmina_rdp_update_queue_full(rfi);
+		timeout = 100;
+		now = g_get_monotonic_time();
+		if (!throttled)
+			throttle_start = 0;
+		else if (!throttle_start)
+			throttle_start = now;
+		else if (now - throttle_start >= REMMINA_RDP_UPDATE_THROTTLE_MAX) {
+			throttle_start = now;
+			throttled = FALSE;
+		}
+		if (throttled)
+			timeout = (DWORD)MAX(1, (REMMINA_RDP_UPDATE_THROTTLE_MAX - (now - throttle_start)) / 1000);
+		else
+			g_atomic_int_set(&rfi->update_throttled, FALSE);
+		nCount = throttled ? 0 : freerdp_get_event_handles(rfi->instance->context, &handles[0], 62);
+		if (throttled && rfi->update_drained_event)
+			handles[nCount++] = rfi->update_drained_event;
 		if (rfi->event_handle)
 			handles[nCount++] = rfi->event_handle;
 
@@ -978,7 +1058,7 @@ static void remmina_rdp_main_loop(RemminaProtocolWidget *gp)
 			break;
 		}
 
-		status = WaitForMultipleObjects(nCount, handles, FALSE, 100);
+		status = WaitForMultipleObjects(nCount, handles, FALSE, timeout);
 
 		if (status == WAIT_FAILED) {
 			fprintf(stderr, "WaitForMultipleObjects failed with %lu\n", (unsigned long)status);
@@ -990,8 +1070,6 @@ static void remmina_rdp_main_loop(RemminaProtocolWidget *gp)
 				fprintf(stderr, "Could not process local keyboard/mouse event queue\n");
 				break;
 			}
-			if (read(rfi->event_pipe[0], buf, sizeof(buf))) {
-			}
 		}
 
 		/* Check if a processed event called freerdp_abort_connect() and exit if true */
@@ -999,6 +1077,9 @@ static void remmina_rdp_main_loop(RemminaProtocolWidget *gp)
 			/* Session disconnected by local user action */
 			break;
 
+		if (throttled)
+			continue;
+
 		if (!freerdp_check_event_handles(rfi->instance->context)) {
 			if (rf_auto_reconnect(rfi)) {
 				/* Reset the possible reason/error which made us doing many reconnection reattempts and continue */
@@ -1829,6 +1910,17 @@ static gboolean remmina_rdp_main(RemminaProtocolWidget *gp)
 	if (remmina_plugin_service->file_get_int(remminafile, "preferipv6", FALSE) ? TRUE : FALSE)
 		freerdp_settings_set_bool(rfi->settings, FreeRDP_PreferIPv6OverIPv4, TRUE);
 
+	/* Decode screen updates in the libfreerdp update thread, so that a heavy
+	 * frame does not delay the network reads */
+#ifdef WITH_FREERDP3
+	/* FreeRDP 3 has no update thread */
+	rfi->update_queue_depth = 0;
+#else
+	rfi->update_queue_depth = MAX(0, remmina_plugin_service->file_get_int(remminafile, "update_queue_depth", 0));
+	if (rfi->update_queue_depth > 0)
+		freerdp_settings_set_bool(rfi->settings, FreeRDP_AsyncUpdate, TRUE);
+#endif
+
 	freerdp_settings_set_bool(rfi->settings, FreeRDP_RedirectClipboard, remmina_plugin_service->file_get_int(remminafile, "disableclipboard", FALSE) ? FALSE : TRUE);
 
 	cs = remmina_plugin_service->file_get_string(remminafile, "sharefolder");
@@ -2381,6 +2473,7 @@ static gboolean remmina_rdp_close_connection(RemminaProtocolWidget *gp)
 	if (rfi->is_reconnecting) {
 		/* Special case: window closed when attempting to reconnect */
 		rfi->stop_reconnecting_requested = TRUE;
+		remmina_plugin_service->protocol_plugin_reconnect_interrupt(gp);
 		return FALSE;
 	}
 
@@ -2471,23 +2564,31 @@ static gboolean remmina_rdp_get_screenshot(RemminaProtocolWidget *gp, RemminaPlu
 	UINT32 bytesPerPixel;
 	UINT32 bitsPerPixel;
 
-	if (!rfi)
+	if (!rfi || !rfi->connected)
+		return FALSE;
+
+	/* The libfreerdp thread cannot update gdi->primary_buffer, its format
+	 * and its size until the copy is done. Only the copy is done here,
+	 * the caller converts and encodes it in another thread */
+	if (!remmina_rdp_event_framebuffer_lock(gp))
 		return FALSE;
 
 	gdi = ((rdpContext *)rfi)->gdi;
+	if (!gdi || !gdi->primary_buffer) {
+		remmina_rdp_event_framebuffer_unlock(gp);
+		return FALSE;
+	}
 
 	bytesPerPixel = GetBytesPerPixel(gdi->hdc->format);
 	bitsPerPixel = GetBitsPerPixel(gdi->hdc->format);
 
-	/** @todo we should lock FreeRDP subthread to update rfi->primary_buffer, rfi->gdi and w/h,
-	 * from here to memcpy, but… how ? */
-
 	szmem = gdi->width * gdi->height * bytesPerPixel;
 
 	REMMINA_PLUGIN_DEBUG("allocating %zu bytes for a full screenshot", szmem);
 	rpsd->buffer = malloc(szmem);
 	if (!rpsd->buffer) {
 		REMMINA_PLUGIN_DEBUG("could not set aside %zu bytes for a full screenshot", szmem);
+		remmina_rdp_event_framebuffer_unlock(gp);
 		return FALSE;
 	}
 	rpsd->width = gdi->width;
@@ -2497,6 +2598,8 @@ static gboolean remmina_rdp_get_screenshot(RemminaProtocolWidget *gp, RemminaPlu
 
 	memcpy(rpsd->buffer, gdi->primary_buffer, szmem);
 
+	remmina_rdp_event_framebuffer_unlock(gp);
+
 	/* Returning TRUE instruct also the caller to deallocate rpsd->buffer */
 	return TRUE;
 }
@@ -2733,6 +2836,10 @@ static const RemminaProtocolSetting remmina_rdp_advanced_settings[] =
 	{ REMMINA_PROTOCOL_SETTING_TYPE_TEXT,	  "vc",			    N_("Static virtual channel"),			 FALSE, NULL,		  N_("<channel>[,<options>]")											 },
 	{ REMMINA_PROTOCOL_SETTING_TYPE_TEXT,	  "rdp2tcp",		    N_("TCP redirection"),				 FALSE, NULL,		  N_("/PATH/TO/rdp2tcp")											 },
 	{ REMMINA_PROTOCOL_SETTING_TYPE_TEXT,	  "rdp_reconnect_attempts", N_("Reconnect attempts number"),			 FALSE, NULL,		  N_("The maximum number of reconnect attempts upon an RDP disconnect (default: 20)")				 },
+	{ REMMINA_PROTOCOL_SETTING_TYPE_TEXT,	  "framerate_max",	    N_("Maximum frame rate"),				 TRUE,	NULL,		  N_("Frames per second, 0 follows the monitor refresh rate (default: 0)")					 },
+#ifndef WITH_FREERDP3
+	{ REMMINA_PROTOCOL_SETTING_TYPE_TEXT,	  "update_queue_depth",	    N_("Screen update queue depth"),			 TRUE,	NULL,		  N_("Screen updates decoded in a separate thread, the network is read less often while more are waiting. 0 decodes them while reading (default: 0)") },
+#endif
 	{ REMMINA_PROTOCOL_SETTING_TYPE_CHECK,	  "preferipv6",		    N_("Prefer IPv6 AAAA record over IPv4 A record"),	 TRUE,	NULL,		  NULL														 },
 	{ REMMINA_PROTOCOL_SETTING_TYPE_CHECK,	  "shareprinter",	    N_("Share printers"),				 TRUE,	NULL,		  NULL														 },
 	{ REMMINA_PROTOCOL_SETTING_TYPE_CHECK,	  "shareserial",	    N_("Share serial ports"),				 TRUE,	NULL,		  NULL														 },
@@ -2797,8 +2904,8 @@ static RemminaProtocolPlugin remmina_rdp =
 	remmina_rdp_call_feature,                       // Call a feature
 	remmina_rdp_keystroke,                          // Send a keystroke
 	remmina_rdp_get_screenshot,                     // Screenshot
-	remmina_rdp_event_on_map,                       // RCW map event
-	remmina_rdp_event_on_unmap                      // RCW unmap event
+	NULL,                                           // RCW map event
+	NULL                                            // RCW unmap event
 };
 
 /* File plugin definition and features */
@@ -37,6 +37,8 @@
 #pragma once
 
 #include "common/remmina_plugin.h"
+#include "common/remmina_scaler.h"
+#include "common/remmina_frame_pacer.h"
 #include <freerdp/freerdp.h>
 #include <freerdp/version.h>
 #include <freerdp/channels/channels.h>
@@ -103,8 +105,6 @@ typedef struct rf_context rfContext;
 #define DEFAULT_QUALITY_9       0x80
 
 extern RemminaPluginService *remmina_plugin_service;
-#define REMMINA_PLUGIN_DEBUG(fmt, ...) remmina_plugin_service->_remmina_debug(__func__, fmt, ##__VA_ARGS__)
-
 struct rf_clipboard {
 	rfContext *		rfi;
 	CliprdrClientContext *	context;
@@ -114,9 +114,21 @@ struct rf_clipboard {
 	UINT32			format;
 	gulong			clipboard_handler;
 
+	/* Guards the fields below, transfer_clip_cond is signalled when they change */
 	pthread_mutex_t		transfer_clip_mutex;
 	pthread_cond_t		transfer_clip_cond;
+	/* State of the GTK thread, blocked in a paste or not */
 	enum  { SCDW_NONE, SCDW_BUSY_WAIT, SCDW_ABORTING } srv_clip_data_wait;
+	/* The blocked GTK thread has UI objects to process */
+	gboolean		srv_clip_ui_wake;
+	/* ClientFormatDataRequest sent and not answered yet. It is stale
+	 * when the server clipboard changed in the meanwhile */
+	gboolean		srv_request_pending;
+	gboolean		srv_request_stale;
+	UINT32			srv_request_format;
+	/* Requests the GTK thread gave up waiting for. The server answers
+	 * in order, so the next responses are theirs and are discarded */
+	guint			srv_request_abandoned;
 	gpointer		srv_data;
 
 	/* Stats for clipboard download */
@@ -196,9 +208,27 @@ struct remmina_plugin_rdp_event {
 };
 typedef struct remmina_plugin_rdp_event RemminaPluginRdpEvent;
 
+/* Size of the input event ring, must be a power of two */
+#define REMMINA_RDP_EVENT_RING_SIZE 1024
+
+/* Single producer (GTK thread), single consumer (libfreerdp thread) ring
+ * of preallocated events. head and tail are free running counters,
+ * each one is written by only one side. wakeup_pending makes the producer
+ * signal event_handle only once per batch, until the consumer drains it */
+struct remmina_plugin_rdp_event_ring {
+	RemminaPluginRdpEvent	events[REMMINA_RDP_EVENT_RING_SIZE];
+	volatile gint		head;
+	volatile gint		tail;
+	volatile gint		wakeup_pending;
+
+	/* Events which did not fit in the ring, owned by the GTK thread */
+	GQueue *		overflow;
+	guint			overflow_handler;
+};
+typedef struct remmina_plugin_rdp_event_ring RemminaPluginRdpEventRing;
+
 typedef enum {
-	REMMINA_RDP_UI_UPDATE_REGIONS = 0,
-	REMMINA_RDP_UI_CONNECTED,
+	REMMINA_RDP_UI_CONNECTED = 0,
 	REMMINA_RDP_UI_RECONNECT_PROGRESS,
 	REMMINA_RDP_UI_CURSOR,
 	REMMINA_RDP_UI_NOCODEC,
@@ -231,6 +261,22 @@ typedef struct {
 	gint x, y, w, h;
 } region;
 
+/* Maximum number of separate rectangles kept by the damage accumulator,
+ * further rectangles are merged into the one which grows the least */
+#define REMMINA_RDP_DAMAGE_MAX_RECTS 16
+
+/* Longest wait of the main thread for the framebuffer lock, in µs */
+#define REMMINA_RDP_FRAMEBUFFER_LOCK_TIMEOUT 1000000
+
+/* Longest pause of the network reads while the update queue is full, in µs:
+ * keepalives and virtual channels must go on if the decoding stalls */
+#define REMMINA_RDP_UPDATE_THROTTLE_MAX 100000
+
+typedef struct remmina_plugin_rdp_damage {
+	region	rects[REMMINA_RDP_DAMAGE_MAX_RECTS];
+	gint	nrects;
+} RemminaPluginRdpDamage;
+
 struct remmina_plugin_rdp_ui_object {
 	RemminaPluginRdpUiType	type;
 	gboolean		sync;
@@ -238,10 +284,6 @@ struct remmina_plugin_rdp_ui_object {
 	pthread_mutex_t		sync_wait_mutex;
 	pthread_cond_t		sync_wait_cond;
 	union {
-		struct {
-			region *ureg;
-			gint	ninvalid;
-		} reg;
 		struct {
 			rdpContext *			context;
 			rfPointer *			pointer;
@@ -320,12 +362,22 @@ struct rf_context {
 	int			reconnect_maxattempts;
 	int			reconnect_nattempt;
 
+	/* Screen updates received and not yet decoded by the libfreerdp
+	 * update thread, beyond which the network is read less often.
+	 * 0 when updates are decoded by the connection thread */
+	gint			update_queue_depth;
+	/* Signaled by the update thread when the queue drains below
+	 * update_queue_depth while the connection thread is throttled */
+	HANDLE			update_drained_event;
+	gint			update_throttled;
+
 	gboolean		sw_gdi;
 	GtkWidget *		drawing_area;
 	gint			scale_width;
 	gint			scale_height;
 	gdouble			scale_x;
 	gdouble			scale_y;
+	RemminaPluginScaler *	scaler;
 	guint			delayed_monitor_layout_handler;
 	gboolean		use_client_keymap;
 
@@ -345,9 +397,30 @@ struct rf_context {
 	pthread_mutex_t		ui_queue_mutex;
 	guint			ui_handler;
 
+	/* Screen damage accumulated by the libfreerdp thread in
+	 * damage[damage_write]. The GTK thread swaps the two buffers
+	 * when damage_source is dispatched */
+	pthread_mutex_t		damage_mutex;
+	RemminaPluginRdpDamage	damage[2];
+	gint			damage_write;
+	gboolean		damage_armed;
+	GSource *		damage_source;
+
+	/* Held by the libfreerdp thread between BeginPaint and EndPaint and
+	 * while it resizes gdi->primary_buffer */
+	pthread_mutex_t		framebuffer_mutex;
+	gboolean		framebuffer_locked;
+	/* Signaled when the framebuffer is released or a UI object is queued,
+	 * for the main thread waiting in remmina_rdp_event_framebuffer_lock() */
+	pthread_mutex_t		framebuffer_wait_mutex;
+	pthread_cond_t		framebuffer_wait_cond;
+	guint			framebuffer_wake;
+
+	/* Frame pacing of damage presentation, the GTK thread only */
+	RemminaPluginFramePacer *pacer;
+
 	GArray *		pressed_keys;
-	GAsyncQueue *		event_queue;
-	gint			event_pipe[2];
+	RemminaPluginRdpEventRing *event_ring;
 	HANDLE			event_handle;
 
 	rfClipboard		clipboard;
@@ -368,3 +441,5 @@ BOOL rf_check_fds(RemminaProtocolWidget *gp);
 void rf_object_free(RemminaProtocolWidget *gp, RemminaPluginRdpUiObject *obj);
 
 void remmina_rdp_event_event_push(RemminaProtocolWidget *gp, const RemminaPluginRdpEvent *e);
+gboolean remmina_rdp_event_event_pop(rfContext *rfi, RemminaPluginRdpEvent *e);
+void remmina_rdp_event_event_ack(rfContext *rfi);
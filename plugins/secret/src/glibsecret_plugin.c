@@ -41,10 +41,9 @@
 #include <glib/gstdio.h>
 #include <libsecret/secret.h>
 #include <remmina/plugin.h>
+#include "common/remmina_plugin.h"
 
 static RemminaPluginService *remmina_plugin_service = NULL;
-#define REMMINA_PLUGIN_DEBUG(fmt, ...) remmina_plugin_service->_remmina_debug(__func__, fmt, ##__VA_ARGS__)
-
 
 static SecretSchema remmina_file_secret_schema =
 { "org.remmina.Password", SECRET_SCHEMA_NONE,
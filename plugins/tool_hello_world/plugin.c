@@ -39,8 +39,6 @@
 #include "common/remmina_plugin.h"
 
 static RemminaPluginService *remmina_plugin_service = NULL;
-#define REMMINA_PLUGIN_DEBUG(fmt, ...) remmina_plugin_service->_remmina_debug(__func__, fmt, ##__VA_ARGS__)
-
 static void remmina_plugin_tool_init(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
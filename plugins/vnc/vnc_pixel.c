@@ -0,0 +1,429 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2010-2011 Vic Lee
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+/* Conversion of the libvncclient framebuffer to cairo ARGB32.
+ * Every kernel produces exactly the same output as the generic per pixel
+ * code in remmina_plugin_vnc_rfb_fill_buffer(); SSE2/AVX2 kernels are
+ * selected at runtime on x86, NEON is used when the compiler targets it. */
+
+#include "common/remmina_plugin.h"
+#include <string.h>
+#include "vnc_pixel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define VNC_PIXEL_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define VNC_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef void (*RemminaPluginVncRow32Func)(guint32 *dest, const guchar *src, gint w);
+typedef void (*RemminaPluginVncRow16Func)(const RemminaPluginVncPixelFormat *pf, guint32 *dest, const guchar *src, gint w);
+
+typedef struct _RemminaPluginVncPixelKernels {
+	const gchar *			name;
+	gboolean			(*supported)(void);     /* NULL when always usable */
+	RemminaPluginVncRow32Func	row32;
+	RemminaPluginVncRow16Func	row16;
+} RemminaPluginVncPixelKernels;
+
+static const RemminaPluginVncPixelKernels *remmina_plugin_vnc_pixel_kernels;
+
+static gint remmina_plugin_vnc_pixel_bits(gint n)
+{
+	gint b = 0;
+
+	while (n) {
+		b++;
+		n >>= 1;
+	}
+	return b ? b : 1;
+}
+
+/* ---- Scalar kernels ---- */
+
+static void remmina_plugin_vnc_pixel_row32_scalar(guint32 *dest, const guchar *src, gint w)
+{
+	gint ix;
+
+	/* Source is B, G, R, X in memory: fill in the alpha channel */
+	for (ix = 0; ix < w; ix++, src += 4)
+		dest[ix] = 0xff000000 | ((guint32)src[2] << 16) | ((guint32)src[1] << 8) | src[0];
+}
+
+static void remmina_plugin_vnc_pixel_row16_scalar(const RemminaPluginVncPixelFormat *pf, guint32 *dest, const guchar *src, gint w)
+{
+	guint32 p;
+	gint ix;
+
+	for (ix = 0; ix < w; ix++, src += 2) {
+		p = src[0] | ((guint32)src[1] << 8);
+		dest[ix] = 0xff000000
+			   | pf->lut[0][(p >> pf->shift[0]) & pf->max[0]]
+			   | pf->lut[1][(p >> pf->shift[1]) & pf->max[1]]
+			   | pf->lut[2][(p >> pf->shift[2]) & pf->max[2]];
+	}
+}
+
+#ifdef VNC_PIXEL_X86
+
+/* ---- SSE2/AVX2 kernels ---- */
+
+/* Expand one channel of 8 pixels of 16 bits to 8 bits, replicating the
+ * high bits into the low ones like the lookup tables do */
+__attribute__((target("sse2")))
+static inline __m128i remmina_plugin_vnc_pixel_expand_sse2(__m128i p, gint bits, __m128i shift, __m128i max)
+{
+	__m128i c;
+	gint r;
+
+	c = _mm_and_si128(_mm_srl_epi16(p, shift), max);
+	c = _mm_sll_epi16(c, _mm_cvtsi32_si128(8 - bits));
+	for (r = bits; r < 8; r *= 2)
+		c = _mm_or_si128(c, _mm_srl_epi16(c, _mm_cvtsi32_si128(r)));
+	return c;
+}
+
+/* Same as above, for 16 pixels */
+__attribute__((target("avx2")))
+static inline __m256i remmina_plugin_vnc_pixel_expand_avx2(__m256i p, gint bits, __m128i shift, __m256i max)
+{
+	__m256i c;
+	gint r;
+
+	c = _mm256_and_si256(_mm256_srl_epi16(p, shift), max);
+	c = _mm256_sll_epi16(c, _mm_cvtsi32_si128(8 - bits));
+	for (r = bits; r < 8; r *= 2)
+		c = _mm256_or_si256(c, _mm256_srl_epi16(c, _mm_cvtsi32_si128(r)));
+	return c;
+}
+
+__attribute__((target("sse2")))
+static void remmina_plugin_vnc_pixel_row32_sse2(guint32 *dest, const guchar *src, gint w)
+{
+	const __m128i alpha = _mm_set1_epi32((gint)0xff000000);
+	gint ix;
+
+	for (ix = 0; ix + 4 <= w; ix += 4)
+		_mm_storeu_si128((__m128i *)(dest + ix),
+				 _mm_or_si128(_mm_loadu_si128((const __m128i *)(src + ix * 4)), alpha));
+	remmina_plugin_vnc_pixel_row32_scalar(dest + ix, src + ix * 4, w - ix);
+}
+
+__attribute__((target("avx2")))
+static void remmina_plugin_vnc_pixel_row32_avx2(guint32 *dest, const guchar *src, gint w)
+{
+	const __m256i alpha = _mm256_set1_epi32((gint)0xff000000);
+	gint ix;
+
+	for (ix = 0; ix + 8 <= w; ix += 8)
+		_mm256_storeu_si256((__m256i *)(dest + ix),
+				    _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(src + ix * 4)), alpha));
+	remmina_plugin_vnc_pixel_row32_scalar(dest + ix, src + ix * 4, w - ix);
+}
+
+__attribute__((target("sse2")))
+static void remmina_plugin_vnc_pixel_row16_sse2(const RemminaPluginVncPixelFormat *pf, guint32 *dest, const guchar *src, gint w)
+{
+	const __m128i rs = _mm_cvtsi32_si128(pf->shift[0]);
+	const __m128i gs = _mm_cvtsi32_si128(pf->shift[1]);
+	const __m128i bs = _mm_cvtsi32_si128(pf->shift[2]);
+	const __m128i rm = _mm_set1_epi16((gshort)pf->max[0]);
+	const __m128i gm = _mm_set1_epi16((gshort)pf->max[1]);
+	const __m128i bm = _mm_set1_epi16((gshort)pf->max[2]);
+	const __m128i alpha = _mm_set1_epi16((gshort)0xff00);
+	__m128i p, r, g, b, lo, hi;
+	gint ix;
+
+	for (ix = 0; ix + 8 <= w; ix += 8) {
+		p = _mm_loadu_si128((const __m128i *)(src + ix * 2));
+		r = remmina_plugin_vnc_pixel_expand_sse2(p, pf->bits[0], rs, rm);
+		g = remmina_plugin_vnc_pixel_expand_sse2(p, pf->bits[1], gs, gm);
+		b = remmina_plugin_vnc_pixel_expand_sse2(p, pf->bits[2], bs, bm);
+		lo = _mm_or_si128(_mm_slli_epi16(g, 8), b);     /* G B */
+		hi = _mm_or_si128(alpha, r);                    /* A R */
+		_mm_storeu_si128((__m128i *)(dest + ix), _mm_unpacklo_epi16(lo, hi));
+		_mm_storeu_si128((__m128i *)(dest + ix + 4), _mm_unpackhi_epi16(lo, hi));
+	}
+	remmina_plugin_vnc_pixel_row16_scalar(pf, dest + ix, src + ix * 2, w - ix);
+}
+
+__attribute__((target("avx2")))
+static void remmina_plugin_vnc_pixel_row16_avx2(const RemminaPluginVncPixelFormat *pf, guint32 *dest, const guchar *src, gint w)
+{
+	const __m128i rs = _mm_cvtsi32_si128(pf->shift[0]);
+	const __m128i gs = _mm_cvtsi32_si128(pf->shift[1]);
+	const __m128i bs = _mm_cvtsi32_si128(pf->shift[2]);
+	const __m256i rm = _mm256_set1_epi16((gshort)pf->max[0]);
+	const __m256i gm = _mm256_set1_epi16((gshort)pf->max[1]);
+	const __m256i bm = _mm256_set1_epi16((gshort)pf->max[2]);
+	const __m256i alpha = _mm256_set1_epi16((gshort)0xff00);
+	__m256i p, r, g, b, lo, hi, px0, px1;
+	gint ix;
+
+	for (ix = 0; ix + 16 <= w; ix += 16) {
+		p = _mm256_loadu_si256((const __m256i *)(src + ix * 2));
+		r = remmina_plugin_vnc_pixel_expand_avx2(p, pf->bits[0], rs, rm);
+		g = remmina_plugin_vnc_pixel_expand_avx2(p, pf->bits[1], gs, gm);
+		b = remmina_plugin_vnc_pixel_expand_avx2(p, pf->bits[2], bs, bm);
+		lo = _mm256_or_si256(_mm256_slli_epi16(g, 8), b);
+		hi = _mm256_or_si256(alpha, r);
+		/* Unpack works on each 128 bits lane: px0 holds pixels 0-3 and 8-11,
+		 * px1 holds pixels 4-7 and 12-15 */
+		px0 = _mm256_unpacklo_epi16(lo, hi);
+		px1 = _mm256_unpackhi_epi16(lo, hi);
+		_mm256_storeu_si256((__m256i *)(dest + ix), _mm256_permute2x128_si256(px0, px1, 0x20));
+		_mm256_storeu_si256((__m256i *)(dest + ix + 8), _mm256_permute2x128_si256(px0, px1, 0x31));
+	}
+	remmina_plugin_vnc_pixel_row16_sse2(pf, dest + ix, src + ix * 2, w - ix);
+}
+
+#endif /* VNC_PIXEL_X86 */
+
+#ifdef VNC_PIXEL_NEON
+
+/* ---- NEON kernels ---- */
+
+static inline uint16x8_t remmina_plugin_vnc_pixel_expand_neon(uint16x8_t p, gint bits, gint shift, uint16x8_t max)
+{
+	uint16x8_t c;
+	gint r;
+
+	c = vandq_u16(vshlq_u16(p, vdupq_n_s16(-shift)), max);
+	c = vshlq_u16(c, vdupq_n_s16(8 - bits));
+	for (r = bits; r < 8; r *= 2)
+		c = vorrq_u16(c, vshlq_u16(c, vdupq_n_s16(-r)));
+	return c;
+}
+
+static void remmina_plugin_vnc_pixel_row32_neon(guint32 *dest, const guchar *src, gint w)
+{
+	const uint32x4_t alpha = vdupq_n_u32(0xff000000);
+	gint ix;
+
+	for (ix = 0; ix + 4 <= w; ix += 4)
+		vst1q_u32(dest + ix, vorrq_u32(vreinterpretq_u32_u8(vld1q_u8(src + ix * 4)), alpha));
+	remmina_plugin_vnc_pixel_row32_scalar(dest + ix, src + ix * 4, w - ix);
+}
+
+static void remmina_plugin_vnc_pixel_row16_neon(const RemminaPluginVncPixelFormat *pf, guint32 *dest, const guchar *src, gint w)
+{
+	const uint16x8_t rm = vdupq_n_u16(pf->max[0]);
+	const uint16x8_t gm = vdupq_n_u16(pf->max[1]);
+	const uint16x8_t bm = vdupq_n_u16(pf->max[2]);
+	uint16x8_t p;
+	uint8x8x4_t px;
+	gint ix;
+
+	px.val[3] = vdup_n_u8(0xff);
+	for (ix = 0; ix + 8 <= w; ix += 8) {
+		p = vreinterpretq_u16_u8(vld1q_u8(src + ix * 2));
+		px.val[0] = vmovn_u16(remmina_plugin_vnc_pixel_expand_neon(p, pf->bits[2], pf->shift[2], bm));
+		px.val[1] = vmovn_u16(remmina_plugin_vnc_pixel_expand_neon(p, pf->bits[1], pf->shift[1], gm));
+		px.val[2] = vmovn_u16(remmina_plugin_vnc_pixel_expand_neon(p, pf->bits[0], pf->shift[0], rm));
+		/* B, G, R, A in memory is ARGB32 on little endian */
+		vst4_u8((guchar *)(dest + ix), px);
+	}
+	remmina_plugin_vnc_pixel_row16_scalar(pf, dest + ix, src + ix * 2, w - ix);
+}
+
+#endif /* VNC_PIXEL_NEON */
+
+#ifdef VNC_PIXEL_X86
+static gboolean remmina_plugin_vnc_pixel_has_avx2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static gboolean remmina_plugin_vnc_pixel_has_sse2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+}
+#endif
+
+/* Every kernel compiled in, the best first */
+static const RemminaPluginVncPixelKernels remmina_plugin_vnc_pixel_kernel_table[] = {
+#if defined(VNC_PIXEL_X86)
+	{ "avx2",   remmina_plugin_vnc_pixel_has_avx2, remmina_plugin_vnc_pixel_row32_avx2,   remmina_plugin_vnc_pixel_row16_avx2   },
+	{ "sse2",   remmina_plugin_vnc_pixel_has_sse2, remmina_plugin_vnc_pixel_row32_sse2,   remmina_plugin_vnc_pixel_row16_sse2   },
+#elif defined(VNC_PIXEL_NEON)
+	{ "neon",   NULL,			       remmina_plugin_vnc_pixel_row32_neon,   remmina_plugin_vnc_pixel_row16_neon   },
+#endif
+	{ "scalar", NULL,			       remmina_plugin_vnc_pixel_row32_scalar, remmina_plugin_vnc_pixel_row16_scalar },
+};
+
+static void remmina_plugin_vnc_pixel_init_kernels(void)
+{
+	TRACE_CALL(__func__);
+	static gsize initialized = 0;
+
+	if (!g_once_init_enter(&initialized))
+		return;
+
+	/* Unless a test has already chosen them */
+	if (!remmina_plugin_vnc_pixel_kernels)
+		remmina_plugin_vnc_pixel_use_kernels(NULL);
+
+	g_once_init_leave(&initialized, 1);
+}
+
+/* Use the named kernels, or the best ones for this CPU when name is NULL.
+ * FALSE when they are not compiled in or the CPU lacks them. For tests
+ * and benchmarks, while no conversion is running */
+gboolean remmina_plugin_vnc_pixel_use_kernels(const gchar *name)
+{
+	TRACE_CALL(__func__);
+	const RemminaPluginVncPixelKernels *k;
+	gsize i;
+
+	for (i = 0; i < G_N_ELEMENTS(remmina_plugin_vnc_pixel_kernel_table); i++) {
+		k = &remmina_plugin_vnc_pixel_kernel_table[i];
+		if (name && strcmp(name, k->name) != 0)
+			continue;
+		if (k->supported && !k->supported())
+			continue;
+		remmina_plugin_vnc_pixel_kernels = k;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* Name of the kernels selected for this CPU, for logs and tests */
+const gchar *remmina_plugin_vnc_pixel_get_kernel_name(void)
+{
+	TRACE_CALL(__func__);
+
+	remmina_plugin_vnc_pixel_init_kernels();
+	return remmina_plugin_vnc_pixel_kernels->name;
+}
+
+void remmina_plugin_vnc_pixel_format_update(RemminaPluginVncPixelFormat *pf, gint bits_per_pixel,
+					    gint red_max, gint green_max, gint blue_max,
+					    gint red_shift, gint green_shift, gint blue_shift)
+{
+	gint max[3] = { red_max, green_max, blue_max };
+	gint shift[3] = { red_shift, green_shift, blue_shift };
+	gint i, v, r, p;
+	guchar c;
+
+	TRACE_CALL(__func__);
+
+	if (pf->bits_per_pixel == bits_per_pixel
+	    && memcmp(pf->max, max, sizeof(max)) == 0
+	    && memcmp(pf->shift, shift, sizeof(shift)) == 0)
+		return;
+
+	remmina_plugin_vnc_pixel_init_kernels();
+
+	pf->bits_per_pixel = bits_per_pixel;
+	pf->lut_valid = TRUE;
+	for (i = 0; i < 3; i++) {
+		pf->max[i] = max[i];
+		pf->shift[i] = shift[i];
+		pf->bits[i] = remmina_plugin_vnc_pixel_bits(max[i]);
+		if (max[i] <= 0 || max[i] > 255 || shift[i] < 0 || shift[i] > 15) {
+			pf->lut_valid = FALSE;
+			continue;
+		}
+		/* Same bit replication as the generic conversion code */
+		for (v = 0; v <= max[i]; v++) {
+			c = (guchar)(v << (8 - pf->bits[i]));
+			for (r = pf->bits[i]; r < 8; r *= 2)
+				c |= c >> r;
+			pf->lut[i][v] = (guint32)c << (16 - 8 * i);
+		}
+	}
+
+	if (pf->lut_valid && bits_per_pixel == 8) {
+		for (p = 0; p < 256; p++)
+			pf->lut8[p] = 0xff000000
+				      | pf->lut[0][(p >> shift[0]) & max[0]]
+				      | pf->lut[1][(p >> shift[1]) & max[1]]
+				      | pf->lut[2][(p >> shift[2]) & max[2]];
+	}
+}
+
+/* TRUE when the server pixels already have the memory layout of a cairo
+ * RGB24 surface, so libvncclient can decode straight into it */
+gboolean remmina_plugin_vnc_pixel_format_is_native(const RemminaPluginVncPixelFormat *pf)
+{
+	TRACE_CALL(__func__);
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+	return pf->bits_per_pixel == 32
+	       && pf->shift[0] == 16 && pf->shift[1] == 8 && pf->shift[2] == 0
+	       && pf->max[0] == 255 && pf->max[1] == 255 && pf->max[2] == 255;
+#else
+	return FALSE;
+#endif
+}
+
+/* Converts a w x h rectangle to ARGB32. Returns FALSE when the format
+ * has no fast path, the caller must then use the generic code */
+gboolean remmina_plugin_vnc_pixel_convert(const RemminaPluginVncPixelFormat *pf, guchar *dest, gint dest_rowstride,
+					  const guchar *src, gint src_rowstride, gint w, gint h)
+{
+	TRACE_CALL(__func__);
+	guint32 *destptr;
+	gint ix, iy;
+
+	switch (pf->bits_per_pixel) {
+	case 32:
+		for (iy = 0; iy < h; iy++)
+			remmina_plugin_vnc_pixel_kernels->row32((guint32 *)(dest + iy * dest_rowstride), src + iy * src_rowstride, w);
+		return TRUE;
+	case 16:
+		if (!pf->lut_valid)
+			return FALSE;
+		for (iy = 0; iy < h; iy++)
+			remmina_plugin_vnc_pixel_kernels->row16(pf, (guint32 *)(dest + iy * dest_rowstride), src + iy * src_rowstride, w);
+		return TRUE;
+	case 8:
+		/* 256 entries: a table lookup beats any vector code */
+		if (!pf->lut_valid)
+			return FALSE;
+		for (iy = 0; iy < h; iy++) {
+			destptr = (guint32 *)(dest + iy * dest_rowstride);
+			for (ix = 0; ix < w; ix++)
+				destptr[ix] = pf->lut8[src[iy * src_rowstride + ix]];
+		}
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
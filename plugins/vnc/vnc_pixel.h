@@ -0,0 +1,65 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2010-2011 Vic Lee
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Server pixel format, with the lookup tables used to expand each
+ * channel to 8 bits. Rebuilt only when the format changes */
+typedef struct _RemminaPluginVncPixelFormat {
+	gint	bits_per_pixel;
+	gint	shift[3];       /* red, green, blue */
+	gint	max[3];
+	gint	bits[3];
+
+	/* TRUE when every channel fits in 8 bits and the tables are usable */
+	gboolean	lut_valid;
+	guint32		lut[3][256];    /* channel value -> ARGB32 component */
+	guint32		lut8[256];      /* 8 bpp pixel -> ARGB32 */
+} RemminaPluginVncPixelFormat;
+
+const gchar *remmina_plugin_vnc_pixel_get_kernel_name(void);
+gboolean remmina_plugin_vnc_pixel_use_kernels(const gchar *name);
+void remmina_plugin_vnc_pixel_format_update(RemminaPluginVncPixelFormat *pf, gint bits_per_pixel,
+					    gint red_max, gint green_max, gint blue_max,
+					    gint red_shift, gint green_shift, gint blue_shift);
+gboolean remmina_plugin_vnc_pixel_format_is_native(const RemminaPluginVncPixelFormat *pf);
+gboolean remmina_plugin_vnc_pixel_convert(const RemminaPluginVncPixelFormat *pf, guchar *dest, gint dest_rowstride,
+					  const guchar *src, gint src_rowstride, gint w, gint h);
+
+G_END_DECLS
@@ -51,8 +51,6 @@
 #define GET_PLUGIN_DATA(gp) (RemminaPluginVncData *)g_object_get_data(G_OBJECT(gp), "plugin-data")
 
 static RemminaPluginService *remmina_plugin_service = NULL;
-#define REMMINA_PLUGIN_DEBUG(fmt, ...) remmina_plugin_service->_remmina_debug(__func__, fmt, ## __VA_ARGS__)
-
 static int dot_cursor_x_hot = 2;
 static int dot_cursor_y_hot = 2;
 static const gchar *dot_cursor_xpm[] =
@@ -61,6 +59,8 @@ static const gchar *dot_cursor_xpm[] =
 
 #define LOCK_BUFFER(t)      if (t) { CANCEL_DEFER } pthread_mutex_lock(&gpdata->buffer_mutex);
 #define UNLOCK_BUFFER(t)    pthread_mutex_unlock(&gpdata->buffer_mutex); if (t) { CANCEL_ASYNC }
+#define LOCK_CLIENT(t)      if (t) { CANCEL_DEFER } pthread_mutex_lock(&gpdata->client_mutex);
+#define UNLOCK_CLIENT(t)    pthread_mutex_unlock(&gpdata->client_mutex); if (t) { CANCEL_ASYNC }
 
 struct onMainThread_cb_data {
 	enum { FUNC_UPDATE_SCALE } func;
@@ -152,6 +152,10 @@ static void remmina_plugin_vnc_event_push(RemminaProtocolWidget *gp, gint event_
 	case REMMINA_PLUGIN_VNC_EVENT_CHAT_SEND:
 		event->event_data.text.text = g_strdup((char *)p1);
 		break;
+	case REMMINA_PLUGIN_VNC_EVENT_FORMAT:
+		event->event_data.format.quality = GPOINTER_TO_INT(p1);
+		event->event_data.format.colordepth = GPOINTER_TO_INT(p2);
+		break;
 	default:
 		break;
 	}
@@ -243,6 +247,11 @@ static void remmina_plugin_vnc_update_scale(RemminaProtocolWidget *gp, gboolean
 
 	gpdata = GET_PLUGIN_DATA(gp);
 
+	/* The scaled copy is rebuilt at the next draw */
+	LOCK_BUFFER(FALSE);
+	remmina_plugin_scaler_invalidate(gpdata->scaler);
+	UNLOCK_BUFFER(FALSE);
+
 	width = remmina_plugin_service->protocol_plugin_get_width(gp);
 	height = remmina_plugin_service->protocol_plugin_get_height(gp);
 	if (scale)
@@ -318,6 +327,10 @@ static RemminaPluginVncEvent *remmina_plugin_vnc_event_queue_pop_head(RemminaPlu
 	return event;
 }
 
+static void remmina_plugin_vnc_update_quality(rfbClient *cl, gint quality);
+static void remmina_plugin_vnc_update_colordepth(rfbClient *cl, gint colordepth);
+static rfbBool remmina_plugin_vnc_rfb_allocfb(rfbClient *cl);
+
 static void remmina_plugin_vnc_process_vnc_event(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
@@ -353,6 +366,22 @@ static void remmina_plugin_vnc_process_vnc_event(RemminaProtocolWidget *gp)
 				TextChatClose(cl);
 				TextChatFinish(cl);
 				break;
+			case REMMINA_PLUGIN_VNC_EVENT_REFRESH:
+				/* Not incremental: the updates skipped while hidden are
+				 * not pending on the server any more */
+				SendFramebufferUpdateRequest(cl, 0, 0, cl->width, cl->height, FALSE);
+				break;
+			case REMMINA_PLUGIN_VNC_EVENT_FORMAT:
+				/* The framebuffer may no longer be decoded straight into
+				 * the cairo surface: allocate it again for the new format,
+				 * here, where libvncclient writes to it */
+				remmina_plugin_vnc_update_quality(cl, event->event_data.format.quality);
+				remmina_plugin_vnc_update_colordepth(cl, event->event_data.format.colordepth);
+				if (!remmina_plugin_vnc_rfb_allocfb(cl))
+					break;
+				SetFormatAndEncodings(cl);
+				SendFramebufferUpdateRequest(cl, 0, 0, cl->width, cl->height, FALSE);
+				break;
 			default:
 				rfbClientLog("Ignoring VNC event: 0x%x\n", event->event_type);
 				break;
@@ -473,7 +502,7 @@ static rfbBool remmina_plugin_vnc_rfb_allocfb(rfbClient *cl)
 	RemminaProtocolWidget *gp = rfbClientGetClientData(cl, NULL);
 	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
 	gint width, height, depth, size;
-	gboolean scale;
+	gboolean scale, direct;
 	cairo_surface_t *new_surface, *old_surface;
 
 	width = cl->width;
@@ -481,9 +510,19 @@ static rfbBool remmina_plugin_vnc_rfb_allocfb(rfbClient *cl)
 	depth = cl->format.bitsPerPixel;
 	size = width * height * (depth / 8);
 
-	new_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	/* When the server pixel format is the cairo one, libvncclient decodes
+	 * straight into the surface and no conversion buffer is needed */
+	remmina_plugin_vnc_pixel_format_update(&gpdata->pixel_format, cl->format.bitsPerPixel,
+					       cl->format.redMax, cl->format.greenMax, cl->format.blueMax,
+					       cl->format.redShift, cl->format.greenShift, cl->format.blueShift);
+	direct = remmina_plugin_vnc_pixel_format_is_native(&gpdata->pixel_format);
+
+	new_surface = cairo_image_surface_create(direct ? CAIRO_FORMAT_RGB24 : CAIRO_FORMAT_ARGB32, width, height);
 	if (cairo_surface_status(new_surface) != CAIRO_STATUS_SUCCESS)
 		return FALSE;
+	/* libvncclient expects rows without padding */
+	if (direct && cairo_image_surface_get_stride(new_surface) != width * 4)
+		direct = FALSE;
 	old_surface = gpdata->rgb_buffer;
 
 	LOCK_BUFFER(TRUE);
@@ -495,8 +534,15 @@ static rfbBool remmina_plugin_vnc_rfb_allocfb(rfbClient *cl)
 
 	if (gpdata->vnc_buffer)
 		g_free(gpdata->vnc_buffer);
-	gpdata->vnc_buffer = (guchar *)g_malloc(size);
-	cl->frameBuffer = gpdata->vnc_buffer;
+	if (direct) {
+		gpdata->vnc_buffer = NULL;
+		cl->frameBuffer = cairo_image_surface_get_data(new_surface);
+	} else {
+		gpdata->vnc_buffer = (guchar *)g_malloc(size);
+		cl->frameBuffer = gpdata->vnc_buffer;
+	}
+	REMMINA_PLUGIN_DEBUG("VNC framebuffer %dx%d, %s", width, height,
+			     direct ? "decoded into the cairo surface" : "converted to the cairo surface");
 
 	UNLOCK_BUFFER(TRUE);
 
@@ -528,26 +574,84 @@ static gint remmina_plugin_vnc_bits(gint n)
 	return b ? b : 1;
 }
 
-static gboolean remmina_plugin_vnc_queue_draw_area_real(RemminaProtocolWidget *gp)
+static void remmina_plugin_vnc_present_frame(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
 	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
 	gint x, y, w, h;
 
+	if (gpdata->pacer)
+		remmina_plugin_frame_pacer_presented(gpdata->pacer);
+
+	LOCK_BUFFER(FALSE);
+	x = gpdata->queuedraw_x;
+	y = gpdata->queuedraw_y;
+	w = gpdata->queuedraw_w;
+	h = gpdata->queuedraw_h;
+	gpdata->queuedraw_pending = FALSE;
+	UNLOCK_BUFFER(FALSE);
+
+	if (g_atomic_int_get(&gpdata->reconnecting))
+		/* The progress message is centered in the whole widget */
+		gtk_widget_queue_draw(GTK_WIDGET(gp));
+	else
+		gtk_widget_queue_draw_area(GTK_WIDGET(gp), x, y, w, h);
+}
+
+/* Called by the frame pacer when the update is due */
+static void remmina_plugin_vnc_on_frame(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
+
+	if (gpdata->connected)
+		remmina_plugin_vnc_present_frame(gp);
+}
+
+static gboolean remmina_plugin_vnc_queue_draw_area_real(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
+	gint64 delay;
+
 	if (GTK_IS_WIDGET(gp) && gpdata->connected) {
+		delay = remmina_plugin_frame_pacer_get_delay(gpdata->pacer, gpdata->drawing_area,
+							     g_atomic_int_get(&gpdata->hidden));
+
 		LOCK_BUFFER(FALSE);
-		x = gpdata->queuedraw_x;
-		y = gpdata->queuedraw_y;
-		w = gpdata->queuedraw_w;
-		h = gpdata->queuedraw_h;
 		gpdata->queuedraw_handler = 0;
+		if (delay > 0)
+			/* Too early, come back when the frame is due */
+			gpdata->queuedraw_handler = g_timeout_add((delay + 999) / 1000,
+								  (GSourceFunc)remmina_plugin_vnc_queue_draw_area_real, gp);
 		UNLOCK_BUFFER(FALSE);
 
-		gtk_widget_queue_draw_area(GTK_WIDGET(gp), x, y, w, h);
+		if (delay > 0)
+			return FALSE;
+
+		remmina_plugin_frame_pacer_request(gpdata->pacer);
 	}
 	return FALSE;
 }
 
+static void remmina_plugin_vnc_on_drawing_area_realize(GtkWidget *widget, RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
+
+	if (gpdata->pacer)
+		remmina_plugin_frame_pacer_attach(gpdata->pacer, widget);
+}
+
+static void remmina_plugin_vnc_on_drawing_area_unrealize(GtkWidget *widget, RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
+
+	if (gpdata->pacer)
+		remmina_plugin_frame_pacer_detach(gpdata->pacer);
+}
+
 static void remmina_plugin_vnc_queue_draw_area(RemminaProtocolWidget *gp, gint x, gint y, gint w, gint h)
 {
 	TRACE_CALL(__func__);
@@ -555,7 +659,8 @@ static void remmina_plugin_vnc_queue_draw_area(RemminaProtocolWidget *gp, gint x
 	gint nx2, ny2, ox2, oy2;
 
 	LOCK_BUFFER(TRUE);
-	if (gpdata->queuedraw_handler) {
+	if (gpdata->queuedraw_pending) {
+		/* Already waiting for its frame, just grow the area */
 		nx2 = x + w;
 		ny2 = y + h;
 		ox2 = gpdata->queuedraw_x + gpdata->queuedraw_w;
@@ -569,6 +674,7 @@ static void remmina_plugin_vnc_queue_draw_area(RemminaProtocolWidget *gp, gint x
 		gpdata->queuedraw_y = y;
 		gpdata->queuedraw_w = w;
 		gpdata->queuedraw_h = h;
+		gpdata->queuedraw_pending = TRUE;
 		gpdata->queuedraw_handler = IDLE_ADD((GSourceFunc)remmina_plugin_vnc_queue_draw_area_real, gp);
 	}
 	UNLOCK_BUFFER(TRUE);
@@ -578,6 +684,8 @@ static void remmina_plugin_vnc_rfb_fill_buffer(rfbClient *cl, guchar *dest, gint
 					       gint src_rowstride, guchar *mask, gint w, gint h)
 {
 	TRACE_CALL(__func__);
+	RemminaProtocolWidget *gp = rfbClientGetClientData(cl, NULL);
+	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
 	guchar *srcptr;
 	gint bytesPerPixel;
 	guint32 src_pixel;
@@ -595,6 +703,15 @@ static void remmina_plugin_vnc_rfb_fill_buffer(rfbClient *cl, guchar *dest, gint
 		guint32 argb;
 	} dst_pixel;
 
+	/* Fast path, without the cursor mask */
+	if (!mask) {
+		remmina_plugin_vnc_pixel_format_update(&gpdata->pixel_format, cl->format.bitsPerPixel,
+						       cl->format.redMax, cl->format.greenMax, cl->format.blueMax,
+						       cl->format.redShift, cl->format.greenShift, cl->format.blueShift);
+		if (remmina_plugin_vnc_pixel_convert(&gpdata->pixel_format, dest, dest_rowstride, src, src_rowstride, w, h))
+			return;
+	}
+
 	bytesPerPixel = cl->format.bitsPerPixel / 8;
 	switch (cl->format.bitsPerPixel) {
 	case 32:
@@ -672,7 +789,11 @@ static void remmina_plugin_vnc_rfb_updatefb(rfbClient *cl, int x, int y, int w,
 
 	LOCK_BUFFER(TRUE);
 
-	if (w >= 1 || h >= 1) {
+	if ((w >= 1 || h >= 1) && !gpdata->vnc_buffer) {
+		/* libvncclient already decoded into the surface */
+		cairo_surface_mark_dirty_rectangle(gpdata->rgb_buffer, x, y, w, h);
+	} else if (w >= 1 || h >= 1) {
+		/* Convert from the server pixel format */
 		width = remmina_plugin_service->protocol_plugin_get_width(gp);
 		bytesPerPixel = cl->format.bitsPerPixel / 8;
 		rowstride = cairo_image_surface_get_stride(gpdata->rgb_buffer);
@@ -680,11 +801,13 @@ static void remmina_plugin_vnc_rfb_updatefb(rfbClient *cl, int x, int y, int w,
 		remmina_plugin_vnc_rfb_fill_buffer(cl, cairo_image_surface_get_data(gpdata->rgb_buffer) + y * rowstride + x * 4,
 						   rowstride, gpdata->vnc_buffer + ((y * width + x) * bytesPerPixel), width * bytesPerPixel, NULL,
 						   w, h);
-		cairo_surface_mark_dirty(gpdata->rgb_buffer);
+		cairo_surface_mark_dirty_rectangle(gpdata->rgb_buffer, x, y, w, h);
 	}
 
-	if ((remmina_plugin_service->remmina_protocol_widget_get_current_scale_mode(gp) != REMMINA_PROTOCOL_WIDGET_SCALE_MODE_NONE))
+	if ((remmina_plugin_service->remmina_protocol_widget_get_current_scale_mode(gp) != REMMINA_PROTOCOL_WIDGET_SCALE_MODE_NONE)) {
 		remmina_plugin_vnc_scale_area(gp, &x, &y, &w, &h);
+		remmina_plugin_scaler_damage(gpdata->scaler, x, y, w, h);
+	}
 
 	UNLOCK_BUFFER(TRUE);
 
@@ -1022,10 +1145,15 @@ static gboolean remmina_plugin_vnc_open_chat(RemminaProtocolWidget *gp)
 	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
 	rfbClient *cl;
 
+	LOCK_CLIENT(FALSE);
 	cl = (rfbClient *)gpdata->client;
-
+	if (!cl) {
+		UNLOCK_CLIENT(FALSE);
+		return FALSE;
+	}
 	remmina_plugin_service->protocol_plugin_chat_open(gp, cl->desktopName, remmina_plugin_vnc_chat_on_send,
 							  remmina_plugin_vnc_chat_on_destroy);
+	UNLOCK_CLIENT(FALSE);
 	remmina_plugin_vnc_event_push(gp, REMMINA_PLUGIN_VNC_EVENT_CHAT_OPEN, NULL, NULL, NULL);
 	return FALSE;
 }
@@ -1096,6 +1224,18 @@ static gboolean remmina_plugin_vnc_incoming_connection(RemminaProtocolWidget *gp
 }
 
 
+static void remmina_plugin_vnc_on_visibility_changed(RemminaProtocolWidget *gp, gpointer data)
+{
+	TRACE_CALL(__func__);
+	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
+	gboolean visible = remmina_plugin_service->protocol_plugin_get_visibility(gp);
+
+	g_atomic_int_set(&gpdata->hidden, !visible);
+	/* Wake up the main loop and ask for what changed while hidden */
+	if (visible && gpdata->connected)
+		remmina_plugin_vnc_event_push(gp, REMMINA_PLUGIN_VNC_EVENT_REFRESH, NULL, NULL, NULL);
+}
+
 static gboolean remmina_plugin_vnc_main_loop(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
@@ -1122,6 +1262,17 @@ static gboolean remmina_plugin_vnc_main_loop(RemminaProtocolWidget *gp)
 	if (cl->buffered)
 		goto handle_buffered;
 
+	if (g_atomic_int_get(&gpdata->hidden)) {
+		/* Every handled update makes libvncclient request the next one,
+		 * so reading the server only once per interval throttles a
+		 * hidden session to about one update per interval */
+		timeout.tv_sec = VNC_HIDDEN_POLL_INTERVAL;
+		timeout.tv_usec = 0;
+		FD_ZERO(&fds);
+		FD_SET(gpdata->vnc_event_pipe[0], &fds);
+		select(gpdata->vnc_event_pipe[0] + 1, &fds, NULL, NULL, &timeout);
+	}
+
 	timeout.tv_sec = 10;
 	timeout.tv_usec = 0;
 	FD_ZERO(&fds);
@@ -1142,6 +1293,9 @@ static gboolean remmina_plugin_vnc_main_loop(RemminaProtocolWidget *gp)
 			return TRUE;
 handle_buffered:
 		if (!HandleRFBServerMessage(cl)) {
+			if (gpdata->thread)
+				/* remmina_plugin_vnc_main() reconnects or closes */
+				return FALSE;
 			gpdata->running = FALSE;
 			if (gpdata->connected && !remmina_plugin_service->protocol_plugin_is_closed(gp))
 				remmina_plugin_service->protocol_plugin_signal_connection_closed(gp);
@@ -1160,6 +1314,10 @@ static gboolean remmina_plugin_vnc_main(RemminaProtocolWidget *gp)
 	rfbClient *cl = NULL;
 	gchar *host;
 	gchar *s = NULL;
+	gboolean reconnecting = FALSE;
+	gboolean ret;
+	guint nattempt = 0;
+	gint maxattempts;
 
 	remminafile = remmina_plugin_service->protocol_plugin_get_file(gp);
 	gpdata->running = TRUE;
@@ -1168,8 +1326,29 @@ static gboolean remmina_plugin_vnc_main(RemminaProtocolWidget *gp)
 
 	gint colordepth = remmina_plugin_service->file_get_int(remminafile, "colordepth", 32);
 	gint quality = remmina_plugin_service->file_get_int(remminafile, "quality", 9);
+	maxattempts = remmina_plugin_service->file_get_int(remminafile, "reconnect_attempts", VNC_RECONNECT_ATTEMPTS);
+	gpdata->reconnect_maxattempts = maxattempts;
 
+reconnect:
 	while (gpdata->connected) {
+		if (reconnecting) {
+			/* Back off between attempts, a network change retries at once.
+			 * close_connection() interrupts the wait before cancelling us */
+			CANCEL_DEFER
+			ret = nattempt < maxattempts && remmina_plugin_service->protocol_plugin_reconnect_wait(gp, nattempt);
+			CANCEL_ASYNC
+			if (!ret || !gpdata->connected) {
+				gpdata->connected = FALSE;
+				break;
+			}
+			nattempt++;
+			REMMINA_PLUGIN_DEBUG("Reconnection attempt %u of %d", nattempt, maxattempts);
+			gpdata->reconnect_nattempt = nattempt;
+			remmina_plugin_vnc_queue_draw_area(gp, 0, 0,
+							   remmina_plugin_service->protocol_plugin_get_width(gp),
+							   remmina_plugin_service->protocol_plugin_get_height(gp));
+		}
+
 		gpdata->auth_called = FALSE;
 
 		host = remmina_plugin_service->protocol_plugin_start_direct_tunnel(gp, 5900, TRUE);
@@ -1297,6 +1476,10 @@ static gboolean remmina_plugin_vnc_main(RemminaProtocolWidget *gp)
 			REMMINA_PLUGIN_DEBUG("Client initialization failed");
 		}
 
+		/* The server is not back yet */
+		if (reconnecting && !gpdata->auth_called && gpdata->connected)
+			continue;
+
 		/* If the authentication is not called, it has to be a fatal error and must quit */
 		if (!gpdata->auth_called) {
 			REMMINA_PLUGIN_DEBUG("Client not authenticated");
@@ -1337,11 +1520,20 @@ static gboolean remmina_plugin_vnc_main(RemminaProtocolWidget *gp)
 	}
 
 	REMMINA_PLUGIN_DEBUG("Client connected");
-	remmina_plugin_service->protocol_plugin_init_save_cred(gp);
 
+	LOCK_CLIENT(gpdata->thread);
 	gpdata->client = cl;
+	UNLOCK_CLIENT(gpdata->thread);
 
-	remmina_plugin_service->protocol_plugin_signal_connection_opened(gp);
+	if (reconnecting) {
+		REMMINA_PLUGIN_DEBUG("Reconnected");
+		reconnecting = FALSE;
+		g_atomic_int_set(&gpdata->reconnecting, FALSE);
+		remmina_plugin_vnc_queue_draw_area(gp, 0, 0, cl->width, cl->height);
+	} else {
+		remmina_plugin_service->protocol_plugin_init_save_cred(gp);
+		remmina_plugin_service->protocol_plugin_signal_connection_opened(gp);
+	}
 
 	if (remmina_plugin_service->file_get_int(remminafile, "disableserverinput", FALSE))
 		PermitServerInput(cl, 1);
@@ -1349,7 +1541,29 @@ static gboolean remmina_plugin_vnc_main(RemminaProtocolWidget *gp)
 	if (gpdata->thread) {
 		while (remmina_plugin_vnc_main_loop(gp)) {
 		}
+		if (gpdata->connected && !cl->listenSpecified && maxattempts > 0 &&
+		    !remmina_plugin_service->protocol_plugin_is_closed(gp)) {
+			/* The server went away, reopen the connection (and the SSH
+			 * tunnel if it died too) with the same settings */
+			REMMINA_PLUGIN_DEBUG("Connection lost, reconnecting");
+			LOCK_CLIENT(TRUE);
+			gpdata->client = NULL;
+			UNLOCK_CLIENT(TRUE);
+			rfbClientCleanup(cl);
+			cl = NULL;
+			reconnecting = TRUE;
+			nattempt = 0;
+			gpdata->reconnect_nattempt = 0;
+			g_atomic_int_set(&gpdata->reconnecting, TRUE);
+			remmina_plugin_vnc_queue_draw_area(gp, 0, 0,
+							   remmina_plugin_service->protocol_plugin_get_width(gp),
+							   remmina_plugin_service->protocol_plugin_get_height(gp));
+			gpdata->auth_first = TRUE;
+			goto reconnect;
+		}
 		gpdata->running = FALSE;
+		if (gpdata->connected && !remmina_plugin_service->protocol_plugin_is_closed(gp))
+			remmina_plugin_service->protocol_plugin_signal_connection_closed(gp);
 	} else {
 		IDLE_ADD((GSourceFunc)remmina_plugin_vnc_main_loop, gp);
 	}
@@ -1713,6 +1927,9 @@ static gboolean remmina_plugin_vnc_close_connection_timeout(RemminaProtocolWidge
 		g_source_remove(gpdata->queuedraw_handler);
 		gpdata->queuedraw_handler = 0;
 	}
+	gpdata->queuedraw_pending = FALSE;
+	remmina_plugin_frame_pacer_free(gpdata->pacer);
+	gpdata->pacer = NULL;
 	if (gpdata->listen_sock >= 0)
 		close(gpdata->listen_sock);
 	if (gpdata->client) {
@@ -1723,6 +1940,8 @@ static gboolean remmina_plugin_vnc_close_connection_timeout(RemminaProtocolWidge
 		cairo_surface_destroy(gpdata->rgb_buffer);
 		gpdata->rgb_buffer = NULL;
 	}
+	remmina_plugin_scaler_free(gpdata->scaler);
+	gpdata->scaler = NULL;
 	if (gpdata->vnc_buffer) {
 		g_free(gpdata->vnc_buffer);
 		gpdata->vnc_buffer = NULL;
@@ -1737,6 +1956,7 @@ static gboolean remmina_plugin_vnc_close_connection_timeout(RemminaProtocolWidge
 
 
 	pthread_mutex_destroy(&gpdata->buffer_mutex);
+	pthread_mutex_destroy(&gpdata->client_mutex);
 	remmina_plugin_service->protocol_plugin_signal_connection_closed(gp);
 
 	return FALSE;
@@ -1748,6 +1968,8 @@ static gboolean remmina_plugin_vnc_close_connection(RemminaProtocolWidget *gp)
 	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
 
 	gpdata->connected = FALSE;
+	/* Do not wait for the next reconnection attempt */
+	remmina_plugin_service->protocol_plugin_reconnect_interrupt(gp);
 
 	if (gpdata->thread) {
 		pthread_cancel(gpdata->thread);
@@ -1765,12 +1987,19 @@ static gboolean remmina_plugin_vnc_query_feature(RemminaProtocolWidget *gp, cons
 {
 	TRACE_CALL(__func__);
 	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
+	gboolean ret;
 
 	switch (feature->id) {
 	case REMMINA_PLUGIN_VNC_FEATURE_PREF_DISABLESERVERINPUT:
-		return SupportsClient2Server((rfbClient *)(gpdata->client), rfbSetServerInput) ? TRUE : FALSE;
+		LOCK_CLIENT(FALSE);
+		ret = gpdata->client && SupportsClient2Server((rfbClient *)(gpdata->client), rfbSetServerInput);
+		UNLOCK_CLIENT(FALSE);
+		return ret;
 	case REMMINA_PLUGIN_VNC_FEATURE_TOOL_CHAT:
-		return SupportsClient2Server((rfbClient *)(gpdata->client), rfbTextChat) ? TRUE : FALSE;
+		LOCK_CLIENT(FALSE);
+		ret = gpdata->client && SupportsClient2Server((rfbClient *)(gpdata->client), rfbTextChat);
+		UNLOCK_CLIENT(FALSE);
+		return ret;
 	default:
 		return TRUE;
 	}
@@ -1785,17 +2014,21 @@ static void remmina_plugin_vnc_call_feature(RemminaProtocolWidget *gp, const Rem
 	remminafile = remmina_plugin_service->protocol_plugin_get_file(gp);
 	switch (feature->id) {
 	case REMMINA_PLUGIN_VNC_FEATURE_PREF_QUALITY:
-		remmina_plugin_vnc_update_quality((rfbClient *)(gpdata->client),
-						  remmina_plugin_service->file_get_int(remminafile, "quality", 9));
-		remmina_plugin_vnc_update_colordepth((rfbClient *)(gpdata->client),
-						     remmina_plugin_service->file_get_int(remminafile, "colordepth", 32));
-		SetFormatAndEncodings((rfbClient *)(gpdata->client));
+		/* Applied by the VNC thread. Reconnecting, the new client
+		 * picks the settings up and the event is dropped */
+		remmina_plugin_vnc_event_push(gp, REMMINA_PLUGIN_VNC_EVENT_FORMAT,
+					      GINT_TO_POINTER(remmina_plugin_service->file_get_int(remminafile, "quality", 9)),
+					      GINT_TO_POINTER(remmina_plugin_service->file_get_int(remminafile, "colordepth", 32)),
+					      NULL);
 		break;
 	case REMMINA_PLUGIN_VNC_FEATURE_PREF_VIEWONLY:
 		break;
 	case REMMINA_PLUGIN_VNC_FEATURE_PREF_DISABLESERVERINPUT:
-		PermitServerInput((rfbClient *)(gpdata->client),
-				  remmina_plugin_service->file_get_int(remminafile, "disableserverinput", FALSE) ? 1 : 0);
+		LOCK_CLIENT(FALSE);
+		if (gpdata->client)
+			PermitServerInput((rfbClient *)(gpdata->client),
+					  remmina_plugin_service->file_get_int(remminafile, "disableserverinput", FALSE) ? 1 : 0);
+		UNLOCK_CLIENT(FALSE);
 		break;
 	case REMMINA_PLUGIN_VNC_FEATURE_UNFOCUS:
 		remmina_plugin_vnc_release_key(gp, 0);
@@ -1804,9 +2037,12 @@ static void remmina_plugin_vnc_call_feature(RemminaProtocolWidget *gp, const Rem
 		remmina_plugin_vnc_update_scale(gp, remmina_plugin_service->file_get_int(remminafile, "scale", FALSE));
 		break;
 	case REMMINA_PLUGIN_VNC_FEATURE_TOOL_REFRESH:
-		SendFramebufferUpdateRequest((rfbClient *)(gpdata->client), 0, 0,
-					     remmina_plugin_service->protocol_plugin_get_width(gp),
-					     remmina_plugin_service->protocol_plugin_get_height(gp), FALSE);
+		LOCK_CLIENT(FALSE);
+		if (gpdata->client)
+			SendFramebufferUpdateRequest((rfbClient *)(gpdata->client), 0, 0,
+						     remmina_plugin_service->protocol_plugin_get_width(gp),
+						     remmina_plugin_service->protocol_plugin_get_height(gp), FALSE);
+		UNLOCK_CLIENT(FALSE);
 		break;
 	case REMMINA_PLUGIN_VNC_FEATURE_TOOL_CHAT:
 		remmina_plugin_vnc_open_chat(gp);
@@ -1834,9 +2070,29 @@ static gboolean remmina_plugin_vnc_on_draw(GtkWidget *widget, cairo_t *context,
 {
 	TRACE_CALL(__func__);
 	RemminaPluginVncData *gpdata = GET_PLUGIN_DATA(gp);
-	cairo_surface_t *surface;
+	cairo_surface_t *surface, *scaled;
 	gint width, height;
 	GtkAllocation widget_allocation;
+	cairo_text_extents_t extents;
+	gchar *msg;
+
+	if (g_atomic_int_get(&gpdata->reconnecting)) {
+		/* The server is gone, just show a message to the user */
+		width = gtk_widget_get_allocated_width(widget);
+		height = gtk_widget_get_allocated_height(widget);
+
+		msg = g_strdup_printf(_("Reconnection attempt %d of %d…"),
+				      gpdata->reconnect_nattempt, gpdata->reconnect_maxattempts);
+
+		cairo_select_font_face(context, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+		cairo_set_font_size(context, 24);
+		cairo_set_source_rgb(context, 0.9, 0.9, 0.9);
+		cairo_text_extents(context, msg, &extents);
+		cairo_move_to(context, (width - (extents.width + extents.x_bearing)) / 2, (height - (extents.height + extents.y_bearing)) / 2);
+		cairo_show_text(context, msg);
+		g_free(msg);
+		return TRUE;
+	}
 
 	LOCK_BUFFER(FALSE);
 
@@ -1851,9 +2107,20 @@ static gboolean remmina_plugin_vnc_on_draw(GtkWidget *widget, cairo_t *context,
 
 	if ((remmina_plugin_service->remmina_protocol_widget_get_current_scale_mode(gp) != REMMINA_PROTOCOL_WIDGET_SCALE_MODE_NONE)) {
 		gtk_widget_get_allocation(widget, &widget_allocation);
-		cairo_scale(context,
-			    (double)widget_allocation.width / width,
-			    (double)widget_allocation.height / height);
+		if (widget_allocation.width != width || widget_allocation.height != height) {
+			/* Only the damaged areas are resampled, then painted 1:1 */
+			scaled = remmina_plugin_scaler_update(gpdata->scaler, surface, widget_allocation.width, widget_allocation.height,
+							      remmina_plugin_service->pref_get_scale_quality());
+			if (scaled) {
+				surface = scaled;
+				width = widget_allocation.width;
+				height = widget_allocation.height;
+			} else {
+				cairo_scale(context,
+					    (double)widget_allocation.width / width,
+					    (double)widget_allocation.height / height);
+			}
+		}
 	}
 
 	cairo_rectangle(context, 0, 0, width, height);
@@ -1898,11 +2165,19 @@ static void remmina_plugin_vnc_init(RemminaProtocolWidget *gp)
 
 
 	g_signal_connect(G_OBJECT(gpdata->drawing_area), "draw", G_CALLBACK(remmina_plugin_vnc_on_draw), gp);
+	g_signal_connect(G_OBJECT(gpdata->drawing_area), "realize", G_CALLBACK(remmina_plugin_vnc_on_drawing_area_realize), gp);
+	g_signal_connect(G_OBJECT(gpdata->drawing_area), "unrealize", G_CALLBACK(remmina_plugin_vnc_on_drawing_area_unrealize), gp);
+	g_signal_connect(G_OBJECT(gp), "visibility-changed", G_CALLBACK(remmina_plugin_vnc_on_visibility_changed), NULL);
+	/* The session may be started in a hidden tab or an iconified window */
+	g_atomic_int_set(&gpdata->hidden, !remmina_plugin_service->protocol_plugin_get_visibility(gp));
 
 	gpdata->auth_first = TRUE;
 	gpdata->clipboard_timer = g_date_time_new_now_utc();
 	gpdata->listen_sock = -1;
+	gpdata->pacer = remmina_plugin_frame_pacer_new(remmina_plugin_service->file_get_int(remminafile, "framerate_max", 0),
+						       (RemminaPluginFramePacerFunc)remmina_plugin_vnc_on_frame, gp);
 	gpdata->pressed_keys = g_ptr_array_new();
+	gpdata->scaler = remmina_plugin_scaler_new();
 	gpdata->vnc_event_queue = g_queue_new();
 	pthread_mutex_init(&gpdata->vnc_event_queue_mutex, NULL);
 	if (pipe(gpdata->vnc_event_pipe)) {
@@ -1914,6 +2189,7 @@ static void remmina_plugin_vnc_init(RemminaProtocolWidget *gp)
 	fcntl(gpdata->vnc_event_pipe[0], F_SETFL, flags | O_NONBLOCK);
 
 	pthread_mutex_init(&gpdata->buffer_mutex, NULL);
+	pthread_mutex_init(&gpdata->client_mutex, NULL);
 }
 
 /* Array of key/value pairs for color depths */
@@ -2004,6 +2280,8 @@ static const RemminaProtocolSetting remmina_plugin_vnci_basic_settings[] =
  */
 static const RemminaProtocolSetting remmina_plugin_vnc_advanced_settings[] =
 {
+	{ REMMINA_PROTOCOL_SETTING_TYPE_TEXT,  "framerate_max",		 N_("Maximum frame rate"),			TRUE,  NULL, N_("Frames per second, 0 follows the monitor refresh rate (default: 0)") },
+	{ REMMINA_PROTOCOL_SETTING_TYPE_TEXT,  "reconnect_attempts",	 N_("Reconnection attempts"),			TRUE,  NULL, N_("Attempts to reopen a lost connection, 0 disables it (default: 0)") },
 	{ REMMINA_PROTOCOL_SETTING_TYPE_CHECK, "showcursor",		 N_("Show remote cursor"),			TRUE,  NULL, NULL },
 	{ REMMINA_PROTOCOL_SETTING_TYPE_CHECK, "viewonly",		 N_("View only"),				FALSE, NULL, NULL },
 	{ REMMINA_PROTOCOL_SETTING_TYPE_CHECK, "disableclipboard",	 N_("Turn off clipboard sync"),			TRUE,  NULL, NULL },
@@ -2085,6 +2363,8 @@ remmina_plugin_entry(RemminaPluginService *service)
 	TRACE_CALL(__func__);
 	remmina_plugin_service = service;
 
+	REMMINA_PLUGIN_DEBUG("VNC pixel conversion: using %s kernels", remmina_plugin_vnc_pixel_get_kernel_name());
+
 	bindtextdomain(GETTEXT_PACKAGE, REMMINA_RUNTIME_LOCALEDIR);
 	bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
 
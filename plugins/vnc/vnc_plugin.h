@@ -34,6 +34,10 @@
 
 #pragma once
 
+#include "common/remmina_scaler.h"
+#include "common/remmina_frame_pacer.h"
+#include "vnc_pixel.h"
+
 #ifndef __PLUGIN_CONFIG_H
 #define __PLUGIN_CONFIG_H
 
@@ -49,6 +53,13 @@
 #define VNCI_PLUGIN_SSH_APPICON     "remmina-vnc-ssh-symbolic"
 #endif
 
+/* Seconds between two server reads while the session is hidden */
+#define VNC_HIDDEN_POLL_INTERVAL 1
+/* Attempts made to reopen a lost connection, unless set in the profile.
+ * Off by default: a server also closes the connection on purpose, on
+ * logout or when another viewer takes it over */
+#define VNC_RECONNECT_ATTEMPTS 0
+
 typedef struct _RemminaPluginVncData {
 	/* Whether the user requests to connect/disconnect */
 	gboolean		connected;
@@ -62,10 +73,17 @@ typedef struct _RemminaPluginVncData {
 	GtkWidget *		drawing_area;
 	guchar *		vnc_buffer;
 	cairo_surface_t *	rgb_buffer;
+	RemminaPluginScaler *	scaler;
+	RemminaPluginVncPixelFormat	pixel_format;
 
 	gint			queuedraw_x, queuedraw_y, queuedraw_w, queuedraw_h;
+	gboolean		queuedraw_pending;
 	guint			queuedraw_handler;
 
+	/* Frame pacing of the screen updates, the GTK thread only */
+	RemminaPluginFramePacer *pacer;
+	gint			hidden;
+
 	gulong			clipboard_handler;
 	GDateTime		*clipboard_timer;
 
@@ -73,9 +91,17 @@ typedef struct _RemminaPluginVncData {
 	gint			queuecursor_x, queuecursor_y;
 	guint			queuecursor_handler;
 
+	/* Replaced by the VNC thread on reconnection, the GTK thread must
+	 * hold client_mutex while it uses it */
 	gpointer		client;
+	pthread_mutex_t		client_mutex;
 	gint			listen_sock;
 
+	/* Reconnection progress, shown instead of the screen */
+	gint			reconnecting;
+	guint			reconnect_nattempt;
+	gint			reconnect_maxattempts;
+
 	gint			button_mask;
 
 	GPtrArray *		pressed_keys;
@@ -97,7 +123,9 @@ enum {
 	REMMINA_PLUGIN_VNC_EVENT_CUTTEXT,
 	REMMINA_PLUGIN_VNC_EVENT_CHAT_OPEN,
 	REMMINA_PLUGIN_VNC_EVENT_CHAT_SEND,
-	REMMINA_PLUGIN_VNC_EVENT_CHAT_CLOSE
+	REMMINA_PLUGIN_VNC_EVENT_CHAT_CLOSE,
+	REMMINA_PLUGIN_VNC_EVENT_REFRESH,
+	REMMINA_PLUGIN_VNC_EVENT_FORMAT
 };
 
 typedef struct _RemminaPluginVncEvent {
@@ -115,6 +143,10 @@ typedef struct _RemminaPluginVncEvent {
 		struct {
 			gchar *text;
 		} text;
+		struct {
+			gint	quality;
+			gint	colordepth;
+		} format;
 	} event_data;
 } RemminaPluginVncEvent;
 
@@ -80,9 +80,10 @@
 		rm_plugin_service->_remmina_message("[%s] " fmt, \
 						    PLUGIN_NAME, ##__VA_ARGS__)
 
+#undef REMMINA_PLUGIN_DEBUG
 #define REMMINA_PLUGIN_DEBUG(fmt, ...)\
-		rm_plugin_service->_remmina_debug(__func__, "[%s] " fmt, \
-						  PLUGIN_NAME, ##__VA_ARGS__)
+		REMMINA_PLUGIN_SERVICE_DEBUG(rm_plugin_service, "[%s] " fmt, \
+					     PLUGIN_NAME, ##__VA_ARGS__)
 
 #define REMMINA_PLUGIN_WARNING(fmt, ...)\
 		rm_plugin_service->_remmina_warning(__func__, "[%s] " fmt, \
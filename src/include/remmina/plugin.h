@@ -234,6 +234,10 @@ typedef struct _RemminaPluginService {
 	gboolean (*gtksocket_available)(void);
 	gint (*get_profile_remote_width)(RemminaProtocolWidget *gp);
 	gint (*get_profile_remote_height)(RemminaProtocolWidget *gp);
+	gboolean (*log_enabled)(GLogLevelFlags level);
+	gboolean (*protocol_plugin_get_visibility)(RemminaProtocolWidget *gp);
+	gboolean (*protocol_plugin_reconnect_wait)(RemminaProtocolWidget *gp, guint attempt);
+	void (*protocol_plugin_reconnect_interrupt)(RemminaProtocolWidget *gp);
 } RemminaPluginService;
 
 /* "Prototype" of the plugin entry function */
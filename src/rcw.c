@@ -57,6 +57,7 @@
 #include "remmina_pref.h"
 #include "remmina_protocol_widget.h"
 #include "remmina_public.h"
+#include "remmina_screenshot.h"
 #include "remmina_scrolled_viewport.h"
 #include "remmina_utils.h"
 #include "remmina_widget_pool.h"
@@ -2073,74 +2074,194 @@ static void rcw_toolbar_duplicate(GtkToolItem *toggle, RemminaConnectionWindow *
 	remmina_exec_command(REMMINA_COMMAND_CONNECT, cnnobj->remmina_file->filename);
 }
 
+/* Screenshots taken at once with rcw_screenshot_all() */
+typedef struct _RcwScreenshotBatch {
+	gint		pending;
+	gint		saved;
+	gint		failed;
+	/* First error, for the failure notification */
+	gchar *		error;
+	/* File names already used, tabs of the same profile share a timestamp */
+	GHashTable *	basenames;
+} RcwScreenshotBatch;
+
+/* Screenshot file name without extension, from the name template of the preferences */
+static gchar *rcw_screenshot_basename(RemminaConnectionObject *cnnobj, GDateTime *date)
+{
+	TRACE_CALL(__func__);
+	GString *str;
+	gchar *value;
+
+	str = g_string_new(NULL);
+	g_string_printf(str, "%s/%s", remmina_pref.screenshot_path, remmina_pref.screenshot_name);
+	remmina_utils_string_replace_all(str, "%p",
+					 remmina_file_get_string(cnnobj->remmina_file, "name"));
+	remmina_utils_string_replace_all(str, "%h",
+					 remmina_file_get_string(cnnobj->remmina_file, "server"));
+	value = g_date_time_format(date, "%Y");
+	remmina_utils_string_replace_all(str, "%Y", value);
+	g_free(value);
+	value = g_date_time_format(date, "%m");
+	remmina_utils_string_replace_all(str, "%m", value);
+	g_free(value);
+	value = g_date_time_format(date, "%d");
+	remmina_utils_string_replace_all(str, "%d", value);
+	g_free(value);
+	value = g_date_time_format(date, "%H");
+	remmina_utils_string_replace_all(str, "%H", value);
+	g_free(value);
+	value = g_date_time_format(date, "%M");
+	remmina_utils_string_replace_all(str, "%M", value);
+	g_free(value);
+	value = g_date_time_format(date, "%S");
+	remmina_utils_string_replace_all(str, "%S", value);
+	g_free(value);
+
+	return g_string_free(str, FALSE);
+}
+
+static void rcw_screenshot_done(RemminaProtocolWidget *gp, const gchar *filename, GdkPixbuf *pixbuf, const GError *error, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+
+	if (error) {
+		// TRANSLATORS: Notification title when a screenshot could not be saved
+		remmina_public_send_notification("remmina-screenshot-failed-id", _("Screenshot failed"), error->message);
+		return;
+	}
+
+	// Transfer the PixBuf in the main clipboard selection
+	if (pixbuf)
+		gtk_clipboard_set_image(gtk_clipboard_get(GDK_SELECTION_CLIPBOARD), pixbuf);
+
+	/* send a desktop notification */
+	remmina_public_send_notification("remmina-screenshot-is-ready-id", _("Screenshot taken"), filename);
+}
+
+static void rcw_screenshot_batch_done(RemminaProtocolWidget *gp, const gchar *filename, GdkPixbuf *pixbuf, const GError *error, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RcwScreenshotBatch *batch = user_data;
+	gchar *message;
+
+	if (error) {
+		batch->failed++;
+		if (!batch->error)
+			batch->error = g_strdup(error->message);
+	} else if (gp) {
+		batch->saved++;
+	}
+	if (--batch->pending > 0)
+		return;
+
+	if (batch->saved > 0) {
+		message = g_strdup_printf(ngettext("%d screenshot saved in %s.", "%d screenshots saved in %s.", batch->saved),
+					  batch->saved, remmina_pref.screenshot_path);
+		remmina_public_send_notification("remmina-screenshot-is-ready-id", _("Screenshots taken"), message);
+		g_free(message);
+	}
+	if (batch->failed > 0) {
+		message = g_strdup_printf(ngettext("%d screenshot could not be taken. %s", "%d screenshots could not be taken. %s", batch->failed),
+					  batch->failed, batch->error);
+		remmina_public_send_notification("remmina-screenshot-failed-id", _("Screenshot failed"), message);
+		g_free(message);
+	}
+	g_hash_table_destroy(batch->basenames);
+	g_free(batch->error);
+	g_free(batch);
+}
+
+static gboolean rcw_screenshot_all_cb(GtkWidget *widget, gpointer data)
+{
+	TRACE_CALL(__func__);
+	RcwScreenshotBatch *batch;
+	RemminaConnectionWindow *cnnwin;
+	RemminaConnectionObject *cnnobj;
+	GDateTime *date;
+	gchar *basename, *unique;
+	gint i, n, k;
+
+	if (!REMMINA_IS_CONNECTION_WINDOW(widget))
+		return FALSE;
+	cnnwin = (RemminaConnectionWindow *)widget;
+	if (!cnnwin->priv->notebook)
+		return FALSE;
+
+	batch = data;
+	date = g_date_time_new_now_utc();
+	n = gtk_notebook_get_n_pages(GTK_NOTEBOOK(cnnwin->priv->notebook));
+	for (i = 0; i < n; i++) {
+		cnnobj = rcw_get_cnnobj_at_page(cnnwin, i);
+		if (!cnnobj || !cnnobj->connected)
+			continue;
+		/* Tabs not shown can only be taken from the plugin framebuffer */
+		basename = rcw_screenshot_basename(cnnobj, date);
+		unique = g_strdup(basename);
+		for (k = 2; g_hash_table_contains(batch->basenames, unique); k++) {
+			g_free(unique);
+			unique = g_strdup_printf("%s-%d", basename, k);
+		}
+		g_free(basename);
+		g_hash_table_add(batch->basenames, unique);
+		batch->pending++;
+		remmina_screenshot_take(REMMINA_PROTOCOL_WIDGET(cnnobj->proto), unique, FALSE, rcw_screenshot_batch_done, batch);
+	}
+	g_date_time_unref(date);
+
+	return TRUE;
+}
+
+/* Take a screenshot of every connection of every window */
+void rcw_screenshot_all(void)
+{
+	TRACE_CALL(__func__);
+	RcwScreenshotBatch *batch;
+
+	batch = g_new0(RcwScreenshotBatch, 1);
+	batch->basenames = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	/* Held until every screenshot has been requested */
+	batch->pending = 1;
+	remmina_widget_pool_foreach(rcw_screenshot_all_cb, batch);
+	rcw_screenshot_batch_done(NULL, NULL, NULL, NULL, batch);
+}
+
 static void rcw_toolbar_screenshot(GtkToolItem *toggle, RemminaConnectionWindow *cnnwin)
 {
 	TRACE_CALL(__func__);
 
-	GdkPixbuf *screenshot;
-	GdkWindow *active_window;
-	cairo_t *cr;
-	gint width, height;
-	GString *pngstr;
-	gchar *pngname;
 	GtkWidget *dialog;
-	RemminaProtocolWidget *gp;
-	RemminaPluginScreenshotData rpsd;
 	RemminaConnectionObject *cnnobj;
-	cairo_surface_t *srcsurface;
-	cairo_format_t cairo_format;
-	cairo_surface_t *surface;
-	int stride;
+	GdkModifierType state;
+	GDateTime *date;
+	gchar *basename;
+	gchar *denyclip;
+	gboolean with_pixbuf;
 
 	if (cnnwin->priv->toolbar_is_reconfiguring)
 		return;
-	if (!(cnnobj = rcw_get_visible_cnnobj(cnnwin))) return;
 
-	GDateTime *date = g_date_time_new_now_utc();
+	/* Shift takes all the connections at once */
+	if (gtk_get_current_event_state(&state) && (state & GDK_SHIFT_MASK)) {
+		rcw_screenshot_all();
+		return;
+	}
 
-	// We will take a screenshot of the currently displayed RemminaProtocolWidget.
-	gp = REMMINA_PROTOCOL_WIDGET(cnnobj->proto);
+	if (!(cnnobj = rcw_get_visible_cnnobj(cnnwin))) return;
 
-	gchar *denyclip = remmina_pref_get_value("deny_screenshot_clipboard");
+	denyclip = remmina_pref_get_value("deny_screenshot_clipboard");
 	REMMINA_DEBUG ("deny_screenshot_clipboard is set to %s", denyclip);
+	with_pixbuf = denyclip && g_strcmp0(denyclip, "true");
+	g_free(denyclip);
 
-	GtkClipboard *c = gtk_clipboard_get(GDK_SELECTION_CLIPBOARD);
-	// Ask the plugin if it can give us a screenshot
-	if (remmina_protocol_widget_plugin_screenshot(gp, &rpsd)) {
-		// Good, we have a screenshot from the plugin !
-
-		REMMINA_DEBUG("Screenshot from plugin: w=%d h=%d bpp=%d bytespp=%d\n",
-				   rpsd.width, rpsd.height, rpsd.bitsPerPixel, rpsd.bytesPerPixel);
-
-		width = rpsd.width;
-		height = rpsd.height;
-
-		if (rpsd.bitsPerPixel == 32)
-			cairo_format = CAIRO_FORMAT_ARGB32;
-		else if (rpsd.bitsPerPixel == 24)
-			cairo_format = CAIRO_FORMAT_RGB24;
-		else
-			cairo_format = CAIRO_FORMAT_RGB16_565;
-
-		stride = cairo_format_stride_for_width(cairo_format, width);
-
-		srcsurface = cairo_image_surface_create_for_data(rpsd.buffer, cairo_format, width, height, stride);
-		// Transfer the PixBuf in the main clipboard selection
-		if (denyclip && (g_strcmp0 (denyclip, "true")))
-			gtk_clipboard_set_image(c, gdk_pixbuf_get_from_surface(
-							srcsurface, 0, 0, width, height));
-		surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
-		cr = cairo_create(surface);
-		cairo_set_source_surface(cr, srcsurface, 0, 0);
-		cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-		cairo_paint(cr);
-		cairo_surface_destroy(srcsurface);
-
-		free(rpsd.buffer);
-	} else {
-		// The plugin is not releasing us a screenshot, just try to catch one via GTK
+	date = g_date_time_new_now_utc();
+	basename = rcw_screenshot_basename(cnnobj, date);
+	g_date_time_unref(date);
 
-		/* Warn the user if image is distorted */
+	// We will take a screenshot of the currently displayed RemminaProtocolWidget,
+	// it is encoded and saved in background
+	if (!remmina_screenshot_take(REMMINA_PROTOCOL_WIDGET(cnnobj->proto), basename, with_pixbuf, rcw_screenshot_done, NULL)) {
+		/* The plugin is not releasing us a screenshot, it has been caught via GTK:
+		 * warn the user if image is distorted */
 		if (cnnobj->plugin_can_scale &&
 		    get_current_allowed_scale_mode(cnnobj, NULL, NULL) == REMMINA_PROTOCOL_WIDGET_SCALE_MODE_SCALED) {
 			dialog = gtk_message_dialog_new(NULL, GTK_DIALOG_MODAL, GTK_MESSAGE_WARNING, GTK_BUTTONS_OK,
@@ -2148,67 +2269,8 @@ static void rcw_toolbar_screenshot(GtkToolItem *toggle, RemminaConnectionWindow
 			g_signal_connect(G_OBJECT(dialog), "response", G_CALLBACK(gtk_widget_destroy), NULL);
 			gtk_widget_show(dialog);
 		}
-
-		// Get the screenshot.
-		active_window = gtk_widget_get_window(GTK_WIDGET(gp));
-		// width = gdk_window_get_width(gtk_widget_get_window(GTK_WIDGET(cnnobj->cnnwin)));
-		width = gdk_window_get_width(active_window);
-		// height = gdk_window_get_height(gtk_widget_get_window(GTK_WIDGET(cnnobj->cnnwin)));
-		height = gdk_window_get_height(active_window);
-
-		screenshot = gdk_pixbuf_get_from_window(active_window, 0, 0, width, height);
-		if (screenshot == NULL)
-			g_print("gdk_pixbuf_get_from_window failed\n");
-
-		// Transfer the PixBuf in the main clipboard selection
-		if (denyclip && (g_strcmp0 (denyclip, "true")))
-			gtk_clipboard_set_image(c, screenshot);
-		// Prepare the destination Cairo surface.
-		surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width, height);
-		cr = cairo_create(surface);
-
-		// Copy the source pixbuf to the surface and paint it.
-		gdk_cairo_set_source_pixbuf(cr, screenshot, 0, 0);
-		cairo_paint(cr);
-
-		// Deallocate screenshot pixbuf
-		g_object_unref(screenshot);
 	}
-
-	//home/antenore/Pictures/remmina_%p_%h_%Y  %m %d-%H%M%S.png pngname
-	//home/antenore/Pictures/remmina_st_  _2018 9 24-151958.240374.png
-
-	pngstr = g_string_new(g_strdup_printf("%s/%s.png",
-					      remmina_pref.screenshot_path,
-					      remmina_pref.screenshot_name));
-	remmina_utils_string_replace_all(pngstr, "%p",
-					 remmina_file_get_string(cnnobj->remmina_file, "name"));
-	remmina_utils_string_replace_all(pngstr, "%h",
-					 remmina_file_get_string(cnnobj->remmina_file, "server"));
-	remmina_utils_string_replace_all(pngstr, "%Y",
-					 g_strdup_printf("%d", g_date_time_get_year(date)));
-	remmina_utils_string_replace_all(pngstr, "%m", g_strdup_printf("%02d",
-								       g_date_time_get_month(date)));
-	remmina_utils_string_replace_all(pngstr, "%d",
-					 g_strdup_printf("%02d", g_date_time_get_day_of_month(date)));
-	remmina_utils_string_replace_all(pngstr, "%H",
-					 g_strdup_printf("%02d", g_date_time_get_hour(date)));
-	remmina_utils_string_replace_all(pngstr, "%M",
-					 g_strdup_printf("%02d", g_date_time_get_minute(date)));
-	remmina_utils_string_replace_all(pngstr, "%S",
-					 g_strdup_printf("%02d", g_date_time_get_second(date)));
-	g_date_time_unref(date);
-	pngname = g_string_free(pngstr, FALSE);
-
-	cairo_surface_write_to_png(surface, pngname);
-
-	/* send a desktop notification */
-	if (g_file_test(pngname, G_FILE_TEST_EXISTS))
-		remmina_public_send_notification("remmina-screenshot-is-ready-id", _("Screenshot taken"), pngname);
-
-	//Clean up and return.
-	cairo_destroy(cr);
-	cairo_surface_destroy(surface);
+	g_free(basename);
 }
 
 static void rcw_toolbar_minimize(GtkToolItem *toggle, RemminaConnectionWindow *cnnwin)
@@ -2490,7 +2552,7 @@ rcw_create_toolbar(RemminaConnectionWindow *cnnwin, gint mode)
 
 	toolitem = gtk_tool_button_new(NULL, "_Screenshot");
 	gtk_tool_button_set_icon_name(GTK_TOOL_BUTTON(toolitem), "remmina-camera-photo-symbolic");
-	rcw_set_tooltip(GTK_WIDGET(toolitem), _("Screenshot"), remmina_pref.shortcutkey_screenshot, 0);
+	rcw_set_tooltip(GTK_WIDGET(toolitem), _("Screenshot, Shift for all the connections"), remmina_pref.shortcutkey_screenshot, 0);
 	gtk_toolbar_insert(GTK_TOOLBAR(toolbar), toolitem, -1);
 	gtk_widget_show(GTK_WIDGET(toolitem));
 	g_signal_connect(G_OBJECT(toolitem), "clicked", G_CALLBACK(rcw_toolbar_screenshot), cnnwin);
@@ -3149,6 +3211,37 @@ static gboolean rcw_focus_in_event(GtkWidget *widget, GdkEventWindowState *event
 	return FALSE;
 }
 
+/* Tell every session of the window whether it is on screen. Only the current
+ * page of a mapped, non iconified window is visible. GTK3 does not report
+ * occlusion by other windows, so covered windows still count as visible.
+ * current_page is passed because during "switch-page" the notebook still
+ * reports the old page. */
+static void rcw_update_visibility(RemminaConnectionWindow *cnnwin, gint current_page)
+{
+	TRACE_CALL(__func__);
+	GtkNotebook *notebook;
+	GdkWindow *window;
+	RemminaConnectionObject *cnnobj;
+	gboolean shown;
+	gint i, n;
+
+	if (!cnnwin->priv->notebook)
+		return;
+	notebook = GTK_NOTEBOOK(cnnwin->priv->notebook);
+	window = gtk_widget_get_window(GTK_WIDGET(cnnwin));
+	shown = gtk_widget_get_mapped(GTK_WIDGET(cnnwin)) && window &&
+		!(gdk_window_get_state(window) & GDK_WINDOW_STATE_ICONIFIED);
+	if (current_page < 0)
+		current_page = gtk_notebook_get_current_page(notebook);
+
+	n = gtk_notebook_get_n_pages(notebook);
+	for (i = 0; i < n; i++) {
+		cnnobj = g_object_get_data(G_OBJECT(gtk_notebook_get_nth_page(notebook, i)), "cnnobj");
+		if (cnnobj && cnnobj->proto)
+			remmina_protocol_widget_set_visibility(REMMINA_PROTOCOL_WIDGET(cnnobj->proto),
+							       shown && i == current_page);
+	}
+}
 
 static gboolean rcw_state_event(GtkWidget *widget, GdkEventWindowState *event, gpointer user_data)
 {
@@ -3168,6 +3261,9 @@ static gboolean rcw_state_event(GtkWidget *widget, GdkEventWindowState *event, g
 			rcw_focus_out((RemminaConnectionWindow *)widget);
 	}
 
+	if (event->changed_mask & GDK_WINDOW_STATE_ICONIFIED)
+		rcw_update_visibility((RemminaConnectionWindow *)widget, -1);
+
 	return FALSE;
 }
 
@@ -3179,6 +3275,7 @@ static gboolean rcw_map_event(GtkWidget *widget, GdkEvent *event, gpointer data)
 	RemminaConnectionObject *cnnobj;
 	RemminaProtocolWidget *gp;
 	if (cnnwin->priv->toolbar_is_reconfiguring) return FALSE;
+	rcw_update_visibility(cnnwin, -1);
 	if (!(cnnobj = rcw_get_visible_cnnobj(cnnwin))) return FALSE;
 
 	gp = REMMINA_PROTOCOL_WIDGET(cnnobj->proto);
@@ -3197,6 +3294,7 @@ static gboolean rcw_unmap_event(GtkWidget *widget, GdkEvent *event, gpointer dat
 	RemminaConnectionObject *cnnobj;
 	RemminaProtocolWidget *gp;
 	if (cnnwin->priv->toolbar_is_reconfiguring) return FALSE;
+	rcw_update_visibility(cnnwin, -1);
 	if (!(cnnobj = rcw_get_visible_cnnobj(cnnwin))) return FALSE;
 
 	gp = REMMINA_PROTOCOL_WIDGET(cnnobj->proto);
@@ -3219,6 +3317,7 @@ static gboolean rcw_map_event_fullscreen(GtkWidget *widget, GdkEvent *event, gpo
 		REMMINA_DEBUG ("Remmina Connection Window undefined, cannot go fullscreen");
 		return FALSE;
 	}
+	rcw_update_visibility((RemminaConnectionWindow*)widget, -1);
 
 	//RemminaConnectionWindow *cnnwin = (RemminaConnectionWindow *)data;
 	cnnobj = rcw_get_visible_cnnobj((RemminaConnectionWindow*)widget);
@@ -3535,6 +3634,7 @@ static void rcw_on_switch_page(GtkNotebook *notebook, GtkWidget *newpage, guint
 	RemminaConnectionObject *cnnobj_newpage;
 
 	cnnobj_newpage = g_object_get_data(G_OBJECT(newpage), "cnnobj");
+	rcw_update_visibility(cnnwin, page_num);
 	if (priv->spf_eventsourceid)
 		g_source_remove(priv->spf_eventsourceid);
 	priv->spf_eventsourceid = g_idle_add(rcw_on_switch_page_finalsel, cnnobj_newpage);
@@ -3545,6 +3645,7 @@ static void rcw_on_page_added(GtkNotebook *notebook, GtkWidget *child, guint pag
 {
 	if (gtk_notebook_get_n_pages(GTK_NOTEBOOK(cnnwin->priv->notebook)) > 0)
 		rcw_update_notebook(cnnwin);
+	rcw_update_visibility(cnnwin, -1);
 }
 
 static void rcw_on_page_removed(GtkNotebook *notebook, GtkWidget *child, guint page_num,
@@ -3554,6 +3655,8 @@ static void rcw_on_page_removed(GtkNotebook *notebook, GtkWidget *child, guint p
 
 	if (gtk_notebook_get_n_pages(GTK_NOTEBOOK(cnnwin->priv->notebook)) <= 0)
 		gtk_widget_destroy(GTK_WIDGET(cnnwin));
+	else
+		rcw_update_visibility(cnnwin, -1);
 }
 
 static GtkNotebook *
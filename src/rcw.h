@@ -76,6 +76,7 @@ gboolean rcw_open_from_filename(const gchar *filename);
 void rcw_open_from_file(RemminaFile *remminafile);
 gboolean rcw_delete(RemminaConnectionWindow *cnnwin);
 void rcw_set_delete_confirm_mode(RemminaConnectionWindow *cnnwin, RemminaConnectionWindowOnDeleteConfirmMode mode);
+void rcw_screenshot_all(void);
 GtkWidget *rcw_open_from_file_full(RemminaFile *remminafile, GCallback disconnect_cb, gpointer data, guint *handler);
 GtkWindow* rcw_get_gtkwindow(RemminaConnectionObject *cnnobj);
 GtkWidget* rcw_get_gtkviewport(RemminaConnectionObject *cnnobj);
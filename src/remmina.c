@@ -44,6 +44,7 @@
 #include "remmina_exec.h"
 #include "remmina_file_manager.h"
 #include "remmina_icon.h"
+#include "remmina_log.h"
 #include "remmina_main.h"
 #include "remmina_masterthread_exec.h"
 #include "remmina_plugin_manager.h"
@@ -334,6 +335,7 @@ int main(int argc, char *argv[])
 		gdk_set_allowed_backends("x11,broadway,quartz,mir");
 
 	remmina_masterthread_exec_save_main_thread_id();
+	remmina_log_init();
 
 	bindtextdomain(GETTEXT_PACKAGE, REMMINA_RUNTIME_LOCALEDIR);
 	bind_textdomain_codeset(GETTEXT_PACKAGE, "UTF-8");
@@ -412,6 +414,8 @@ int main(int argc, char *argv[])
 	g_application_set_inactivity_timeout(G_APPLICATION(app), 10000);
 	status = g_application_run(G_APPLICATION(app), argc, argv);
 	g_object_unref(app);
+	/* Preferences are written back lazily */
+	remmina_pref_flush();
 
 	return status;
 }
@@ -44,6 +44,7 @@
 #include "remmina_applet_menu_item.h"
 #include "remmina_applet_menu.h"
 #include "remmina_file_manager.h"
+#include "remmina_file_index.h"
 #include "remmina_pref.h"
 #include "remmina/remmina_trace_calls.h"
 
@@ -241,45 +242,34 @@ void remmina_applet_menu_set_hide_count(RemminaAppletMenu *menu, gboolean hide_c
 	menu->priv->hide_count = hide_count;
 }
 
+static void remmina_applet_menu_populate_callback(const RemminaFileIndexEntry *entry, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	GtkWidget *menuitem;
+
+	menuitem = remmina_applet_menu_item_new_from_index(entry);
+	remmina_applet_menu_add_item(REMMINA_APPLET_MENU(user_data), REMMINA_APPLET_MENU_ITEM(menuitem));
+	gtk_widget_show(menuitem);
+}
+
 void remmina_applet_menu_populate(RemminaAppletMenu *menu)
 {
 	TRACE_CALL(__func__);
 	GtkWidget *menuitem;
-	gchar filename[MAX_PATH_LEN];
-	GDir *dir;
-	gchar *remmina_data_dir;
-	const gchar *name;
-	gint count = 0;
+	gint count;
 
 	gboolean new_ontop = remmina_pref.applet_new_ontop;
 
-	remmina_data_dir = remmina_file_get_datadir();
-	dir = g_dir_open(remmina_data_dir, 0, NULL);
-	if (dir != NULL) {
-		/* Iterate all remote desktop profiles */
-		while ((name = g_dir_read_name(dir)) != NULL) {
-			if (!g_str_has_suffix(name, ".remmina"))
-				continue;
-			g_snprintf(filename, sizeof(filename), "%s/%s", remmina_data_dir, name);
-
-			menuitem = remmina_applet_menu_item_new(REMMINA_APPLET_MENU_ITEM_FILE, filename);
-			if (menuitem != NULL) {
-				remmina_applet_menu_add_item(menu, REMMINA_APPLET_MENU_ITEM(menuitem));
-				gtk_widget_show(menuitem);
-				count++;
-			}
-		}
-		g_dir_close(dir);
-		if (count > 0) {
-			/* Separator */
-			menuitem = gtk_separator_menu_item_new();
-			gtk_widget_show(menuitem);
-			if (new_ontop)
-				gtk_menu_shell_prepend(GTK_MENU_SHELL(menu), menuitem);
-			else
-				gtk_menu_shell_append(GTK_MENU_SHELL(menu), menuitem);
-		}
+	/* Iterate all remote desktop profiles */
+	count = remmina_file_index_iterate(remmina_applet_menu_populate_callback, menu);
+	if (count > 0) {
+		/* Separator */
+		menuitem = gtk_separator_menu_item_new();
+		gtk_widget_show(menuitem);
+		if (new_ontop)
+			gtk_menu_shell_prepend(GTK_MENU_SHELL(menu), menuitem);
+		else
+			gtk_menu_shell_append(GTK_MENU_SHELL(menu), menuitem);
 	}
-	g_free(remmina_data_dir);
 }
 
@@ -35,6 +35,8 @@
 
 #pragma once
 
+#include "remmina_file_index.h"
+
 G_BEGIN_DECLS
 
 #define REMMINA_TYPE_APPLET_MENU_ITEM            (remmina_applet_menu_item_get_type())
@@ -68,6 +70,7 @@ GType remmina_applet_menu_item_get_type(void)
 G_GNUC_CONST;
 
 GtkWidget *remmina_applet_menu_item_new(RemminaAppletMenuItemType item_type, ...);
+GtkWidget *remmina_applet_menu_item_new_from_index(const RemminaFileIndexEntry *entry);
 gint remmina_applet_menu_item_compare(gconstpointer a, gconstpointer b, gpointer user_data);
 
 G_END_DECLS
@@ -112,6 +112,8 @@ static gboolean remmina_external_tools_launcher(const gchar* filename, const gch
 	remminafile = remmina_file_load(filename);
 	if (!remminafile)
 		return FALSE;
+	/* The tools get every setting in their environment, secrets included */
+	remmina_file_resolve_secrets(remminafile);
 	GHashTableIter iter;
 	const gchar *key, *value;
 	g_hash_table_iter_init(&iter, remminafile->settings);
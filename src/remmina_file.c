@@ -82,10 +82,205 @@ remmina_file_new_empty(void)
 	 * it’s used by remmina_file_store_secret_plugin_password() to know
 	 * where to change */
 	remminafile->spsettings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	/* pending contains the raw values of encrypted settings which have not
+	 * been decrypted or fetched from the secret plugin yet. They are resolved
+	 * on first access, so listing a profile never touches the keyring */
+	remminafile->pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	remminafile->snapshot_strings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 	remminafile->prevent_saving = FALSE;
 	return remminafile;
 }
 
+static void
+remmina_file_resolve_secret(RemminaFile *remminafile, const gchar *setting)
+{
+	TRACE_CALL(__func__);
+	RemminaSecretPlugin *secret_plugin;
+	gchar *key, *s, *sec;
+
+	if (!g_hash_table_lookup_extended(remminafile->pending, setting, (gpointer *)&key, (gpointer *)&s))
+		return;
+	g_hash_table_steal(remminafile->pending, key);
+
+	if (g_strcmp0(s, ".") == 0) {
+		secret_plugin = remmina_plugin_manager_get_secret_plugin();
+		if (secret_plugin && secret_plugin->is_service_available()) {
+			sec = secret_plugin->get_password(remminafile, key);
+			remmina_file_set_string(remminafile, key, sec);
+			/* Annotate in spsettings that this value comes from secret_plugin */
+			g_hash_table_insert(remminafile->spsettings, g_strdup(key), NULL);
+			g_free(sec);
+		} else {
+			remmina_file_set_string(remminafile, key, s);
+		}
+	} else {
+		remmina_file_set_string_ref(remminafile, key, remmina_crypt_decrypt(s));
+	}
+
+	g_free(key);
+	g_free(s);
+}
+
+/* Resolve every pending secret. Must be called before iterating
+ * remminafile->settings directly */
+void remmina_file_resolve_secrets(RemminaFile *remminafile)
+{
+	TRACE_CALL(__func__);
+	GList *keys, *l;
+
+	if (g_hash_table_size(remminafile->pending) == 0)
+		return;
+
+	keys = g_hash_table_get_keys(remminafile->pending);
+	for (l = keys; l; l = l->next) {
+		gchar *key = g_strdup((const gchar *)l->data);
+		remmina_file_resolve_secret(remminafile, key);
+		g_free(key);
+	}
+	g_list_free(keys);
+}
+
+/* Every change to settings or pending must go through here, so that the
+ * other threads stop reading the published snapshot */
+static void remmina_file_changed(RemminaFile *remminafile)
+{
+	g_atomic_int_set(&remminafile->snapshot_stale, TRUE);
+}
+
+/* Strings handed out to the other threads must stay valid after the
+ * snapshot they came from is gone: keep one copy of each distinct string,
+ * shared by the snapshots, until no snapshot uses it */
+static const gchar *
+remmina_file_intern(RemminaFile *remminafile, const gchar *str)
+{
+	gchar *interned;
+
+	if (str == NULL)
+		return NULL;
+	interned = g_hash_table_lookup(remminafile->snapshot_strings, str);
+	if (interned == NULL) {
+		interned = g_strdup(str);
+		g_hash_table_add(remminafile->snapshot_strings, interned);
+	}
+	return interned;
+}
+
+static gboolean remmina_file_string_unused(gpointer key, gpointer value, gpointer in_use)
+{
+	return !g_hash_table_contains((GHashTable *)in_use, key);
+}
+
+/* Free the retired snapshots, and the strings only they used, when no
+ * other thread is reading a snapshot. Otherwise retry on next publish */
+static void remmina_file_reclaim(RemminaFile *remminafile)
+{
+	TRACE_CALL(__func__);
+	GHashTable *in_use;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	if (remminafile->snapshot_retired == NULL || g_atomic_int_get(&remminafile->snapshot_readers) != 0)
+		return;
+
+	g_slist_free_full(remminafile->snapshot_retired, (GDestroyNotify)g_hash_table_unref);
+	remminafile->snapshot_retired = NULL;
+
+	in_use = g_hash_table_new(NULL, NULL);
+	g_hash_table_iter_init(&iter, remminafile->snapshot);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		g_hash_table_add(in_use, key);
+		if (value)
+			g_hash_table_add(in_use, value);
+	}
+	g_hash_table_foreach_remove(remminafile->snapshot_strings, remmina_file_string_unused, in_use);
+	g_hash_table_destroy(in_use);
+}
+
+/* Publish a copy of the settings for the other threads. Pending secrets
+ * are recorded with a NULL value. Main thread only. */
+static GHashTable *
+remmina_file_publish(RemminaFile *remminafile)
+{
+	TRACE_CALL(__func__);
+	GHashTable *snapshot, *old;
+	GHashTableIter iter;
+	const gchar *key, *value;
+
+	if (remminafile->snapshot && !g_atomic_int_get(&remminafile->snapshot_stale))
+		return remminafile->snapshot;
+
+	snapshot = g_hash_table_new(g_str_hash, g_str_equal);
+	g_hash_table_iter_init(&iter, remminafile->settings);
+	while (g_hash_table_iter_next(&iter, (gpointer *)&key, (gpointer *)&value))
+		g_hash_table_insert(snapshot, (gpointer)remmina_file_intern(remminafile, key),
+				    (gpointer)remmina_file_intern(remminafile, value));
+	g_hash_table_iter_init(&iter, remminafile->pending);
+	while (g_hash_table_iter_next(&iter, (gpointer *)&key, NULL))
+		g_hash_table_insert(snapshot, (gpointer)remmina_file_intern(remminafile, key), NULL);
+
+	/* Readers may still be looking the previous copy up, retire it.
+	 * Swapping the pointer before counting the readers guarantees that
+	 * a reader we do not count only sees the new copy */
+	old = remminafile->snapshot;
+	g_atomic_pointer_set(&remminafile->snapshot, snapshot);
+	g_atomic_int_set(&remminafile->snapshot_stale, FALSE);
+	if (old)
+		remminafile->snapshot_retired = g_slist_prepend(remminafile->snapshot_retired, old);
+	remmina_file_reclaim(remminafile);
+
+	return snapshot;
+}
+
+/* Lookup from a thread other than the main one. The snapshot is read
+ * while it is current; otherwise, or for a secret not
+ * resolved yet, the main thread publishes a new one. */
+static const gchar *
+remmina_file_lookup_shared(RemminaFile *remminafile, const gchar *setting)
+{
+	TRACE_CALL(__func__);
+	GHashTable *snapshot;
+	gboolean current = FALSE, found = FALSE;
+	gpointer value = NULL;
+	RemminaMTExecData *d;
+	const gchar *retval;
+
+	/* The main thread does not free a snapshot while we are counted */
+	g_atomic_int_inc(&remminafile->snapshot_readers);
+	snapshot = g_atomic_pointer_get(&remminafile->snapshot);
+	if (snapshot && !g_atomic_int_get(&remminafile->snapshot_stale)) {
+		current = TRUE;
+		found = g_hash_table_lookup_extended(snapshot, setting, NULL, &value);
+	}
+	g_atomic_int_add(&remminafile->snapshot_readers, -1);
+
+	if (current) {
+		if (!found)
+			return NULL;
+		if (value)
+			return value;
+	}
+
+	d = (RemminaMTExecData *)g_malloc(sizeof(RemminaMTExecData));
+	d->func = FUNC_FILE_GET_STRING;
+	d->p.file_get_string.remminafile = remminafile;
+	d->p.file_get_string.setting = setting;
+	remmina_masterthread_exec_and_wait(d);
+	retval = d->p.file_get_string.retval;
+	g_free(d);
+	return retval;
+}
+
+static const gchar *
+remmina_file_lookup(RemminaFile *remminafile, const gchar *setting)
+{
+	TRACE_CALL(__func__);
+	if (!remmina_masterthread_exec_is_main_thread())
+		return remmina_file_lookup_shared(remminafile, setting);
+	if (g_hash_table_contains(remminafile->pending, setting))
+		remmina_file_resolve_secret(remminafile, setting);
+	return g_hash_table_lookup(remminafile->settings, setting);
+}
+
 RemminaFile *
 remmina_file_new(void)
 {
@@ -334,10 +529,7 @@ remmina_file_load(const gchar *filename)
 	gchar *key;
 	gchar *resolution_str;
 	gint i;
-	gchar *s, *sec;
 	RemminaProtocolPlugin *protocol_plugin;
-	RemminaSecretPlugin *secret_plugin;
-	gboolean secret_service_available;
 	int w, h;
 
 	gkeyfile = g_key_file_new();
@@ -363,9 +555,6 @@ remmina_file_load(const gchar *filename)
 			g_free(proto);
 		}
 
-		secret_plugin = remmina_plugin_manager_get_secret_plugin();
-		secret_service_available = secret_plugin && secret_plugin->is_service_available();
-
 		remminafile->filename = g_strdup(filename);
 		keys = g_key_file_get_keys(gkeyfile, KEYFILE_GROUP_REMMINA, NULL, NULL);
 		if (keys) {
@@ -373,21 +562,10 @@ remmina_file_load(const gchar *filename)
 			for (i = 0; keys[i]; i++) {
 				key = keys[i];
 				if (protocol_plugin && remmina_plugin_manager_is_encrypted_setting(protocol_plugin, key)) {
-					s = g_key_file_get_string(gkeyfile, KEYFILE_GROUP_REMMINA, key, NULL);
-					if (g_strcmp0(s, ".") == 0) {
-						if (secret_service_available) {
-							sec = secret_plugin->get_password(remminafile, key);
-							remmina_file_set_string(remminafile, key, sec);
-							/* Annotate in spsettings that this value comes from secret_plugin */
-							g_hash_table_insert(remminafile->spsettings, g_strdup(key), NULL);
-							g_free(sec);
-						} else {
-							remmina_file_set_string(remminafile, key, s);
-						}
-					} else {
-						remmina_file_set_string_ref(remminafile, key, remmina_crypt_decrypt(s));
-					}
-					g_free(s);
+					/* Decryption and secret plugin lookups are deferred
+					 * until the setting is first read */
+					g_hash_table_insert(remminafile->pending, g_strdup(key),
+							    g_key_file_get_string(gkeyfile, KEYFILE_GROUP_REMMINA, key, NULL));
 				} else {
 					/* If we find "resolution", then we split it in two */
 					if (strcmp(key, "resolution") == 0) {
@@ -427,23 +605,43 @@ void remmina_file_set_string(RemminaFile *remminafile, const gchar *setting, con
 	remmina_file_set_string_ref(remminafile, setting, g_strdup(value));
 }
 
+static gboolean
+remmina_file_warn_deprecated_idle(gpointer data)
+{
+	TRACE_CALL(__func__);
+	remmina_main_show_warning_dialog((const gchar *)data);
+	return G_SOURCE_REMOVE;
+}
+
+/* The dialog can only be shown from the main thread */
+static void
+remmina_file_warn_deprecated(const gchar *message)
+{
+	TRACE_CALL(__func__);
+	fputs(message, stdout);
+	if (remmina_masterthread_exec_is_main_thread())
+		remmina_main_show_warning_dialog(message);
+	else
+		g_idle_add(remmina_file_warn_deprecated_idle, (gpointer)message);
+}
+
 void remmina_file_set_string_ref(RemminaFile *remminafile, const gchar *setting, gchar *value)
 {
 	TRACE_CALL(__func__);
-	const gchar *message;
 
 	if (value) {
 		/* We refuse to accept to set the "resolution" field */
 		if (strcmp(setting, "resolution") == 0) {
-			message = "WARNING: the “resolution” setting in .pref files is deprecated, but some code in remmina or in a plugin is trying to set it.\n";
-			fputs(message, stdout);
-			remmina_main_show_warning_dialog(message);
+			remmina_file_warn_deprecated("WARNING: the “resolution” setting in .pref files is deprecated, but some code in remmina or in a plugin is trying to set it.\n");
+			g_free(value);
 			return;
 		}
 		g_hash_table_insert(remminafile->settings, g_strdup(setting), value);
 	} else {
 		g_hash_table_insert(remminafile->settings, g_strdup(setting), g_strdup(""));
 	}
+	g_hash_table_remove(remminafile->pending, setting);
+	remmina_file_changed(remminafile);
 }
 
 const gchar *
@@ -451,36 +649,36 @@ remmina_file_get_string(RemminaFile *remminafile, const gchar *setting)
 {
 	TRACE_CALL(__func__);
 	gchar *value;
-	const gchar *message;
-
-	/* Returned value is a pointer to the string stored on the hash table,
-	 * please do not free it or the hash table will contain invalid pointer */
-	if (!remmina_masterthread_exec_is_main_thread()) {
-		/* Allow the execution of this function from a non main thread
-		 * (plugins needs it to have user credentials)*/
-		RemminaMTExecData *d;
-		const gchar *retval;
-		d = (RemminaMTExecData *)g_malloc(sizeof(RemminaMTExecData));
-		d->func = FUNC_FILE_GET_STRING;
-		d->p.file_get_string.remminafile = remminafile;
-		d->p.file_get_string.setting = setting;
-		remmina_masterthread_exec_and_wait(d);
-		retval = d->p.file_get_string.retval;
-		g_free(d);
-		return retval;
-	}
 
 	if (strcmp(setting, "resolution") == 0) {
-		message = "WARNING: the “resolution” setting in .pref files is deprecated, but some code in remmina or in a plugin is trying to read it.\n";
-		fputs(message, stdout);
-		remmina_main_show_warning_dialog(message);
+		remmina_file_warn_deprecated("WARNING: the “resolution” setting in .pref files is deprecated, but some code in remmina or in a plugin is trying to read it.\n");
 		return NULL;
 	}
 
-	value = (gchar *)g_hash_table_lookup(remminafile->settings, setting);
+	/* Returned value is a pointer to the string stored on the hash table,
+	 * please do not free it or the hash table will contain invalid pointer.
+	 * Other threads (plugins need it to have user credentials) read the
+	 * published snapshot, whose strings stay valid until the setting
+	 * changes and a newer snapshot is published */
+	if (!remmina_masterthread_exec_is_main_thread()) {
+		value = (gchar *)remmina_file_lookup_shared(remminafile, setting);
+		return value && value[0] ? value : NULL;
+	}
+
+	value = (gchar *)remmina_file_lookup(remminafile, setting);
 	return value && value[0] ? value : NULL;
 }
 
+/* Main thread side of remmina_file_lookup_shared(): resolve the setting
+ * and return it from an up to date snapshot */
+const gchar *
+remmina_file_get_string_shared(RemminaFile *remminafile, const gchar *setting)
+{
+	TRACE_CALL(__func__);
+	remmina_file_resolve_secret(remminafile, setting);
+	return g_hash_table_lookup(remmina_file_publish(remminafile), setting);
+}
+
 gchar *
 remmina_file_get_secret(RemminaFile *remminafile, const gchar *setting)
 {
@@ -519,19 +717,22 @@ gchar *remmina_file_format_properties(RemminaFile *remminafile, const gchar *set
 void remmina_file_set_int(RemminaFile *remminafile, const gchar *setting, gint value)
 {
 	TRACE_CALL(__func__);
-	if (remminafile)
+	if (remminafile) {
 		g_hash_table_insert(remminafile->settings,
 							g_strdup(setting),
 							g_strdup_printf("%i", value));
+		g_hash_table_remove(remminafile->pending, setting);
+		remmina_file_changed(remminafile);
+	}
 }
 
 gint remmina_file_get_int(RemminaFile *remminafile, const gchar *setting, gint default_value)
 {
 	TRACE_CALL(__func__);
-	gchar *value;
+	const gchar *value;
 	gint r;
 
-	value = g_hash_table_lookup(remminafile->settings, setting);
+	value = remmina_file_lookup(remminafile, setting);
 	r = value == NULL ? default_value : (value[0] == 't' ? TRUE : atoi(value));
 	// TOO verbose: REMMINA_DEBUG ("Integer value is: %d", r);
 	return r;
@@ -544,9 +745,9 @@ gdouble remmina_file_get_double(RemminaFile *remminafile,
 							   gdouble default_value)
 {
 	TRACE_CALL(__func__);
-	gchar *value;
+	const gchar *value;
 
-	value = g_hash_table_lookup(remminafile->settings, setting);
+	value = remmina_file_lookup(remminafile, setting);
 	if (!value)
 		return default_value;
 
@@ -590,6 +791,12 @@ void remmina_file_free(RemminaFile *remminafile)
 		g_hash_table_destroy(remminafile->settings);
 	if (remminafile->spsettings)
 		g_hash_table_destroy(remminafile->spsettings);
+	if (remminafile->pending)
+		g_hash_table_destroy(remminafile->pending);
+	if (remminafile->snapshot)
+		g_hash_table_unref(remminafile->snapshot);
+	g_slist_free_full(remminafile->snapshot_retired, (GDestroyNotify)g_hash_table_unref);
+	g_hash_table_destroy(remminafile->snapshot_strings);
 
 	g_free(remminafile);
 }
@@ -608,14 +815,24 @@ void remmina_file_save(RemminaFile *remminafile)
 	GKeyFile *gkeyfile;
 	gsize length = 0;
 	GError *err = NULL;
+	gboolean is_pref;
 
 	if (remminafile->prevent_saving)
 		return;
 
-	if ((gkeyfile = remmina_file_get_keyfile(remminafile)) == NULL)
+	/* The default profile shares its file with the preferences */
+	is_pref = g_strcmp0(remminafile->filename, remmina_pref_file) == 0;
+	if (is_pref)
+		remmina_pref_file_lock();
+
+	if ((gkeyfile = remmina_file_get_keyfile(remminafile)) == NULL) {
+		if (is_pref)
+			remmina_pref_file_unlock();
 		return;
+	}
 
 	REMMINA_DEBUG ("Saving profile");
+	remmina_file_resolve_secrets(remminafile);
 	/* get disablepasswordstoring */
 	nopasswdsave = remmina_file_get_int(remminafile, "disablepasswordstoring", 0);
 	/* Identify the protocol plugin and get pointers to its RemminaProtocolSetting structs */
@@ -685,6 +902,8 @@ void remmina_file_save(RemminaFile *remminafile)
 	} else {
 		g_warning("Remmina connection profile cannot be saved, with error %d (%s)", err->code, err->message);
 	}
+	if (is_pref)
+		remmina_pref_file_unlock();
 	if (err != NULL)
 		g_error_free (err);
 
@@ -703,7 +922,18 @@ void remmina_file_store_secret_plugin_password(RemminaFile *remminafile, const g
 	 * when possible, and is used by the mpchanger */
 	RemminaSecretPlugin *plugin;
 
-	if (g_hash_table_lookup_extended(remminafile->spsettings, g_strdup(key), NULL, NULL)) {
+	/* A secret still pending with a "." placeholder lives in the keyring:
+	 * overwrite it there without fetching the old value first */
+	if (g_strcmp0(g_hash_table_lookup(remminafile->pending, key), ".") == 0) {
+		plugin = remmina_plugin_manager_get_secret_plugin();
+		if (plugin && plugin->is_service_available()) {
+			g_hash_table_remove(remminafile->pending, key);
+			remmina_file_changed(remminafile);
+			g_hash_table_insert(remminafile->spsettings, g_strdup(key), NULL);
+		}
+	}
+
+	if (g_hash_table_lookup_extended(remminafile->spsettings, key, NULL, NULL)) {
 		plugin = remmina_plugin_manager_get_secret_plugin();
 		plugin->store_password(remminafile, key, value);
 	} else {
@@ -719,6 +949,7 @@ remmina_file_dup(RemminaFile *remminafile)
 	RemminaFile *dupfile;
 	GHashTableIter iter;
 	const gchar *key, *value;
+	GSList *keyring = NULL, *l;
 
 	dupfile = remmina_file_new_empty();
 	dupfile->filename = g_strdup(remminafile->filename);
@@ -727,6 +958,19 @@ remmina_file_dup(RemminaFile *remminafile)
 	while (g_hash_table_iter_next(&iter, (gpointer *)&key, (gpointer *)&value))
 		remmina_file_set_string(dupfile, key, value);
 
+	/* Unresolved secrets stay unresolved in the copy, except the ones in
+	 * the keyring: they are looked up by file name, which callers often
+	 * change or clear on the copy, so fetch them while it still matches */
+	g_hash_table_iter_init(&iter, remminafile->pending);
+	while (g_hash_table_iter_next(&iter, (gpointer *)&key, (gpointer *)&value)) {
+		g_hash_table_insert(dupfile->pending, g_strdup(key), g_strdup(value));
+		if (g_strcmp0(value, ".") == 0)
+			keyring = g_slist_prepend(keyring, g_strdup(key));
+	}
+	for (l = keyring; l; l = l->next)
+		remmina_file_resolve_secret(dupfile, l->data);
+	g_slist_free_full(keyring, g_free);
+
 	return dupfile;
 }
 
@@ -45,6 +45,16 @@ struct _RemminaFile {
 	GHashTable *	settings;
 	GHashTable *	spsettings;
 	gboolean	prevent_saving;
+	GHashTable *	pending;
+	/* Immutable copy of settings read by the other threads without
+	 * locking. Replaced copies are retired, and freed together with the
+	 * snapshot_strings the current copy does not use once no reader is
+	 * counted in snapshot_readers */
+	GHashTable *	snapshot;
+	gint		snapshot_stale;
+	gint		snapshot_readers;
+	GSList *	snapshot_retired;
+	GHashTable *	snapshot_strings;
 };
 
 /**
@@ -83,10 +93,12 @@ RemminaFile *remmina_file_load(const gchar *filename);
 void remmina_file_set_string(RemminaFile *remminafile, const gchar *setting, const gchar *value);
 void remmina_file_set_string_ref(RemminaFile *remminafile, const gchar *setting, gchar *value);
 const gchar *remmina_file_get_string(RemminaFile *remminafile, const gchar *setting);
+const gchar *remmina_file_get_string_shared(RemminaFile *remminafile, const gchar *setting);
 gchar *remmina_file_get_secret(RemminaFile *remminafile, const gchar *setting);
 gchar *remmina_file_format_properties(RemminaFile *remminafile, const gchar *setting);
 void remmina_file_set_int(RemminaFile *remminafile, const gchar *setting, gint value);
 gint remmina_file_get_int(RemminaFile *remminafile, const gchar *setting, gint default_value);
+void remmina_file_resolve_secrets(RemminaFile *remminafile);
 void remmina_file_store_secret_plugin_password(RemminaFile *remminafile, const gchar *key, const gchar *value);
 gboolean remmina_file_remove_key(RemminaFile *remminafile, const gchar *setting);
 /* Create or overwrite the .remmina file */
@@ -54,6 +54,7 @@
 #include "remmina_plugin_manager.h"
 #include "remmina_icon.h"
 #include "remmina_file_editor.h"
+#include "remmina_prewarm.h"
 #include "remmina/remmina_trace_calls.h"
 
 G_DEFINE_TYPE(RemminaFileEditor, remmina_file_editor, GTK_TYPE_DIALOG)
@@ -1866,6 +1867,8 @@ void remmina_file_editor_file_save(RemminaFileEditor *gfe)
 	RemminaFileEditorPriv *priv;
 
 	priv = gfe->priv;
+	/* Whatever was warmed up used the settings being replaced */
+	remmina_prewarm_cancel();
 	if (remmina_file_get_filename(priv->remmina_file) == NULL) {
 		remmina_file_generate_filename(priv->remmina_file);
 	} else {
@@ -0,0 +1,744 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2009-2010 Vic Lee
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+/* Persistent index of the profile summaries.
+ *
+ * The index is a single GVariant of type REMMINA_FILE_INDEX_TYPE stored in
+ * the cache dir. It is memory mapped at the first iteration and its records
+ * are used in place; a profile is parsed again only when its mtime or size
+ * differ from the recorded ones. The index is rewritten when something
+ * changed, and kept in memory for the next iterations.
+ *
+ * The asynchronous iteration does the same work in a thread pool: one worker
+ * scans the directory and the others parse the changed profiles. Results go
+ * back to the main loop through a queue drained by an idle handler, so the
+ * index itself is only touched in the main thread. */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "remmina_file_index.h"
+#include "remmina_file_manager.h"
+#include "remmina_plugin_manager.h"
+#include "remmina_log.h"
+#include "remmina/remmina_trace_calls.h"
+
+#define REMMINA_FILE_INDEX_VERSION 1
+/* version, data dir, records */
+#define REMMINA_FILE_INDEX_TYPE "(usa(sssssbxx))"
+/* file name, name, group, server, protocol, ssh_tunnel_enabled, mtime (ns), size */
+#define REMMINA_FILE_INDEX_RECORD_TYPE "(sssssbxx)"
+/* Time spent in the main loop for each batch of the asynchronous iteration */
+#define REMMINA_FILE_INDEX_BATCH_USEC 4000
+/* Delay before writing the index after single profile updates */
+#define REMMINA_FILE_INDEX_SAVE_DELAY 2
+
+typedef struct _RemminaFileIndexRecord {
+	RemminaFileIndexEntry	entry;
+	GVariant *		variant;
+	gchar *			filename;
+	gint64			mtime_ns;
+	gint64			size;
+} RemminaFileIndexRecord;
+
+typedef enum {
+	REMMINA_FILE_INDEX_ITEM_SCAN,           /* To a worker: scan the directory */
+	REMMINA_FILE_INDEX_ITEM_STAT,           /* From a worker: a file found by the scan */
+	REMMINA_FILE_INDEX_ITEM_SCANNED,        /* From a worker: the scan is over */
+	REMMINA_FILE_INDEX_ITEM_PARSE,          /* To a worker: parse a changed file */
+	REMMINA_FILE_INDEX_ITEM_PARSED          /* From a worker: the parsed file, if it is a profile */
+} RemminaFileIndexItemType;
+
+typedef struct _RemminaFileIndexItem {
+	RemminaFileIndexItemType	type;
+	RemminaFileIndexIteration *	iteration;
+	gchar *				name;
+	gchar *				filename;
+	GStatBuf			st;
+	GVariant *			variant;
+} RemminaFileIndexItem;
+
+struct _RemminaFileIndexIteration {
+	gint				refcount;
+	/* NULL once cancelled */
+	RemminaFileIndexFunc		func;
+	RemminaFileIndexProgressFunc	progress;
+	gpointer			user_data;
+
+	gchar *				datadir;
+	GAsyncQueue *			queue;
+	gint				scheduled;
+
+	/* Main thread only */
+	GHashTable *			previous;
+	GHashTable *			index;
+	guint				pending;
+	gboolean			scanned;
+	gboolean			dirty;
+	gint				count;
+};
+
+/* File name -> RemminaFileIndexRecord, for remmina_file_index_datadir */
+static GHashTable *remmina_file_index;
+static gchar *remmina_file_index_datadir;
+
+static GThreadPool *remmina_file_index_pool;
+/* Only one asynchronous iteration runs at a time, it owns the index meanwhile */
+static RemminaFileIndexIteration *remmina_file_index_running;
+static GQueue remmina_file_index_waiting = G_QUEUE_INIT;
+static guint remmina_file_index_save_source;
+
+static gchar *remmina_file_index_get_path(void)
+{
+	TRACE_CALL(__func__);
+	return g_build_filename(g_get_user_cache_dir(), "remmina", "profiles.index", NULL);
+}
+
+static const gchar *remmina_file_index_nonempty(const gchar *s)
+{
+	return s && s[0] ? s : NULL;
+}
+
+static void remmina_file_index_record_free(RemminaFileIndexRecord *record)
+{
+	TRACE_CALL(__func__);
+	g_variant_unref(record->variant);
+	g_free(record->filename);
+	g_free(record);
+}
+
+static RemminaFileIndexRecord *remmina_file_index_record_new(GVariant *variant, const gchar *datadir)
+{
+	TRACE_CALL(__func__);
+	RemminaFileIndexRecord *record;
+	const gchar *name;
+
+	record = g_new0(RemminaFileIndexRecord, 1);
+	/* The strings point straight into the variant, which may be the mapped file */
+	record->variant = g_variant_ref_sink(variant);
+	g_variant_get(record->variant, "(&s&s&s&s&sbxx)", &name,
+		      &record->entry.name, &record->entry.group, &record->entry.server, &record->entry.protocol,
+		      &record->entry.ssh_tunnel_enabled, &record->mtime_ns, &record->size);
+	record->entry.group = remmina_file_index_nonempty(record->entry.group);
+	record->entry.server = remmina_file_index_nonempty(record->entry.server);
+	record->entry.protocol = remmina_file_index_nonempty(record->entry.protocol);
+	record->filename = g_build_filename(datadir, name, NULL);
+	record->entry.filename = record->filename;
+	record->entry.mtime = record->mtime_ns / G_GINT64_CONSTANT(1000000000);
+
+	return record;
+}
+
+static GVariant *remmina_file_index_parse(const gchar *filename, const gchar *name, GStatBuf *st)
+{
+	TRACE_CALL(__func__);
+	GKeyFile *gkeyfile;
+	GVariant *variant;
+	gchar *pname, *group, *server, *protocol, *tunnel;
+	gboolean ssh_tunnel_enabled;
+
+	gkeyfile = g_key_file_new();
+	if (!g_key_file_load_from_file(gkeyfile, filename, G_KEY_FILE_NONE, NULL) ||
+	    !g_key_file_has_key(gkeyfile, "remmina", "name", NULL)) {
+		g_key_file_free(gkeyfile);
+		return NULL;
+	}
+
+	pname = g_key_file_get_string(gkeyfile, "remmina", "name", NULL);
+	group = g_key_file_get_string(gkeyfile, "remmina", "group", NULL);
+	server = g_key_file_get_string(gkeyfile, "remmina", "server", NULL);
+	protocol = g_key_file_get_string(gkeyfile, "remmina", "protocol", NULL);
+	tunnel = g_key_file_get_string(gkeyfile, "remmina", "ssh_tunnel_enabled", NULL);
+	/* Profiles older than 1.4 are upgraded by remmina_file_load() */
+	if (!tunnel && g_strcmp0(protocol, "SSH") != 0)
+		tunnel = g_key_file_get_string(gkeyfile, "remmina", "ssh_enabled", NULL);
+	/* Same rule as remmina_file_get_int() */
+	ssh_tunnel_enabled = tunnel && (tunnel[0] == 't' || atoi(tunnel));
+	g_key_file_free(gkeyfile);
+
+	variant = g_variant_new(REMMINA_FILE_INDEX_RECORD_TYPE, name,
+				pname ? pname : "", group ? group : "", server ? server : "", protocol ? protocol : "",
+				ssh_tunnel_enabled,
+				(gint64)st->st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st->st_mtim.tv_nsec,
+				(gint64)st->st_size);
+	g_free(pname);
+	g_free(group);
+	g_free(server);
+	g_free(protocol);
+	g_free(tunnel);
+
+	return variant;
+}
+
+static GHashTable *remmina_file_index_load(const gchar *datadir)
+{
+	TRACE_CALL(__func__);
+	GHashTable *index;
+	GMappedFile *mapped;
+	GBytes *bytes;
+	GVariant *variant, *records, *child;
+	RemminaFileIndexRecord *record;
+	gchar *path;
+	guint32 version;
+	const gchar *indexdir;
+	gsize i, n;
+
+	index = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)remmina_file_index_record_free);
+
+	path = remmina_file_index_get_path();
+	mapped = g_mapped_file_new(path, FALSE, NULL);
+	g_free(path);
+	if (!mapped)
+		return index;
+
+	bytes = g_mapped_file_get_bytes(mapped);
+	g_mapped_file_unref(mapped);
+	variant = g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE(REMMINA_FILE_INDEX_TYPE), bytes, FALSE));
+	g_bytes_unref(bytes);
+
+	g_variant_get(variant, "(u&s@a" REMMINA_FILE_INDEX_RECORD_TYPE ")", &version, &indexdir, &records);
+	if (version == REMMINA_FILE_INDEX_VERSION && g_strcmp0(indexdir, datadir) == 0) {
+		n = g_variant_n_children(records);
+		for (i = 0; i < n; i++) {
+			child = g_variant_get_child_value(records, i);
+			record = remmina_file_index_record_new(child, datadir);
+			g_variant_unref(child);
+			/* The key is the file name, the last component of record->filename */
+			g_hash_table_replace(index, strrchr(record->filename, '/') + 1, record);
+		}
+		REMMINA_DEBUG("Profile index loaded, %" G_GSIZE_FORMAT " entries", n);
+	}
+	g_variant_unref(records);
+	g_variant_unref(variant);
+
+	return index;
+}
+
+static void remmina_file_index_save(GHashTable *index, const gchar *datadir)
+{
+	TRACE_CALL(__func__);
+	GVariantBuilder builder;
+	GHashTableIter iter;
+	RemminaFileIndexRecord *record;
+	GVariant *variant;
+	GError *error = NULL;
+	gchar *path;
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a" REMMINA_FILE_INDEX_RECORD_TYPE));
+	g_hash_table_iter_init(&iter, index);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&record))
+		g_variant_builder_add_value(&builder, record->variant);
+	variant = g_variant_ref_sink(g_variant_new("(us@a" REMMINA_FILE_INDEX_RECORD_TYPE ")",
+						   REMMINA_FILE_INDEX_VERSION, datadir, g_variant_builder_end(&builder)));
+
+	path = remmina_file_index_get_path();
+	if (!g_file_set_contents(path, g_variant_get_data(variant), g_variant_get_size(variant), &error)) {
+		REMMINA_DEBUG("Could not write the profile index %s: %s", path, error->message);
+		g_error_free(error);
+	}
+	g_free(path);
+	g_variant_unref(variant);
+}
+
+static GHashTable *remmina_file_index_get(const gchar *datadir)
+{
+	TRACE_CALL(__func__);
+	if (remmina_file_index == NULL || g_strcmp0(remmina_file_index_datadir, datadir) != 0) {
+		if (remmina_file_index)
+			g_hash_table_destroy(remmina_file_index);
+		g_free(remmina_file_index_datadir);
+		remmina_file_index = remmina_file_index_load(datadir);
+		remmina_file_index_datadir = g_strdup(datadir);
+	}
+	return remmina_file_index;
+}
+
+/* Take the record of name out of previous if it is still up to date */
+static RemminaFileIndexRecord *remmina_file_index_claim(GHashTable *previous, const gchar *name, GStatBuf *st, gboolean *dirty)
+{
+	TRACE_CALL(__func__);
+	RemminaFileIndexRecord *record;
+	gint64 mtime_ns;
+
+	mtime_ns = (gint64)st->st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000) + st->st_mtim.tv_nsec;
+	record = g_hash_table_lookup(previous, name);
+	if (record && record->mtime_ns == mtime_ns && record->size == (gint64)st->st_size) {
+		g_hash_table_steal(previous, name);
+		return record;
+	}
+	/* Files which are not profiles are not recorded, they do not need a
+	 * new index every time */
+	*dirty |= record != NULL;
+	return NULL;
+}
+
+gint remmina_file_index_iterate(RemminaFileIndexFunc func, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	GHashTable *previous, *index;
+	GPtrArray *records;
+	RemminaFileIndexRecord *record;
+	GVariant *variant;
+	GStatBuf st;
+	GDir *dir;
+	const gchar *name;
+	gchar *datadir;
+	gchar *filename;
+	gboolean dirty = FALSE;
+	guint i;
+
+	datadir = remmina_file_get_datadir();
+	previous = remmina_file_index_get(datadir);
+
+	/* Build the new index from the directory content, taking over the
+	 * records still valid from the previous one */
+	index = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)remmina_file_index_record_free);
+	records = g_ptr_array_new();
+
+	dir = g_dir_open(datadir, 0, NULL);
+	if (dir) {
+		while ((name = g_dir_read_name(dir)) != NULL) {
+			if (!g_str_has_suffix(name, ".remmina"))
+				continue;
+			filename = g_build_filename(datadir, name, NULL);
+			if (g_stat(filename, &st) < 0 || !S_ISREG(st.st_mode)) {
+				g_free(filename);
+				continue;
+			}
+
+			record = remmina_file_index_claim(previous, name, &st, &dirty);
+			if (!record) {
+				variant = remmina_file_index_parse(filename, name, &st);
+				if (variant) {
+					record = remmina_file_index_record_new(variant, datadir);
+					dirty = TRUE;
+				}
+			}
+			g_free(filename);
+
+			if (record) {
+				g_hash_table_replace(index, strrchr(record->filename, '/') + 1, record);
+				g_ptr_array_add(records, record);
+			}
+		}
+		g_dir_close(dir);
+	}
+
+	/* Whatever is left belongs to deleted profiles */
+	if (g_hash_table_size(previous) > 0)
+		dirty = TRUE;
+	g_hash_table_destroy(previous);
+	remmina_file_index = index;
+
+	if (dirty)
+		remmina_file_index_save(index, datadir);
+	g_free(datadir);
+
+	for (i = 0; i < records->len; i++) {
+		record = g_ptr_array_index(records, i);
+		(*func)(&record->entry, user_data);
+	}
+	i = records->len;
+	g_ptr_array_free(records, TRUE);
+
+	return (gint)i;
+}
+
+static RemminaFileIndexIteration *remmina_file_index_iteration_ref(RemminaFileIndexIteration *iteration)
+{
+	g_atomic_int_inc(&iteration->refcount);
+	return iteration;
+}
+
+static void remmina_file_index_iteration_unref(RemminaFileIndexIteration *iteration)
+{
+	TRACE_CALL(__func__);
+	if (!g_atomic_int_dec_and_test(&iteration->refcount))
+		return;
+	g_async_queue_unref(iteration->queue);
+	g_free(iteration->datadir);
+	g_free(iteration);
+}
+
+static RemminaFileIndexItem *remmina_file_index_item_new(RemminaFileIndexItemType type, RemminaFileIndexIteration *iteration)
+{
+	RemminaFileIndexItem *item;
+
+	item = g_new0(RemminaFileIndexItem, 1);
+	item->type = type;
+	item->iteration = remmina_file_index_iteration_ref(iteration);
+	return item;
+}
+
+static void remmina_file_index_item_free(RemminaFileIndexItem *item)
+{
+	if (item->variant)
+		g_variant_unref(g_variant_ref_sink(item->variant));
+	remmina_file_index_iteration_unref(item->iteration);
+	g_free(item->name);
+	g_free(item->filename);
+	g_free(item);
+}
+
+static gboolean remmina_file_index_dispatch(gpointer user_data);
+
+/* Hand an item from a worker to the main loop */
+static void remmina_file_index_post(RemminaFileIndexItem *item)
+{
+	RemminaFileIndexIteration *iteration;
+
+	/* The item, and its reference, may be gone as soon as it is queued */
+	iteration = remmina_file_index_iteration_ref(item->iteration);
+	g_async_queue_push(iteration->queue, item);
+	if (g_atomic_int_compare_and_exchange(&iteration->scheduled, FALSE, TRUE))
+		g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, remmina_file_index_dispatch,
+				remmina_file_index_iteration_ref(iteration),
+				(GDestroyNotify)remmina_file_index_iteration_unref);
+	remmina_file_index_iteration_unref(iteration);
+}
+
+static void remmina_file_index_scan(RemminaFileIndexIteration *iteration)
+{
+	TRACE_CALL(__func__);
+	RemminaFileIndexItem *item;
+	GStatBuf st;
+	GDir *dir;
+	const gchar *name;
+	gchar *filename;
+
+	dir = g_dir_open(iteration->datadir, 0, NULL);
+	if (!dir)
+		return;
+	while ((name = g_dir_read_name(dir)) != NULL) {
+		if (!g_str_has_suffix(name, ".remmina"))
+			continue;
+		filename = g_build_filename(iteration->datadir, name, NULL);
+		if (g_stat(filename, &st) < 0 || !S_ISREG(st.st_mode)) {
+			g_free(filename);
+			continue;
+		}
+		item = remmina_file_index_item_new(REMMINA_FILE_INDEX_ITEM_STAT, iteration);
+		item->name = g_strdup(name);
+		item->filename = filename;
+		item->st = st;
+		remmina_file_index_post(item);
+	}
+	g_dir_close(dir);
+}
+
+static void remmina_file_index_worker(gpointer data, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaFileIndexItem *item = data;
+
+	switch (item->type) {
+	case REMMINA_FILE_INDEX_ITEM_SCAN:
+		remmina_file_index_scan(item->iteration);
+		item->type = REMMINA_FILE_INDEX_ITEM_SCANNED;
+		break;
+	case REMMINA_FILE_INDEX_ITEM_PARSE:
+		item->variant = remmina_file_index_parse(item->filename, item->name, &item->st);
+		item->type = REMMINA_FILE_INDEX_ITEM_PARSED;
+		break;
+	default:
+		g_assert_not_reached();
+	}
+	remmina_file_index_post(item);
+}
+
+static void remmina_file_index_add(RemminaFileIndexIteration *iteration, RemminaFileIndexRecord *record)
+{
+	g_hash_table_replace(iteration->index, strrchr(record->filename, '/') + 1, record);
+	iteration->count++;
+	if (iteration->func)
+		(*iteration->func)(&record->entry, iteration->user_data);
+}
+
+static void remmina_file_index_process(RemminaFileIndexIteration *iteration, RemminaFileIndexItem *item)
+{
+	TRACE_CALL(__func__);
+	RemminaFileIndexRecord *record;
+
+	switch (item->type) {
+	case REMMINA_FILE_INDEX_ITEM_STAT:
+		record = remmina_file_index_claim(iteration->previous, item->name, &item->st, &iteration->dirty);
+		if (!record) {
+			/* Changed or new, parse it in the pool */
+			item->type = REMMINA_FILE_INDEX_ITEM_PARSE;
+			iteration->pending++;
+			g_thread_pool_push(remmina_file_index_pool, item, NULL);
+			return;
+		}
+		remmina_file_index_add(iteration, record);
+		break;
+	case REMMINA_FILE_INDEX_ITEM_PARSED:
+		iteration->pending--;
+		if (item->variant) {
+			record = remmina_file_index_record_new(item->variant, iteration->datadir);
+			item->variant = NULL;
+			iteration->dirty = TRUE;
+			remmina_file_index_add(iteration, record);
+		}
+		break;
+	case REMMINA_FILE_INDEX_ITEM_SCANNED:
+		iteration->pending--;
+		iteration->scanned = TRUE;
+		break;
+	default:
+		g_assert_not_reached();
+	}
+	remmina_file_index_item_free(item);
+}
+
+static void remmina_file_index_start(RemminaFileIndexIteration *iteration)
+{
+	TRACE_CALL(__func__);
+	remmina_file_index_running = iteration;
+
+	if (!remmina_file_index_pool)
+		remmina_file_index_pool = g_thread_pool_new(remmina_file_index_worker, NULL,
+							     g_get_num_processors(), FALSE, NULL);
+
+	/* The iteration owns the index until it finishes; a synchronous
+	 * iteration meanwhile loads its own copy from the disk */
+	iteration->previous = remmina_file_index_get(iteration->datadir);
+	remmina_file_index = NULL;
+	iteration->index = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)remmina_file_index_record_free);
+	/* Single updates not saved yet are saved with the new index */
+	if (remmina_file_index_save_source) {
+		g_source_remove(remmina_file_index_save_source);
+		remmina_file_index_save_source = 0;
+		iteration->dirty = TRUE;
+	}
+
+	iteration->pending++;
+	g_thread_pool_push(remmina_file_index_pool,
+			   remmina_file_index_item_new(REMMINA_FILE_INDEX_ITEM_SCAN, iteration), NULL);
+}
+
+static void remmina_file_index_finish(RemminaFileIndexIteration *iteration)
+{
+	TRACE_CALL(__func__);
+	RemminaFileIndexIteration *next;
+
+	/* Whatever is left belongs to deleted profiles */
+	if (g_hash_table_size(iteration->previous) > 0)
+		iteration->dirty = TRUE;
+	g_hash_table_destroy(iteration->previous);
+	iteration->previous = NULL;
+
+	if (remmina_file_index)
+		g_hash_table_destroy(remmina_file_index);
+	remmina_file_index = iteration->index;
+	iteration->index = NULL;
+	g_free(remmina_file_index_datadir);
+	remmina_file_index_datadir = g_strdup(iteration->datadir);
+
+	if (iteration->dirty)
+		remmina_file_index_save(remmina_file_index, remmina_file_index_datadir);
+
+	REMMINA_DEBUG("Profile index iterated, %d entries", iteration->count);
+	if (iteration->progress)
+		(*iteration->progress)(iteration->count, TRUE, iteration->user_data);
+
+	remmina_file_index_running = NULL;
+	remmina_file_index_iteration_unref(iteration);
+
+	next = g_queue_pop_head(&remmina_file_index_waiting);
+	if (next)
+		remmina_file_index_start(next);
+}
+
+static gboolean remmina_file_index_dispatch(gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaFileIndexIteration *iteration = user_data;
+	RemminaFileIndexItem *item;
+	gint64 deadline;
+	gint count;
+
+	count = iteration->count;
+	deadline = g_get_monotonic_time() + REMMINA_FILE_INDEX_BATCH_USEC;
+	while ((item = g_async_queue_try_pop(iteration->queue)) != NULL) {
+		remmina_file_index_process(iteration, item);
+		if (g_get_monotonic_time() >= deadline)
+			break;
+	}
+
+	if (iteration->scanned && iteration->pending == 0) {
+		/* scheduled stays set, nothing will be posted anymore */
+		remmina_file_index_finish(iteration);
+		return G_SOURCE_REMOVE;
+	}
+
+	if (iteration->progress && iteration->count != count)
+		(*iteration->progress)(iteration->count, FALSE, iteration->user_data);
+
+	if (g_async_queue_length(iteration->queue) > 0)
+		return G_SOURCE_CONTINUE;
+	g_atomic_int_set(&iteration->scheduled, FALSE);
+	/* A worker may have posted before the flag was cleared */
+	if (g_async_queue_length(iteration->queue) > 0 &&
+	    g_atomic_int_compare_and_exchange(&iteration->scheduled, FALSE, TRUE))
+		return G_SOURCE_CONTINUE;
+	return G_SOURCE_REMOVE;
+}
+
+RemminaFileIndexIteration *remmina_file_index_iterate_async(RemminaFileIndexFunc func, RemminaFileIndexProgressFunc progress, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaFileIndexIteration *iteration;
+
+	iteration = g_new0(RemminaFileIndexIteration, 1);
+	iteration->refcount = 1;
+	iteration->func = func;
+	iteration->progress = progress;
+	iteration->user_data = user_data;
+	iteration->datadir = remmina_file_get_datadir();
+	iteration->queue = g_async_queue_new();
+
+	if (remmina_file_index_running)
+		g_queue_push_tail(&remmina_file_index_waiting, iteration);
+	else
+		remmina_file_index_start(iteration);
+
+	return iteration;
+}
+
+void remmina_file_index_iterate_cancel(RemminaFileIndexIteration *iteration)
+{
+	TRACE_CALL(__func__);
+	if (g_queue_remove(&remmina_file_index_waiting, iteration)) {
+		remmina_file_index_iteration_unref(iteration);
+		return;
+	}
+	/* A running iteration still completes the index, silently */
+	iteration->func = NULL;
+	iteration->progress = NULL;
+}
+
+static gboolean remmina_file_index_save_timeout(gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	remmina_file_index_save_source = 0;
+	if (remmina_file_index)
+		remmina_file_index_save(remmina_file_index, remmina_file_index_datadir);
+	return G_SOURCE_REMOVE;
+}
+
+const RemminaFileIndexEntry *remmina_file_index_update(const gchar *filename)
+{
+	TRACE_CALL(__func__);
+	GHashTable *index;
+	RemminaFileIndexRecord *record;
+	GVariant *variant;
+	GStatBuf st;
+	gchar *datadir, *name, *path;
+	gboolean dirty = FALSE;
+
+	g_return_val_if_fail(remmina_file_index_running == NULL, NULL);
+
+	/* Only profiles of the data dir, named as the iteration would name them */
+	datadir = remmina_file_get_datadir();
+	name = g_path_get_basename(filename);
+	path = g_build_filename(datadir, name, NULL);
+	if (g_strcmp0(path, filename) != 0 || !g_str_has_suffix(name, ".remmina")) {
+		g_free(path);
+		g_free(name);
+		g_free(datadir);
+		return NULL;
+	}
+	g_free(path);
+
+	index = remmina_file_index_get(datadir);
+	record = NULL;
+
+	if (g_stat(filename, &st) < 0 || !S_ISREG(st.st_mode)) {
+		dirty = g_hash_table_remove(index, name);
+	} else {
+		record = remmina_file_index_claim(index, name, &st, &dirty);
+		if (!record) {
+			variant = remmina_file_index_parse(filename, name, &st);
+			if (variant) {
+				record = remmina_file_index_record_new(variant, datadir);
+				dirty = TRUE;
+			} else {
+				dirty |= g_hash_table_remove(index, name);
+			}
+		}
+		if (record)
+			g_hash_table_replace(index, strrchr(record->filename, '/') + 1, record);
+	}
+	g_free(name);
+	g_free(datadir);
+
+	if (dirty && !remmina_file_index_save_source)
+		remmina_file_index_save_source = g_timeout_add_seconds(REMMINA_FILE_INDEX_SAVE_DELAY,
+								       remmina_file_index_save_timeout, NULL);
+
+	return record ? &record->entry : NULL;
+}
+
+const gchar *remmina_file_index_entry_get_icon_name(const RemminaFileIndexEntry *entry)
+{
+	TRACE_CALL(__func__);
+	RemminaProtocolPlugin *plugin;
+
+	plugin = (RemminaProtocolPlugin *)remmina_plugin_manager_get_plugin(REMMINA_PLUGIN_TYPE_PROTOCOL, entry->protocol);
+	if (!plugin)
+		return REMMINA_APP_ID "-symbolic";
+
+	return entry->ssh_tunnel_enabled ? plugin->icon_name_ssh : plugin->icon_name;
+}
+
+/* Same format as remmina_file_get_datetime(), without another stat() */
+gchar *remmina_file_index_entry_get_datetime(const RemminaFileIndexEntry *entry)
+{
+	TRACE_CALL(__func__);
+	GDateTime *datetime;
+	gchar *str;
+
+	datetime = g_date_time_new_from_unix_local(entry->mtime);
+	if (!datetime)
+		return g_strdup("26/01/1976 23:30:00");
+	str = g_date_time_format(datetime, "%F - %T");
+	g_date_time_unref(datetime);
+
+	return str;
+}
@@ -0,0 +1,74 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2009-2010 Vic Lee
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Summary of a profile, as shown in the main window and in the tray menu.
+ * Strings are owned by the index and valid until the next iteration. */
+typedef struct _RemminaFileIndexEntry {
+	const gchar *	filename;
+	const gchar *	name;
+	const gchar *	group;
+	const gchar *	server;
+	const gchar *	protocol;
+	gboolean	ssh_tunnel_enabled;
+	gint64		mtime;
+} RemminaFileIndexEntry;
+
+typedef void (*RemminaFileIndexFunc)(const RemminaFileIndexEntry *entry, gpointer user_data);
+/* Called after each batch of entries, and one last time with finished set to TRUE */
+typedef void (*RemminaFileIndexProgressFunc)(gint count, gboolean finished, gpointer user_data);
+
+typedef struct _RemminaFileIndexIteration RemminaFileIndexIteration;
+
+/* Iterate all .remmina profiles, parsing only the ones changed since the index was written */
+gint remmina_file_index_iterate(RemminaFileIndexFunc func, gpointer user_data);
+/* Same, but the directory is scanned and the profiles are parsed in a thread pool.
+ * The callbacks run in the main loop; the returned handle is valid until the
+ * last progress call or until it is cancelled */
+RemminaFileIndexIteration *remmina_file_index_iterate_async(RemminaFileIndexFunc func, RemminaFileIndexProgressFunc progress, gpointer user_data);
+void remmina_file_index_iterate_cancel(RemminaFileIndexIteration *iteration);
+/* Refresh the entry of a single profile after it changed on disk. Returns
+ * NULL if the file is gone or is not a profile. Not to be called while an
+ * asynchronous iteration runs */
+const RemminaFileIndexEntry *remmina_file_index_update(const gchar *filename);
+const gchar *remmina_file_index_entry_get_icon_name(const RemminaFileIndexEntry *entry);
+gchar *remmina_file_index_entry_get_datetime(const RemminaFileIndexEntry *entry);
+
+G_END_DECLS
@@ -44,6 +44,7 @@
 #include "remmina_string_array.h"
 #include "remmina_plugin_manager.h"
 #include "remmina_file_manager.h"
+#include "remmina_file_index.h"
 #include "remmina/remmina_trace_calls.h"
 
 static gchar *remminadir;
@@ -180,42 +181,26 @@ gint remmina_file_manager_iterate(GFunc func, gpointer user_data)
 	return items_count;
 }
 
+static void remmina_file_manager_get_groups_callback(const RemminaFileIndexEntry *entry, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaStringArray *array = (RemminaStringArray *)user_data;
+
+	if (entry->group && remmina_string_array_find(array, entry->group) < 0)
+		remmina_string_array_add(array, entry->group);
+}
+
 gchar *remmina_file_manager_get_groups(void)
 {
 	TRACE_CALL(__func__);
-	gchar filename[MAX_PATH_LEN];
-	GDir *dir;
-	const gchar *name;
-	RemminaFile *remminafile;
 	RemminaStringArray *array;
-	const gchar *group;
 	gchar *groups;
-	gchar *remmina_data_dir;
 
-	remmina_data_dir = remmina_file_get_datadir();
 	array = remmina_string_array_new();
-
-	dir = g_dir_open(remmina_data_dir, 0, NULL);
-
-	if (dir == NULL)
-		return 0;
-	while ((name = g_dir_read_name(dir)) != NULL) {
-		if (!g_str_has_suffix(name, ".remmina"))
-			continue;
-		g_snprintf(filename, MAX_PATH_LEN, "%s/%s", remmina_data_dir, name);
-		remminafile = remmina_file_load(filename);
-		if (remminafile) {
-			group = remmina_file_get_string(remminafile, "group");
-			if (group && remmina_string_array_find(array, group) < 0)
-				remmina_string_array_add(array, group);
-			remmina_file_free(remminafile);
-		}
-	}
-	g_dir_close(dir);
+	remmina_file_index_iterate(remmina_file_manager_get_groups_callback, array);
 	remmina_string_array_sort(array);
 	groups = remmina_string_array_to_string(array);
 	remmina_string_array_free(array);
-	g_free(remmina_data_dir);
 	return groups;
 }
 
@@ -273,36 +258,19 @@ static void remmina_file_manager_add_group(GNode *node, const gchar *group)
 		g_free(p1);
 }
 
+static void remmina_file_manager_get_group_tree_callback(const RemminaFileIndexEntry *entry, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	remmina_file_manager_add_group((GNode *)user_data, entry->group);
+}
+
 GNode *remmina_file_manager_get_group_tree(void)
 {
 	TRACE_CALL(__func__);
-	gchar filename[MAX_PATH_LEN];
-	GDir *dir;
-	g_autofree gchar *datadir = NULL;
-	const gchar *name;
-	RemminaFile *remminafile;
-	const gchar *group;
 	GNode *root;
 
 	root = g_node_new(NULL);
-
-	datadir = g_strdup(remmina_file_get_datadir());
-	dir = g_dir_open(datadir, 0, NULL);
-
-	if (dir == NULL)
-		return root;
-	while ((name = g_dir_read_name(dir)) != NULL) {
-		if (!g_str_has_suffix(name, ".remmina"))
-			continue;
-		g_snprintf(filename, MAX_PATH_LEN, "%s/%s", datadir, name);
-		remminafile = remmina_file_load(filename);
-		if (remminafile) {
-			group = remmina_file_get_string(remminafile, "group");
-			remmina_file_manager_add_group(root, group);
-			remmina_file_free(remminafile);
-		}
-	}
-	g_dir_close(dir);
+	remmina_file_index_iterate(remmina_file_manager_get_group_tree_callback, root);
 	return root;
 }
 
@@ -286,18 +286,25 @@ static void remmina_ftp_client_cell_data_size_progress(GtkTreeViewColumn *col, G
 {
 	TRACE_CALL(__func__);
 	gint status;
-	gfloat size, donesize;
-	gchar *strsize, *strdonesize, *str;
+	gfloat size, donesize, rate;
+	gchar *strsize, *strdonesize, *strrate, *str;
 
 	gtk_tree_model_get(model, iter, REMMINA_FTP_TASK_COLUMN_STATUS, &status, REMMINA_FTP_TASK_COLUMN_SIZE, &size,
-		REMMINA_FTP_TASK_COLUMN_DONESIZE, &donesize, -1);
+		REMMINA_FTP_TASK_COLUMN_DONESIZE, &donesize, REMMINA_FTP_TASK_COLUMN_RATE, &rate, -1);
 
 	if (status == REMMINA_FTP_TASK_STATUS_FINISH) {
 		str = remmina_ftp_client_size_to_str(size);
 	}else  {
 		strsize = remmina_ftp_client_size_to_str(size);
 		strdonesize = remmina_ftp_client_size_to_str(donesize);
-		str = g_strdup_printf("%s / %s", strdonesize, strsize);
+		if (status == REMMINA_FTP_TASK_STATUS_RUN && rate > 0) {
+			strrate = remmina_ftp_client_size_to_str(rate);
+			// TRANSLATORS: Transferred size, total size and transfer rate, e.g. "12 MiB / 1 GiB (4 MiB/s)"
+			str = g_strdup_printf(_("%s / %s (%s/s)"), strdonesize, strsize, strrate);
+			g_free(strrate);
+		} else {
+			str = g_strdup_printf("%s / %s", strdonesize, strsize);
+		}
 		g_free(strsize);
 		g_free(strdonesize);
 	}
@@ -1024,7 +1031,7 @@ static void remmina_ftp_client_init(RemminaFTPClient *client)
 	/* Task List - Model */
 	priv->task_list_model = GTK_TREE_MODEL(
 		gtk_list_store_new(REMMINA_FTP_TASK_N_COLUMNS, G_TYPE_INT, G_TYPE_STRING, G_TYPE_FLOAT, G_TYPE_INT,
-			G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT, G_TYPE_FLOAT, G_TYPE_STRING));
+			G_TYPE_INT, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT, G_TYPE_FLOAT, G_TYPE_STRING, G_TYPE_FLOAT));
 	gtk_tree_view_set_model(GTK_TREE_VIEW(priv->task_list_view), priv->task_list_model);
 
 	/* Setup the internal signals */
@@ -1186,6 +1193,9 @@ remmina_ftp_client_get_waiting_task(RemminaFTPClient *client)
 		if (task.status == REMMINA_FTP_TASK_STATUS_WAIT) {
 			path = gtk_tree_model_get_path(priv->task_list_model, &iter);
 			task.rowref = gtk_tree_row_reference_new(priv->task_list_model, path);
+			task.rate = 0;
+			task.rate_stamp = 0;
+			task.rate_donesize = 0;
 			gtk_tree_path_free(path);
 			return (RemminaFTPTask*)g_memdup(&task, sizeof(RemminaFTPTask));
 		}
@@ -1224,7 +1234,8 @@ void remmina_ftp_client_update_task(RemminaFTPClient *client, RemminaFTPTask* ta
 	gtk_tree_model_get_iter(priv->task_list_model, &iter, path);
 	gtk_tree_path_free(path);
 	gtk_list_store_set(store, &iter, REMMINA_FTP_TASK_COLUMN_SIZE, task->size, REMMINA_FTP_TASK_COLUMN_STATUS, task->status,
-		REMMINA_FTP_TASK_COLUMN_DONESIZE, task->donesize, REMMINA_FTP_TASK_COLUMN_TOOLTIP, task->tooltip, -1);
+		REMMINA_FTP_TASK_COLUMN_DONESIZE, task->donesize, REMMINA_FTP_TASK_COLUMN_TOOLTIP, task->tooltip,
+		REMMINA_FTP_TASK_COLUMN_RATE, task->rate, -1);
 }
 
 void remmina_ftp_task_free(RemminaFTPTask *task)
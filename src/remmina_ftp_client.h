@@ -103,6 +103,7 @@ enum {
 	REMMINA_FTP_TASK_COLUMN_STATUS,
 	REMMINA_FTP_TASK_COLUMN_DONESIZE,
 	REMMINA_FTP_TASK_COLUMN_TOOLTIP,
+	REMMINA_FTP_TASK_COLUMN_RATE,
 	REMMINA_FTP_TASK_N_COLUMNS
 };
 
@@ -120,6 +121,10 @@ typedef struct _RemminaFTPTask {
 	gint			status;
 	gfloat			donesize;
 	gchar *			tooltip;
+	gfloat			rate;	/* bytes per second, 0 when unknown */
+	/* Private to the transfer thread */
+	gint64			rate_stamp;
+	gfloat			rate_donesize;
 } RemminaFTPTask;
 
 GtkWidget *remmina_ftp_client_new(void);
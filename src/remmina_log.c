@@ -41,6 +41,51 @@
 #include "remmina_stats_sender.h"
 #include "remmina/remmina_trace_calls.h"
 
+/* Messages are formatted only when their level is enabled, that is when
+ * GLib prints them or when the log window is open. For the log window, each
+ * thread puts its messages in its own ring, without locking; the main thread
+ * drains all the rings at most once per REMMINA_LOG_DRAIN_INTERVAL and
+ * inserts them in the text buffer at once, ordered by their sequence number. */
+
+/* Messages kept per thread between two drains, a power of 2 */
+#define REMMINA_LOG_RING_SIZE 512
+/* ms, about one frame */
+#define REMMINA_LOG_DRAIN_INTERVAL 16
+
+typedef struct _RemminaLogEntry {
+	guint	seq;
+	gchar * text;
+} RemminaLogEntry;
+
+/* Single producer (its thread), single consumer (the main thread) */
+typedef struct _RemminaLogRing {
+	RemminaLogEntry entries[REMMINA_LOG_RING_SIZE];
+	gint		head;
+	gint		tail;
+	gint		dropped;
+	/* The thread exited, the ring is freed once drained */
+	gint		orphaned;
+} RemminaLogRing;
+
+/* Everything enabled until remmina_log_init() knows better */
+gint remmina_log_levels = G_LOG_LEVEL_MASK;
+
+static gboolean remmina_log_glib_debug;
+static gint remmina_log_window_open;
+static gint remmina_log_seq;
+static gint remmina_log_drain_scheduled;
+static GSList *remmina_log_rings;
+G_LOCK_DEFINE_STATIC(remmina_log_rings);
+
+static void remmina_log_ring_release(gpointer data)
+{
+	RemminaLogRing *ring = data;
+
+	g_atomic_int_set(&ring->orphaned, 1);
+}
+
+static GPrivate remmina_log_ring_key = G_PRIVATE_INIT(remmina_log_ring_release);
+
 /***** Define the log window GUI *****/
 #define REMMINA_TYPE_LOG_WINDOW               (remmina_log_window_get_type())
 #define REMMINA_LOG_WINDOW(obj)               (G_TYPE_CHECK_INSTANCE_CAST((obj), REMMINA_TYPE_LOG_WINDOW, RemminaLogWindow))
@@ -122,10 +167,36 @@ remmina_log_window_new(void)
 	return GTK_WIDGET(g_object_new(REMMINA_TYPE_LOG_WINDOW, NULL));
 }
 
+static void remmina_log_update_levels(void)
+{
+	TRACE_CALL(__func__);
+	gint levels;
+
+	/* Warnings and more severe messages are always printed by GLib */
+	levels = G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING | G_LOG_LEVEL_MESSAGE;
+	if (remmina_log_glib_debug || g_atomic_int_get(&remmina_log_window_open))
+		levels |= G_LOG_LEVEL_INFO | G_LOG_LEVEL_DEBUG;
+	g_atomic_int_set(&remmina_log_levels, levels);
+}
+
+void remmina_log_init(void)
+{
+	TRACE_CALL(__func__);
+	const gchar *domains;
+
+	/* GLib default handler prints debug and info messages only when
+	 * G_MESSAGES_DEBUG is set */
+	domains = g_getenv("G_MESSAGES_DEBUG");
+	remmina_log_glib_debug = domains && domains[0];
+	remmina_log_update_levels();
+}
+
 static void remmina_log_end(GtkWidget *widget, gpointer data)
 {
 	TRACE_CALL(__func__);
 	log_window = NULL;
+	g_atomic_int_set(&remmina_log_window_open, 0);
+	remmina_log_update_levels();
 }
 
 void remmina_log_start(void)
@@ -138,6 +209,8 @@ void remmina_log_start(void)
 		gtk_window_set_default_size(GTK_WINDOW(log_window), 640, 480);
 		g_signal_connect(G_OBJECT(log_window), "destroy", G_CALLBACK(remmina_log_end), NULL);
 		gtk_widget_show(log_window);
+		g_atomic_int_set(&remmina_log_window_open, 1);
+		remmina_log_update_levels();
 	}
 	if (remmina_stat_sender_can_send())
 		remmina_log_print("Shortcut keys for stats:\n"
@@ -164,18 +237,111 @@ static gboolean remmina_log_scroll_to_end(gpointer data)
 	return FALSE;
 }
 
-static gboolean remmina_log_print_real(gpointer data)
+static gint remmina_log_entry_compare(gconstpointer a, gconstpointer b)
+{
+	/* Sequence numbers wrap around */
+	return (gint)(((const RemminaLogEntry *)a)->seq - ((const RemminaLogEntry *)b)->seq);
+}
+
+/* Move the messages of every thread to the log window */
+static gboolean remmina_log_drain(gpointer data)
 {
 	TRACE_CALL(__func__);
+	RemminaLogRing *ring;
+	GArray *entries;
+	GString *text;
+	GSList *l, *next;
 	GtkTextIter iter;
+	guint head, tail, i;
+	gint dropped;
+	gboolean orphaned;
+
+	/* Messages put from now on schedule another drain */
+	g_atomic_int_set(&remmina_log_drain_scheduled, 0);
+
+	entries = g_array_new(FALSE, FALSE, sizeof(RemminaLogEntry));
+	dropped = 0;
+
+	G_LOCK(remmina_log_rings);
+	for (l = remmina_log_rings; l; l = next) {
+		next = l->next;
+		ring = l->data;
+		orphaned = g_atomic_int_get(&ring->orphaned);
+		head = (guint)g_atomic_int_get(&ring->head);
+		tail = (guint)ring->tail;
+		for (; tail != head; tail++)
+			g_array_append_val(entries, ring->entries[tail & (REMMINA_LOG_RING_SIZE - 1)]);
+		g_atomic_int_set(&ring->tail, (gint)tail);
+		dropped += g_atomic_int_and(&ring->dropped, 0);
+		if (orphaned) {
+			remmina_log_rings = g_slist_delete_link(remmina_log_rings, l);
+			g_free(ring);
+		}
+	}
+	G_UNLOCK(remmina_log_rings);
 
-	if (log_window) {
+	g_array_sort(entries, remmina_log_entry_compare);
+	text = g_string_new(NULL);
+	for (i = 0; i < entries->len; i++) {
+		g_string_append(text, g_array_index(entries, RemminaLogEntry, i).text);
+		g_free(g_array_index(entries, RemminaLogEntry, i).text);
+	}
+	if (dropped > 0)
+		g_string_append_printf(text, "(%d log messages dropped)\n", dropped);
+	g_array_free(entries, TRUE);
+
+	if (log_window && text->len > 0) {
 		gtk_text_buffer_get_end_iter(REMMINA_LOG_WINDOW(log_window)->log_buffer, &iter);
-		gtk_text_buffer_insert(REMMINA_LOG_WINDOW(log_window)->log_buffer, &iter, (const gchar*)data, -1);
+		gtk_text_buffer_insert(REMMINA_LOG_WINDOW(log_window)->log_buffer, &iter, text->str, text->len);
 		IDLE_ADD(remmina_log_scroll_to_end, NULL);
 	}
-	g_free(data);
-	return FALSE;
+	g_string_free(text, TRUE);
+
+	return G_SOURCE_REMOVE;
+}
+
+static RemminaLogRing *remmina_log_ring_get(void)
+{
+	RemminaLogRing *ring;
+
+	ring = g_private_get(&remmina_log_ring_key);
+	if (!ring) {
+		ring = g_new0(RemminaLogRing, 1);
+		g_private_set(&remmina_log_ring_key, ring);
+		G_LOCK(remmina_log_rings);
+		remmina_log_rings = g_slist_prepend(remmina_log_rings, ring);
+		G_UNLOCK(remmina_log_rings);
+	}
+	return ring;
+}
+
+/* Queue text, which is taken, for the log window. Any thread */
+static void remmina_log_put(gchar *text)
+{
+	RemminaLogRing *ring;
+	RemminaLogEntry *entry;
+	guint head;
+
+	if (!g_atomic_int_get(&remmina_log_window_open)) {
+		g_free(text);
+		return;
+	}
+
+	ring = remmina_log_ring_get();
+	head = (guint)ring->head;
+	if (head - (guint)g_atomic_int_get(&ring->tail) >= REMMINA_LOG_RING_SIZE) {
+		g_atomic_int_inc(&ring->dropped);
+		g_free(text);
+	} else {
+		entry = &ring->entries[head & (REMMINA_LOG_RING_SIZE - 1)];
+		entry->seq = (guint)g_atomic_int_add(&remmina_log_seq, 1);
+		entry->text = text;
+		/* Publish the entry to the main thread */
+		g_atomic_int_set(&ring->head, (gint)(head + 1));
+	}
+
+	if (g_atomic_int_compare_and_exchange(&remmina_log_drain_scheduled, 0, 1))
+		g_timeout_add(REMMINA_LOG_DRAIN_INTERVAL, remmina_log_drain, NULL);
 }
 
 // Only prints into Remmina's own debug window. (Not stdout!)
@@ -183,10 +349,10 @@ static gboolean remmina_log_print_real(gpointer data)
 void remmina_log_print(const gchar *text)
 {
 	TRACE_CALL(__func__);
-	if (!log_window)
+	if (!g_atomic_int_get(&remmina_log_window_open))
 		return;
 
-	IDLE_ADD(remmina_log_print_real, g_strdup(text));
+	remmina_log_put(g_strdup(text));
 }
 
 void _remmina_info(const gchar *fmt, ...)
@@ -194,7 +360,11 @@ void _remmina_info(const gchar *fmt, ...)
 	TRACE_CALL(__func__);
 
 	va_list args;
-	g_autofree gchar *text;
+	g_autofree gchar *text = NULL;
+
+	if (!REMMINA_LOG_ENABLED(G_LOG_LEVEL_INFO))
+		return;
+
 	va_start(args, fmt);
 	text = g_strdup_vprintf(fmt, args);
 	va_end(args);
@@ -202,15 +372,7 @@ void _remmina_info(const gchar *fmt, ...)
 	// always appends newline
 	g_info ("%s", text);
 
-	g_autofree gchar *buf_tmp = g_strconcat(text, "\n", NULL);
-	/* freed in remmina_log_print_real */
-	gchar *bufn = g_strconcat("(INFO) - ", buf_tmp, NULL);
-
-	if (!log_window) {
-		free(bufn);
-		return;
-	}
-	IDLE_ADD(remmina_log_print_real, bufn);
+	remmina_log_put(g_strconcat("(INFO) - ", text, "\n", NULL));
 }
 
 void _remmina_message(const gchar *fmt, ...)
@@ -218,7 +380,7 @@ void _remmina_message(const gchar *fmt, ...)
 	TRACE_CALL(__func__);
 
 	va_list args;
-	g_autofree gchar *text;
+	g_autofree gchar *text = NULL;
 	va_start(args, fmt);
 	text = g_strdup_vprintf(fmt, args);
 	va_end(args);
@@ -226,47 +388,34 @@ void _remmina_message(const gchar *fmt, ...)
 	// always appends newline
 	g_message ("%s", text);
 
-	if (!log_window) {
-		return;
-	}
-
-	g_autofree gchar *buf_tmp = g_strconcat(text, "\n", NULL);
-	/* freed in remmina_log_print_real */
-	gchar *bufn = g_strconcat("(MESSAGE) - ", buf_tmp, NULL);
-
-	IDLE_ADD(remmina_log_print_real, bufn);
+	remmina_log_put(g_strconcat("(MESSAGE) - ", text, "\n", NULL));
 }
 
 /**
  * Print a string in the Remmina Debug Windows and in the terminal.
  * The string will be visible in the terminal if G_MESSAGES_DEBUG=all
- * Variadic function of REMMINA_DEBUG
+ * Variadic function of REMMINA_DEBUG, which does not call it when debug
+ * messages are disabled
  */
 void _remmina_debug(const gchar *fun, const gchar *fmt, ...)
 {
 	TRACE_CALL(__func__);
 
 	va_list args;
-	gchar *text;
+	g_autofree gchar *text = NULL;
+
+	/* Plugins built before REMMINA_LOG_ENABLED() call us anyway */
+	if (!REMMINA_LOG_ENABLED(G_LOG_LEVEL_DEBUG))
+		return;
+
 	va_start(args, fmt);
 	text = g_strdup_vprintf(fmt, args);
 	va_end(args);
 
-	g_autofree gchar *buf = g_strconcat("(", fun, ") - ", text, NULL);
-	g_free(text);
-
 	// always appends newline
-	g_debug ("%s", buf);
-
-	if (!log_window) {
-		return;
-	}
-
-	g_autofree gchar *buf_tmp = g_strconcat(buf, "\n", NULL);
-	/* freed in remmina_log_print_real */
-	gchar *bufn = g_strconcat("(DEBUG) - ", buf_tmp, NULL);
+	g_debug ("(%s) - %s", fun, text);
 
-	IDLE_ADD(remmina_log_print_real, bufn);
+	remmina_log_put(g_strconcat("(DEBUG) - (", fun, ") - ", text, "\n", NULL));
 }
 
 void _remmina_warning(const gchar *fun, const gchar *fmt, ...)
@@ -274,26 +423,15 @@ void _remmina_warning(const gchar *fun, const gchar *fmt, ...)
 	TRACE_CALL(__func__);
 
 	va_list args;
-	gchar *text;
+	g_autofree gchar *text = NULL;
 	va_start(args, fmt);
 	text = g_strdup_vprintf(fmt, args);
 	va_end(args);
 
-	g_autofree gchar *buf = g_strconcat("(", fun, ") - ", text, NULL);
-	g_free(text);
-
 	// always appends newline
-	g_warning ("%s", buf);
+	g_warning ("(%s) - %s", fun, text);
 
-	if (!log_window) {
-		return;
-	}
-
-	g_autofree gchar *buf_tmp = g_strconcat(buf, "\n", NULL);
-	/* freed in remmina_log_print_real */
-	gchar *bufn = g_strconcat("(WARN) - ", buf_tmp, NULL);
-
-	IDLE_ADD(remmina_log_print_real, bufn);
+	remmina_log_put(g_strconcat("(WARN) - (", fun, ") - ", text, "\n", NULL));
 }
 
 // !!! Calling this function will crash Remmina !!!
@@ -303,26 +441,15 @@ void _remmina_error(const gchar *fun, const gchar *fmt, ...)
 	TRACE_CALL(__func__);
 
 	va_list args;
-	gchar *text;
+	g_autofree gchar *text = NULL;
 	va_start(args, fmt);
 	text = g_strdup_vprintf(fmt, args);
 	va_end(args);
 
-	g_autofree gchar *buf = g_strconcat("(", fun, ") - ", text, NULL);
-	g_free(text);
-
 	// always appends newline
-	g_error ("%s", buf);
-
-	if (!log_window) {
-		return;
-	}
-
-	g_autofree gchar *buf_tmp = g_strconcat(buf, "\n", NULL);
-	/* freed in remmina_log_print_real */
-	gchar *bufn = g_strconcat("(ERROR) - ", buf_tmp, NULL);
+	g_error ("(%s) - %s", fun, text);
 
-	IDLE_ADD(remmina_log_print_real, bufn);
+	remmina_log_put(g_strconcat("(ERROR) - (", fun, ") - ", text, "\n", NULL));
 }
 
 void _remmina_critical(const gchar *fun, const gchar *fmt, ...)
@@ -330,26 +457,15 @@ void _remmina_critical(const gchar *fun, const gchar *fmt, ...)
 	TRACE_CALL(__func__);
 
 	va_list args;
-	gchar *text;
+	g_autofree gchar *text = NULL;
 	va_start(args, fmt);
 	text = g_strdup_vprintf(fmt, args);
 	va_end(args);
 
-	g_autofree gchar *buf = g_strconcat("(", fun, ") - ", text, NULL);
-	g_free(text);
-
 	// always appends newline
-	g_critical ("%s", buf);
-
-	if (!log_window) {
-		return;
-	}
+	g_critical ("(%s) - %s", fun, text);
 
-	g_autofree gchar *buf_tmp = g_strconcat(buf, "\n", NULL);
-	/* freed in remmina_log_print_real */
-	gchar *bufn = g_strconcat("(CRIT) - ", buf_tmp, NULL);
-
-	IDLE_ADD(remmina_log_print_real, bufn);
+	remmina_log_put(g_strconcat("(CRIT) - (", fun, ") - ", text, "\n", NULL));
 }
 
 // Only prints into Remmina's own debug window. (Not stdout!)
@@ -360,11 +476,16 @@ void remmina_log_printf(const gchar *fmt, ...)
 	va_list args;
 	gchar *text;
 
-	if (!log_window) return;
+	if (!g_atomic_int_get(&remmina_log_window_open)) return;
 
 	va_start(args, fmt);
 	text = g_strdup_vprintf(fmt, args);
 	va_end(args);
 
-	IDLE_ADD(remmina_log_print_real, text);
+	remmina_log_put(text);
+}
+
+gboolean remmina_log_enabled(GLogLevelFlags level)
+{
+	return REMMINA_LOG_ENABLED(level);
 }
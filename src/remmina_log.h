@@ -39,14 +39,21 @@
 
 G_BEGIN_DECLS
 
-#define REMMINA_INFO(fmt, ...)     _remmina_info(fmt, ##__VA_ARGS__)
+/* GLogLevelFlags of the messages shown somewhere, updated atomically */
+extern gint remmina_log_levels;
+#define REMMINA_LOG_ENABLED(level) (g_atomic_int_get(&remmina_log_levels) & (level))
+
+/* Info and debug arguments are not even evaluated when nobody reads them */
+#define REMMINA_INFO(fmt, ...)     G_STMT_START { if (REMMINA_LOG_ENABLED(G_LOG_LEVEL_INFO)) _remmina_info(fmt, ##__VA_ARGS__); } G_STMT_END
 #define REMMINA_MESSAGE(fmt, ...)  _remmina_message(fmt, ##__VA_ARGS__)
-#define REMMINA_DEBUG(fmt, ...)    _remmina_debug(__func__, fmt, ##__VA_ARGS__)
+#define REMMINA_DEBUG(fmt, ...)    G_STMT_START { if (REMMINA_LOG_ENABLED(G_LOG_LEVEL_DEBUG)) _remmina_debug(__func__, fmt, ##__VA_ARGS__); } G_STMT_END
 #define REMMINA_WARNING(fmt, ...)  _remmina_warning(__func__, fmt, ##__VA_ARGS__)
 #define REMMINA_ERROR(fmt, ...)    _remmina_error(__func__, fmt, ##__VA_ARGS__)
 #define REMMINA_CRITICAL(fmt, ...) _remmina_critical(__func__, fmt, ##__VA_ARGS__)
 
+void remmina_log_init(void);
 void remmina_log_start(void);
+gboolean remmina_log_enabled(GLogLevelFlags level);
 gboolean remmina_log_running(void);
 void remmina_log_print(const gchar *text);
 void _remmina_info(const gchar *fmt, ...);
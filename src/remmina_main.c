@@ -47,11 +47,13 @@
 #include "remmina_public.h"
 #include "remmina_file.h"
 #include "remmina_file_manager.h"
+#include "remmina_file_index.h"
 #include "remmina_file_editor.h"
 #include "rcw.h"
 #include "remmina_about.h"
 #include "remmina_pref.h"
 #include "remmina_pref_dialog.h"
+#include "remmina_prewarm.h"
 #include "remmina_widget_pool.h"
 #include "remmina_plugin_manager.h"
 #include "remmina_log.h"
@@ -159,6 +161,9 @@ static void remmina_main_save_expanded_group_func(GtkTreeView *tree_view, GtkTre
 static void remmina_main_save_expanded_group(void)
 {
 	TRACE_CALL(__func__);
+	/* A partially loaded tree would lose the groups not loaded yet */
+	if (remminamain->priv->file_load)
+		return;
 	if (GTK_IS_TREE_STORE(remminamain->priv->file_model)) {
 		if (remminamain->priv->expanded_group)
 			remmina_string_array_free(remminamain->priv->expanded_group);
@@ -194,6 +199,22 @@ void remmina_main_destroy()
 			gtk_widget_destroy(GTK_WIDGET(remminamain->window));
 
 		g_object_unref(remminamain->builder);
+		remmina_pref_notify_remove(remminamain->priv->pref_notify_id);
+		if (remminamain->priv->file_load)
+			remmina_file_index_iterate_cancel(remminamain->priv->file_load);
+		if (remminamain->priv->file_groups)
+			g_hash_table_destroy(remminamain->priv->file_groups);
+		if (remminamain->priv->file_rows)
+			g_hash_table_destroy(remminamain->priv->file_rows);
+		g_free(remminamain->priv->file_load_selected);
+		if (remminamain->priv->file_monitor) {
+			g_file_monitor_cancel(remminamain->priv->file_monitor);
+			g_object_unref(remminamain->priv->file_monitor);
+		}
+		g_free(remminamain->priv->file_monitor_dir);
+		if (remminamain->priv->file_changes_source)
+			g_source_remove(remminamain->priv->file_changes_source);
+		g_hash_table_destroy(remminamain->priv->file_changes);
 		remmina_string_array_free(remminamain->priv->expanded_group);
 		remminamain->priv->expanded_group = NULL;
 		if (remminamain->priv->file_model)
@@ -247,6 +268,10 @@ void remmina_main_on_destroy_event()
 	if (remminamain) {
 		/* Invalidate remminamain->window to avoid multiple destructions */
 		remminamain->window = NULL;
+		if (remminamain->priv->file_load) {
+			remmina_file_index_iterate_cancel(remminamain->priv->file_load);
+			remminamain->priv->file_load = NULL;
+		}
 		/* Destroy remminamain struct, later. We can't destroy
 			important objects like the builder now */
 		g_idle_add(remmina_main_idle_destroy, NULL);
@@ -340,68 +365,97 @@ static gboolean remmina_main_selection_func(GtkTreeSelection *selection, GtkTree
 	if (remminamain->priv->selected_filename) {
 		g_snprintf(buf, sizeof(buf), "%s (%s)", remminamain->priv->selected_name, remminamain->priv->selected_filename);
 		gtk_statusbar_push(remminamain->statusbar_main, context_id, buf);
+		remmina_prewarm_schedule(remminamain->priv->selected_filename);
 	} else
 		gtk_statusbar_push(remminamain->statusbar_main, context_id, remminamain->priv->selected_name);
 
 	return TRUE;
 }
 
-static void remmina_main_load_file_list_callback(RemminaFile *remminafile, gpointer user_data)
+static void remmina_main_file_row_set(GtkTreeModel *model, GtkTreeIter *iter, const RemminaFileIndexEntry *entry)
 {
 	TRACE_CALL(__func__);
-	GtkTreeIter iter;
-	GtkListStore *store;
-	store = GTK_LIST_STORE(user_data);
 	gchar *datetime;
 
-	datetime = remmina_file_get_datetime(remminafile);
-	gtk_list_store_append(store, &iter);
-	gtk_list_store_set(store, &iter,
-			   PROTOCOL_COLUMN, remmina_file_get_icon_name(remminafile),
-			   NAME_COLUMN, remmina_file_get_string(remminafile, "name"),
-			   GROUP_COLUMN, remmina_file_get_string(remminafile, "group"),
-			   SERVER_COLUMN, remmina_file_get_string(remminafile, "server"),
-			   PLUGIN_COLUMN, remmina_file_get_string(remminafile, "protocol"),
-			   DATE_COLUMN, datetime,
-			   FILENAME_COLUMN, remmina_file_get_filename(remminafile),
-			   -1);
+	datetime = remmina_file_index_entry_get_datetime(entry);
+	if (GTK_IS_TREE_STORE(model))
+		gtk_tree_store_set(GTK_TREE_STORE(model), iter,
+				   PROTOCOL_COLUMN, remmina_file_index_entry_get_icon_name(entry),
+				   NAME_COLUMN, entry->name,
+				   GROUP_COLUMN, entry->group,
+				   SERVER_COLUMN, entry->server,
+				   PLUGIN_COLUMN, entry->protocol,
+				   DATE_COLUMN, datetime,
+				   FILENAME_COLUMN, entry->filename,
+				   -1);
+	else
+		gtk_list_store_set(GTK_LIST_STORE(model), iter,
+				   PROTOCOL_COLUMN, remmina_file_index_entry_get_icon_name(entry),
+				   NAME_COLUMN, entry->name,
+				   GROUP_COLUMN, entry->group,
+				   SERVER_COLUMN, entry->server,
+				   PLUGIN_COLUMN, entry->protocol,
+				   DATE_COLUMN, datetime,
+				   FILENAME_COLUMN, entry->filename,
+				   -1);
 	g_free(datetime);
+
+	/* List and tree store iters persist, keep them for the row level updates */
+	if (!g_hash_table_contains(remminamain->priv->file_rows, entry->filename))
+		g_hash_table_insert(remminamain->priv->file_rows, g_strdup(entry->filename), g_memdup(iter, sizeof(GtkTreeIter)));
 }
 
-static gboolean remmina_main_load_file_tree_traverse(GNode *node, GtkTreeStore *store, GtkTreeIter *parent)
+static void remmina_main_load_file_list_callback(const RemminaFileIndexEntry *entry, gpointer user_data)
 {
 	TRACE_CALL(__func__);
-	GtkTreeIter *iter;
-	RemminaGroupData *data;
-	GNode *child;
+	GtkTreeIter iter;
 
-	iter = NULL;
-	if (node->data) {
-		data = (RemminaGroupData *)node->data;
-		iter = g_new0(GtkTreeIter, 1);
-		gtk_tree_store_append(store, iter, parent);
-		gtk_tree_store_set(store, iter,
-				   PROTOCOL_COLUMN, "folder-symbolic",
-				   NAME_COLUMN, data->name,
-				   GROUP_COLUMN, data->group,
-				   DATE_COLUMN, data->datetime,
-				   FILENAME_COLUMN, NULL,
-				   -1);
-	}
-	for (child = g_node_first_child(node); child; child = g_node_next_sibling(child))
-		remmina_main_load_file_tree_traverse(child, store, iter);
-	g_free(iter);
-	return FALSE;
+	gtk_list_store_append(GTK_LIST_STORE(user_data), &iter);
+	remmina_main_file_row_set(GTK_TREE_MODEL(user_data), &iter, entry);
 }
 
-static void remmina_main_load_file_tree_group(GtkTreeStore *store)
+/* Get the row of a group, creating it and its parents if needed */
+static gboolean remmina_main_load_file_tree_get_group(GtkTreeStore *store, const gchar *group, GtkTreeIter *iter)
 {
 	TRACE_CALL(__func__);
-	GNode *root;
+	GtkTreeIter *found, *parent;
+	const gchar *p, *end;
+	gchar *path, *name;
+
+	if (group == NULL || group[0] == '\0')
+		return FALSE;
+
+	/* GtkTreeStore iters persist, they are kept for the whole load */
+	parent = NULL;
+	p = group;
+	while (TRUE) {
+		end = strchr(p, '/');
+		path = end ? g_strndup(group, end - group) : g_strdup(group);
+		found = g_hash_table_lookup(remminamain->priv->file_groups, path);
+		if (found) {
+			g_free(path);
+		} else {
+			name = end ? g_strndup(p, end - p) : g_strdup(p);
+			found = g_new(GtkTreeIter, 1);
+			gtk_tree_store_append(store, found, parent);
+			gtk_tree_store_set(store, found,
+					   PROTOCOL_COLUMN, "folder-symbolic",
+					   NAME_COLUMN, name,
+					   GROUP_COLUMN, path,
+					   DATE_COLUMN, NULL,
+					   FILENAME_COLUMN, NULL,
+					   -1);
+			g_free(name);
+			g_hash_table_insert(remminamain->priv->file_groups, path, found);
+		}
+		parent = found;
+		if (!end)
+			break;
+		p = end + 1;
+	}
 
-	root = remmina_file_manager_get_group_tree();
-	remmina_main_load_file_tree_traverse(root, store, NULL);
-	remmina_file_manager_free_group_tree(root);
+	*iter = *parent;
+	return TRUE;
 }
 
 static void remmina_main_expand_group_traverse(GtkTreeIter *iter)
@@ -442,61 +496,18 @@ static void remmina_main_expand_group(void)
 		remmina_main_expand_group_traverse(&iter);
 }
 
-static gboolean remmina_main_load_file_tree_find(GtkTreeModel *tree, GtkTreeIter *iter, const gchar *match_group)
-{
-	TRACE_CALL(__func__);
-	gboolean ret, match;
-	gchar *group, *filename;
-	GtkTreeIter child;
-
-	match = FALSE;
-	ret = TRUE;
-	while (ret) {
-		gtk_tree_model_get(tree, iter, GROUP_COLUMN, &group, FILENAME_COLUMN, &filename, -1);
-		match = (filename == NULL && g_strcmp0(group, match_group) == 0);
-		g_free(group);
-		g_free(filename);
-		if (match)
-			break;
-		if (gtk_tree_model_iter_children(tree, &child, iter)) {
-			match = remmina_main_load_file_tree_find(tree, &child, match_group);
-			if (match) {
-				memcpy(iter, &child, sizeof(GtkTreeIter));
-				break;
-			}
-		}
-		ret = gtk_tree_model_iter_next(tree, iter);
-	}
-	return match;
-}
-
-static void remmina_main_load_file_tree_callback(RemminaFile *remminafile, gpointer user_data)
+static void remmina_main_load_file_tree_callback(const RemminaFileIndexEntry *entry, gpointer user_data)
 {
 	TRACE_CALL(__func__);
 	GtkTreeIter iter, child;
 	GtkTreeStore *store;
 	gboolean found;
-	gchar *datetime;
 
 	store = GTK_TREE_STORE(user_data);
 
-	found = FALSE;
-	if (gtk_tree_model_get_iter_first(GTK_TREE_MODEL(store), &iter))
-		found = remmina_main_load_file_tree_find(GTK_TREE_MODEL(store), &iter,
-							 remmina_file_get_string(remminafile, "group"));
-
-	datetime = remmina_file_get_datetime(remminafile);
+	found = remmina_main_load_file_tree_get_group(store, entry->group, &iter);
 	gtk_tree_store_append(store, &child, (found ? &iter : NULL));
-	gtk_tree_store_set(store, &child,
-			   PROTOCOL_COLUMN, remmina_file_get_icon_name(remminafile),
-			   NAME_COLUMN, remmina_file_get_string(remminafile, "name"),
-			   GROUP_COLUMN, remmina_file_get_string(remminafile, "group"),
-			   SERVER_COLUMN, remmina_file_get_string(remminafile, "server"),
-			   PLUGIN_COLUMN, remmina_file_get_string(remminafile, "protocol"),
-			   DATE_COLUMN, datetime,
-			   FILENAME_COLUMN, remmina_file_get_filename(remminafile),
-			   -1);
-	g_free(datetime);
+	remmina_main_file_row_set(GTK_TREE_MODEL(store), &child, entry);
 }
 
 static void remmina_main_file_model_on_sort(GtkTreeSortable *sortable, gpointer user_data)
@@ -585,18 +596,222 @@ static void remmina_main_select_file(const gchar *filename)
 	}
 }
 
-static void remmina_main_load_files()
+static void remmina_main_show_items_count(gint count)
 {
 	TRACE_CALL(__func__);
-	gint items_count;
 	gchar buf[200];
 	guint context_id;
+
+	/* Show in the status bar the total number of connections found */
+	g_snprintf(buf, sizeof(buf), ngettext("Total %i item.", "Total %i items.", count), count);
+	context_id = gtk_statusbar_get_context_id(remminamain->statusbar_main, "status");
+	gtk_statusbar_pop(remminamain->statusbar_main, context_id);
+	gtk_statusbar_push(remminamain->statusbar_main, context_id, buf);
+}
+
+static void remmina_main_load_files_progress(gint count, gboolean finished, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	remmina_main_show_items_count(count);
+
+	if (!finished)
+		return;
+
+	remminamain->priv->file_load = NULL;
+
+	remmina_main_expand_group();
+	/* Select the file previously selected, unless another one has been selected meanwhile */
+	if (remminamain->priv->file_load_selected) {
+		if (gtk_tree_selection_count_selected_rows(gtk_tree_view_get_selection(remminamain->tree_files_list)) == 0)
+			remmina_main_select_file(remminamain->priv->file_load_selected);
+		g_free(remminamain->priv->file_load_selected);
+		remminamain->priv->file_load_selected = NULL;
+	}
+}
+
+static void remmina_main_file_row_remove(const gchar *filename)
+{
+	TRACE_CALL(__func__);
+	GtkTreeModel *model;
+	GtkTreeIter *found, iter, parent;
+	gboolean has_parent;
+	gchar *group;
+
+	found = g_hash_table_lookup(remminamain->priv->file_rows, filename);
+	if (!found)
+		return;
+	iter = *found;
+	g_hash_table_remove(remminamain->priv->file_rows, filename);
+
+	model = remminamain->priv->file_model;
+	if (!GTK_IS_TREE_STORE(model)) {
+		gtk_list_store_remove(GTK_LIST_STORE(model), &iter);
+		return;
+	}
+
+	has_parent = gtk_tree_model_iter_parent(model, &parent, &iter);
+	gtk_tree_store_remove(GTK_TREE_STORE(model), &iter);
+	/* Drop the groups left empty, as a full reload would */
+	while (has_parent && !gtk_tree_model_iter_has_child(model, &parent)) {
+		iter = parent;
+		has_parent = gtk_tree_model_iter_parent(model, &parent, &iter);
+		gtk_tree_model_get(model, &iter, GROUP_COLUMN, &group, -1);
+		g_hash_table_remove(remminamain->priv->file_groups, group);
+		g_free(group);
+		gtk_tree_store_remove(GTK_TREE_STORE(model), &iter);
+	}
+}
+
+/* Apply the change of a single profile to the current model */
+static void remmina_main_file_row_update(const gchar *filename)
+{
+	TRACE_CALL(__func__);
+	const RemminaFileIndexEntry *entry;
+	GtkTreeModel *model;
+	GtkTreeIter *found;
+	gchar *group;
+
+	model = remminamain->priv->file_model;
+	entry = remmina_file_index_update(filename);
+	found = g_hash_table_lookup(remminamain->priv->file_rows, filename);
+
+	if (found && entry && GTK_IS_TREE_STORE(model)) {
+		/* Moving to another group means another parent row */
+		gtk_tree_model_get(model, found, GROUP_COLUMN, &group, -1);
+		if (g_strcmp0(group, entry->group) != 0) {
+			remmina_main_file_row_remove(filename);
+			found = NULL;
+		}
+		g_free(group);
+	}
+
+	if (!entry)
+		remmina_main_file_row_remove(filename);
+	else if (found)
+		remmina_main_file_row_set(model, found, entry);
+	else if (GTK_IS_TREE_STORE(model))
+		remmina_main_load_file_tree_callback(entry, model);
+	else
+		remmina_main_load_file_list_callback(entry, model);
+}
+
+static gboolean remmina_main_file_changes_apply(gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	GHashTableIter iter;
+	const gchar *filename;
+
+	/* The load in progress owns the index, wait for it */
+	if (remminamain->priv->file_load)
+		return G_SOURCE_CONTINUE;
+
+	g_hash_table_iter_init(&iter, remminamain->priv->file_changes);
+	while (g_hash_table_iter_next(&iter, (gpointer *)&filename, NULL))
+		remmina_main_file_row_update(filename);
+	g_hash_table_remove_all(remminamain->priv->file_changes);
+	remminamain->priv->file_changes_source = 0;
+
+	remmina_main_show_items_count(g_hash_table_size(remminamain->priv->file_rows));
+	return G_SOURCE_REMOVE;
+}
+
+static void remmina_main_file_changed(const gchar *filename)
+{
+	TRACE_CALL(__func__);
+	if (!filename || !g_str_has_suffix(filename, ".remmina"))
+		return;
+
+	/* Coalesce the bursts of events of a single save */
+	g_hash_table_add(remminamain->priv->file_changes, g_strdup(filename));
+	if (!remminamain->priv->file_changes_source)
+		remminamain->priv->file_changes_source = g_timeout_add(100, remmina_main_file_changes_apply, NULL);
+}
+
+static void remmina_main_file_monitor_changed(GFileMonitor *monitor, GFile *file, GFile *other_file,
+					      GFileMonitorEvent event_type, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	gchar *filename;
+
+	switch (event_type) {
+	case G_FILE_MONITOR_EVENT_RENAMED:
+		/* g_file_set_contents() renames a temporary file over the profile */
+		filename = g_file_get_path(other_file);
+		remmina_main_file_changed(filename);
+		g_free(filename);
+	/* Fallthrough */
+	case G_FILE_MONITOR_EVENT_CHANGED:
+	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+	case G_FILE_MONITOR_EVENT_MOVED_IN:
+	case G_FILE_MONITOR_EVENT_MOVED_OUT:
+		filename = g_file_get_path(file);
+		remmina_main_file_changed(filename);
+		g_free(filename);
+		break;
+	default:
+		break;
+	}
+}
+
+static void remmina_main_monitor_files(void)
+{
+	TRACE_CALL(__func__);
+	GFile *dir;
+	GError *error = NULL;
+	gchar *datadir;
+
+	datadir = remmina_file_get_datadir();
+	if (g_strcmp0(datadir, remminamain->priv->file_monitor_dir) == 0) {
+		g_free(datadir);
+		return;
+	}
+
+	if (remminamain->priv->file_monitor) {
+		g_file_monitor_cancel(remminamain->priv->file_monitor);
+		g_object_unref(remminamain->priv->file_monitor);
+	}
+	g_free(remminamain->priv->file_monitor_dir);
+	remminamain->priv->file_monitor_dir = datadir;
+
+	dir = g_file_new_for_path(datadir);
+	remminamain->priv->file_monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+	g_object_unref(dir);
+	if (!remminamain->priv->file_monitor) {
+		REMMINA_DEBUG("Cannot watch the profile directory %s: %s", datadir, error->message);
+		g_error_free(error);
+		return;
+	}
+	g_signal_connect(remminamain->priv->file_monitor, "changed", G_CALLBACK(remmina_main_file_monitor_changed), NULL);
+}
+
+static void remmina_main_load_files()
+{
+	TRACE_CALL(__func__);
 	gint view_file_mode;
-	char *save_selected_filename;
 	GtkTreeModel *newmodel;
+	RemminaFileIndexFunc func;
 
-	save_selected_filename = g_strdup(remminamain->priv->selected_filename);
-	remmina_main_save_expanded_group();
+	if (remminamain->priv->file_load) {
+		/* Still loading: keep the selection and the expanded groups saved
+		 * before the first load */
+		remmina_file_index_iterate_cancel(remminamain->priv->file_load);
+		remminamain->priv->file_load = NULL;
+	} else {
+		g_free(remminamain->priv->file_load_selected);
+		remminamain->priv->file_load_selected = g_strdup(remminamain->priv->selected_filename);
+		remmina_main_save_expanded_group();
+	}
+	if (remminamain->priv->file_groups) {
+		g_hash_table_destroy(remminamain->priv->file_groups);
+		remminamain->priv->file_groups = NULL;
+	}
+	if (remminamain->priv->file_rows)
+		g_hash_table_destroy(remminamain->priv->file_rows);
+	remminamain->priv->file_rows = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	remmina_main_monitor_files();
 
 	view_file_mode = remmina_pref.view_file_mode;
 	if (remminamain->priv->override_view_file_mode_to_list)
@@ -618,10 +833,9 @@ static void remmina_main_load_files()
 		newmodel = GTK_TREE_MODEL(gtk_tree_store_new(7, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING));
 		/* Hide the Group column in the tree view mode */
 		gtk_tree_view_column_set_visible(remminamain->column_files_list_group, FALSE);
-		/* Load groups first */
-		remmina_main_load_file_tree_group(GTK_TREE_STORE(newmodel));
-		/* Load files list */
-		items_count = remmina_file_manager_iterate((GFunc)remmina_main_load_file_tree_callback, (gpointer)newmodel);
+		/* Groups are created along with the files */
+		remminamain->priv->file_groups = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+		func = remmina_main_load_file_tree_callback;
 		break;
 
 	case REMMINA_VIEW_FILE_LIST:
@@ -630,8 +844,7 @@ static void remmina_main_load_files()
 		newmodel = GTK_TREE_MODEL(gtk_list_store_new(7, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING));
 		/* Show the Group column in the list view mode */
 		gtk_tree_view_column_set_visible(remminamain->column_files_list_group, TRUE);
-		/* Load files list */
-		items_count = remmina_file_manager_iterate((GFunc)remmina_main_load_file_list_callback, (gpointer)newmodel);
+		func = remmina_main_load_file_list_callback;
 		break;
 	}
 
@@ -652,17 +865,25 @@ static void remmina_main_load_files()
 	gtk_tree_view_set_model(remminamain->tree_files_list, remminamain->priv->file_model_sort);
 	g_signal_connect(G_OBJECT(remminamain->priv->file_model_sort), "sort-column-changed",
 			 G_CALLBACK(remmina_main_file_model_on_sort), NULL);
-	remmina_main_expand_group();
-	/* Select the file previously selected */
-	if (save_selected_filename) {
-		remmina_main_select_file(save_selected_filename);
-		g_free(save_selected_filename);
-	}
-	/* Show in the status bar the total number of connections found */
-	g_snprintf(buf, sizeof(buf), ngettext("Total %i item.", "Total %i items.", items_count), items_count);
-	context_id = gtk_statusbar_get_context_id(remminamain->statusbar_main, "status");
-	gtk_statusbar_pop(remminamain->statusbar_main, context_id);
-	gtk_statusbar_push(remminamain->statusbar_main, context_id, buf);
+
+	/* The rows are streamed into the attached model while the profiles are
+	 * parsed in the background; the selection and the expanded groups are
+	 * restored when it is over */
+	remminamain->priv->file_load = remmina_file_index_iterate_async(func, remmina_main_load_files_progress, newmodel);
+}
+
+static void remmina_main_pref_changed(const gchar *key, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	gchar *datadir;
+
+	if (!remminamain || (key && g_strcmp0(key, "datadir_path") != 0))
+		return;
+	/* The profiles moved to another directory */
+	datadir = remmina_file_get_datadir();
+	if (g_strcmp0(datadir, remminamain->priv->file_monitor_dir) != 0)
+		remmina_main_load_files();
+	g_free(datadir);
 }
 
 void remmina_main_load_files_cb(GtkEntry *entry, char *string, gpointer user_data)
@@ -706,7 +927,9 @@ void remmina_main_on_action_connection_external_tools(GSimpleAction *action, GVa
 static void remmina_main_file_editor_destroy(GtkWidget *widget, gpointer user_data)
 {
 	TRACE_CALL(__func__);
-	remmina_main_load_files();
+	/* Saved profiles are updated row by row, see remmina_main_update_file_datetime() */
+	if (!remminamain->priv->file_monitor)
+		remmina_main_load_files();
 }
 
 void remmina_main_on_action_application_mpchange(GSimpleAction *action, GVariant *param, gpointer data)
@@ -765,6 +988,30 @@ static gboolean remmina_main_search_key_event (GtkWidget *search_entry, GdkEvent
 	return FALSE;
 }
 
+/* Warm up the connection of the hovered profile, see remmina_prewarm.c */
+static gboolean remmina_main_tree_motion (GtkWidget *tree, GdkEventMotion *event, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	GtkTreeModel *model;
+	GtkTreePath *path;
+	GtkTreeIter iter;
+	gchar *filename = NULL;
+
+	if (!remmina_pref.prewarm_connections)
+		return FALSE;
+	if (!gtk_tree_view_get_path_at_pos(GTK_TREE_VIEW(tree), event->x, event->y, &path, NULL, NULL, NULL))
+		return FALSE;
+
+	model = gtk_tree_view_get_model(GTK_TREE_VIEW(tree));
+	if (gtk_tree_model_get_iter(model, &iter, path)) {
+		gtk_tree_model_get(model, &iter, FILENAME_COLUMN, &filename, -1);
+		remmina_prewarm_schedule(filename);
+		g_free(filename);
+	}
+	gtk_tree_path_free(path);
+	return FALSE;
+}
+
 static gboolean remmina_main_tree_row_activated (GtkTreeView *tree, GtkTreePath *path, GtkTreeViewColumn *column, gpointer user_data)
 {
 	TRACE_CALL(__func__);
@@ -853,10 +1100,11 @@ void remmina_main_on_action_connection_delete(GSimpleAction *action, GVariant *p
 					_("Are you sure you want to delete “%s”?"), remminamain->priv->selected_name);
 	if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_YES) {
 		delfilename = g_strdup(remminamain->priv->selected_filename);
+		remmina_prewarm_cancel();
 		remmina_file_delete(delfilename);
+		remmina_main_file_changed(delfilename);
 		g_free(delfilename);
 		remmina_icon_populate_menu();
-		remmina_main_load_files();
 	}
 	gtk_widget_destroy(dialog);
 	remmina_main_clear_selection_data();
@@ -1383,6 +1631,7 @@ static void remmina_main_init(void)
 		gtk_widget_grab_focus (GTK_WIDGET(remminamain->tree_files_list));
 	/* Load the files list */
 	remmina_main_load_files();
+	remminamain->priv->pref_notify_id = remmina_pref_notify_add(remmina_main_pref_changed, NULL);
 
 	/* Drag-n-drop support */
 	gtk_drag_dest_set(GTK_WIDGET(remminamain->window), GTK_DEST_DEFAULT_ALL, remmina_drop_types, 1, GDK_ACTION_COPY);
@@ -1413,6 +1662,7 @@ GtkWidget *remmina_main_new(void)
 
 	remminamain = g_new0(RemminaMain, 1);
 	remminamain->priv = g_new0(RemminaMainPriv, 1);
+	remminamain->priv->file_changes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 	/* Assign UI widgets to the private members */
 	remminamain->builder = remmina_public_gtk_builder_new_from_resource ("/org/remmina/Remmina/src/../data/ui/remmina_main.glade");
 	remminamain->window = GTK_WINDOW(RM_GET_OBJECT("RemminaMain"));
@@ -1457,6 +1707,7 @@ GtkWidget *remmina_main_new(void)
 	/* signals */
 	g_signal_connect (remminamain->entry_quick_connect_server, "key-release-event", G_CALLBACK (remmina_main_search_key_event), NULL);
 	g_signal_connect (remminamain->tree_files_list, "row-activated", G_CALLBACK (remmina_main_tree_row_activated), NULL);
+	g_signal_connect (remminamain->tree_files_list, "motion-notify-event", G_CALLBACK (remmina_main_tree_motion), NULL);
 	/* Non widget objects */
 	actions = g_simple_action_group_new();
 	g_action_map_add_action_entries(G_ACTION_MAP(actions), app_actions, G_N_ELEMENTS(app_actions), remminamain->window);
@@ -1498,7 +1749,8 @@ void remmina_main_update_file_datetime(RemminaFile *file)
 {
 	if (!remminamain)
 		return;
-	remmina_main_load_files();
+	/* Without waiting for the directory monitor, if any */
+	remmina_main_file_changed(remmina_file_get_filename(file));
 }
 
 void remmina_main_show_warning_dialog(const gchar *message)
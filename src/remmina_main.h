@@ -39,6 +39,7 @@
 #pragma once
 
 #include "remmina_file.h"
+#include "remmina_file_index.h"
 
 typedef struct _RemminaMainPriv RemminaMainPriv;
 
@@ -86,6 +87,19 @@ struct _RemminaMainPriv {
 	gchar *			selected_name;
 	gboolean		override_view_file_mode_to_list;
 	RemminaStringArray *	expanded_group;
+
+	/* Files list being loaded */
+	RemminaFileIndexIteration *	file_load;
+	gchar *			file_load_selected;
+	/* Rows of file_model: file name or group -> GtkTreeIter */
+	GHashTable *		file_rows;
+	GHashTable *		file_groups;
+	/* Profile directory watch, and the changes not applied yet */
+	GFileMonitor *		file_monitor;
+	gchar *			file_monitor_dir;
+	GHashTable *		file_changes;
+	guint			file_changes_source;
+	guint			pref_notify_id;
 };
 
 G_BEGIN_DECLS
@@ -58,7 +58,7 @@ static gboolean remmina_masterthread_exec_callback(RemminaMTExecData *d)
 			remmina_protocol_widget_chat_receive(d->p.chat_receive.gp, d->p.chat_receive.text);
 			break;
 		case FUNC_FILE_GET_STRING:
-			d->p.file_get_string.retval = remmina_file_get_string( d->p.file_get_string.remminafile, d->p.file_get_string.setting );
+			d->p.file_get_string.retval = remmina_file_get_string_shared( d->p.file_get_string.remminafile, d->p.file_get_string.setting );
 			break;
 		case FUNC_GTK_LABEL_SET_TEXT:
 			gtk_label_set_text( d->p.gtk_label_set_text.label, d->p.gtk_label_set_text.str );
@@ -255,7 +255,11 @@ RemminaPluginService remmina_plugin_manager_service =
 	remmina_masterthread_exec_is_main_thread,
 	remmina_gtksocket_available,
 	remmina_protocol_widget_get_profile_remote_width,
-	remmina_protocol_widget_get_profile_remote_height
+	remmina_protocol_widget_get_profile_remote_height,
+	remmina_log_enabled,
+	remmina_protocol_widget_get_visibility,
+	remmina_protocol_widget_reconnect_wait,
+	remmina_protocol_widget_reconnect_interrupt
 };
 
 const char *get_filename_ext(const char *filename) {
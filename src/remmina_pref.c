@@ -53,12 +53,236 @@
 #include "remmina_pref.h"
 #include "remmina/remmina_trace_calls.h"
 
+/* Delay before writing back the preferences, to coalesce bursts of changes */
+#define REMMINA_PREF_WRITE_DELAY 500
+
 const gchar *default_resolutions = "640x480,800x600,1024x768,1152x864,1280x960,1400x1050";
 const gchar *default_keystrokes = "Send hello world§hello world\\n";
 
 gchar *remmina_keymap_file;
 static GHashTable *remmina_keymap_table = NULL;
 
+/* The parsed remmina.pref, shared by all threads. The "remmina" group holds
+ * the default profile, which is owned by remmina_file_save() on disk. Both
+ * read the file back before writing it, under remmina_pref_write_mutex */
+static GKeyFile *remmina_pref_keyfile = NULL;
+static GMutex remmina_pref_mutex;
+static guint remmina_pref_write_source = 0;
+/* Generation of the last snapshot taken and of the last one written */
+static guint remmina_pref_generation = 0;
+static guint remmina_pref_written = 0;
+static GMutex remmina_pref_write_mutex;
+
+typedef struct _RemminaPrefNotify {
+	guint			id;
+	RemminaPrefNotifyFunc	func;
+	gpointer		user_data;
+} RemminaPrefNotify;
+
+static GList *remmina_pref_notify_list = NULL;
+static guint remmina_pref_notify_id = 0;
+
+typedef struct _RemminaPrefSnapshot {
+	gchar * data;
+	gsize	length;
+	guint	generation;
+} RemminaPrefSnapshot;
+
+static void remmina_pref_snapshot_free(RemminaPrefSnapshot *snapshot)
+{
+	g_free(snapshot->data);
+	g_free(snapshot);
+}
+
+/* Must be called with remmina_pref_mutex held */
+static RemminaPrefSnapshot *remmina_pref_snapshot(void)
+{
+	RemminaPrefSnapshot *snapshot;
+
+	snapshot = g_new0(RemminaPrefSnapshot, 1);
+	snapshot->data = g_key_file_to_data(remmina_pref_keyfile, &snapshot->length, NULL);
+	snapshot->generation = ++remmina_pref_generation;
+	return snapshot;
+}
+
+static gboolean remmina_pref_write(RemminaPrefSnapshot *snapshot, GError **error)
+{
+	TRACE_CALL(__func__);
+	GKeyFile *gkeyfile, *disk;
+	gchar **keys;
+	gchar *value;
+	g_autofree gchar *content = NULL;
+	gsize length;
+	gboolean ret = TRUE;
+	gint i;
+
+	g_mutex_lock(&remmina_pref_write_mutex);
+	/* An older snapshot must not overwrite a newer one */
+	if (snapshot->generation <= remmina_pref_written) {
+		g_mutex_unlock(&remmina_pref_write_mutex);
+		return TRUE;
+	}
+
+	gkeyfile = g_key_file_new();
+	g_key_file_load_from_data(gkeyfile, snapshot->data, snapshot->length, G_KEY_FILE_NONE, NULL);
+
+	/* Keep the default profile as it is on disk, if there is one */
+	disk = g_key_file_new();
+	if (g_key_file_load_from_file(disk, remmina_pref_file, G_KEY_FILE_NONE, NULL) &&
+	    g_key_file_has_key(disk, "remmina", "name", NULL)) {
+		g_key_file_remove_group(gkeyfile, "remmina", NULL);
+		keys = g_key_file_get_keys(disk, "remmina", NULL, NULL);
+		for (i = 0; keys && keys[i]; i++) {
+			value = g_key_file_get_value(disk, "remmina", keys[i], NULL);
+			g_key_file_set_value(gkeyfile, "remmina", keys[i], value);
+			g_free(value);
+		}
+		g_strfreev(keys);
+	}
+	g_key_file_free(disk);
+
+	content = g_key_file_to_data(gkeyfile, &length, NULL);
+	g_key_file_free(gkeyfile);
+	if (g_file_set_contents(remmina_pref_file, content, length, error))
+		remmina_pref_written = snapshot->generation;
+	else
+		ret = FALSE;
+
+	g_mutex_unlock(&remmina_pref_write_mutex);
+	return ret;
+}
+
+static void remmina_pref_write_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	TRACE_CALL(__func__);
+	GError *error = NULL;
+
+	if (!remmina_pref_write((RemminaPrefSnapshot *)task_data, &error)) {
+		g_warning("remmina_pref_save error: %s", error->message);
+		g_error_free(error);
+	}
+}
+
+static gboolean remmina_pref_write_timeout(gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	GTask *task;
+	RemminaPrefSnapshot *snapshot;
+
+	g_mutex_lock(&remmina_pref_mutex);
+	remmina_pref_write_source = 0;
+	snapshot = remmina_pref_snapshot();
+	g_mutex_unlock(&remmina_pref_mutex);
+
+	task = g_task_new(NULL, NULL, NULL, NULL);
+	g_task_set_task_data(task, snapshot, (GDestroyNotify)remmina_pref_snapshot_free);
+	g_task_run_in_thread(task, remmina_pref_write_thread);
+	g_object_unref(task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Must be called with remmina_pref_mutex held */
+static void remmina_pref_schedule_write(void)
+{
+	if (remmina_pref_write_source == 0)
+		remmina_pref_write_source = g_timeout_add(REMMINA_PREF_WRITE_DELAY, remmina_pref_write_timeout, NULL);
+}
+
+/* Write the pending changes now, to be called before exiting */
+void remmina_pref_flush(void)
+{
+	TRACE_CALL(__func__);
+	RemminaPrefSnapshot *snapshot;
+	GError *error = NULL;
+
+	gboolean pending;
+
+	g_mutex_lock(&remmina_pref_mutex);
+	g_mutex_lock(&remmina_pref_write_mutex);
+	/* Either scheduled, or handed to a thread which may not have run yet */
+	pending = remmina_pref_write_source != 0 || remmina_pref_generation > remmina_pref_written;
+	g_mutex_unlock(&remmina_pref_write_mutex);
+	if (!pending) {
+		g_mutex_unlock(&remmina_pref_mutex);
+		return;
+	}
+	if (remmina_pref_write_source) {
+		g_source_remove(remmina_pref_write_source);
+		remmina_pref_write_source = 0;
+	}
+	/* A newer snapshot, the thread will skip its own */
+	snapshot = remmina_pref_snapshot();
+	g_mutex_unlock(&remmina_pref_mutex);
+
+	if (!remmina_pref_write(snapshot, &error)) {
+		g_warning("remmina_pref_save error: %s", error->message);
+		g_error_free(error);
+	}
+	remmina_pref_snapshot_free(snapshot);
+}
+
+/* Held by remmina_file_save() while it rewrites the default profile, so
+ * that it does not interleave with a write of the preferences */
+void remmina_pref_file_lock(void)
+{
+	TRACE_CALL(__func__);
+	g_mutex_lock(&remmina_pref_write_mutex);
+}
+
+void remmina_pref_file_unlock(void)
+{
+	TRACE_CALL(__func__);
+	g_mutex_unlock(&remmina_pref_write_mutex);
+}
+
+guint remmina_pref_notify_add(RemminaPrefNotifyFunc func, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaPrefNotify *notify;
+
+	notify = g_new0(RemminaPrefNotify, 1);
+	notify->id = ++remmina_pref_notify_id;
+	notify->func = func;
+	notify->user_data = user_data;
+	remmina_pref_notify_list = g_list_append(remmina_pref_notify_list, notify);
+	return notify->id;
+}
+
+void remmina_pref_notify_remove(guint id)
+{
+	TRACE_CALL(__func__);
+	GList *l;
+
+	for (l = remmina_pref_notify_list; l; l = l->next) {
+		if (((RemminaPrefNotify *)l->data)->id == id) {
+			g_free(l->data);
+			remmina_pref_notify_list = g_list_delete_link(remmina_pref_notify_list, l);
+			return;
+		}
+	}
+}
+
+static gboolean remmina_pref_notify_dispatch(gpointer data)
+{
+	TRACE_CALL(__func__);
+	gchar *key = data;
+	GList *l, *next;
+
+	for (l = remmina_pref_notify_list; l; l = next) {
+		next = l->next;
+		((RemminaPrefNotify *)l->data)->func(key, ((RemminaPrefNotify *)l->data)->user_data);
+	}
+	g_free(key);
+	return G_SOURCE_REMOVE;
+}
+
+/* Listeners always run in the main thread. key is NULL when everything may have changed */
+static void remmina_pref_notify(const gchar *key)
+{
+	g_main_context_invoke(NULL, remmina_pref_notify_dispatch, g_strdup(key));
+}
+
 /* We could customize this further if there are more requirements */
 static const gchar *default_keymap_data = "# Please check gdk/gdkkeysyms.h for a full list of all key names or hex key values\n"
 					  "\n"
@@ -73,21 +297,12 @@ static void remmina_pref_gen_secret(void)
 	TRACE_CALL(__func__);
 	guchar s[32];
 	gint i;
-	GKeyFile *gkeyfile;
-	g_autofree gchar *content = NULL;
-	gsize length;
 
 	for (i = 0; i < 32; i++)
 		s[i] = (guchar)(randombytes_uniform(257));
 	remmina_pref.secret = g_base64_encode(s, 32);
 
-	gkeyfile = g_key_file_new();
-	g_key_file_load_from_file(gkeyfile, remmina_pref_file, G_KEY_FILE_NONE, NULL);
-	g_key_file_set_string(gkeyfile, "remmina_pref", "secret", remmina_pref.secret);
-	content = g_key_file_to_data(gkeyfile, &length, NULL);
-	g_file_set_contents(remmina_pref_file, content, length, NULL);
-
-	g_key_file_free(gkeyfile);
+	remmina_pref_set_value("secret", remmina_pref.secret);
 }
 
 static guint remmina_pref_get_keyval_from_str(const gchar *str)
@@ -453,6 +668,11 @@ void remmina_pref_init(void)
 	else
 		remmina_pref.ssh_parseconfig = DEFAULT_SSH_PARSECONFIG;
 
+	if (g_key_file_has_key(gkeyfile, "remmina_pref", "prewarm_connections", NULL))
+		remmina_pref.prewarm_connections = g_key_file_get_boolean(gkeyfile, "remmina_pref", "prewarm_connections", NULL);
+	else
+		remmina_pref.prewarm_connections = FALSE;
+
 	if (g_key_file_has_key(gkeyfile, "remmina_pref", "sshtunnel_port", NULL))
 		remmina_pref.sshtunnel_port = g_key_file_get_integer(gkeyfile, "remmina_pref", "sshtunnel_port", NULL);
 	else
@@ -478,6 +698,21 @@ void remmina_pref_init(void)
 	else
 		remmina_pref.ssh_tcp_usrtimeout = SSH_SOCKET_TCP_USER_TIMEOUT;
 
+	if (g_key_file_has_key(gkeyfile, "remmina_pref", "sftp_chunk_size", NULL))
+		remmina_pref.sftp_chunk_size = g_key_file_get_integer(gkeyfile, "remmina_pref", "sftp_chunk_size", NULL);
+	else
+		remmina_pref.sftp_chunk_size = DEFAULT_SFTP_CHUNK_SIZE;
+
+	if (g_key_file_has_key(gkeyfile, "remmina_pref", "sftp_requests", NULL))
+		remmina_pref.sftp_requests = g_key_file_get_integer(gkeyfile, "remmina_pref", "sftp_requests", NULL);
+	else
+		remmina_pref.sftp_requests = DEFAULT_SFTP_REQUESTS;
+
+	if (g_key_file_has_key(gkeyfile, "remmina_pref", "sftp_workers", NULL))
+		remmina_pref.sftp_workers = g_key_file_get_integer(gkeyfile, "remmina_pref", "sftp_workers", NULL);
+	else
+		remmina_pref.sftp_workers = DEFAULT_SFTP_WORKERS;
+
 	if (g_key_file_has_key(gkeyfile, "remmina_pref", "applet_new_ontop", NULL))
 		remmina_pref.applet_new_ontop = g_key_file_get_boolean(gkeyfile, "remmina_pref", "applet_new_ontop", NULL);
 	else
@@ -726,16 +961,21 @@ void remmina_pref_init(void)
 		g_remove(remmina_colors_file);
 	}
 
+	/* From now on the preferences are read from memory */
+	g_mutex_lock(&remmina_pref_mutex);
+	remmina_pref_keyfile = gkeyfile;
+	g_mutex_unlock(&remmina_pref_mutex);
+
 	/* Default settings */
 	if (!g_key_file_has_key(gkeyfile, "remmina", "name", NULL)) {
+		g_mutex_lock(&remmina_pref_mutex);
 		g_key_file_set_string(gkeyfile, "remmina", "name", "");
 		g_key_file_set_integer(gkeyfile, "remmina", "ignore-tls-errors", 1);
 		g_key_file_set_integer(gkeyfile, "remmina", "enable-plugins", 1);
+		g_mutex_unlock(&remmina_pref_mutex);
 		remmina_pref_save();
 	}
 
-	g_key_file_free(gkeyfile);
-
 	if (remmina_pref.secret == NULL)
 		remmina_pref_gen_secret();
 
@@ -761,13 +1001,9 @@ gboolean remmina_pref_save(void)
 		return FALSE;
 	}
 	GKeyFile *gkeyfile;
-	GError *error = NULL;
-	g_autofree gchar *content = NULL;
-	gsize length;
 
-	gkeyfile = g_key_file_new();
-
-	g_key_file_load_from_file(gkeyfile, remmina_pref_file, G_KEY_FILE_NONE, NULL);
+	g_mutex_lock(&remmina_pref_mutex);
+	gkeyfile = remmina_pref_keyfile;
 
 	g_key_file_set_string(gkeyfile, "remmina_pref", "datadir_path", remmina_pref.datadir_path);
 	g_key_file_set_string(gkeyfile, "remmina_pref", "remmina_file_name", remmina_pref.remmina_file_name);
@@ -797,6 +1033,7 @@ gboolean remmina_pref_save(void)
 	g_key_file_set_integer(gkeyfile, "remmina_pref", "scale_quality", remmina_pref.scale_quality);
 	g_key_file_set_integer(gkeyfile, "remmina_pref", "ssh_loglevel", remmina_pref.ssh_loglevel);
 	g_key_file_set_boolean(gkeyfile, "remmina_pref", "ssh_parseconfig", remmina_pref.ssh_parseconfig);
+	g_key_file_set_boolean(gkeyfile, "remmina_pref", "prewarm_connections", remmina_pref.prewarm_connections);
 	g_key_file_set_boolean(gkeyfile, "remmina_pref", "hide_toolbar", remmina_pref.hide_toolbar);
 	g_key_file_set_boolean(gkeyfile, "remmina_pref", "small_toolbutton", remmina_pref.small_toolbutton);
 	g_key_file_set_integer(gkeyfile, "remmina_pref", "view_file_mode", remmina_pref.view_file_mode);
@@ -814,6 +1051,9 @@ gboolean remmina_pref_save(void)
 	g_key_file_set_integer(gkeyfile, "remmina_pref", "ssh_tcp_keepintvl", remmina_pref.ssh_tcp_keepintvl);
 	g_key_file_set_integer(gkeyfile, "remmina_pref", "ssh_tcp_keepcnt", remmina_pref.ssh_tcp_keepcnt);
 	g_key_file_set_integer(gkeyfile, "remmina_pref", "ssh_tcp_usrtimeout", remmina_pref.ssh_tcp_usrtimeout);
+	g_key_file_set_integer(gkeyfile, "remmina_pref", "sftp_chunk_size", remmina_pref.sftp_chunk_size);
+	g_key_file_set_integer(gkeyfile, "remmina_pref", "sftp_requests", remmina_pref.sftp_requests);
+	g_key_file_set_integer(gkeyfile, "remmina_pref", "sftp_workers", remmina_pref.sftp_workers);
 	g_key_file_set_boolean(gkeyfile, "remmina_pref", "applet_new_ontop", remmina_pref.applet_new_ontop);
 	g_key_file_set_boolean(gkeyfile, "remmina_pref", "applet_hide_count", remmina_pref.applet_hide_count);
 	g_key_file_set_boolean(gkeyfile, "remmina_pref", "applet_enable_avahi", remmina_pref.applet_enable_avahi);
@@ -883,20 +1123,10 @@ gboolean remmina_pref_save(void)
 	g_key_file_set_string(gkeyfile, "remmina_news", "periodic_rmnews_uuid_prefix",
 			      remmina_pref.periodic_rmnews_uuid_prefix ? remmina_pref.periodic_rmnews_uuid_prefix : "");
 
-	/* Default settings */
-	g_key_file_set_string(gkeyfile, "remmina", "name", "");
-	g_key_file_set_integer(gkeyfile, "remmina", "ignore-tls-errors", 1);
+	remmina_pref_schedule_write();
+	g_mutex_unlock(&remmina_pref_mutex);
 
-	content = g_key_file_to_data(gkeyfile, &length, NULL);
-	g_file_set_contents(remmina_pref_file, content, length, &error);
-
-	if (error != NULL) {
-		g_warning("remmina_pref_save error: %s", error->message);
-		g_clear_error(&error);
-		g_key_file_free(gkeyfile);
-		return FALSE;
-	}
-	g_key_file_free(gkeyfile);
+	remmina_pref_notify(NULL);
 	return TRUE;
 }
 
@@ -904,22 +1134,16 @@ void remmina_pref_add_recent(const gchar *protocol, const gchar *server)
 {
 	TRACE_CALL(__func__);
 	RemminaStringArray *array;
-	GKeyFile *gkeyfile;
 	gchar key[20];
 	g_autofree gchar *val = NULL;
-	g_autofree gchar *content = NULL;
-	gsize length;
 
 	if (remmina_pref.recent_maximum <= 0 || server == NULL || server[0] == 0)
 		return;
 
-	/* Load original value into memory */
-	gkeyfile = g_key_file_new();
-
-	g_key_file_load_from_file(gkeyfile, remmina_pref_file, G_KEY_FILE_NONE, NULL);
+	g_mutex_lock(&remmina_pref_mutex);
 
 	g_snprintf(key, sizeof(key), "recent_%s", protocol);
-	array = remmina_string_array_new_from_allocated_string(g_key_file_get_string(gkeyfile, "remmina_pref", key, NULL));
+	array = remmina_string_array_new_from_allocated_string(g_key_file_get_string(remmina_pref_keyfile, "remmina_pref", key, NULL));
 
 	/* Add the new value */
 	remmina_string_array_remove(array, server);
@@ -929,58 +1153,43 @@ void remmina_pref_add_recent(const gchar *protocol, const gchar *server)
 
 	/* Save */
 	val = remmina_string_array_to_string(array);
-	g_key_file_set_string(gkeyfile, "remmina_pref", key, val);
+	remmina_string_array_free(array);
+	g_key_file_set_string(remmina_pref_keyfile, "remmina_pref", key, val);
 
-	content = g_key_file_to_data(gkeyfile, &length, NULL);
-	g_file_set_contents(remmina_pref_file, content, length, NULL);
+	remmina_pref_schedule_write();
+	g_mutex_unlock(&remmina_pref_mutex);
 
-	g_key_file_free(gkeyfile);
+	remmina_pref_notify(key);
 }
 
 gchar *
 remmina_pref_get_recent(const gchar *protocol)
 {
 	TRACE_CALL(__func__);
-	GKeyFile *gkeyfile;
 	gchar key[20];
-	gchar *val = NULL;
-
-	gkeyfile = g_key_file_new();
-
-	g_key_file_load_from_file(gkeyfile, remmina_pref_file, G_KEY_FILE_NONE, NULL);
 
 	g_snprintf(key, sizeof(key), "recent_%s", protocol);
-	val = g_key_file_get_string(gkeyfile, "remmina_pref", key, NULL);
-
-	g_key_file_free(gkeyfile);
-
-	return val;
+	return remmina_pref_get_value(key);
 }
 
 void remmina_pref_clear_recent(void)
 {
 	TRACE_CALL(__func__);
-	GKeyFile *gkeyfile;
 	gchar **keys;
 	gint i;
-	g_autofree gchar *content = NULL;
-	gsize length;
-
-	gkeyfile = g_key_file_new();
 
-	g_key_file_load_from_file(gkeyfile, remmina_pref_file, G_KEY_FILE_NONE, NULL);
-	keys = g_key_file_get_keys(gkeyfile, "remmina_pref", NULL, NULL);
+	g_mutex_lock(&remmina_pref_mutex);
+	keys = g_key_file_get_keys(remmina_pref_keyfile, "remmina_pref", NULL, NULL);
 	if (keys) {
 		for (i = 0; keys[i]; i++)
 			if (strncmp(keys[i], "recent_", 7) == 0)
-				g_key_file_set_string(gkeyfile, "remmina_pref", keys[i], "");
+				g_key_file_set_string(remmina_pref_keyfile, "remmina_pref", keys[i], "");
 		g_strfreev(keys);
 	}
+	remmina_pref_schedule_write();
+	g_mutex_unlock(&remmina_pref_mutex);
 
-	content = g_key_file_to_data(gkeyfile, &length, NULL);
-	g_file_set_contents(remmina_pref_file, content, length, NULL);
-
-	g_key_file_free(gkeyfile);
+	remmina_pref_notify(NULL);
 }
 
 guint remmina_pref_keymap_get_keyval(const gchar *keymap, guint keyval)
@@ -1079,30 +1288,34 @@ gint remmina_pref_get_ssh_tcp_usrtimeout(void)
 void remmina_pref_set_value(const gchar *key, const gchar *value)
 {
 	TRACE_CALL(__func__);
-	GKeyFile *gkeyfile;
-	gchar *content;
-	gsize length;
+	gchar *old;
+	gboolean changed;
 
-	gkeyfile = g_key_file_new();
-	g_key_file_load_from_file(gkeyfile, remmina_pref_file, G_KEY_FILE_NONE, NULL);
-	g_key_file_set_string(gkeyfile, "remmina_pref", key, value);
-	content = g_key_file_to_data(gkeyfile, &length, NULL);
-	g_file_set_contents(remmina_pref_file, content, length, NULL);
+	g_return_if_fail(remmina_pref_keyfile != NULL);
 
-	g_key_file_free(gkeyfile);
-	g_free(content);
+	g_mutex_lock(&remmina_pref_mutex);
+	old = g_key_file_get_string(remmina_pref_keyfile, "remmina_pref", key, NULL);
+	changed = g_strcmp0(old, value) != 0;
+	if (changed) {
+		g_key_file_set_string(remmina_pref_keyfile, "remmina_pref", key, value);
+		remmina_pref_schedule_write();
+	}
+	g_mutex_unlock(&remmina_pref_mutex);
+	g_free(old);
+
+	if (changed)
+		remmina_pref_notify(key);
 }
 
 gchar *remmina_pref_get_value(const gchar *key)
 {
 	TRACE_CALL(__func__);
-	GKeyFile *gkeyfile;
 	gchar *value = NULL;
 
-	gkeyfile = g_key_file_new();
-	g_key_file_load_from_file(gkeyfile, remmina_pref_file, G_KEY_FILE_NONE, NULL);
-	value = g_key_file_get_string(gkeyfile, "remmina_pref", key, NULL);
-	g_key_file_free(gkeyfile);
+	g_mutex_lock(&remmina_pref_mutex);
+	if (remmina_pref_keyfile)
+		value = g_key_file_get_string(remmina_pref_keyfile, "remmina_pref", key, NULL);
+	g_mutex_unlock(&remmina_pref_mutex);
 
 	return value;
 }
@@ -1110,13 +1323,30 @@ gchar *remmina_pref_get_value(const gchar *key)
 gboolean remmina_pref_get_boolean(const gchar *key)
 {
 	TRACE_CALL(__func__);
-	GKeyFile *gkeyfile;
-	gboolean value;
+	gboolean value = FALSE;
 
-	gkeyfile = g_key_file_new();
-	g_key_file_load_from_file(gkeyfile, remmina_pref_file, G_KEY_FILE_NONE, NULL);
-	value = g_key_file_get_boolean(gkeyfile, "remmina_pref", key, NULL);
-	g_key_file_free(gkeyfile);
+	g_mutex_lock(&remmina_pref_mutex);
+	if (remmina_pref_keyfile)
+		value = g_key_file_get_boolean(remmina_pref_keyfile, "remmina_pref", key, NULL);
+	g_mutex_unlock(&remmina_pref_mutex);
+
+	return value;
+}
+
+gint remmina_pref_get_int(const gchar *key, gint default_value)
+{
+	TRACE_CALL(__func__);
+	GError *error = NULL;
+	gint value = default_value;
+
+	g_mutex_lock(&remmina_pref_mutex);
+	if (remmina_pref_keyfile)
+		value = g_key_file_get_integer(remmina_pref_keyfile, "remmina_pref", key, &error);
+	g_mutex_unlock(&remmina_pref_mutex);
+	if (error) {
+		g_error_free(error);
+		return default_value;
+	}
 
 	return value;
 }
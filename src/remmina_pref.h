@@ -145,11 +145,16 @@ typedef struct _RemminaPref {
 	/* In RemminaPrefDialog SSH Option tab */
 	gint			ssh_loglevel;
 	gboolean		ssh_parseconfig;
+	gboolean		prewarm_connections;
 	gint			sshtunnel_port;
 	gint			ssh_tcp_keepidle;
 	gint			ssh_tcp_keepintvl;
 	gint			ssh_tcp_keepcnt;
 	gint			ssh_tcp_usrtimeout;
+	/* Only in the remmina.pref file */
+	gint			sftp_chunk_size;
+	gint			sftp_requests;
+	gint			sftp_workers;
 	/* In RemminaPrefDialog keyboard tab */
 	guint			hostkey;
 	guint			shortcutkey_fullscreen;
@@ -230,6 +235,12 @@ typedef struct _RemminaPref {
 #define SSH_SOCKET_TCP_KEEPINTVL 10
 #define SSH_SOCKET_TCP_KEEPCNT 3
 #define SSH_SOCKET_TCP_USER_TIMEOUT 60000 // 60 seconds
+#define DEFAULT_SFTP_CHUNK_SIZE 32768
+#define DEFAULT_SFTP_REQUESTS 16
+#define DEFAULT_SFTP_WORKERS 4
+
+/* Called in the main thread when key changes, or with NULL when many keys may have changed */
+typedef void (*RemminaPrefNotifyFunc)(const gchar *key, gpointer user_data);
 
 extern const gchar *default_resolutions;
 extern gchar *remmina_pref_file;
@@ -239,6 +250,11 @@ extern RemminaPref remmina_pref;
 void remmina_pref_init(void);
 gboolean remmina_pref_is_rw(void);
 gboolean remmina_pref_save(void);
+void remmina_pref_flush(void);
+void remmina_pref_file_lock(void);
+void remmina_pref_file_unlock(void);
+guint remmina_pref_notify_add(RemminaPrefNotifyFunc func, gpointer user_data);
+void remmina_pref_notify_remove(guint id);
 
 void remmina_pref_add_recent(const gchar *protocol, const gchar *server);
 gchar *remmina_pref_get_recent(const gchar *protocol);
@@ -260,5 +276,6 @@ gint remmina_pref_get_ssh_tcp_usrtimeout(void);
 void remmina_pref_set_value(const gchar *key, const gchar *value);
 gchar *remmina_pref_get_value(const gchar *key);
 gboolean remmina_pref_get_boolean(const gchar *key);
+gint remmina_pref_get_int(const gchar *key, gint default_value);
 
 G_END_DECLS
@@ -75,6 +75,7 @@ typedef struct _RemminaPrefDialog {
 	GtkComboBox *		comboboxtext_options_ssh_loglevel;
 	GtkComboBox *		comboboxtext_appearance_fullscreen_toolbar_visibility;
 	GtkCheckButton *	checkbutton_options_ssh_parseconfig;
+	GtkCheckButton *	checkbutton_options_prewarm_connections;
 	GtkEntry *		entry_options_ssh_port;
 	GtkEntry *		entry_options_ssh_tcp_keepidle;
 	GtkEntry *		entry_options_ssh_tcp_keepintvl;
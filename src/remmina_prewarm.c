@@ -0,0 +1,282 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+/* Speculative connection pre-warming, enabled by the prewarm_connections
+ * preference. When a profile stays selected or hovered in the main window
+ * for REMMINA_PREWARM_DELAY, the slow steps that do not need the user are
+ * started before the click:
+ *  - the server name is resolved, which fills the resolver caches;
+ *  - with an SSH tunnel, the SSH session is connected and the key
+ *    exchange completed in a thread. The protocol widget adopts it in
+ *    remmina_protocol_widget_init_tunnel() and only has to check the host
+ *    key and authenticate.
+ * The TCP connection to the protocol port itself is not opened in advance:
+ * the protocol libraries open their own sockets and cannot adopt one.
+ * Whatever is not used within REMMINA_PREWARM_TIMEOUT is torn down. */
+
+#include "config.h"
+#include <gio/gio.h>
+#include <string.h>
+#include "remmina_log.h"
+#include "remmina_pref.h"
+#include "remmina_prewarm.h"
+#include "remmina_public.h"
+#include "remmina/remmina_trace_calls.h"
+
+typedef struct _RemminaPrewarm {
+	gchar *			filename;
+	RemminaFile *		remminafile;
+	GCancellable *		cancellable;
+#ifdef HAVE_LIBSSH
+	/* Connected, not yet authenticated, set by the thread when done */
+	RemminaSSHTunnel *	tunnel;
+	gboolean		running;
+	/* Torn down while the thread was running, the thread frees it */
+	gboolean		discarded;
+#endif
+} RemminaPrewarm;
+
+G_LOCK_DEFINE_STATIC(remmina_prewarm);
+static RemminaPrewarm *remmina_prewarm_current = NULL;
+static gchar *remmina_prewarm_pending = NULL;
+static guint remmina_prewarm_delay_source = 0;
+static guint remmina_prewarm_expire_source = 0;
+
+/* Must be called with the lock held */
+static void remmina_prewarm_free(RemminaPrewarm *prewarm)
+{
+	TRACE_CALL(__func__);
+
+#ifdef HAVE_LIBSSH
+	if (prewarm->running) {
+		prewarm->discarded = TRUE;
+		return;
+	}
+	if (prewarm->tunnel)
+		remmina_ssh_tunnel_free(prewarm->tunnel);
+#endif
+	g_cancellable_cancel(prewarm->cancellable);
+	g_object_unref(prewarm->cancellable);
+	remmina_file_free(prewarm->remminafile);
+	g_free(prewarm->filename);
+	g_free(prewarm);
+}
+
+static void remmina_prewarm_discard(void)
+{
+	TRACE_CALL(__func__);
+
+	if (remmina_prewarm_expire_source) {
+		g_source_remove(remmina_prewarm_expire_source);
+		remmina_prewarm_expire_source = 0;
+	}
+	G_LOCK(remmina_prewarm);
+	if (remmina_prewarm_current) {
+		REMMINA_DEBUG("Tearing down the warm connection to %s", remmina_prewarm_current->filename);
+		remmina_prewarm_free(remmina_prewarm_current);
+		remmina_prewarm_current = NULL;
+	}
+	G_UNLOCK(remmina_prewarm);
+}
+
+static gboolean remmina_prewarm_expire(gpointer user_data)
+{
+	TRACE_CALL(__func__);
+
+	remmina_prewarm_expire_source = 0;
+	remmina_prewarm_discard();
+	return G_SOURCE_REMOVE;
+}
+
+static void remmina_prewarm_resolved(GObject *source, GAsyncResult *result, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	GList *addresses;
+
+	/* Only the resolver caches are of interest */
+	addresses = g_resolver_lookup_by_name_finish(G_RESOLVER(source), result, NULL);
+	if (addresses)
+		g_resolver_free_addresses(addresses);
+}
+
+#ifdef HAVE_LIBSSH
+static gpointer remmina_prewarm_tunnel_thread(gpointer data)
+{
+	TRACE_CALL(__func__);
+	RemminaPrewarm *prewarm = (RemminaPrewarm *)data;
+	RemminaSSHTunnel *tunnel;
+
+	tunnel = remmina_ssh_tunnel_new_from_file(prewarm->remminafile);
+	if (!remmina_ssh_init_session(REMMINA_SSH(tunnel))) {
+		REMMINA_DEBUG("Could not warm up the SSH tunnel: %s", REMMINA_SSH(tunnel)->error);
+		remmina_ssh_tunnel_free(tunnel);
+		tunnel = NULL;
+	}
+
+	G_LOCK(remmina_prewarm);
+	prewarm->running = FALSE;
+	prewarm->tunnel = tunnel;
+	if (prewarm->discarded)
+		remmina_prewarm_free(prewarm);
+	else if (tunnel)
+		REMMINA_DEBUG("SSH tunnel of %s is warm", prewarm->filename);
+	G_UNLOCK(remmina_prewarm);
+
+	return NULL;
+}
+#endif
+
+static gboolean remmina_prewarm_start(gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaPrewarm *prewarm;
+	RemminaFile *remminafile;
+	GResolver *resolver;
+	const gchar *server;
+	gchar *host;
+	gint port;
+
+	remmina_prewarm_delay_source = 0;
+	remminafile = remmina_file_load(remmina_prewarm_pending);
+	if (!remminafile)
+		return G_SOURCE_REMOVE;
+
+	remmina_prewarm_discard();
+
+	prewarm = g_new0(RemminaPrewarm, 1);
+	prewarm->filename = g_strdup(remmina_prewarm_pending);
+	prewarm->remminafile = remminafile;
+	prewarm->cancellable = g_cancellable_new();
+	REMMINA_DEBUG("Warming up the connection to %s", prewarm->filename);
+
+	server = remmina_file_get_string(remminafile, "server");
+#ifdef HAVE_LIBSSH
+	if (remmina_file_get_int(remminafile, "ssh_tunnel_enabled", FALSE)) {
+		/* The SSH session resolves the names it needs */
+		prewarm->running = TRUE;
+		g_thread_unref(g_thread_new("remmina-prewarm", remmina_prewarm_tunnel_thread, prewarm));
+		server = NULL;
+	}
+#endif
+	if (server && server[0] != '\0' && !strstr(server, "unix:///")) {
+		remmina_public_get_server_port(server, 0, &host, &port);
+		if (host && host[0] != '\0' && !g_hostname_is_ip_address(host)) {
+			/* The pending lookup holds its own reference */
+			resolver = g_resolver_get_default();
+			g_resolver_lookup_by_name_async(resolver, host, prewarm->cancellable,
+							remmina_prewarm_resolved, NULL);
+			g_object_unref(resolver);
+		}
+		g_free(host);
+	}
+
+	G_LOCK(remmina_prewarm);
+	remmina_prewarm_current = prewarm;
+	G_UNLOCK(remmina_prewarm);
+	remmina_prewarm_expire_source = g_timeout_add_seconds(REMMINA_PREWARM_TIMEOUT, remmina_prewarm_expire, NULL);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Called from the main window each time a profile is selected or hovered,
+ * warms it up once it stays there for REMMINA_PREWARM_DELAY */
+void remmina_prewarm_schedule(const gchar *filename)
+{
+	TRACE_CALL(__func__);
+	gboolean warm;
+
+	if (!remmina_pref.prewarm_connections || !filename)
+		return;
+
+	G_LOCK(remmina_prewarm);
+	warm = remmina_prewarm_current && g_strcmp0(remmina_prewarm_current->filename, filename) == 0;
+	G_UNLOCK(remmina_prewarm);
+	if (warm || (remmina_prewarm_delay_source && g_strcmp0(remmina_prewarm_pending, filename) == 0))
+		return;
+
+	if (remmina_prewarm_delay_source)
+		g_source_remove(remmina_prewarm_delay_source);
+	g_free(remmina_prewarm_pending);
+	remmina_prewarm_pending = g_strdup(filename);
+	remmina_prewarm_delay_source = g_timeout_add(REMMINA_PREWARM_DELAY, remmina_prewarm_start, NULL);
+}
+
+void remmina_prewarm_cancel(void)
+{
+	TRACE_CALL(__func__);
+
+	if (remmina_prewarm_delay_source) {
+		g_source_remove(remmina_prewarm_delay_source);
+		remmina_prewarm_delay_source = 0;
+	}
+	remmina_prewarm_discard();
+}
+
+#ifdef HAVE_LIBSSH
+/* Hands the warm SSH session over to a connection to the same profile.
+ * Returns NULL when there is none, or when any setting read by
+ * remmina_ssh_init_from_file() for a tunnel changed since it was warmed
+ * up. May be called from any thread. */
+RemminaSSHTunnel *remmina_prewarm_take_tunnel(RemminaFile *remminafile)
+{
+	TRACE_CALL(__func__);
+	RemminaPrewarm *prewarm;
+	RemminaSSHTunnel *tunnel = NULL;
+	static const gchar *keys[] = {
+		"server", "ssh_tunnel_server", "ssh_tunnel_username", "ssh_tunnel_privatekey",
+		"ssh_tunnel_certfile", "ssh_tunnel_auth", "ssh_charset", "ssh_tunnel_kex_algorithms",
+		"ssh_tunnel_ciphers", "ssh_tunnel_hostkeytypes", "ssh_tunnel_proxycommand",
+		"ssh_tunnel_stricthostkeycheck", "ssh_tunnel_compression", NULL
+	};
+	gint i;
+
+	G_LOCK(remmina_prewarm);
+	prewarm = remmina_prewarm_current;
+	if (prewarm && prewarm->tunnel && g_strcmp0(prewarm->filename, remmina_file_get_filename(remminafile)) == 0) {
+		for (i = 0; keys[i]; i++)
+			if (g_strcmp0(remmina_file_get_string(prewarm->remminafile, keys[i]),
+				      remmina_file_get_string(remminafile, keys[i])) != 0)
+				break;
+		if (!keys[i]) {
+			tunnel = prewarm->tunnel;
+			prewarm->tunnel = NULL;
+		}
+	}
+	G_UNLOCK(remmina_prewarm);
+
+	if (tunnel)
+		REMMINA_DEBUG("Using the warm SSH session to %s", REMMINA_SSH(tunnel)->server);
+	return tunnel;
+}
+#endif
@@ -49,8 +49,10 @@
 #include "remmina_ext_exec.h"
 #include "remmina_plugin_manager.h"
 #include "remmina_pref.h"
+#include "remmina_prewarm.h"
 #include "remmina_protocol_widget.h"
 #include "remmina_public.h"
+#include "remmina_reconnect.h"
 #include "remmina_ssh.h"
 #include "remmina_log.h"
 #include "remmina/remmina_trace_calls.h"
@@ -68,6 +70,12 @@ struct _RemminaProtocolWidgetPriv {
 	gint			height;
 	RemminaScaleMode	scalemode;
 	gboolean		scaler_expand;
+	/* The session is not on screen: background tab, iconified or unmapped window */
+	gboolean		hidden;
+	/* Set to stop a plugin waiting for its next reconnection attempt */
+	gint			reconnect_interrupted;
+	/* Monotonic time the connection was requested, to log how long it took */
+	gint64			open_time;
 
 	gboolean		has_error;
 	gchar *			error_message;
@@ -117,6 +125,7 @@ enum {
 	UPDATE_ALIGN_SIGNAL,
 	LOCK_DYNRES_SIGNAL,
 	UNLOCK_DYNRES_SIGNAL,
+	VISIBILITY_CHANGED_SIGNAL,
 	LAST_SIGNAL
 };
 
@@ -149,6 +158,9 @@ static void remmina_protocol_widget_class_init(RemminaProtocolWidgetClass *klass
 	remmina_protocol_widget_signals[UNLOCK_DYNRES_SIGNAL] = g_signal_new("unlock-dynres", G_TYPE_FROM_CLASS(klass),
 									     G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION, G_STRUCT_OFFSET(RemminaProtocolWidgetClass, unlock_dynres), NULL, NULL,
 									     g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+	remmina_protocol_widget_signals[VISIBILITY_CHANGED_SIGNAL] = g_signal_new("visibility-changed", G_TYPE_FROM_CLASS(klass),
+										  G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET(RemminaProtocolWidgetClass, visibility_changed), NULL, NULL,
+										  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 }
 
 
@@ -237,6 +249,8 @@ static void remmina_protocol_widget_init(RemminaProtocolWidget *gp)
 	gp->priv->closed = TRUE;
 	gp->priv->ssh_tunnels = g_ptr_array_new();
 
+	remmina_reconnect_init();
+
 	g_signal_connect(G_OBJECT(gp), "destroy", G_CALLBACK(remmina_protocol_widget_destroy), NULL);
 }
 
@@ -253,6 +267,7 @@ void remmina_protocol_widget_open_connection_real(gpointer data)
 	gint num_ssh;
 
 	gp->priv->closed = FALSE;
+	gp->priv->open_time = g_get_monotonic_time();
 
 	plugin = gp->priv->plugin;
 	plugin->init(gp);
@@ -390,6 +405,8 @@ void remmina_protocol_widget_signal_connection_opened(RemminaProtocolWidget *gp)
 	/* Plugin told us that it closed the connection,
 	 * add async event to main thread to complete our close tasks */
 	TRACE_CALL(__func__);
+	REMMINA_DEBUG("Connection opened in %" G_GINT64_FORMAT " ms",
+		      (g_get_monotonic_time() - gp->priv->open_time) / G_TIME_SPAN_MILLISECOND);
 	g_idle_add(conn_opened, (gpointer)gp);
 }
 
@@ -716,7 +733,7 @@ gboolean remmina_protocol_widget_map_event(RemminaProtocolWidget *gp)
 gboolean remmina_protocol_widget_unmap_event(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
-	if (!gp->priv->plugin->get_plugin_screenshot) {
+	if (!gp->priv->plugin->unmap_event) {
 		REMMINA_DEBUG("Unmap plugin function not implemented");
 		return FALSE;
 	}
@@ -903,8 +920,13 @@ static RemminaSSHTunnel* remmina_protocol_widget_init_tunnel(RemminaProtocolWidg
 	RemminaMessagePanel *mp;
 	gboolean partial = FALSE;
 	gboolean cont = FALSE;
+	gboolean warm;
 
-	tunnel = remmina_ssh_tunnel_new_from_file(gp->priv->remmina_file);
+	/* The main window may have connected the SSH session already */
+	tunnel = remmina_prewarm_take_tunnel(gp->priv->remmina_file);
+	warm = tunnel != NULL;
+	if (!tunnel)
+		tunnel = remmina_ssh_tunnel_new_from_file(gp->priv->remmina_file);
 
 	REMMINA_DEBUG ("Creating SSH tunnel to “%s” via SSH…", REMMINA_SSH(tunnel)->server);
 	// TRANSLATORS: “%s” is a placeholder for an hostname or an IP address.
@@ -916,7 +938,7 @@ static RemminaSSHTunnel* remmina_protocol_widget_init_tunnel(RemminaProtocolWidg
 
 
 	while (1) {
-		if (!partial) {
+		if (!partial && !warm) {
 			if (!remmina_ssh_init_session(REMMINA_SSH(tunnel))) {
 				REMMINA_DEBUG("SSH Tunnel init session error: %s", REMMINA_SSH(tunnel)->error);
 				remmina_protocol_widget_set_error(gp, REMMINA_SSH(tunnel)->error);
@@ -924,6 +946,7 @@ static RemminaSSHTunnel* remmina_protocol_widget_init_tunnel(RemminaProtocolWidg
 				break;
 			}
 		}
+		warm = FALSE;
 
 		ret = remmina_ssh_auth_gui(REMMINA_SSH(tunnel), gp, gp->priv->remmina_file);
 		REMMINA_DEBUG ("Tunnel auth returned %d", ret);
@@ -1036,8 +1059,38 @@ static gboolean remmina_protocol_widget_tunnel_destroy(RemminaSSHTunnel *tunnel,
 	return TRUE;
 }
 
+#ifdef HAVE_LIBSSH
+/* Look for the direct tunnel of a previous connection to host:port.
+ * A working one is returned so that a reconnection does not authenticate
+ * to the SSH server again. Dead ones only give the local port back: their
+ * thread may still be on its way out, remmina_protocol_widget_tunnel_destroy()
+ * frees them on the main thread. */
+static RemminaSSHTunnel *remmina_protocol_widget_get_direct_tunnel(RemminaProtocolWidget *gp, const gchar *host, gint port)
+{
+	TRACE_CALL(__func__);
+	RemminaSSHTunnel *tunnel;
+	guint i;
+
+	for (i = 0; i < gp->priv->ssh_tunnels->len; i++) {
+		tunnel = (RemminaSSHTunnel *)gp->priv->ssh_tunnels->pdata[i];
+		if (tunnel->tunnel_type != REMMINA_SSH_TUNNEL_OPEN || tunnel->port != port || g_strcmp0(tunnel->dest, host) != 0)
+			continue;
+		if (remmina_ssh_tunnel_terminated(tunnel))
+			/* The tunnel thread already asked to destroy it */
+			continue;
+		if (tunnel->running && tunnel->server_sock >= 0 && ssh_is_connected(REMMINA_SSH(tunnel)->session))
+			return tunnel;
+
+		REMMINA_DEBUG("SSH tunnel to %s:%d is dead, releasing its local port", host, port);
+		remmina_ssh_tunnel_cancel_accept(tunnel);
+	}
+	return NULL;
+}
+#endif
+
 /**
  * Start an SSH tunnel if possible and return the host:port string.
+ * A tunnel still working from a previous connection is reused.
  *
  */
 gchar *remmina_protocol_widget_start_direct_tunnel(RemminaProtocolWidget *gp, gint default_port, gboolean port_plus)
@@ -1083,6 +1136,21 @@ gchar *remmina_protocol_widget_start_direct_tunnel(RemminaProtocolWidget *gp, gi
 		return dest;
 	}
 
+	if (remmina_file_get_int(gp->priv->remmina_file, "ssh_tunnel_loopback", FALSE)) {
+		g_free(srv_host);
+		g_free(ssh_tunnel_host);
+		ssh_tunnel_host = NULL;
+		srv_host = g_strdup("127.0.0.1");
+	}
+
+	tunnel = remmina_protocol_widget_get_direct_tunnel(gp, srv_host, srv_port);
+	if (tunnel) {
+		REMMINA_DEBUG ("Reusing the SSH tunnel to %s:%d", srv_host, srv_port);
+		g_free(srv_host);
+		g_free(ssh_tunnel_host);
+		return g_strdup_printf("127.0.0.1:%i", tunnel->localport);
+	}
+
 	tunnel = remmina_protocol_widget_init_tunnel(gp);
 	if (!tunnel) {
 		g_free(srv_host);
@@ -1097,13 +1165,6 @@ gchar *remmina_protocol_widget_start_direct_tunnel(RemminaProtocolWidget *gp, gi
 	mp = remmina_protocol_widget_mpprogress(gp->cnnobj, msg, cancel_start_direct_tunnel_cb, NULL);
 	g_free(msg);
 
-	if (remmina_file_get_int(gp->priv->remmina_file, "ssh_tunnel_loopback", FALSE)) {
-		g_free(srv_host);
-		g_free(ssh_tunnel_host);
-		ssh_tunnel_host = NULL;
-		srv_host = g_strdup("127.0.0.1");
-	}
-
 	REMMINA_DEBUG ("Starting tunnel to: %s, port: %d", ssh_tunnel_host, ssh_tunnel_port);
 	if (!remmina_ssh_tunnel_open(tunnel, srv_host, srv_port, remmina_pref.sshtunnel_port)) {
 		g_free(srv_host);
@@ -1398,6 +1459,43 @@ void remmina_protocol_widget_set_current_scale_mode(RemminaProtocolWidget *gp, R
 	gp->priv->scalemode = scalemode;
 }
 
+/* Plugins connect to "visibility-changed" to stop updating hidden sessions */
+void remmina_protocol_widget_set_visibility(RemminaProtocolWidget *gp, gboolean visible)
+{
+	TRACE_CALL(__func__);
+	if (gp->priv->hidden == !visible)
+		return;
+
+	gp->priv->hidden = !visible;
+	REMMINA_DEBUG("Session %s is now %s", remmina_file_get_string(gp->priv->remmina_file, "name"),
+		      visible ? "visible" : "hidden");
+	g_signal_emit(G_OBJECT(gp), remmina_protocol_widget_signals[VISIBILITY_CHANGED_SIGNAL], 0);
+}
+
+gboolean remmina_protocol_widget_get_visibility(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	return !gp->priv->hidden;
+}
+
+/* Called by plugins from their connection thread between two reconnection
+ * attempts, attempt is 0 before the first one. Returns FALSE when
+ * remmina_protocol_widget_reconnect_interrupt() was called, the plugin
+ * must then give up reconnecting. */
+gboolean remmina_protocol_widget_reconnect_wait(RemminaProtocolWidget *gp, guint attempt)
+{
+	TRACE_CALL(__func__);
+	if (attempt == 0)
+		g_atomic_int_set(&gp->priv->reconnect_interrupted, FALSE);
+	return remmina_reconnect_wait(attempt, &gp->priv->reconnect_interrupted);
+}
+
+void remmina_protocol_widget_reconnect_interrupt(RemminaProtocolWidget *gp)
+{
+	TRACE_CALL(__func__);
+	remmina_reconnect_interrupt(&gp->priv->reconnect_interrupted);
+}
+
 gboolean remmina_protocol_widget_get_expand(RemminaProtocolWidget *gp)
 {
 	TRACE_CALL(__func__);
@@ -71,6 +71,7 @@ struct _RemminaProtocolWidgetClass {
 	void			(*update_align)(RemminaProtocolWidget *gp);
 	void			(*lock_dynres)(RemminaProtocolWidget *gp);
 	void			(*unlock_dynres)(RemminaProtocolWidget *gp);
+	void			(*visibility_changed)(RemminaProtocolWidget *gp);
 };
 
 GType remmina_protocol_widget_get_type(void)
@@ -175,6 +176,11 @@ gboolean remmina_protocol_widget_plugin_screenshot(RemminaProtocolWidget *gp, Re
 /* Deal with the remimna connection window map/unmap events */
 gboolean remmina_protocol_widget_map_event(RemminaProtocolWidget *gp);
 gboolean remmina_protocol_widget_unmap_event(RemminaProtocolWidget *gp);
+/* Whether the session is on screen, emits "visibility-changed" */
+void remmina_protocol_widget_set_visibility(RemminaProtocolWidget *gp, gboolean visible);
+gboolean remmina_protocol_widget_get_visibility(RemminaProtocolWidget *gp);
+gboolean remmina_protocol_widget_reconnect_wait(RemminaProtocolWidget *gp, guint attempt);
+void remmina_protocol_widget_reconnect_interrupt(RemminaProtocolWidget *gp);
 
 void remmina_protocol_widget_update_remote_resolution(RemminaProtocolWidget *gp);
 
@@ -0,0 +1,152 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+/* Reconnection scheduler shared by the protocol plugins.
+ * Attempts are spaced with a jittered exponential backoff, so a short
+ * network glitch is recovered quickly while a server outage is not
+ * hammered by every open session at the same time. When GNetworkMonitor
+ * reports that the network became reachable again, the pending waits
+ * retry soon, each after its own short random delay. */
+
+#include "config.h"
+#include <gio/gio.h>
+#include "remmina_log.h"
+#include "remmina_reconnect.h"
+#include "remmina/remmina_trace_calls.h"
+
+static GMutex reconnect_mutex;
+static GCond reconnect_cond;
+static guint reconnect_network_serial;
+static gboolean reconnect_network_available = TRUE;
+static GNetworkConnectivity reconnect_network_connectivity = G_NETWORK_CONNECTIVITY_FULL;
+
+/* Wakes up the pending waits when the network becomes reachable or its
+ * connectivity changes. Route and address churn that leaves both as they
+ * were, like a VPN or a container bridge coming up, is ignored */
+void remmina_reconnect_network_update(gboolean available, GNetworkConnectivity connectivity)
+{
+	TRACE_CALL(__func__);
+	gboolean wake;
+
+	g_mutex_lock(&reconnect_mutex);
+	wake = available && (!reconnect_network_available || connectivity != reconnect_network_connectivity);
+	reconnect_network_available = available;
+	reconnect_network_connectivity = connectivity;
+	if (wake) {
+		reconnect_network_serial++;
+		g_cond_broadcast(&reconnect_cond);
+	}
+	g_mutex_unlock(&reconnect_mutex);
+
+	if (wake)
+		REMMINA_DEBUG("Network connectivity changed, waking up pending reconnections");
+}
+
+static void remmina_reconnect_network_changed(GNetworkMonitor *monitor, gboolean available, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+
+	remmina_reconnect_network_update(available, g_network_monitor_get_connectivity(monitor));
+}
+
+/* Must be called from the main thread, which receives the monitor signals */
+void remmina_reconnect_init(void)
+{
+	TRACE_CALL(__func__);
+	static gsize initialized = 0;
+	GNetworkMonitor *monitor;
+
+	if (g_once_init_enter(&initialized)) {
+		monitor = g_network_monitor_get_default();
+		remmina_reconnect_network_update(g_network_monitor_get_network_available(monitor),
+						 g_network_monitor_get_connectivity(monitor));
+		g_signal_connect(monitor, "network-changed",
+				 G_CALLBACK(remmina_reconnect_network_changed), NULL);
+		g_once_init_leave(&initialized, 1);
+	}
+}
+
+/* Delay in milliseconds before the given attempt, the first one is 0.
+ * The delay doubles at each attempt and is randomized in its upper half */
+guint remmina_reconnect_delay(guint attempt)
+{
+	TRACE_CALL(__func__);
+	guint delay;
+
+	delay = REMMINA_RECONNECT_DELAY_MIN << MIN(attempt, 16);
+	delay = MIN(delay, REMMINA_RECONNECT_DELAY_MAX);
+
+	return delay / 2 + g_random_int_range(0, delay / 2 + 1);
+}
+
+/* Blocks the calling thread until the next attempt is due, or shortly
+ * after the network comes back. Returns FALSE if remmina_reconnect_interrupt()
+ * was called on interrupt, which also makes any later wait return at once. */
+gboolean remmina_reconnect_wait(guint attempt, gint *interrupt)
+{
+	TRACE_CALL(__func__);
+	gint64 end_time;
+	guint serial;
+	gboolean ret;
+
+	end_time = g_get_monotonic_time() + (gint64)remmina_reconnect_delay(attempt) * G_TIME_SPAN_MILLISECOND;
+
+	g_mutex_lock(&reconnect_mutex);
+	serial = reconnect_network_serial;
+	while (!g_atomic_int_get(interrupt)) {
+		if (serial != reconnect_network_serial) {
+			/* Every session was woken up by the same change: spread
+			 * their attempts instead of retrying all at once */
+			serial = reconnect_network_serial;
+			end_time = MIN(end_time, g_get_monotonic_time() +
+				       (gint64)g_random_int_range(0, REMMINA_RECONNECT_NETWORK_JITTER + 1) * G_TIME_SPAN_MILLISECOND);
+		}
+		if (!g_cond_wait_until(&reconnect_cond, &reconnect_mutex, end_time))
+			break;
+	}
+	ret = !g_atomic_int_get(interrupt);
+	g_mutex_unlock(&reconnect_mutex);
+
+	return ret;
+}
+
+void remmina_reconnect_interrupt(gint *interrupt)
+{
+	TRACE_CALL(__func__);
+
+	g_mutex_lock(&reconnect_mutex);
+	g_atomic_int_set(interrupt, TRUE);
+	g_cond_broadcast(&reconnect_cond);
+	g_mutex_unlock(&reconnect_mutex);
+}
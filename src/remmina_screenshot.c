@@ -0,0 +1,385 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2009-2010 Vic Lee
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+/* Screenshots of the connections.
+ *
+ * The framebuffer is copied in the main thread, under the plugin's own lock
+ * when the plugin gives it, and everything else (pixel conversion, encoding
+ * and writing the file) runs in a GTask worker. The result goes back to the
+ * main loop through the GTask callback. */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "remmina_protocol_widget.h"
+#include "remmina_pref.h"
+#include "remmina_screenshot.h"
+#include "remmina_log.h"
+#include "remmina/remmina_trace_calls.h"
+
+/* zlib level of PNG screenshots when not set in remmina.pref: larger files,
+ * but several times faster than the default level */
+#define REMMINA_SCREENSHOT_PNG_COMPRESSION 1
+
+typedef struct _RemminaScreenshot {
+	RemminaProtocolWidget *		gp;
+	gchar *				filename;
+	RemminaScreenshotFormat		format;
+	gint				compression;
+	gboolean			with_pixbuf;
+	/* Either the framebuffer copy given by the plugin or the window grab */
+	RemminaPluginScreenshotData	rpsd;
+	GdkPixbuf *			pixbuf;
+	RemminaScreenshotFunc		callback;
+	gpointer			user_data;
+} RemminaScreenshot;
+
+static void remmina_screenshot_free(RemminaScreenshot *shot)
+{
+	TRACE_CALL(__func__);
+	g_object_unref(shot->gp);
+	g_free(shot->filename);
+	/* Allocated by the plugin */
+	free(shot->rpsd.buffer);
+	if (shot->pixbuf)
+		g_object_unref(shot->pixbuf);
+	g_free(shot);
+}
+
+RemminaScreenshotFormat remmina_screenshot_get_format(void)
+{
+	TRACE_CALL(__func__);
+	RemminaScreenshotFormat format;
+	gchar *value;
+
+	value = remmina_pref_get_value("screenshot_format");
+	if (g_strcmp0(value, "webp") == 0)
+		format = REMMINA_SCREENSHOT_FORMAT_WEBP;
+	else if (g_strcmp0(value, "qoi") == 0)
+		format = REMMINA_SCREENSHOT_FORMAT_QOI;
+	else
+		format = REMMINA_SCREENSHOT_FORMAT_PNG;
+	g_free(value);
+
+	return format;
+}
+
+const gchar *remmina_screenshot_format_get_extension(RemminaScreenshotFormat format)
+{
+	switch (format) {
+	case REMMINA_SCREENSHOT_FORMAT_WEBP:
+		return "webp";
+	case REMMINA_SCREENSHOT_FORMAT_QOI:
+		return "qoi";
+	default:
+		return "png";
+	}
+}
+
+/* WebP is written by an optional gdk-pixbuf loader */
+static gboolean remmina_screenshot_webp_available(void)
+{
+	TRACE_CALL(__func__);
+	static gsize available = 0;
+	GSList *formats, *l;
+	gsize found = 1;
+
+	if (g_once_init_enter(&available)) {
+		formats = gdk_pixbuf_get_formats();
+		for (l = formats; l; l = l->next) {
+			gchar *name = gdk_pixbuf_format_get_name(l->data);
+			if (g_strcmp0(name, "webp") == 0 && gdk_pixbuf_format_is_writable(l->data))
+				found = 2;
+			g_free(name);
+		}
+		g_slist_free(formats);
+		g_once_init_leave(&available, found);
+	}
+
+	return available == 2;
+}
+
+/* Convert the framebuffer given by the plugin to a RGB pixbuf. 32 bpp
+ * pixels are native endian xRGB words, as cairo expects them. */
+static GdkPixbuf *remmina_screenshot_pixbuf_from_plugin(const RemminaPluginScreenshotData *rpsd)
+{
+	TRACE_CALL(__func__);
+	GdkPixbuf *pixbuf;
+	const guchar *src;
+	guchar *pixels, *dst;
+	gint x, y, rowstride;
+	guint32 p32;
+	guint16 p16;
+
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rpsd->width, rpsd->height);
+	if (!pixbuf)
+		return NULL;
+	pixels = gdk_pixbuf_get_pixels(pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+
+	for (y = 0; y < rpsd->height; y++) {
+		src = rpsd->buffer + (gsize)y * rpsd->width * rpsd->bytesPerPixel;
+		dst = pixels + (gsize)y * rowstride;
+		switch (rpsd->bytesPerPixel) {
+		case 4:
+			for (x = 0; x < rpsd->width; x++, src += 4, dst += 3) {
+				memcpy(&p32, src, sizeof(p32));
+				dst[0] = p32 >> 16;
+				dst[1] = p32 >> 8;
+				dst[2] = p32;
+			}
+			break;
+		case 3:
+			for (x = 0; x < rpsd->width; x++, src += 3, dst += 3) {
+				dst[0] = src[2];
+				dst[1] = src[1];
+				dst[2] = src[0];
+			}
+			break;
+		default:
+			for (x = 0; x < rpsd->width; x++, src += 2, dst += 3) {
+				memcpy(&p16, src, sizeof(p16));
+				dst[0] = ((p16 >> 8) & 0xf8) | (p16 >> 13);
+				dst[1] = ((p16 >> 3) & 0xfc) | ((p16 >> 9) & 0x03);
+				dst[2] = ((p16 << 3) & 0xf8) | ((p16 >> 2) & 0x07);
+			}
+			break;
+		}
+	}
+
+	return pixbuf;
+}
+
+static inline guchar *remmina_screenshot_qoi_put32(guchar *o, guint32 v)
+{
+	*o++ = v >> 24;
+	*o++ = v >> 16;
+	*o++ = v >> 8;
+	*o++ = v;
+	return o;
+}
+
+/* Encode an opaque RGB pixbuf as QOI ("Quite OK Image", qoiformat.org),
+ * which is lossless and an order of magnitude faster to write than PNG */
+static gboolean remmina_screenshot_save_qoi(GdkPixbuf *pixbuf, const gchar *filename, GError **error)
+{
+	TRACE_CALL(__func__);
+	static const guchar padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	guint32 index[64] = { 0 };
+	guint32 px, prev;
+	const guchar *pixels, *src;
+	guchar *out, *o;
+	gint width, height, rowstride, n_channels, x, y, run, h;
+	gint vr, vg, vb, vg_r, vg_b;
+	gboolean ret;
+
+	width = gdk_pixbuf_get_width(pixbuf);
+	height = gdk_pixbuf_get_height(pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+	n_channels = gdk_pixbuf_get_n_channels(pixbuf);
+	pixels = gdk_pixbuf_read_pixels(pixbuf);
+
+	/* Worst case is 4 bytes per pixel, plus header and end marker */
+	out = g_malloc(14 + (gsize)width * height * 4 + sizeof(padding));
+	o = out;
+	memcpy(o, "qoif", 4);
+	o = remmina_screenshot_qoi_put32(o + 4, width);
+	o = remmina_screenshot_qoi_put32(o, height);
+	*o++ = 3;       /* RGB */
+	*o++ = 0;       /* sRGB */
+
+	prev = 0x000000ff;
+	run = 0;
+	for (y = 0; y < height; y++) {
+		src = pixels + (gsize)y * rowstride;
+		for (x = 0; x < width; x++, src += n_channels) {
+			px = ((guint32)src[0] << 24) | ((guint32)src[1] << 16) | ((guint32)src[2] << 8) | 0xff;
+			if (px == prev) {
+				if (++run == 62) {
+					*o++ = 0xc0 | (run - 1);
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0) {
+				*o++ = 0xc0 | (run - 1);
+				run = 0;
+			}
+
+			h = (src[0] * 3 + src[1] * 5 + src[2] * 7 + 255 * 11) % 64;
+			if (index[h] == px) {
+				*o++ = h;
+			} else {
+				index[h] = px;
+				vr = (gint8)(src[0] - (prev >> 24));
+				vg = (gint8)(src[1] - (prev >> 16));
+				vb = (gint8)(src[2] - (prev >> 8));
+				vg_r = vr - vg;
+				vg_b = vb - vg;
+				if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+					*o++ = 0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+				} else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+					*o++ = 0x80 | (vg + 32);
+					*o++ = (vg_r + 8) << 4 | (vg_b + 8);
+				} else {
+					*o++ = 0xfe;
+					*o++ = src[0];
+					*o++ = src[1];
+					*o++ = src[2];
+				}
+			}
+			prev = px;
+		}
+	}
+	if (run > 0)
+		*o++ = 0xc0 | (run - 1);
+	memcpy(o, padding, sizeof(padding));
+	o += sizeof(padding);
+
+	ret = g_file_set_contents(filename, (const gchar *)out, o - out, error);
+	g_free(out);
+
+	return ret;
+}
+
+static void remmina_screenshot_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	TRACE_CALL(__func__);
+	RemminaScreenshot *shot = task_data;
+	GError *error = NULL;
+	gchar *level;
+	gboolean ret;
+
+	if (!shot->pixbuf) {
+		shot->pixbuf = remmina_screenshot_pixbuf_from_plugin(&shot->rpsd);
+		free(shot->rpsd.buffer);
+		shot->rpsd.buffer = NULL;
+		if (!shot->pixbuf) {
+			g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, "%s",
+						// TRANSLATORS: Error message when the screenshot image cannot be allocated
+						_("Could not allocate the screenshot image."));
+			return;
+		}
+	}
+
+	switch (shot->format) {
+	case REMMINA_SCREENSHOT_FORMAT_WEBP:
+		ret = gdk_pixbuf_save(shot->pixbuf, shot->filename, "webp", &error, NULL);
+		break;
+	case REMMINA_SCREENSHOT_FORMAT_QOI:
+		ret = remmina_screenshot_save_qoi(shot->pixbuf, shot->filename, &error);
+		break;
+	default:
+		level = g_strdup_printf("%d", shot->compression);
+		ret = gdk_pixbuf_save(shot->pixbuf, shot->filename, "png", &error, "compression", level, NULL);
+		g_free(level);
+		break;
+	}
+
+	if (ret)
+		g_task_return_boolean(task, TRUE);
+	else
+		g_task_return_error(task, error);
+}
+
+static void remmina_screenshot_done(GObject *source_object, GAsyncResult *result, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaScreenshot *shot = g_task_get_task_data(G_TASK(result));
+	GError *error = NULL;
+
+	if (!g_task_propagate_boolean(G_TASK(result), &error))
+		REMMINA_WARNING("Could not write the screenshot %s: %s", shot->filename, error->message);
+
+	if (shot->callback)
+		shot->callback(shot->gp, shot->filename, !error && shot->with_pixbuf ? shot->pixbuf : NULL, error, shot->user_data);
+
+	g_clear_error(&error);
+}
+
+gboolean remmina_screenshot_take(RemminaProtocolWidget *gp, const gchar *basename, gboolean with_pixbuf, RemminaScreenshotFunc callback, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	RemminaScreenshot *shot;
+	GdkWindow *window;
+	GTask *task;
+	gboolean from_plugin;
+
+	shot = g_new0(RemminaScreenshot, 1);
+	shot->gp = g_object_ref(gp);
+	shot->with_pixbuf = with_pixbuf;
+	shot->callback = callback;
+	shot->user_data = user_data;
+	shot->format = remmina_screenshot_get_format();
+	if (shot->format == REMMINA_SCREENSHOT_FORMAT_WEBP && !remmina_screenshot_webp_available()) {
+		REMMINA_DEBUG("No WebP loader for gdk-pixbuf, the screenshot is saved as PNG");
+		shot->format = REMMINA_SCREENSHOT_FORMAT_PNG;
+	}
+	shot->compression = CLAMP(remmina_pref_get_int("screenshot_png_compression", REMMINA_SCREENSHOT_PNG_COMPRESSION), 0, 9);
+	shot->filename = g_strdup_printf("%s.%s", basename, remmina_screenshot_format_get_extension(shot->format));
+
+	task = g_task_new(NULL, NULL, remmina_screenshot_done, NULL);
+	g_task_set_task_data(task, shot, (GDestroyNotify)remmina_screenshot_free);
+
+	/* Ask the plugin for a copy of its framebuffer, taken in a consistent
+	 * state. Otherwise grab what GTK shows */
+	from_plugin = remmina_protocol_widget_plugin_screenshot(gp, &shot->rpsd);
+	if (from_plugin) {
+		REMMINA_DEBUG("Screenshot from plugin: w=%d h=%d bpp=%d bytespp=%d",
+			      shot->rpsd.width, shot->rpsd.height, shot->rpsd.bitsPerPixel, shot->rpsd.bytesPerPixel);
+	} else {
+		memset(&shot->rpsd, 0, sizeof(shot->rpsd));
+		window = gtk_widget_get_window(GTK_WIDGET(gp));
+		if (window && gdk_window_is_viewable(window))
+			shot->pixbuf = gdk_pixbuf_get_from_window(window, 0, 0,
+								  gdk_window_get_width(window), gdk_window_get_height(window));
+		if (!shot->pixbuf) {
+			g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, "%s",
+						// TRANSLATORS: Error message when a screenshot of a connection window cannot be taken
+						_("The connection is not shown, so no screenshot could be taken."));
+			g_object_unref(task);
+			return FALSE;
+		}
+	}
+
+	g_task_run_in_thread(task, remmina_screenshot_thread);
+	g_object_unref(task);
+
+	return from_plugin;
+}
@@ -0,0 +1,61 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2009-2010 Vic Lee
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+#include "remmina/types.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+	REMMINA_SCREENSHOT_FORMAT_PNG,
+	REMMINA_SCREENSHOT_FORMAT_WEBP,
+	REMMINA_SCREENSHOT_FORMAT_QOI
+} RemminaScreenshotFormat;
+
+/* Called in the main loop once the image has been written. pixbuf is only
+ * set when it was asked for; take a reference to keep it. */
+typedef void (*RemminaScreenshotFunc)(RemminaProtocolWidget *gp, const gchar *filename, GdkPixbuf *pixbuf, const GError *error, gpointer user_data);
+
+/* Snapshot the framebuffer of gp and encode it in a worker thread, to
+ * basename plus the extension of the format chosen in the preferences.
+ * Returns FALSE when the plugin cannot give its framebuffer and the image
+ * is grabbed from the GTK window instead. */
+gboolean remmina_screenshot_take(RemminaProtocolWidget *gp, const gchar *basename, gboolean with_pixbuf, RemminaScreenshotFunc callback, gpointer user_data);
+RemminaScreenshotFormat remmina_screenshot_get_format(void);
+const gchar *remmina_screenshot_format_get_extension(RemminaScreenshotFormat format);
+
+G_END_DECLS
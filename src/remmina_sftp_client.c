@@ -63,10 +63,22 @@ G_DEFINE_TYPE(RemminaSFTPClient, remmina_sftp_client, REMMINA_TYPE_FTP_CLIENT)
 		gdk_window_set_cursor(gtk_widget_get_window(GTK_WIDGET(client)), cur); \
 	}
 
+static void
+remmina_sftp_client_finalize(GObject *object)
+{
+	TRACE_CALL(__func__);
+	RemminaSFTPClient *client = REMMINA_SFTP_CLIENT(object);
+
+	g_mutex_clear(&client->confirm_lock);
+
+	G_OBJECT_CLASS(remmina_sftp_client_parent_class)->finalize(object);
+}
+
 static void
 remmina_sftp_client_class_init(RemminaSFTPClientClass *klass)
 {
 	TRACE_CALL(__func__);
+	G_OBJECT_CLASS(klass)->finalize = remmina_sftp_client_finalize;
 }
 
 #define GET_SFTPATTR_TYPE(a, type) \
@@ -86,7 +98,18 @@ static gboolean remmina_sftp_client_refresh(RemminaSFTPClient *client);
 #define THREAD_CHECK_EXIT \
 	(!client->taskid || client->thread_abort)
 
+/* Bounds for the remmina.pref sftp_chunk_size and sftp_requests values */
+#define REMMINA_SFTP_CHUNK_MIN 4096
+#define REMMINA_SFTP_CHUNK_MAX (256 * 1024)
+#define REMMINA_SFTP_REQUESTS_MAX 256
+#define REMMINA_SFTP_WORKERS_MAX 16
 
+/* Every task list update is a round trip to the main thread, so progress
+ * is only pushed this often (microseconds) */
+#define REMMINA_SFTP_PROGRESS_INTERVAL (200 * 1000)
+
+/* The task of a folder transfer is shared by all the workers, every change
+ * to it and every push to the task list happens under client->task_lock */
 
 static gboolean
 remmina_sftp_client_thread_update_task(RemminaSFTPClient *client, RemminaFTPTask *task)
@@ -94,17 +117,107 @@ remmina_sftp_client_thread_update_task(RemminaSFTPClient *client, RemminaFTPTask
 	TRACE_CALL(__func__);
 	if (THREAD_CHECK_EXIT) return FALSE;
 
+	g_rec_mutex_lock(&client->task_lock);
 	remmina_ftp_client_update_task(REMMINA_FTP_CLIENT(client), task);
+	g_rec_mutex_unlock(&client->task_lock);
 
 	return TRUE;
 }
 
+static gboolean
+remmina_sftp_client_thread_update_progress(RemminaSFTPClient *client, RemminaFTPTask *task, guint64 *donesize, guint64 len)
+{
+	TRACE_CALL(__func__);
+	gint64 now, elapsed;
+	gfloat rate;
+	gboolean ret = TRUE;
+
+	if (THREAD_CHECK_EXIT) return FALSE;
+
+	g_rec_mutex_lock(&client->task_lock);
+
+	*donesize += len;
+	task->donesize = (gfloat)(*donesize);
+
+	now = g_get_monotonic_time();
+	if (task->rate_stamp == 0) {
+		task->rate_stamp = now;
+		task->rate_donesize = task->donesize;
+		ret = remmina_sftp_client_thread_update_task(client, task);
+	} else if ((elapsed = now - task->rate_stamp) >= REMMINA_SFTP_PROGRESS_INTERVAL) {
+		/* Smooth the rate a little, so the figure does not jump at every update */
+		rate = (task->donesize - task->rate_donesize) * G_USEC_PER_SEC / elapsed;
+		task->rate = task->rate > 0 ? task->rate * 0.7f + rate * 0.3f : rate;
+		task->rate_stamp = now;
+		task->rate_donesize = task->donesize;
+		ret = remmina_sftp_client_thread_update_task(client, task);
+	}
+
+	g_rec_mutex_unlock(&client->task_lock);
+	return ret;
+}
+
+static void
+remmina_sftp_client_thread_skip_progress(RemminaSFTPClient *client, RemminaFTPTask *task, guint64 *donesize, guint64 len)
+{
+	TRACE_CALL(__func__);
+
+	/* The resumed part has not been transferred now, keep it out of the rate */
+	g_rec_mutex_lock(&client->task_lock);
+	*donesize += len;
+	task->donesize = (gfloat)(*donesize);
+	task->rate_donesize += (gfloat)len;
+	g_rec_mutex_unlock(&client->task_lock);
+}
+
+static void
+remmina_sftp_client_thread_get_window(RemminaSFTP *sftp, gboolean upload, gint *chunk, gint *requests)
+{
+	TRACE_CALL(__func__);
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 10, 0)
+	sftp_limits_t limits;
+#endif
+
+	*chunk = CLAMP(remmina_pref.sftp_chunk_size, REMMINA_SFTP_CHUNK_MIN, REMMINA_SFTP_CHUNK_MAX);
+	*requests = CLAMP(remmina_pref.sftp_requests, 1, REMMINA_SFTP_REQUESTS_MAX);
+
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 10, 0)
+	/* Never ask for more than the server is willing to handle in one packet */
+	limits = sftp_limits(sftp->sftp_sess);
+	if (limits) {
+		if (upload && limits->max_write_length > 0)
+			*chunk = MIN(*chunk, (gint)limits->max_write_length);
+		else if (!upload && limits->max_read_length > 0)
+			*chunk = MIN(*chunk, (gint)limits->max_read_length);
+		sftp_limits_free(limits);
+	}
+#endif
+}
+
+static void
+remmina_sftp_client_thread_drain_reads(sftp_file remote_file, gchar *buf, gint chunk,
+				       uint32_t *ids, gint nids, gint *head, gint *inflight)
+{
+	TRACE_CALL(__func__);
+
+	/* Collect the replies we are no longer interested in, so they do not
+	 * pile up in the session queue. Once libssh has seen EOF it answers 0
+	 * without reading the reply at all, seeking in place clears that. */
+	while (*inflight > 0) {
+		sftp_seek64(remote_file, sftp_tell64(remote_file));
+		sftp_async_read(remote_file, buf, chunk, ids[*head]);
+		*head = (*head + 1) % nids;
+		(*inflight)--;
+	}
+}
+
 static void
 remmina_sftp_client_thread_set_error(RemminaSFTPClient *client, RemminaFTPTask *task, const gchar *error_format, ...)
 {
 	TRACE_CALL(__func__);
 	va_list args;
 
+	g_rec_mutex_lock(&client->task_lock);
 	task->status = REMMINA_FTP_TASK_STATUS_ERROR;
 	g_free(task->tooltip);
 	if (error_format) {
@@ -116,17 +229,20 @@ remmina_sftp_client_thread_set_error(RemminaSFTPClient *client, RemminaFTPTask *
 	}
 
 	remmina_sftp_client_thread_update_task(client, task);
+	g_rec_mutex_unlock(&client->task_lock);
 }
 
 static void
 remmina_sftp_client_thread_set_finish(RemminaSFTPClient *client, RemminaFTPTask *task)
 {
 	TRACE_CALL(__func__);
+	g_rec_mutex_lock(&client->task_lock);
 	task->status = REMMINA_FTP_TASK_STATUS_FINISH;
 	g_free(task->tooltip);
 	task->tooltip = NULL;
 
 	remmina_sftp_client_thread_update_task(client, task);
+	g_rec_mutex_unlock(&client->task_lock);
 }
 
 static RemminaFTPTask *
@@ -156,24 +272,26 @@ remmina_sftp_client_thread_download_file(RemminaSFTPClient *client, RemminaSFTP
 	sftp_file remote_file;
 	FILE *local_file;
 	gchar *tmp;
-	gchar buf[20480];
+	gchar *buf;
+	uint32_t *ids;
+	gint chunk, requests, head, inflight;
+	gint id;
 	gint len;
 	gint response;
 	uint64_t size;
+	gboolean ret;
 
 	if (THREAD_CHECK_EXIT) return FALSE;
 
 	/* Ensure local dir exists */
-	g_strlcpy(buf, local_path, sizeof(buf));
-	tmp = g_strrstr(buf, "/");
-	if (tmp && tmp != buf) {
-		*tmp = '\0';
-		if (g_mkdir_with_parents(buf, 0755) < 0) {
-			// TRANSLATORS: The placeholder %s is a directory path
-			remmina_sftp_client_thread_set_error(client, task, _("Could not create the folder “%s”."), buf);
-			return FALSE;
-		}
+	tmp = g_path_get_dirname(local_path);
+	if (g_strcmp0(tmp, ".") != 0 && g_strcmp0(tmp, "/") != 0 && g_mkdir_with_parents(tmp, 0755) < 0) {
+		// TRANSLATORS: The placeholder %s is a directory path
+		remmina_sftp_client_thread_set_error(client, task, _("Could not create the folder “%s”."), tmp);
+		g_free(tmp);
+		return FALSE;
 	}
+	g_free(tmp);
 
 	local_file = g_fopen(local_path, "ab");
 	if (!local_file) {
@@ -218,7 +336,7 @@ remmina_sftp_client_thread_download_file(RemminaSFTPClient *client, RemminaSFTP
 		fclose(local_file);
 		// TRANSLATORS: The placeholders %s are a file path, and an error message.
 		remmina_sftp_client_thread_set_error(client, task, _("Could not open the file “%s” on the server. %s"),
-						     remote_path, ssh_get_error(REMMINA_SSH(client->sftp)->session));
+						     remote_path, ssh_get_error(REMMINA_SSH(sftp)->session));
 		return FALSE;
 	}
 
@@ -227,38 +345,202 @@ remmina_sftp_client_thread_download_file(RemminaSFTPClient *client, RemminaSFTP
 			sftp_close(remote_file);
 			fclose(local_file);
 			remmina_sftp_client_thread_set_error(client, task, "Could not download the file “%s”. %s",
-							     remote_path, ssh_get_error(REMMINA_SSH(client->sftp)->session));
+							     remote_path, ssh_get_error(REMMINA_SSH(sftp)->session));
 			return FALSE;
 		}
-		*donesize = size;
+		remmina_sftp_client_thread_skip_progress(client, task, donesize, size);
 	}
 
-	while (!THREAD_CHECK_EXIT && (len = sftp_read(remote_file, buf, sizeof(buf))) > 0) {
-		if (THREAD_CHECK_EXIT) break;
+	/* Keep a window of read requests in flight instead of waiting a full
+	 * round trip for every chunk. The server answers them in order, and
+	 * each request advances the remote file offset by a full chunk. */
+	remmina_sftp_client_thread_get_window(sftp, FALSE, &chunk, &requests);
+	buf = g_malloc(chunk);
+	ids = g_new(uint32_t, requests);
+	head = 0;
+	inflight = 0;
+	ret = TRUE;
+
+	while (!THREAD_CHECK_EXIT) {
+		while (inflight < requests) {
+			id = sftp_async_read_begin(remote_file, chunk);
+			if (id < 0) {
+				ret = FALSE;
+				break;
+			}
+			ids[(head + inflight) % requests] = (uint32_t)id;
+			inflight++;
+		}
+		if (!ret)
+			break;
+
+		len = sftp_async_read(remote_file, buf, chunk, ids[head]);
+		head = (head + 1) % requests;
+		inflight--;
+
+		if (len < 0) {
+			ret = FALSE;
+			break;
+		}
+		if (len == 0)
+			/* End of file, the requests behind this one get the same answer */
+			break;
 
 		if (fwrite(buf, 1, len, local_file) < len) {
+			remmina_sftp_client_thread_drain_reads(remote_file, buf, chunk, ids, requests, &head, &inflight);
 			sftp_close(remote_file);
 			fclose(local_file);
+			g_free(ids);
+			g_free(buf);
 			remmina_sftp_client_thread_set_error(client, task, _("Could not save the file “%s”."), local_path);
 			return FALSE;
 		}
 
-		*donesize += (guint64)len;
-		task->donesize = (gfloat)(*donesize);
+		size += (uint64_t)len;
+
+		if (len < chunk) {
+			/* A short read leaves a hole before the requests already in
+			 * flight: drop them and restart right after the data we got */
+			remmina_sftp_client_thread_drain_reads(remote_file, buf, chunk, ids, requests, &head, &inflight);
+			if (sftp_seek64(remote_file, size) < 0) {
+				ret = FALSE;
+				break;
+			}
+		}
 
-		if (!remmina_sftp_client_thread_update_task(client, task)) break;
+		if (!remmina_sftp_client_thread_update_progress(client, task, donesize, len)) break;
 	}
 
+	remmina_sftp_client_thread_drain_reads(remote_file, buf, chunk, ids, requests, &head, &inflight);
 	sftp_close(remote_file);
 	fclose(local_file);
+	g_free(ids);
+	g_free(buf);
+
+	if (!ret) {
+		// TRANSLATORS: The placeholders %s are a file path, and an error message.
+		remmina_sftp_client_thread_set_error(client, task, _("Could not download the file “%s”. %s"),
+						     remote_path, ssh_get_error(REMMINA_SSH(sftp)->session));
+		return FALSE;
+	}
 	return TRUE;
 }
 
+/* A folder transfer. The task thread lists the folder and queues the files,
+ * while up to sftp_workers sessions pick them up, smallest first. */
+typedef struct _RemminaSFTPClientJob {
+	RemminaSFTPClient *	client;
+	RemminaFTPTask *	task;
+	gboolean		upload;
+	const gchar *		remote;
+	const gchar *		local;
+
+	GMutex			mutex;
+	GCond			cond;
+	GSequence *		files;
+	gboolean		listing;
+	gboolean		failed;
+
+	/* Under client->task_lock */
+	guint64			donesize;
+} RemminaSFTPClientJob;
+
+typedef struct _RemminaSFTPClientJobFile {
+	gchar * path;
+	guint64 size;
+} RemminaSFTPClientJobFile;
+
+typedef struct _RemminaSFTPClientWorker {
+	RemminaSFTPClientJob *	job;
+	RemminaSFTP *		primary;
+	RemminaSFTP **		sftp;
+	pthread_t		thread;
+	gboolean		started;
+} RemminaSFTPClientWorker;
+
+static gint
+remmina_sftp_client_job_file_cmp(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const RemminaSFTPClientJobFile *fa = a;
+	const RemminaSFTPClientJobFile *fb = b;
+
+	return (fa->size > fb->size) - (fa->size < fb->size);
+}
+
+static void
+remmina_sftp_client_job_file_free(RemminaSFTPClientJobFile *file)
+{
+	g_free(file->path);
+	g_free(file);
+}
+
+static gboolean
+remmina_sftp_client_job_push(RemminaSFTPClientJob *job, gchar *path, guint64 size)
+{
+	TRACE_CALL(__func__);
+	RemminaSFTPClient *client = job->client;
+	RemminaSFTPClientJobFile *file;
+	gboolean failed;
+
+	file = g_new(RemminaSFTPClientJobFile, 1);
+	file->path = path;
+	file->size = size;
+
+	g_mutex_lock(&job->mutex);
+	g_sequence_insert_sorted(job->files, file, remmina_sftp_client_job_file_cmp, NULL);
+	g_cond_signal(&job->cond);
+	failed = job->failed;
+	g_mutex_unlock(&job->mutex);
+
+	/* No point in listing further once a worker gave up */
+	if (failed)
+		return FALSE;
+
+	g_rec_mutex_lock(&client->task_lock);
+	job->task->size += (gfloat)size;
+	g_rec_mutex_unlock(&client->task_lock);
+
+	return remmina_sftp_client_thread_update_progress(client, job->task, &job->donesize, 0);
+}
+
+static RemminaSFTPClientJobFile *
+remmina_sftp_client_job_pop(RemminaSFTPClientJob *job)
+{
+	TRACE_CALL(__func__);
+	RemminaSFTPClient *client = job->client;
+	RemminaSFTPClientJobFile *file = NULL;
+	GSequenceIter *iter;
+
+	g_mutex_lock(&job->mutex);
+	/* Wake up now and then, a cancel does not signal us */
+	while (!job->failed && job->listing && g_sequence_is_empty(job->files) && !THREAD_CHECK_EXIT)
+		g_cond_wait_until(&job->cond, &job->mutex, g_get_monotonic_time() + G_TIME_SPAN_SECOND / 2);
+	if (!job->failed && !THREAD_CHECK_EXIT && !g_sequence_is_empty(job->files)) {
+		iter = g_sequence_get_begin_iter(job->files);
+		file = g_sequence_get(iter);
+		g_sequence_remove(iter);
+	}
+	g_mutex_unlock(&job->mutex);
+
+	return file;
+}
+
+static void
+remmina_sftp_client_job_fail(RemminaSFTPClientJob *job)
+{
+	TRACE_CALL(__func__);
+	g_mutex_lock(&job->mutex);
+	job->failed = TRUE;
+	g_cond_broadcast(&job->cond);
+	g_mutex_unlock(&job->mutex);
+}
+
 static gboolean
-remmina_sftp_client_thread_recursive_dir(RemminaSFTPClient *client, RemminaSFTP *sftp, RemminaFTPTask *task,
-					 const gchar *rootdir_path, const gchar *subdir_path, GPtrArray *array)
+remmina_sftp_client_thread_recursive_dir(RemminaSFTPClient *client, RemminaSFTP *sftp, RemminaSFTPClientJob *job,
+					 const gchar *rootdir_path, const gchar *subdir_path)
 {
 	TRACE_CALL(__func__);
+	RemminaFTPTask *task = job->task;
 	sftp_dir sftpdir;
 	sftp_attributes sftpattr;
 	gchar *tmp;
@@ -279,7 +561,7 @@ remmina_sftp_client_thread_recursive_dir(RemminaSFTPClient *client, RemminaSFTP
 
 	if (!sftpdir) {
 		remmina_sftp_client_thread_set_error(client, task, _("Could not open the folder “%s”. %s"),
-						     dir_path, ssh_get_error(REMMINA_SSH(client->sftp)->session));
+						     dir_path, ssh_get_error(REMMINA_SSH(sftp)->session));
 		g_free(dir_path);
 		return FALSE;
 	}
@@ -300,17 +582,15 @@ remmina_sftp_client_thread_recursive_dir(RemminaSFTPClient *client, RemminaSFTP
 			}
 
 			if (type == REMMINA_FTP_FILE_TYPE_DIR) {
-				ret = remmina_sftp_client_thread_recursive_dir(client, sftp, task, rootdir_path, file_path, array);
+				ret = remmina_sftp_client_thread_recursive_dir(client, sftp, job, rootdir_path, file_path);
 				g_free(file_path);
 				if (!ret) {
 					sftp_attributes_free(sftpattr);
 					break;
 				}
 			} else {
-				task->size += (gfloat)sftpattr->size;
-				g_ptr_array_add(array, file_path);
-
-				if (!remmina_sftp_client_thread_update_task(client, task)) {
+				/* The workers may start on it right away */
+				if (!remmina_sftp_client_job_push(job, file_path, sftpattr->size)) {
 					sftp_attributes_free(sftpattr);
 					break;
 				}
@@ -326,8 +606,27 @@ remmina_sftp_client_thread_recursive_dir(RemminaSFTPClient *client, RemminaSFTP
 }
 
 static gboolean
-remmina_sftp_client_thread_recursive_localdir(RemminaSFTPClient *client, RemminaFTPTask *task,
-					      const gchar *rootdir_path, const gchar *subdir_path, GPtrArray *array)
+remmina_sftp_client_thread_mkdir(RemminaSFTPClient *client, RemminaSFTP *sftp, RemminaFTPTask *task, const gchar *path)
+{
+	TRACE_CALL(__func__);
+	sftp_attributes sftpattr;
+
+	sftpattr = sftp_stat(sftp->sftp_sess, path);
+	if (sftpattr != NULL) {
+		sftp_attributes_free(sftpattr);
+		return TRUE;
+	}
+	if (sftp_mkdir(sftp->sftp_sess, path, 0755) < 0) {
+		remmina_sftp_client_thread_set_error(client, task, _("Could not create the folder “%s” on the server. %s"),
+						     path, ssh_get_error(REMMINA_SSH(sftp)->session));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+remmina_sftp_client_thread_recursive_localdir(RemminaSFTPClient *client, RemminaSFTP *sftp, RemminaSFTPClientJob *job,
+					      const gchar *rootdir_path, const gchar *subdir_path)
 {
 	TRACE_CALL(__func__);
 	GDir *dir;
@@ -335,6 +634,7 @@ remmina_sftp_client_thread_recursive_localdir(RemminaSFTPClient *client, Remmina
 	const gchar *name;
 	gchar *relpath;
 	gchar *abspath;
+	gchar *remote_path;
 	struct stat st;
 	gboolean ret = TRUE;
 
@@ -356,39 +656,25 @@ remmina_sftp_client_thread_recursive_localdir(RemminaSFTPClient *client, Remmina
 			continue;
 		}
 		relpath = g_build_filename(subdir_path ? subdir_path : "", name, NULL);
-		g_ptr_array_add(array, relpath);
 		if (g_file_test(abspath, G_FILE_TEST_IS_DIR)) {
-			ret = remmina_sftp_client_thread_recursive_localdir(client, task, rootdir_path, relpath, array);
-			if (!ret) break;
+			/* Create it before queueing anything that goes inside */
+			remote_path = remmina_public_combine_path(job->remote, relpath);
+			ret = remmina_sftp_client_thread_mkdir(client, sftp, job->task, remote_path);
+			g_free(remote_path);
+			if (ret)
+				ret = remmina_sftp_client_thread_recursive_localdir(client, sftp, job, rootdir_path, relpath);
+			g_free(relpath);
 		} else {
-			task->size += (gfloat)st.st_size;
+			ret = remmina_sftp_client_job_push(job, relpath, st.st_size);
 		}
 		g_free(abspath);
+		if (!ret) break;
 	}
 	g_free(path);
 	g_dir_close(dir);
 	return ret;
 }
 
-static gboolean
-remmina_sftp_client_thread_mkdir(RemminaSFTPClient *client, RemminaSFTP *sftp, RemminaFTPTask *task, const gchar *path)
-{
-	TRACE_CALL(__func__);
-	sftp_attributes sftpattr;
-
-	sftpattr = sftp_stat(sftp->sftp_sess, path);
-	if (sftpattr != NULL) {
-		sftp_attributes_free(sftpattr);
-		return TRUE;
-	}
-	if (sftp_mkdir(sftp->sftp_sess, path, 0755) < 0) {
-		remmina_sftp_client_thread_set_error(client, task, _("Could not create the folder “%s” on the server. %s"),
-						     path, ssh_get_error(REMMINA_SSH(client->sftp)->session));
-		return FALSE;
-	}
-	return TRUE;
-}
-
 static gboolean
 remmina_sftp_client_thread_upload_file(RemminaSFTPClient *client, RemminaSFTP *sftp, RemminaFTPTask *task,
 				       const gchar *remote_path, const gchar *local_path, guint64 *donesize)
@@ -397,8 +683,16 @@ remmina_sftp_client_thread_upload_file(RemminaSFTPClient *client, RemminaSFTP *s
 	sftp_file remote_file;
 	FILE *local_file;
 	gchar *tmp;
-	gchar buf[20480];
+	gchar *buf;
+	gint chunk, requests;
 	gint len;
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+	sftp_aio *aios;
+	gint head, inflight;
+	ssize_t written;
+	gboolean eof;
+#endif
+	gboolean ret;
 	sftp_attributes attr;
 	gint response;
 	uint64_t size;
@@ -411,7 +705,7 @@ remmina_sftp_client_thread_upload_file(RemminaSFTPClient *client, RemminaSFTP *s
 
 	if (!remote_file) {
 		remmina_sftp_client_thread_set_error(client, task, _("Could not create the file “%s” on the server. %s"),
-						     remote_path, ssh_get_error(REMMINA_SSH(client->sftp)->session));
+						     remote_path, ssh_get_error(REMMINA_SSH(sftp)->session));
 		return FALSE;
 	}
 	attr = sftp_fstat(remote_file);
@@ -433,7 +727,7 @@ remmina_sftp_client_thread_upload_file(RemminaSFTPClient *client, RemminaSFTP *s
 			g_free(tmp);
 			if (!remote_file) {
 				remmina_sftp_client_thread_set_error(client, task, _("Could not create the file “%s” on the server. %s"),
-								     remote_path, ssh_get_error(REMMINA_SSH(client->sftp)->session));
+								     remote_path, ssh_get_error(REMMINA_SSH(sftp)->session));
 				return FALSE;
 			}
 			size = 0;
@@ -443,7 +737,7 @@ remmina_sftp_client_thread_upload_file(RemminaSFTPClient *client, RemminaSFTP *s
 			if (sftp_seek64(remote_file, size) < 0) {
 				sftp_close(remote_file);
 				remmina_sftp_client_thread_set_error(client, task, "Could not download the file “%s”. %s",
-								     remote_path, ssh_get_error(REMMINA_SSH(client->sftp)->session));
+								     remote_path, ssh_get_error(REMMINA_SSH(sftp)->session));
 				return FALSE;
 			}
 			break;
@@ -464,31 +758,215 @@ remmina_sftp_client_thread_upload_file(RemminaSFTPClient *client, RemminaSFTP *s
 			remmina_sftp_client_thread_set_error(client, task, "Could not find the local file “%s”.", local_path);
 			return FALSE;
 		}
-		*donesize = size;
+		remmina_sftp_client_thread_skip_progress(client, task, donesize, size);
 	}
 
-	while (!THREAD_CHECK_EXIT && (len = fread(buf, 1, sizeof(buf), local_file)) > 0) {
-		if (THREAD_CHECK_EXIT) break;
+	remmina_sftp_client_thread_get_window(sftp, TRUE, &chunk, &requests);
+	buf = g_malloc(chunk);
+	ret = TRUE;
+
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+	/* Same window as for downloads. The data is copied into the outgoing
+	 * packet when the write is issued, so one buffer is enough. */
+	aios = g_new0(sftp_aio, requests);
+	head = 0;
+	inflight = 0;
+	eof = FALSE;
+
+	while (!THREAD_CHECK_EXIT) {
+		while (!eof && inflight < requests) {
+			len = fread(buf, 1, chunk, local_file);
+			if (len <= 0) {
+				eof = TRUE;
+				break;
+			}
+			if (sftp_aio_begin_write(remote_file, buf, len, &aios[(head + inflight) % requests]) == SSH_ERROR) {
+				ret = FALSE;
+				break;
+			}
+			inflight++;
+		}
+		if (!ret || inflight == 0)
+			break;
 
-		if (sftp_write(remote_file, buf, len) < len) {
-			sftp_close(remote_file);
-			fclose(local_file);
-			remmina_sftp_client_thread_set_error(client, task, _("Could not write to the file “%s” on the server. %s"),
-							     remote_path, ssh_get_error(REMMINA_SSH(client->sftp)->session));
-			return FALSE;
+		written = sftp_aio_wait_write(&aios[head]);
+		head = (head + 1) % requests;
+		inflight--;
+		if (written == SSH_ERROR) {
+			ret = FALSE;
+			break;
 		}
 
-		*donesize += (guint64)len;
-		task->donesize = (gfloat)(*donesize);
+		if (!remmina_sftp_client_thread_update_progress(client, task, donesize, written)) break;
+	}
 
-		if (!remmina_sftp_client_thread_update_task(client, task)) break;
+	while (inflight > 0) {
+		sftp_aio_free(aios[head]);
+		head = (head + 1) % requests;
+		inflight--;
 	}
+	g_free(aios);
+#else
+	/* No asynchronous writes before libssh 0.11, larger chunks are all we can do */
+	while (!THREAD_CHECK_EXIT && (len = fread(buf, 1, chunk, local_file)) > 0) {
+		if (sftp_write(remote_file, buf, len) < len) {
+			ret = FALSE;
+			break;
+		}
+
+		if (!remmina_sftp_client_thread_update_progress(client, task, donesize, len)) break;
+	}
+#endif
 
 	sftp_close(remote_file);
 	fclose(local_file);
+	g_free(buf);
+
+	if (!ret) {
+		remmina_sftp_client_thread_set_error(client, task, _("Could not write to the file “%s” on the server. %s"),
+						     remote_path, ssh_get_error(REMMINA_SSH(sftp)->session));
+		return FALSE;
+	}
 	return TRUE;
 }
 
+static void
+remmina_sftp_client_job_run(RemminaSFTPClientJob *job, RemminaSFTP *sftp)
+{
+	TRACE_CALL(__func__);
+	RemminaSFTPClient *client = job->client;
+	RemminaSFTPClientJobFile *file;
+	gchar *remote_file, *local_file;
+	gboolean ret;
+
+	while ((file = remmina_sftp_client_job_pop(job)) != NULL) {
+		remote_file = remmina_public_combine_path(job->remote, file->path);
+		if (job->upload) {
+			local_file = g_build_filename(job->local, file->path, NULL);
+			ret = remmina_sftp_client_thread_upload_file(client, sftp, job->task,
+								     remote_file, local_file, &job->donesize);
+		} else {
+			local_file = remmina_public_combine_path(job->local, file->path);
+			ret = remmina_sftp_client_thread_download_file(client, sftp, job->task,
+								       remote_file, local_file, &job->donesize);
+		}
+		g_free(remote_file);
+		g_free(local_file);
+		remmina_sftp_client_job_file_free(file);
+
+		if (!ret)
+			remmina_sftp_client_job_fail(job);
+	}
+}
+
+static RemminaSFTP *
+remmina_sftp_client_thread_clone_session(RemminaSFTPClient *client, RemminaSFTP *primary)
+{
+	TRACE_CALL(__func__);
+	RemminaSFTP *sftp;
+
+	/* Go through the entrance the first session already opened: asking for
+	 * another direct tunnel would close the whole connection on failure */
+	sftp = remmina_sftp_new_from_ssh(REMMINA_SSH(primary));
+	g_free((REMMINA_SSH(sftp))->tunnel_entrance_host);
+	(REMMINA_SSH(sftp))->tunnel_entrance_host = g_strdup((REMMINA_SSH(primary))->tunnel_entrance_host);
+	(REMMINA_SSH(sftp))->tunnel_entrance_port = (REMMINA_SSH(primary))->tunnel_entrance_port;
+
+	if (remmina_ssh_init_session(REMMINA_SSH(sftp)) &&
+	    remmina_ssh_auth(REMMINA_SSH(sftp), REMMINA_SSH(sftp)->password, client->gp, NULL) == REMMINA_SSH_AUTH_SUCCESS &&
+	    remmina_sftp_open(sftp))
+		return sftp;
+
+	g_debug("[SFTPCLI] %s could not open an additional session: %s", __func__, (REMMINA_SSH(sftp))->error);
+	remmina_sftp_free(sftp);
+	return NULL;
+}
+
+static gpointer
+remmina_sftp_client_job_worker(gpointer data)
+{
+	TRACE_CALL(__func__);
+	RemminaSFTPClientWorker *worker = (RemminaSFTPClientWorker *)data;
+
+	/* Sessions are kept across tasks, only the first folder pays for the handshake */
+	if (*worker->sftp == NULL)
+		*worker->sftp = remmina_sftp_client_thread_clone_session(worker->job->client, worker->primary);
+	if (*worker->sftp)
+		remmina_sftp_client_job_run(worker->job, *worker->sftp);
+
+	return NULL;
+}
+
+static void
+remmina_sftp_client_free_session(gpointer data, gpointer user_data)
+{
+	TRACE_CALL(__func__);
+	if (data)
+		remmina_sftp_free((RemminaSFTP *)data);
+}
+
+static gboolean
+remmina_sftp_client_thread_run_job(RemminaSFTPClient *client, RemminaSFTP *sftp, GPtrArray *sessions,
+				   RemminaFTPTask *task, gboolean upload, const gchar *remote, const gchar *local)
+{
+	TRACE_CALL(__func__);
+	RemminaSFTPClientJob job = { 0 };
+	RemminaSFTPClientWorker *workers;
+	gint nworkers, i;
+	gboolean ret;
+
+	job.client = client;
+	job.task = task;
+	job.upload = upload;
+	job.remote = remote;
+	job.local = local;
+	g_mutex_init(&job.mutex);
+	g_cond_init(&job.cond);
+	job.files = g_sequence_new(NULL);
+	job.listing = TRUE;
+
+	/* The additional workers start transferring while we are still listing */
+	nworkers = CLAMP(remmina_pref.sftp_workers, 1, REMMINA_SFTP_WORKERS_MAX) - 1;
+	if (sessions->len < nworkers)
+		g_ptr_array_set_size(sessions, nworkers);
+	workers = g_new0(RemminaSFTPClientWorker, nworkers);
+	for (i = 0; i < nworkers; i++) {
+		workers[i].job = &job;
+		workers[i].primary = sftp;
+		workers[i].sftp = (RemminaSFTP **)&g_ptr_array_index(sessions, i);
+		workers[i].started = pthread_create(&workers[i].thread, NULL, remmina_sftp_client_job_worker, &workers[i]) == 0;
+	}
+
+	if (upload)
+		ret = remmina_sftp_client_thread_recursive_localdir(client, sftp, &job, local, NULL);
+	else
+		ret = remmina_sftp_client_thread_recursive_dir(client, sftp, &job, remote, NULL);
+
+	g_mutex_lock(&job.mutex);
+	job.listing = FALSE;
+	if (!ret)
+		job.failed = TRUE;
+	g_cond_broadcast(&job.cond);
+	g_mutex_unlock(&job.mutex);
+
+	/* Then help with whatever is left */
+	remmina_sftp_client_job_run(&job, sftp);
+
+	for (i = 0; i < nworkers; i++)
+		if (workers[i].started)
+			pthread_join(workers[i].thread, NULL);
+	g_free(workers);
+
+	ret = !job.failed && !THREAD_CHECK_EXIT;
+
+	g_sequence_foreach(job.files, (GFunc)remmina_sftp_client_job_file_free, NULL);
+	g_sequence_free(job.files);
+	g_cond_clear(&job.cond);
+	g_mutex_clear(&job.mutex);
+
+	return ret;
+}
+
 static gpointer
 remmina_sftp_client_thread_main(gpointer data)
 {
@@ -498,9 +976,7 @@ remmina_sftp_client_thread_main(gpointer data)
 	RemminaFTPTask *task;
 	gchar *remote, *local;
 	guint64 size;
-	GPtrArray *array;
-	gint i;
-	gchar *remote_file, *local_file;
+	GPtrArray *sessions;
 	gboolean ret;
 	gchar *refreshdir = NULL;
 	gchar *tmp;
@@ -508,6 +984,9 @@ remmina_sftp_client_thread_main(gpointer data)
 	gchar *host;
 	int port;
 
+	/* Additional sessions for folder transfers, see remmina_sftp_client_thread_run_job() */
+	sessions = g_ptr_array_new();
+
 	task = remmina_sftp_client_thread_get_task(client);
 	while (task) {
 		size = 0;
@@ -517,8 +996,10 @@ remmina_sftp_client_thread_main(gpointer data)
 			/* we may need to open a new tunnel too */
 			host = NULL;
 			port = 0;
-			if (!remmina_plugin_sftp_start_direct_tunnel(client->gp, &host, &port))
+			if (!remmina_plugin_sftp_start_direct_tunnel(client->gp, &host, &port)) {
+				g_ptr_array_free(sessions, TRUE);
 				return NULL;
+			}
 			(REMMINA_SSH(sftp))->tunnel_entrance_host = host;
 			(REMMINA_SSH(sftp))->tunnel_entrance_port = port;
 
@@ -558,25 +1039,7 @@ remmina_sftp_client_thread_main(gpointer data)
 				break;
 
 			case REMMINA_FTP_FILE_TYPE_DIR:
-				array = g_ptr_array_new();
-				ret = remmina_sftp_client_thread_recursive_dir(client, sftp, task, remote, NULL, array);
-				if (ret) {
-					for (i = 0; i < array->len; i++) {
-						if (THREAD_CHECK_EXIT) {
-							ret = FALSE;
-							break;
-						}
-						remote_file = remmina_public_combine_path(remote, (gchar *)g_ptr_array_index(array, i));
-						local_file = remmina_public_combine_path(local, (gchar *)g_ptr_array_index(array, i));
-						ret = remmina_sftp_client_thread_download_file(client, sftp, task,
-											       remote_file, local_file, &size);
-						g_free(remote_file);
-						g_free(local_file);
-						if (!ret) break;
-					}
-				}
-				g_ptr_array_foreach(array, (GFunc)g_free, NULL);
-				g_ptr_array_free(array, TRUE);
+				ret = remmina_sftp_client_thread_run_job(client, sftp, sessions, task, FALSE, remote, local);
 				break;
 
 			default:
@@ -597,28 +1060,7 @@ remmina_sftp_client_thread_main(gpointer data)
 			case REMMINA_FTP_FILE_TYPE_DIR:
 				ret = remmina_sftp_client_thread_mkdir(client, sftp, task, remote);
 				if (!ret) break;
-				array = g_ptr_array_new();
-				ret = remmina_sftp_client_thread_recursive_localdir(client, task, local, NULL, array);
-				if (ret) {
-					for (i = 0; i < array->len; i++) {
-						if (THREAD_CHECK_EXIT) {
-							ret = FALSE;
-							break;
-						}
-						remote_file = remmina_public_combine_path(remote, (gchar *)g_ptr_array_index(array, i));
-						local_file = g_build_filename(local, (gchar *)g_ptr_array_index(array, i), NULL);
-						if (g_file_test(local_file, G_FILE_TEST_IS_DIR))
-							ret = remmina_sftp_client_thread_mkdir(client, sftp, task, remote_file);
-						else
-							ret = remmina_sftp_client_thread_upload_file(client, sftp, task,
-												     remote_file, local_file, &size);
-						g_free(remote_file);
-						g_free(local_file);
-						if (!ret) break;
-					}
-				}
-				g_ptr_array_foreach(array, (GFunc)g_free, NULL);
-				g_ptr_array_free(array, TRUE);
+				ret = remmina_sftp_client_thread_run_job(client, sftp, sessions, task, TRUE, remote, local);
 				break;
 
 			default:
@@ -650,6 +1092,8 @@ remmina_sftp_client_thread_main(gpointer data)
 		task = remmina_sftp_client_thread_get_task(client);
 	}
 
+	g_ptr_array_foreach(sessions, remmina_sftp_client_free_session, NULL);
+	g_ptr_array_free(sessions, TRUE);
 	if (sftp)
 		remmina_sftp_free(sftp);
 
@@ -871,6 +1315,8 @@ remmina_sftp_client_init(RemminaSFTPClient *client)
 	client->thread = 0;
 	client->taskid = 0;
 	client->thread_abort = FALSE;
+	g_rec_mutex_init(&client->task_lock);
+	g_mutex_init(&client->confirm_lock);
 
 	/* Setup the internal signals */
 	g_signal_connect(G_OBJECT(client), "destroy",
@@ -926,6 +1372,18 @@ remmina_sftp_client_confirm_resume(RemminaSFTPClient *client, const gchar *path)
 		/* Allow the execution of this function from a non main thread */
 		RemminaMTExecData *d;
 		gint retval;
+
+		/* Folder transfer workers may all hit an existing file at once:
+		 * ask one at a time, the answer may apply to the next ones too */
+		g_mutex_lock(&client->confirm_lock);
+		if (remmina_ftp_client_get_overwrite_status(REMMINA_FTP_CLIENT(client))) {
+			g_mutex_unlock(&client->confirm_lock);
+			return GTK_RESPONSE_ACCEPT;
+		}
+		if (remmina_ftp_client_get_resume_status(REMMINA_FTP_CLIENT(client))) {
+			g_mutex_unlock(&client->confirm_lock);
+			return GTK_RESPONSE_APPLY;
+		}
 		d = (RemminaMTExecData *)g_malloc(sizeof(RemminaMTExecData));
 		d->func = FUNC_SFTP_CLIENT_CONFIRM_RESUME;
 		d->p.sftp_client_confirm_resume.client = client;
@@ -933,6 +1391,7 @@ remmina_sftp_client_confirm_resume(RemminaSFTPClient *client, const gchar *path)
 		remmina_masterthread_exec_and_wait(d);
 		retval = d->p.sftp_client_confirm_resume.retval;
 		g_free(d);
+		g_mutex_unlock(&client->confirm_lock);
 		return retval;
 	}
 
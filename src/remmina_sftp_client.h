@@ -61,6 +61,8 @@ typedef struct _RemminaSFTPClient {
 	pthread_t		thread;
 	gint			taskid;
 	gboolean		thread_abort;
+	GRecMutex		task_lock;
+	GMutex			confirm_lock;
 	RemminaProtocolWidget * gp;
 } RemminaSFTPClient;
 
@@ -50,7 +50,9 @@
 #include <signal.h>
 #include <time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <pthread.h>
+#include <poll.h>
 #ifdef HAVE_NETDB_H
 #include <netdb.h>
 #endif
@@ -1565,35 +1567,126 @@ remmina_ssh_free(RemminaSSH *ssh)
 /*-----------------------------------------------------------------------------*
 *                           SSH Tunnel                                        *
 *-----------------------------------------------------------------------------*/
+/* Size limits of the tunnel buffers: the size doubles each time a read
+ * fills a whole buffer and halves when reads stay well below it */
+#define REMMINA_SSH_TUNNEL_BUFFER_MIN   (16 * 1024)
+#define REMMINA_SSH_TUNNEL_BUFFER_MAX   (256 * 1024)
+#define REMMINA_SSH_TUNNEL_SHRINK_READS 64
+/* Free buffers kept for reuse */
+#define REMMINA_SSH_TUNNEL_POOL_MAX     16
+/* Buffers queued for a local socket, written with a single writev() */
+#define REMMINA_SSH_TUNNEL_IOV_MAX      16
+
+/* Bytes each channel may move in each direction per scheduling round:
+ * a bulk channel cannot starve the others sharing the tunnel */
+#define REMMINA_SSH_TUNNEL_QUANTUM      (64 * 1024)
+
+/* Deficit round robin state of a channel */
+struct _RemminaSSHTunnelChannelState {
+	gint	deficit_local;  /* local socket -> SSH channel */
+	gint	deficit_remote; /* SSH channel -> local socket */
+	gsize	queued;         /* bytes waiting to be written to the local socket */
+	gboolean	blocked;
+	gboolean	hup;            /* the local socket has hung up, drain it and close */
+};
+
 struct _RemminaSSHTunnelBuffer {
-	gchar * data;
-	gchar * ptr;
-	ssize_t len;
+	gchar *				data;
+	gchar *				ptr;
+	ssize_t				len;
+	ssize_t				size;
+	RemminaSSHTunnelBuffer *	next;
 };
 
 static RemminaSSHTunnelBuffer *
-remmina_ssh_tunnel_buffer_new(ssize_t len)
+remmina_ssh_tunnel_buffer_new(ssize_t size)
 {
 	TRACE_CALL(__func__);
 	RemminaSSHTunnelBuffer *buffer;
 
 	buffer = g_new(RemminaSSHTunnelBuffer, 1);
-	buffer->data = (gchar *)g_malloc(len);
+	buffer->data = (gchar *)g_malloc(size);
 	buffer->ptr = buffer->data;
-	buffer->len = len;
+	buffer->len = 0;
+	buffer->size = size;
+	buffer->next = NULL;
 	return buffer;
 }
 
+/* Free a whole chain of buffers */
 static void
 remmina_ssh_tunnel_buffer_free(RemminaSSHTunnelBuffer *buffer)
 {
 	TRACE_CALL(__func__);
-	if (buffer) {
+	RemminaSSHTunnelBuffer *next;
+
+	while (buffer) {
+		next = buffer->next;
 		g_free(buffer->data);
 		g_free(buffer);
+		buffer = next;
 	}
 }
 
+/* Take a buffer from the pool, or allocate a new one */
+static RemminaSSHTunnelBuffer *
+remmina_ssh_tunnel_buffer_get(RemminaSSHTunnel *tunnel)
+{
+	RemminaSSHTunnelBuffer *buffer;
+
+	buffer = tunnel->buffer_pool;
+	if (!buffer)
+		return remmina_ssh_tunnel_buffer_new(tunnel->buffer_len);
+
+	tunnel->buffer_pool = buffer->next;
+	tunnel->buffer_pool_len--;
+	buffer->ptr = buffer->data;
+	buffer->len = 0;
+	buffer->next = NULL;
+	return buffer;
+}
+
+/* Give a buffer back to the pool. Buffers of an outdated size are freed */
+static void
+remmina_ssh_tunnel_buffer_put(RemminaSSHTunnel *tunnel, RemminaSSHTunnelBuffer *buffer)
+{
+	if (buffer->size != tunnel->buffer_len || tunnel->buffer_pool_len >= REMMINA_SSH_TUNNEL_POOL_MAX) {
+		buffer->next = NULL;
+		remmina_ssh_tunnel_buffer_free(buffer);
+		return;
+	}
+	buffer->next = tunnel->buffer_pool;
+	tunnel->buffer_pool = buffer;
+	tunnel->buffer_pool_len++;
+}
+
+/* Adapt the buffer size to the amount of data moved by the last read */
+static void
+remmina_ssh_tunnel_buffer_adapt(RemminaSSHTunnel *tunnel, ssize_t len)
+{
+	gint size = tunnel->buffer_len;
+
+	if (len < size / 8) {
+		/* Shrink only after many small reads in a row */
+		if (++tunnel->buffer_small_reads < REMMINA_SSH_TUNNEL_SHRINK_READS || size <= REMMINA_SSH_TUNNEL_BUFFER_MIN)
+			return;
+		size /= 2;
+	} else if (len >= size && size < REMMINA_SSH_TUNNEL_BUFFER_MAX) {
+		size *= 2;
+	} else {
+		tunnel->buffer_small_reads = 0;
+		return;
+	}
+	tunnel->buffer_small_reads = 0;
+
+	tunnel->buffer_len = size;
+	g_free(tunnel->buffer);
+	tunnel->buffer = g_malloc(size);
+	remmina_ssh_tunnel_buffer_free(tunnel->buffer_pool);
+	tunnel->buffer_pool = NULL;
+	tunnel->buffer_pool_len = 0;
+}
+
 RemminaSSHTunnel *
 remmina_ssh_tunnel_new_from_file(RemminaFile *remminafile)
 {
@@ -1608,6 +1701,7 @@ remmina_ssh_tunnel_new_from_file(RemminaFile *remminafile)
 	tunnel->channels = NULL;
 	tunnel->sockets = NULL;
 	tunnel->socketbuffers = NULL;
+	tunnel->channelstates = NULL;
 	tunnel->num_channels = 0;
 	tunnel->max_channels = 0;
 	tunnel->thread = 0;
@@ -1617,7 +1711,10 @@ remmina_ssh_tunnel_new_from_file(RemminaFile *remminafile)
 	tunnel->port = 0;
 	tunnel->buffer = NULL;
 	tunnel->buffer_len = 0;
-	tunnel->channels_out = NULL;
+	tunnel->buffer_pool = NULL;
+	tunnel->buffer_pool_len = 0;
+	tunnel->buffer_small_reads = 0;
+	tunnel->pollfds = NULL;
 	tunnel->remotedisplay = 0;
 	tunnel->localdisplay = NULL;
 	tunnel->init_func = NULL;
@@ -1648,6 +1745,8 @@ remmina_ssh_tunnel_close_all_channels(RemminaSSHTunnel *tunnel)
 	tunnel->sockets = NULL;
 	g_free(tunnel->socketbuffers);
 	tunnel->socketbuffers = NULL;
+	g_free(tunnel->channelstates);
+	tunnel->channelstates = NULL;
 
 	tunnel->num_channels = 0;
 	tunnel->max_channels = 0;
@@ -1667,6 +1766,7 @@ remmina_ssh_tunnel_remove_channel(RemminaSSHTunnel *tunnel, gint n)
 	tunnel->channels[tunnel->num_channels] = NULL;
 	tunnel->sockets[n] = tunnel->sockets[tunnel->num_channels];
 	tunnel->socketbuffers[n] = tunnel->socketbuffers[tunnel->num_channels];
+	tunnel->channelstates[n] = tunnel->channelstates[tunnel->num_channels];
 }
 
 /* Register the new channel/socket pair */
@@ -1686,15 +1786,19 @@ remmina_ssh_tunnel_add_channel(RemminaSSHTunnel *tunnel, ssh_channel channel, gi
 						    sizeof(gint) * tunnel->num_channels);
 		tunnel->socketbuffers = (RemminaSSHTunnelBuffer **)g_realloc(tunnel->socketbuffers,
 									     sizeof(RemminaSSHTunnelBuffer *) * tunnel->num_channels);
+		tunnel->channelstates = (RemminaSSHTunnelChannelState *)g_realloc(tunnel->channelstates,
+										  sizeof(RemminaSSHTunnelChannelState) * tunnel->num_channels);
 		tunnel->max_channels = tunnel->num_channels;
 
-		tunnel->channels_out = (ssh_channel *)g_realloc(tunnel->channels_out,
-								sizeof(ssh_channel) * (tunnel->num_channels + 1));
+		/* The SSH session, the listening socket and the local sockets */
+		tunnel->pollfds = (struct pollfd *)g_realloc(tunnel->pollfds,
+							     sizeof(struct pollfd) * (tunnel->num_channels + 2));
 	}
 	tunnel->channels[i] = channel;
 	tunnel->channels[i + 1] = NULL;
 	tunnel->sockets[i] = sock;
 	tunnel->socketbuffers[i] = NULL;
+	memset(&tunnel->channelstates[i], 0, sizeof(RemminaSSHTunnelChannelState));
 
 	flags = fcntl(sock, F_GETFL, 0);
 	fcntl(sock, F_SETFL, flags | O_NONBLOCK);
@@ -1750,29 +1854,208 @@ remmina_ssh_tunnel_create_forward_channel(RemminaSSHTunnel *tunnel)
 	return channel;
 }
 
+/* Forward the data available on the local socket n to its SSH channel,
+ * within the channel quota and the SSH window: ssh_channel_write() would
+ * otherwise block the whole tunnel until the server grows the window.
+ * Returns FALSE when the connection has to be closed */
+static gboolean
+remmina_ssh_tunnel_forward_local(RemminaSSHTunnel *tunnel, gint n)
+{
+	RemminaSSHTunnelChannelState *state = &tunnel->channelstates[n];
+	gchar *ptr;
+	ssize_t len, lenr, lenw;
+	guint32 window;
+
+	while (state->deficit_local > 0) {
+		window = ssh_channel_window_size(tunnel->channels[n]);
+		if (window == 0)
+			/* The data stays in the socket until the window opens */
+			return TRUE;
+		len = MIN((ssize_t)tunnel->buffer_len, MIN(state->deficit_local, (ssize_t)window));
+		lenr = read(tunnel->sockets[n], tunnel->buffer, len);
+		if (lenr == 0 || (lenr < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+			// TRANSLATORS: The placeholder %s is an error message
+			remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not read from tunnel listening socket. %s"));
+			return FALSE;
+		}
+		if (lenr < 0) {
+			/* Nothing left to send, an idle channel keeps no credit */
+			state->deficit_local = 0;
+			return TRUE;
+		}
+		for (ptr = tunnel->buffer, len = lenr; len > 0; len -= lenw, ptr += lenw) {
+			lenw = ssh_channel_write(tunnel->channels[n], (char *)ptr, len);
+			if (lenw <= 0) {
+				// TRANSLATORS: The placeholder %s is an error message
+				remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not write to SSH channel. %s"));
+				return FALSE;
+			}
+		}
+		state->deficit_local -= lenr;
+		remmina_ssh_tunnel_buffer_adapt(tunnel, lenr);
+	}
+	return TRUE;
+}
+
+/* Write the buffers queued for the local socket n, with a single writev()
+ * for up to REMMINA_SSH_TUNNEL_IOV_MAX buffers.
+ * Returns FALSE when the connection has to be closed */
+static gboolean
+remmina_ssh_tunnel_flush_local(RemminaSSHTunnel *tunnel, gint n)
+{
+	struct iovec iov[REMMINA_SSH_TUNNEL_IOV_MAX];
+	RemminaSSHTunnelBuffer *buffer;
+	ssize_t lenw;
+	gint iovcnt;
+
+	while (tunnel->socketbuffers[n]) {
+		iovcnt = 0;
+		for (buffer = tunnel->socketbuffers[n]; buffer && iovcnt < REMMINA_SSH_TUNNEL_IOV_MAX; buffer = buffer->next) {
+			iov[iovcnt].iov_base = buffer->ptr;
+			iov[iovcnt].iov_len = buffer->len;
+			iovcnt++;
+		}
+		lenw = writev(tunnel->sockets[n], iov, iovcnt);
+		if (lenw < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			/* The socket buffer is full, wait until poll() tells it is writable */
+			if (!tunnel->channelstates[n].blocked) {
+				tunnel->channelstates[n].blocked = TRUE;
+				REMMINA_DEBUG("SSH tunnel channel %d blocked, %" G_GSIZE_FORMAT " bytes queued for the local socket",
+					      n, tunnel->channelstates[n].queued);
+			}
+			return TRUE;
+		}
+		if (lenw <= 0) {
+			// TRANSLATORS: The placeholder %s is an error message
+			remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not send data to tunnel listening socket. %s"));
+			return FALSE;
+		}
+		/* Release the buffers which have been written */
+		tunnel->channelstates[n].queued -= lenw;
+		while (lenw > 0) {
+			buffer = tunnel->socketbuffers[n];
+			if (lenw < buffer->len) {
+				buffer->ptr += lenw;
+				buffer->len -= lenw;
+				break;
+			}
+			lenw -= buffer->len;
+			tunnel->socketbuffers[n] = buffer->next;
+			remmina_ssh_tunnel_buffer_put(tunnel, buffer);
+		}
+	}
+	tunnel->channelstates[n].blocked = FALSE;
+	return TRUE;
+}
+
+/* Read the data available on SSH channel n, within the channel quota, and
+ * write it to its local socket. Nothing more is read from the channel while
+ * the socket cannot accept it, so the SSH window closes and the server
+ * slows down that channel only.
+ * Returns FALSE when the connection has to be closed */
+static gboolean
+remmina_ssh_tunnel_forward_remote(RemminaSSHTunnel *tunnel, gint n)
+{
+	RemminaSSHTunnelChannelState *state = &tunnel->channelstates[n];
+	RemminaSSHTunnelBuffer *buffer, **tail;
+	gboolean eof = FALSE;
+	gint queued;
+	int len;
+
+	while (remmina_ssh_tunnel_flush_local(tunnel, n)) {
+		if (tunnel->socketbuffers[n])
+			return TRUE;
+		if (eof)
+			return FALSE;
+
+		if (state->deficit_remote <= 0)
+			/* Quota used, the rest waits for the next round */
+			return TRUE;
+
+		tail = &tunnel->socketbuffers[n];
+		for (queued = 0; queued < REMMINA_SSH_TUNNEL_IOV_MAX && state->deficit_remote > 0; queued++) {
+			len = ssh_channel_poll(tunnel->channels[n], 0);
+			if (len == SSH_ERROR || len == SSH_EOF) {
+				// TRANSLATORS: The placeholder %s is an error message
+				remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not poll SSH channel. %s"));
+				/* Still deliver what has been queued */
+				eof = TRUE;
+				break;
+			}
+			if (len == 0) {
+				/* Nothing left to read, an idle channel keeps no credit */
+				state->deficit_remote = 0;
+				break;
+			}
+			buffer = remmina_ssh_tunnel_buffer_get(tunnel);
+			len = ssh_channel_read_nonblocking(tunnel->channels[n], buffer->data,
+							   MIN(len, MIN(buffer->size, state->deficit_remote)), 0);
+			if (len <= 0) {
+				remmina_ssh_tunnel_buffer_put(tunnel, buffer);
+				// TRANSLATORS: The placeholder %s is an error message
+				remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not read SSH channel in a non-blocking way. %s"));
+				return FALSE;
+			}
+			buffer->len = len;
+			*tail = buffer;
+			tail = &buffer->next;
+			state->queued += len;
+			state->deficit_remote -= len;
+			remmina_ssh_tunnel_buffer_adapt(tunnel, len);
+		}
+		if (queued == 0 && !eof)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* TRUE when libssh already holds data for a channel which can take it:
+ * the SSH socket may have been drained while serving another channel,
+ * so poll() would not wake up for it */
+static gboolean
+remmina_ssh_tunnel_remote_pending(RemminaSSHTunnel *tunnel)
+{
+	gint i;
+
+	for (i = 0; i < tunnel->num_channels; i++)
+		if (!tunnel->socketbuffers[i] && ssh_channel_poll(tunnel->channels[i], 0) != 0)
+			return TRUE;
+	return FALSE;
+}
+
+/* TRUE when every channel still has data queued for its local socket:
+ * the SSH session is not read until one of them drains */
+static gboolean
+remmina_ssh_tunnel_backed_up(RemminaSSHTunnel *tunnel)
+{
+	gint i;
+
+	for (i = 0; i < tunnel->num_channels; i++)
+		if (!tunnel->socketbuffers[i])
+			return FALSE;
+	return TRUE;
+}
+
 static gpointer
 remmina_ssh_tunnel_main_thread_proc(gpointer data)
 {
 	TRACE_CALL(__func__);
 	RemminaSSHTunnel *tunnel = (RemminaSSHTunnel *)data;
-	gchar *ptr;
-	ssize_t len = 0, lenw = 0;
-	fd_set set;
-	struct timeval timeout;
-	g_autoptr(GDateTime) t1 = NULL;
-	g_autoptr(GDateTime) t2 = NULL;
-	GTimeSpan diff;                                                 // microseconds
+	RemminaSSHTunnelChannelState *state;
+	struct pollfd *pfd;
 	ssh_channel channel = NULL;
 	gboolean first = TRUE;
-	gboolean disconnected;
+	gboolean accept_pending = FALSE;
+	gboolean remote_pending = FALSE;
 	gint sock;
-	gint maxfd;
+	gint nfds, listen_idx, socks_idx;
+	gint timeout;
 	gint i;
 	gint ret;
+	short revents;
+	guint32 window;
 	struct sockaddr_in sin;
 
-	t1 = t2 = g_date_time_new_now_local();
-
 	switch (tunnel->tunnel_type) {
 	case REMMINA_SSH_TUNNEL_OPEN:
 		sock = remmina_ssh_tunnel_accept_local_connection(tunnel, TRUE);
@@ -1862,8 +2145,10 @@ remmina_ssh_tunnel_main_thread_proc(gpointer data)
 		break;
 	}
 
-	tunnel->buffer_len = 10240;
-	tunnel->buffer = g_malloc(tunnel->buffer_len);
+	if (!tunnel->buffer) {
+		tunnel->buffer_len = REMMINA_SSH_TUNNEL_BUFFER_MIN;
+		tunnel->buffer = g_malloc(tunnel->buffer_len);
+	}
 
 	/* Start the tunnel data transmission */
 	while (tunnel->running) {
@@ -1889,20 +2174,11 @@ remmina_ssh_tunnel_main_thread_proc(gpointer data)
 					ssh_forward_cancel(REMMINA_SSH(tunnel)->session, NULL, tunnel->port);
 #endif
 				}
-			} else if (tunnel->tunnel_type != REMMINA_SSH_TUNNEL_REVERSE) {
-				/* Poll once per some period of time if no incoming connections.
-				 * Don’t try to poll continuously as it will significantly slow down the loop */
-				t1 = g_date_time_new_now_local();
-				diff = g_date_time_difference(t1, t2) * 10000000
-				       + g_date_time_difference(t1, t2) / 100000;
-				if (diff > 1) {
-					REMMINA_DEBUG("Polling tunnel channels");
-						channel = ssh_channel_accept_forward(REMMINA_SSH(tunnel)->session, 0, &tunnel->port);
-					if (channel == NULL)
-						t2 = t1;
-				}
-				g_date_time_unref(t1);
-				g_date_time_unref(t2);
+			} else if (tunnel->tunnel_type != REMMINA_SSH_TUNNEL_REVERSE && accept_pending) {
+				/* Only look for incoming connections when the SSH session had
+				 * some traffic or the poll() below timed out */
+				accept_pending = FALSE;
+				channel = ssh_channel_accept_forward(REMMINA_SSH(tunnel)->session, 0, &tunnel->port);
 			}
 
 			if (channel) {
@@ -1935,120 +2211,106 @@ remmina_ssh_tunnel_main_thread_proc(gpointer data)
 			/* No more connections. We should quit */
 			break;
 
-		timeout.tv_sec = 0;
-		timeout.tv_usec = 200000;
-
-		FD_ZERO(&set);
-		maxfd = 0;
+		/* Wait for the SSH session, a new local connection, or the local
+		 * sockets. No timeout is needed, except for X11 forwarding where new
+		 * channels are accepted from the SSH session */
+		pfd = tunnel->pollfds;
+		nfds = 0;
+		pfd[nfds].fd = ssh_get_fd(REMMINA_SSH(tunnel)->session);
+		pfd[nfds].events = POLLIN;
+		/* Nothing would read it, POLLOUT of the local sockets resumes us */
+		if (remmina_ssh_tunnel_backed_up(tunnel))
+			pfd[nfds].fd = -1;
+		nfds++;
+		listen_idx = -1;
+		if (tunnel->tunnel_type == REMMINA_SSH_TUNNEL_OPEN && tunnel->server_sock >= 0) {
+			listen_idx = nfds;
+			pfd[nfds].fd = tunnel->server_sock;
+			pfd[nfds].events = POLLIN;
+			nfds++;
+		}
+		socks_idx = nfds;
 		for (i = 0; i < tunnel->num_channels; i++) {
-			if (tunnel->sockets[i] > maxfd)
-				maxfd = tunnel->sockets[i];
-			FD_SET(tunnel->sockets[i], &set);
+			window = ssh_channel_window_size(tunnel->channels[i]);
+			/* Read the socket only when the SSH window can take the data,
+			 * wait for POLLOUT only while there is data queued for it */
+			pfd[nfds].fd = tunnel->sockets[i];
+			pfd[nfds].events = (window > 0 ? POLLIN : 0) | (tunnel->socketbuffers[i] ? POLLOUT : 0);
+			/* POLLHUP is reported whatever the events: leave a hung up
+			 * socket out until the window opens and it can be drained */
+			if (tunnel->channelstates[i].hup && pfd[nfds].events == 0)
+				pfd[nfds].fd = -1;
+			nfds++;
 		}
 
-		ret = ssh_select(tunnel->channels, tunnel->channels_out, maxfd + 1, &set, &timeout);
+		if (remote_pending)
+			timeout = 0;
+		else if (tunnel->tunnel_type == REMMINA_SSH_TUNNEL_XPORT)
+			timeout = 1000;
+		else
+			timeout = -1;
+
+		ret = poll(pfd, nfds, timeout);
 		if (!tunnel->running) break;
-		if (ret == SSH_EINTR) continue;
-		if (ret == -1) break;
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		accept_pending = (ret == 0 || (pfd[0].revents & POLLIN));
 
-		i = 0;
-		while (tunnel->running && i < tunnel->num_channels) {
-			disconnected = FALSE;
-			if (FD_ISSET(tunnel->sockets[i], &set)) {
-				while (!disconnected &&
-				       (len = read(tunnel->sockets[i], tunnel->buffer, tunnel->buffer_len)) > 0) {
-					for (ptr = tunnel->buffer, lenw = 0; len > 0; len -= lenw, ptr += lenw) {
-						lenw = ssh_channel_write(tunnel->channels[i], (char *)ptr, len);
-						if (lenw <= 0) {
-							disconnected = TRUE;
-							// TRANSLATORS: The placeholder %s is an error message
-							remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not write to SSH channel. %s"));
-							break;
-						}
-					}
-				}
-				if (len == 0) {
-					// TRANSLATORS: The placeholder %s is an error message
-					remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not read from tunnel listening socket. %s"));
-					disconnected = TRUE;
-				}
+		/* A new round: every channel gets its quota, unused credit is kept
+		 * for one more round only */
+		for (i = 0; i < tunnel->num_channels; i++) {
+			state = &tunnel->channelstates[i];
+			state->deficit_local = MIN(state->deficit_local + REMMINA_SSH_TUNNEL_QUANTUM, 2 * REMMINA_SSH_TUNNEL_QUANTUM);
+			state->deficit_remote = MIN(state->deficit_remote + REMMINA_SSH_TUNNEL_QUANTUM, 2 * REMMINA_SSH_TUNNEL_QUANTUM);
+		}
+
+		/* Walk the channels backwards: a removed channel is replaced by
+		 * the last one, which has already been served */
+		for (i = tunnel->num_channels - 1; tunnel->running && i >= 0; i--) {
+			revents = pfd[socks_idx + i].revents;
+			if (revents & POLLERR) {
+				REMMINA_DEBUG("tunnel disconnected because of an error on local socket %d", tunnel->sockets[i]);
+				remmina_ssh_tunnel_remove_channel(tunnel, i);
+				continue;
 			}
-			if (disconnected) {
+			if (revents & POLLHUP)
+				tunnel->channelstates[i].hup = TRUE;
+			if ((revents & (POLLIN | POLLHUP))
+			    && !remmina_ssh_tunnel_forward_local(tunnel, i)) {
 				REMMINA_DEBUG("tunnel disconnected because %s", REMMINA_SSH(tunnel)->error);
 				remmina_ssh_tunnel_remove_channel(tunnel, i);
 				continue;
 			}
-			i++;
-		}
-		if (!tunnel->running) break;
-
-		i = 0;
-		while (tunnel->running && i < tunnel->num_channels) {
-			disconnected = FALSE;
-			if (!tunnel->socketbuffers[i]) {
-				len = ssh_channel_poll(tunnel->channels[i], 0);
-				if (len == SSH_ERROR || len == SSH_EOF) {
-					// TRANSLATORS: The placeholder %s is an error message
-					remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not poll SSH channel. %s"));
-					disconnected = TRUE;
-				} else if (len > 0) {
-					tunnel->socketbuffers[i] = remmina_ssh_tunnel_buffer_new(len);
-					len = ssh_channel_read_nonblocking(tunnel->channels[i], tunnel->socketbuffers[i]->data, len, 0);
-					if (len <= 0) {
-						// TRANSLATORS: The placeholder %s is an error message
-						remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not read SSH channel in a non-blocking way. %s"));
-						disconnected = TRUE;
-					} else {
-						tunnel->socketbuffers[i]->len = len;
-					}
-				}
-			}
-
-			if (!disconnected && tunnel->socketbuffers[i]) {
-				for (lenw = 0; tunnel->socketbuffers[i]->len > 0;
-				     tunnel->socketbuffers[i]->len -= lenw, tunnel->socketbuffers[i]->ptr += lenw) {
-					lenw = write(tunnel->sockets[i], tunnel->socketbuffers[i]->ptr, tunnel->socketbuffers[i]->len);
-					if (lenw == -1 && errno == EAGAIN && tunnel->running)
-						/* Sometimes we cannot write to a socket (always EAGAIN), probably because it’s internal
-						 * buffer is full. We need read the pending bytes from the socket first. so here we simply
-						 * break, leave the buffer there, and continue with other data */
-						break;
-					if (lenw <= 0) {
-						// TRANSLATORS: The placeholder %s is an error message
-						remmina_ssh_set_error(REMMINA_SSH(tunnel), _("Could not send data to tunnel listening socket. %s"));
-						disconnected = TRUE;
-						break;
-					}
-				}
-				if (tunnel->socketbuffers[i]->len <= 0) {
-					remmina_ssh_tunnel_buffer_free(tunnel->socketbuffers[i]);
-					tunnel->socketbuffers[i] = NULL;
-				}
-			}
-
-			if (disconnected) {
+			if (!remmina_ssh_tunnel_forward_remote(tunnel, i)) {
 				REMMINA_DEBUG("Connection to SSH tunnel dropped. %s", REMMINA_SSH(tunnel)->error);
 				remmina_ssh_tunnel_remove_channel(tunnel, i);
-				continue;
 			}
-			i++;
 		}
+		if (!tunnel->running) break;
+
 		/**
 		 * Some protocols may open new connections during the session.
 		 * e.g: SPICE opens a new connection for some channels.
 		 */
-		sock = remmina_ssh_tunnel_accept_local_connection(tunnel, FALSE);
-		if (sock > 0) {
-			channel = remmina_ssh_tunnel_create_forward_channel(tunnel);
-			if (!channel) {
-				REMMINA_DEBUG("Could not open new SSH connection. %s", REMMINA_SSH(tunnel)->error);
-				close(sock);
-				/* Leave thread loop */
-				tunnel->running = FALSE;
-			} else {
-				remmina_ssh_tunnel_add_channel(tunnel, channel, sock);
+		if (listen_idx >= 0 && (pfd[listen_idx].revents & POLLIN)) {
+			sock = remmina_ssh_tunnel_accept_local_connection(tunnel, FALSE);
+			if (sock > 0) {
+				channel = remmina_ssh_tunnel_create_forward_channel(tunnel);
+				if (!channel) {
+					REMMINA_DEBUG("Could not open new SSH connection. %s", REMMINA_SSH(tunnel)->error);
+					close(sock);
+					/* Leave thread loop */
+					tunnel->running = FALSE;
+				} else {
+					remmina_ssh_tunnel_add_channel(tunnel, channel, sock);
+				}
+				channel = NULL;
 			}
 		}
+
+		remote_pending = remmina_ssh_tunnel_remote_pending(tunnel);
 	}
 
 	remmina_ssh_tunnel_close_all_channels(tunnel);
@@ -2116,6 +2378,7 @@ remmina_ssh_tunnel_open(RemminaSSHTunnel *tunnel, const gchar *host, gint port,
 	tunnel->tunnel_type = REMMINA_SSH_TUNNEL_OPEN;
 	tunnel->dest = g_strdup(host);
 	tunnel->port = port;
+	tunnel->localport = local_port;
 	if (tunnel->port == 0) {
 		REMMINA_SSH(tunnel)->error = g_strdup(_("Assign a destination port."));
 		return FALSE;
@@ -2230,7 +2493,8 @@ remmina_ssh_tunnel_free(RemminaSSHTunnel *tunnel)
 	remmina_ssh_tunnel_close_all_channels(tunnel);
 
 	g_free(tunnel->buffer);
-	g_free(tunnel->channels_out);
+	remmina_ssh_tunnel_buffer_free(tunnel->buffer_pool);
+	g_free(tunnel->pollfds);
 	g_free(tunnel->dest);
 	g_free(tunnel->localdisplay);
 
@@ -2346,6 +2610,208 @@ remmina_ssh_call_exit_callback_on_main_thread(gpointer data)
 	return FALSE;
 }
 
+/* Bytes moved per read. The buffer grows while the server keeps filling it */
+#define REMMINA_SSH_SHELL_BUFFER_MIN (16 * 1024)
+#define REMMINA_SSH_SHELL_BUFFER_MAX (256 * 1024)
+
+/* While the channel window is closed, the window adjust of the server does
+ * not wake ssh_select(): poll it, backing off from the min to the max, in µs */
+#define REMMINA_SSH_SHELL_WINDOW_POLL_MIN 10000
+#define REMMINA_SSH_SHELL_WINDOW_POLL_MAX 250000
+
+/* The session log is written at most once per interval, unless this much is pending */
+#define REMMINA_SSH_LOG_FLUSH_INTERVAL G_TIME_SPAN_SECOND
+#define REMMINA_SSH_LOG_FLUSH_SIZE (64 * 1024)
+/* Beyond this the output is not logged, rather than slowing down the terminal */
+#define REMMINA_SSH_LOG_PENDING_MAX (16 * 1024 * 1024)
+
+/* Session log written by its own thread, so that the shell thread never
+ * waits for the disk. A log filename ending in .gz is gzip compressed. */
+typedef struct _RemminaSSHSessionLog {
+	GOutputStream * stream;
+	GThread *	thread;
+	GMutex		mutex;
+	GCond		cond;
+	GByteArray *	pending;
+	gsize		dropped;
+	gboolean	closing;
+} RemminaSSHSessionLog;
+
+static gpointer
+remmina_ssh_session_log_thread(gpointer data)
+{
+	TRACE_CALL(__func__);
+	RemminaSSHSessionLog *log = (RemminaSSHSessionLog *)data;
+	GByteArray *chunk, *tmp;
+	GError *error = NULL;
+	gboolean closing;
+	gboolean failed = FALSE;
+	gint64 deadline;
+	gsize dropped;
+	gchar *note;
+
+	chunk = g_byte_array_sized_new(REMMINA_SSH_LOG_FLUSH_SIZE);
+
+	g_mutex_lock(&log->mutex);
+	while (TRUE) {
+		while (!log->closing && log->pending->len == 0)
+			g_cond_wait(&log->cond, &log->mutex);
+		/* Let the output accumulate, to write it in large chunks */
+		deadline = g_get_monotonic_time() + REMMINA_SSH_LOG_FLUSH_INTERVAL;
+		while (!log->closing && log->pending->len < REMMINA_SSH_LOG_FLUSH_SIZE)
+			if (!g_cond_wait_until(&log->cond, &log->mutex, deadline))
+				break;
+
+		tmp = log->pending;
+		log->pending = chunk;
+		chunk = tmp;
+		dropped = log->dropped;
+		log->dropped = 0;
+		closing = log->closing;
+		g_mutex_unlock(&log->mutex);
+
+		if (!failed && chunk->len > 0)
+			failed = !g_output_stream_write_all(log->stream, chunk->data, chunk->len, NULL, NULL, &error);
+		if (!failed && dropped > 0) {
+			note = g_strdup_printf("\r\n[%" G_GSIZE_FORMAT " bytes not logged]\r\n", dropped);
+			failed = !g_output_stream_write_all(log->stream, note, strlen(note), NULL, NULL, &error);
+			g_free(note);
+		}
+		if (error) {
+			REMMINA_WARNING("Could not write the SSH session log: %s", error->message);
+			g_clear_error(&error);
+		}
+		g_byte_array_set_size(chunk, 0);
+
+		if (closing)
+			break;
+		g_mutex_lock(&log->mutex);
+	}
+
+	if (!g_output_stream_close(log->stream, NULL, &error)) {
+		REMMINA_WARNING("Could not close the SSH session log: %s", error->message);
+		g_error_free(error);
+	}
+	g_byte_array_unref(chunk);
+	return NULL;
+}
+
+static RemminaSSHSessionLog *
+remmina_ssh_session_log_open(const gchar *filename)
+{
+	TRACE_CALL(__func__);
+	RemminaSSHSessionLog *log;
+	GFileOutputStream *fstream;
+	GConverter *compressor;
+	GOutputStream *stream;
+	GError *error = NULL;
+	GFile *file;
+
+	file = g_file_new_for_path(filename);
+	fstream = g_file_replace(file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error);
+	g_object_unref(file);
+	if (!fstream) {
+		REMMINA_WARNING("Could not open the SSH session log %s: %s", filename, error->message);
+		g_error_free(error);
+		return NULL;
+	}
+
+	if (g_str_has_suffix(filename, ".gz")) {
+		compressor = G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1));
+		stream = g_converter_output_stream_new(G_OUTPUT_STREAM(fstream), compressor);
+		g_object_unref(compressor);
+		g_object_unref(fstream);
+	} else {
+		stream = G_OUTPUT_STREAM(fstream);
+	}
+
+	log = g_new0(RemminaSSHSessionLog, 1);
+	log->stream = stream;
+	log->pending = g_byte_array_sized_new(REMMINA_SSH_LOG_FLUSH_SIZE);
+	g_mutex_init(&log->mutex);
+	g_cond_init(&log->cond);
+	log->thread = g_thread_new("remmina-ssh-log", remmina_ssh_session_log_thread, log);
+
+	return log;
+}
+
+static void
+remmina_ssh_session_log_append(RemminaSSHSessionLog *log, const gchar *buf, gint len)
+{
+	TRACE_CALL(__func__);
+	guint pending;
+
+	g_mutex_lock(&log->mutex);
+	pending = log->pending->len;
+	if (pending + len > REMMINA_SSH_LOG_PENDING_MAX) {
+		log->dropped += len;
+	} else {
+		g_byte_array_append(log->pending, (const guint8 *)buf, len);
+		/* Wake up the writer when it has something to wait for, or enough to write */
+		if (pending == 0 || (pending < REMMINA_SSH_LOG_FLUSH_SIZE && log->pending->len >= REMMINA_SSH_LOG_FLUSH_SIZE))
+			g_cond_signal(&log->cond);
+	}
+	g_mutex_unlock(&log->mutex);
+}
+
+/* Write what is pending and free the log */
+static void
+remmina_ssh_session_log_close(RemminaSSHSessionLog *log)
+{
+	TRACE_CALL(__func__);
+	g_mutex_lock(&log->mutex);
+	log->closing = TRUE;
+	g_cond_signal(&log->cond);
+	g_mutex_unlock(&log->mutex);
+
+	g_thread_join(log->thread);
+
+	g_object_unref(log->stream);
+	g_byte_array_unref(log->pending);
+	g_mutex_clear(&log->mutex);
+	g_cond_clear(&log->cond);
+	g_free(log);
+}
+
+static RemminaSSHSessionLog *
+remmina_ssh_shell_open_session_log(RemminaFile *remminafile)
+{
+	TRACE_CALL(__func__);
+	RemminaSSHSessionLog *log;
+	const gchar *setting;
+	gchar *dir;
+	gchar *basename;
+	gchar *sshlogname;
+	gchar *filename;
+
+	setting = remmina_file_get_string(remminafile, "sshlogfolder");
+	if (setting == NULL)
+		dir = g_build_path("/", g_get_user_cache_dir(), "remmina", NULL);
+	else
+		dir = g_strdup(setting);
+
+	setting = remmina_file_get_string(remminafile, "sshlogname");
+	if (setting == NULL) {
+		basename = g_path_get_basename(remminafile->filename);
+		sshlogname = g_strconcat(basename, ".", "log", NULL);
+		g_free(basename);
+	} else {
+		sshlogname = g_strdup(setting);
+	}
+	setting = sshlogname;
+	sshlogname = remmina_file_format_properties(remminafile, setting);
+	g_free((gchar *)setting);
+	filename = g_strconcat(dir, "/", sshlogname, NULL);
+
+	REMMINA_DEBUG("Saving session log to %s", filename);
+	log = remmina_ssh_session_log_open(filename);
+
+	g_free(filename);
+	g_free(sshlogname);
+	g_free(dir);
+	return log;
+}
+
 static gpointer
 remmina_ssh_shell_thread(gpointer data)
 {
@@ -2358,14 +2824,14 @@ remmina_ssh_shell_thread(gpointer data)
 	struct timeval timeout;
 	ssh_channel channel = NULL;
 	ssh_channel ch[2], chout[2];
+	RemminaSSHSessionLog *log = NULL;
 	gchar *buf = NULL;
+	gchar *p;
 	gint buf_len;
 	gint len;
 	gint i, ret;
-	const gchar *filename;
-	const gchar *dir;
-	const gchar *sshlogname;
-	FILE *fp;
+	guint32 window;
+	glong window_poll = 0;
 
 	//gint screen;
 
@@ -2402,43 +2868,43 @@ remmina_ssh_shell_thread(gpointer data)
 
 	UNLOCK_SSH(shell)
 
-	buf_len = 1000;
-	buf = g_malloc(buf_len + 1);
+	buf_len = REMMINA_SSH_SHELL_BUFFER_MIN;
+	buf = g_malloc(buf_len);
 
 	ch[0] = channel;
 	ch[1] = NULL;
 
-	GFile *rf = g_file_new_for_path(remminafile->filename);
-
-	if (remmina_file_get_string(remminafile, "sshlogfolder") == NULL)
-		dir = g_build_path("/", g_get_user_cache_dir(), "remmina", NULL);
-	else
-		dir = remmina_file_get_string(remminafile, "sshlogfolder");
-
-	if (remmina_file_get_string(remminafile, "sshlogname") == NULL)
-		sshlogname = g_strconcat(g_file_get_basename(rf), ".", "log", NULL);
-	else
-		sshlogname = remmina_file_get_string(remminafile, "sshlogname");
-	sshlogname = remmina_file_format_properties(remminafile, sshlogname);
-	filename = g_strconcat(dir, "/", sshlogname, NULL);
+	/* Resolved once, the profile is not read again while the shell runs */
+	if (remmina_file_get_int(remminafile, "sshsavesession", FALSE))
+		log = remmina_ssh_shell_open_session_log(remminafile);
 
-	if (remmina_file_get_int (remminafile, "sshsavesession", FALSE)) {
-		REMMINA_DEBUG("Saving session log to %s", filename);
-		fp = fopen(filename, "w");
-	}
 	while (!shell->closed) {
-		timeout.tv_sec = 1;
-		timeout.tv_usec = 0;
+		/* Leave pasted input in the PTY while the server does not accept more */
+		LOCK_SSH(shell)
+		window = ssh_channel_window_size(channel);
+		UNLOCK_SSH(shell)
+
+		if (window > 0) {
+			window_poll = 0;
+			timeout.tv_sec = 1;
+			timeout.tv_usec = 0;
+		} else {
+			/* Server output still wakes us up at once */
+			window_poll = window_poll ? MIN(window_poll * 2, REMMINA_SSH_SHELL_WINDOW_POLL_MAX) : REMMINA_SSH_SHELL_WINDOW_POLL_MIN;
+			timeout.tv_sec = 0;
+			timeout.tv_usec = window_poll;
+		}
 
 		FD_ZERO(&fds);
-		FD_SET(shell->slave, &fds);
+		if (window > 0)
+			FD_SET(shell->slave, &fds);
 
 		ret = ssh_select(ch, chout, shell->slave + 1, &fds, &timeout);
 		if (ret == SSH_EINTR) continue;
 		if (ret == -1) break;
 
-		if (FD_ISSET(shell->slave, &fds)) {
-			len = read(shell->slave, buf, buf_len);
+		if (window > 0 && FD_ISSET(shell->slave, &fds)) {
+			len = read(shell->slave, buf, MIN((guint32)buf_len, window));
 			if (len <= 0) break;
 			LOCK_SSH(shell)
 			ssh_channel_write(channel, buf, len);
@@ -2454,38 +2920,40 @@ remmina_ssh_shell_thread(gpointer data)
 				break;
 			}
 			if (len <= 0) continue;
-			if (len > buf_len) {
-				buf_len = len;
-				buf = (gchar *)g_realloc(buf, buf_len + 1);
+			if (len > buf_len && buf_len < REMMINA_SSH_SHELL_BUFFER_MAX) {
+				buf_len = MIN(MAX(buf_len * 2, len), REMMINA_SSH_SHELL_BUFFER_MAX);
+				g_free(buf);
+				buf = g_malloc(buf_len);
 			}
 			LOCK_SSH(shell)
-			len = ssh_channel_read_nonblocking(channel, buf, len, i);
+			len = ssh_channel_read_nonblocking(channel, buf, MIN(len, buf_len), i);
 			UNLOCK_SSH(shell)
 			if (len <= 0) {
 				shell->closed = TRUE;
 				break;
 			}
+			if (log)
+				remmina_ssh_session_log_append(log, buf, len);
+			p = buf;
 			while (len > 0) {
-				ret = write(shell->slave, buf, len);
-				if (remmina_file_get_int (remminafile, "sshsavesession", FALSE)) {
-					fwrite(buf, ret, 1, fp );
-					fflush(fp);
-				}
+				ret = write(shell->slave, p, len);
+				if (ret < 0 && errno == EINTR) continue;
 				if (ret <= 0) break;
+				p += ret;
 				len -= ret;
 			}
 		}
 	}
 
 	LOCK_SSH(shell)
-	if (remmina_file_get_int (remminafile, "sshsavesession", FALSE))
-	fclose(fp);
 	shell->channel = NULL;
 	ssh_channel_close(channel);
 	ssh_channel_send_eof(channel);
 	ssh_channel_free(channel);
 	UNLOCK_SSH(shell)
 
+	if (log)
+		remmina_ssh_session_log_close(log);
 	g_free(buf);
 	shell->thread = 0;
 
@@ -2494,7 +2962,6 @@ remmina_ssh_shell_thread(gpointer data)
 	return NULL;
 }
 
-
 gboolean
 remmina_ssh_shell_open(RemminaSSHShell *shell, RemminaSSHExitFunc exit_callback, gpointer data)
 {
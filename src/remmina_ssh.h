@@ -45,6 +45,7 @@
 #include <libssh/callbacks.h>
 #include <libssh/sftp.h>
 #include <pthread.h>
+#include <poll.h>
 #include "remmina_file.h"
 #include "rcw.h"
 
@@ -134,6 +135,7 @@ void remmina_ssh_free(RemminaSSH *ssh);
 *-----------------------------------------------------------------------------*/
 typedef struct _RemminaSSHTunnel RemminaSSHTunnel;
 typedef struct _RemminaSSHTunnelBuffer RemminaSSHTunnelBuffer;
+typedef struct _RemminaSSHTunnelChannelState RemminaSSHTunnelChannelState;
 
 typedef gboolean (*RemminaSSHTunnelCallback) (RemminaSSHTunnel *, gpointer);
 
@@ -152,15 +154,21 @@ struct _RemminaSSHTunnel {
 	ssh_channel *			channels;
 	gint *				sockets;
 	RemminaSSHTunnelBuffer **	socketbuffers;
+	RemminaSSHTunnelChannelState *	channelstates;
 	gint				num_channels;
 	gint				max_channels;
 
 	pthread_t			thread;
 	gboolean			running;
 
+	/* Read buffer and pool of free buffers, all sized buffer_len,
+	 * which adapts to the throughput of the tunnel */
 	gchar *				buffer;
 	gint				buffer_len;
-	ssh_channel *			channels_out;
+	RemminaSSHTunnelBuffer *	buffer_pool;
+	gint				buffer_pool_len;
+	gint				buffer_small_reads;
+	struct pollfd *			pollfds;
 
 	gint				server_sock;
 	gchar *				dest;
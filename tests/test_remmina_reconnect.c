@@ -0,0 +1,203 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+/* Checks the reconnection backoff and how waits react to interruptions
+ * and to network changes, which are injected without a GNetworkMonitor */
+
+#include <gio/gio.h>
+#include "remmina_reconnect.h"
+
+/* remmina_log.c is not linked in */
+gint remmina_log_levels = 0;
+
+void _remmina_debug(const gchar *fun, const gchar *fmt, ...)
+{
+}
+
+typedef struct {
+	guint		attempt;
+	gint		interrupt;
+	gboolean	ret;
+	gint		done;
+	gint64		elapsed;
+	GThread *	thread;
+} Waiter;
+
+static gpointer waiter_thread(gpointer data)
+{
+	Waiter *w = data;
+	gint64 start = g_get_monotonic_time();
+
+	w->ret = remmina_reconnect_wait(w->attempt, &w->interrupt);
+	w->elapsed = (g_get_monotonic_time() - start) / G_TIME_SPAN_MILLISECOND;
+	g_atomic_int_set(&w->done, TRUE);
+	return NULL;
+}
+
+static void waiter_start(Waiter *w, guint attempt)
+{
+	w->attempt = attempt;
+	w->interrupt = FALSE;
+	w->done = FALSE;
+	w->thread = g_thread_new("waiter", waiter_thread, w);
+}
+
+static void waiter_join(Waiter *w)
+{
+	g_thread_join(w->thread);
+	w->thread = NULL;
+}
+
+static void test_delay(void)
+{
+	guint attempt, delay, cap, lowest, highest;
+	gint i;
+
+	for (attempt = 0; attempt < 40; attempt++) {
+		cap = MIN((guint64)REMMINA_RECONNECT_DELAY_MIN << MIN(attempt, 16), REMMINA_RECONNECT_DELAY_MAX);
+		lowest = G_MAXUINT;
+		highest = 0;
+		for (i = 0; i < 200; i++) {
+			delay = remmina_reconnect_delay(attempt);
+			g_assert_cmpuint(delay, >=, cap / 2);
+			g_assert_cmpuint(delay, <=, cap);
+			lowest = MIN(lowest, delay);
+			highest = MAX(highest, delay);
+		}
+		/* Jittered, so that sessions do not retry in lockstep */
+		g_assert_cmpuint(lowest, <, highest);
+	}
+}
+
+static void test_wait(void)
+{
+	Waiter w;
+
+	waiter_start(&w, 0);
+	waiter_join(&w);
+	g_assert_true(w.ret);
+	g_assert_cmpint(w.elapsed, >=, REMMINA_RECONNECT_DELAY_MIN / 2 - 1);
+	g_assert_cmpint(w.elapsed, <, REMMINA_RECONNECT_DELAY_MIN + 1000);
+}
+
+static void test_interrupt(void)
+{
+	Waiter w;
+
+	waiter_start(&w, 20);
+	g_usleep(100 * G_TIME_SPAN_MILLISECOND);
+	g_assert_false(g_atomic_int_get(&w.done));
+	remmina_reconnect_interrupt(&w.interrupt);
+	waiter_join(&w);
+	g_assert_false(w.ret);
+	g_assert_cmpint(w.elapsed, <, 1000);
+
+	/* Once interrupted, the session gives up without waiting */
+	g_assert_false(remmina_reconnect_wait(0, &w.interrupt));
+}
+
+static void test_network_back(void)
+{
+	Waiter w;
+
+	remmina_reconnect_network_update(TRUE, G_NETWORK_CONNECTIVITY_FULL);
+	waiter_start(&w, 20);
+
+	/* Losing the network does not retry */
+	remmina_reconnect_network_update(FALSE, G_NETWORK_CONNECTIVITY_LOCAL);
+	g_usleep(300 * G_TIME_SPAN_MILLISECOND);
+	g_assert_false(g_atomic_int_get(&w.done));
+
+	/* Getting it back does, within the jitter */
+	remmina_reconnect_network_update(TRUE, G_NETWORK_CONNECTIVITY_FULL);
+	waiter_join(&w);
+	g_assert_true(w.ret);
+	g_assert_cmpint(w.elapsed, <, 300 + REMMINA_RECONNECT_NETWORK_JITTER + 1000);
+}
+
+static void test_network_churn(void)
+{
+	Waiter w;
+	gint i;
+
+	remmina_reconnect_network_update(TRUE, G_NETWORK_CONNECTIVITY_FULL);
+	waiter_start(&w, 20);
+
+	/* Routes coming and going with the same connectivity, like a VPN */
+	for (i = 0; i < 10; i++)
+		remmina_reconnect_network_update(TRUE, G_NETWORK_CONNECTIVITY_FULL);
+	g_usleep(REMMINA_RECONNECT_NETWORK_JITTER * G_TIME_SPAN_MILLISECOND + 500 * G_TIME_SPAN_MILLISECOND);
+	g_assert_false(g_atomic_int_get(&w.done));
+
+	remmina_reconnect_interrupt(&w.interrupt);
+	waiter_join(&w);
+	g_assert_false(w.ret);
+}
+
+static void test_network_spread(void)
+{
+	Waiter w[8];
+	gint64 lowest = G_MAXINT64, highest = 0;
+	guint i;
+
+	remmina_reconnect_network_update(FALSE, G_NETWORK_CONNECTIVITY_LOCAL);
+	for (i = 0; i < G_N_ELEMENTS(w); i++)
+		waiter_start(&w[i], 20);
+	g_usleep(100 * G_TIME_SPAN_MILLISECOND);
+	remmina_reconnect_network_update(TRUE, G_NETWORK_CONNECTIVITY_FULL);
+
+	for (i = 0; i < G_N_ELEMENTS(w); i++) {
+		waiter_join(&w[i]);
+		g_assert_true(w[i].ret);
+		lowest = MIN(lowest, w[i].elapsed);
+		highest = MAX(highest, w[i].elapsed);
+	}
+	/* The sessions woken up together do not retry together */
+	g_assert_cmpint(highest - lowest, >=, 50);
+	g_assert_cmpint(highest, <, 100 + REMMINA_RECONNECT_NETWORK_JITTER + 1000);
+}
+
+int main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/reconnect/delay", test_delay);
+	g_test_add_func("/reconnect/wait", test_wait);
+	g_test_add_func("/reconnect/interrupt", test_interrupt);
+	g_test_add_func("/reconnect/network-back", test_network_back);
+	g_test_add_func("/reconnect/network-churn", test_network_churn);
+	g_test_add_func("/reconnect/network-spread", test_network_spread);
+
+	return g_test_run();
+}
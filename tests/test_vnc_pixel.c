@@ -0,0 +1,253 @@
+/*
+ * Remmina - The GTK+ Remote Desktop Client
+ * Copyright (C) 2016-2021 Antenore Gatta, Giovanni Panozzo
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ *
+ *  In addition, as a special exception, the copyright holders give
+ *  permission to link the code of portions of this program with the
+ *  OpenSSL library under certain conditions as described in each
+ *  individual source file, and distribute linked combinations
+ *  including the two.
+ *  You must obey the GNU General Public License in all respects
+ *  for all of the code used other than OpenSSL. *  If you modify
+ *  file(s) with this exception, you may extend this exception to your
+ *  version of the file(s), but you are not obligated to do so. *  If you
+ *  do not wish to do so, delete this exception statement from your
+ *  version. *  If you delete this exception statement from all source
+ *  files in the program, then also delete it here.
+ *
+ */
+
+/* Checks every VNC pixel conversion kernel usable on this CPU against
+ * the generic per pixel code, run with "-m perf" for the benchmark */
+
+#include <string.h>
+#include <glib.h>
+#include "vnc/vnc_pixel.h"
+
+typedef struct {
+	const gchar *	name;
+	gint		bits_per_pixel;
+	gint		max[3];
+	gint		shift[3];
+} TestFormat;
+
+static const TestFormat test_formats[] = {
+	{ "rgb888", 32, { 255, 255, 255 }, { 16, 8, 0 } },
+	/* The shifts of 32 bpp formats are not looked at */
+	{ "bgr888", 32, { 255, 255, 255 }, { 0, 8, 16 } },
+	{ "rgb565", 16, { 31, 63, 31 }, { 11, 5, 0 } },
+	{ "rgb555", 16, { 31, 31, 31 }, { 10, 5, 0 } },
+	{ "bgr565", 16, { 31, 63, 31 }, { 0, 5, 11 } },
+	{ "bgr233", 8, { 7, 7, 3 }, { 0, 3, 6 } },
+	{ "rgb332", 8, { 7, 7, 3 }, { 5, 2, 0 } },
+};
+
+static const gchar *test_kernels[] = { "scalar", "sse2", "avx2", "neon" };
+
+typedef struct {
+	const gchar *		kernels;
+	const TestFormat *	format;
+} TestCase;
+
+/* Odd widths exercise the scalar tails of the vector kernels */
+static const gint test_widths[] = { 1, 2, 3, 7, 8, 15, 16, 17, 31, 33, 64, 257 };
+
+static gint bits(gint n)
+{
+	gint b = 0;
+
+	while (n) {
+		b++;
+		n >>= 1;
+	}
+	return b ? b : 1;
+}
+
+/* Same conversion as remmina_plugin_vnc_rfb_fill_buffer() without mask */
+static void reference_convert(const TestFormat *f, guchar *dest, gint dest_rowstride,
+			      const guchar *src, gint src_rowstride, gint w, gint h)
+{
+	gint bpp = f->bits_per_pixel / 8;
+	guint32 src_pixel, argb;
+	const guchar *srcptr;
+	guint32 *destptr;
+	gint ix, iy, i, r, b;
+	guchar c;
+
+	for (iy = 0; iy < h; iy++) {
+		destptr = (guint32 *)(dest + iy * dest_rowstride);
+		srcptr = src + iy * src_rowstride;
+		for (ix = 0; ix < w; ix++) {
+			src_pixel = 0;
+			for (i = 0; i < bpp; i++)
+				src_pixel += (guint32)(*srcptr++) << (8 * i);
+			argb = 0xff000000;
+			if (f->bits_per_pixel == 32) {
+				/* The bytes are taken as B, G, R, X in memory */
+				argb |= (src_pixel & 0xff0000) | (src_pixel & 0xff00) | (src_pixel & 0xff);
+			} else {
+				for (i = 0; i < 3; i++) {
+					b = bits(f->max[i]);
+					c = (guchar)(((src_pixel >> f->shift[i]) & f->max[i]) << (8 - b));
+					for (r = b; r < 8; r *= 2)
+						c |= c >> r;
+					argb |= (guint32)c << (16 - 8 * i);
+				}
+			}
+			destptr[ix] = argb;
+		}
+	}
+}
+
+static void fill_random(GRand *rand, guchar *buf, gsize len)
+{
+	gsize i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (guchar)g_rand_int_range(rand, 0, 256);
+}
+
+static void test_convert(gconstpointer data)
+{
+	const TestCase *tc = data;
+	const TestFormat *f = tc->format;
+	RemminaPluginVncPixelFormat pf = { 0 };
+	gint bpp = f->bits_per_pixel / 8;
+	gint h = 5, w, i, src_rowstride, dest_rowstride;
+	guchar *src, *dest, *expected;
+	GRand *rand;
+
+	if (!remmina_plugin_vnc_pixel_use_kernels(tc->kernels)) {
+		g_test_skip("kernels not compiled in or not supported by this CPU");
+		return;
+	}
+	rand = g_rand_new_with_seed(0x564e43);
+	remmina_plugin_vnc_pixel_format_update(&pf, f->bits_per_pixel,
+					       f->max[0], f->max[1], f->max[2],
+					       f->shift[0], f->shift[1], f->shift[2]);
+
+	for (i = 0; i < (gint)G_N_ELEMENTS(test_widths); i++) {
+		w = test_widths[i];
+		/* Padded rows, like a server framebuffer wider than the rectangle */
+		src_rowstride = w * bpp + 3;
+		dest_rowstride = (w + 2) * 4;
+		src = g_malloc(src_rowstride * h);
+		dest = g_malloc0(dest_rowstride * h);
+		expected = g_malloc0(dest_rowstride * h);
+		fill_random(rand, src, src_rowstride * h);
+
+		/* Convert from an unaligned start too */
+		g_assert_true(remmina_plugin_vnc_pixel_convert(&pf, dest, dest_rowstride, src + 1, src_rowstride, w - 1 > 0 ? w - 1 : 1, h));
+		reference_convert(f, expected, dest_rowstride, src + 1, src_rowstride, w - 1 > 0 ? w - 1 : 1, h);
+		g_assert_cmpmem(dest, dest_rowstride * h, expected, dest_rowstride * h);
+
+		g_assert_true(remmina_plugin_vnc_pixel_convert(&pf, dest, dest_rowstride, src, src_rowstride, w, h));
+		reference_convert(f, expected, dest_rowstride, src, src_rowstride, w, h);
+		g_assert_cmpmem(dest, dest_rowstride * h, expected, dest_rowstride * h);
+
+		g_free(src);
+		g_free(dest);
+		g_free(expected);
+	}
+	g_rand_free(rand);
+}
+
+static void test_unsupported(void)
+{
+	RemminaPluginVncPixelFormat pf = { 0 };
+	guchar src[8] = { 0 }, dest[16];
+
+	/* Channels wider than 8 bits have no tables: the caller falls back */
+	remmina_plugin_vnc_pixel_format_update(&pf, 16, 1023, 31, 1, 6, 1, 0);
+	g_assert_false(remmina_plugin_vnc_pixel_convert(&pf, dest, 16, src, 8, 4, 1));
+
+	remmina_plugin_vnc_pixel_format_update(&pf, 32, 255, 255, 255, 16, 8, 0);
+	g_assert_true(remmina_plugin_vnc_pixel_format_is_native(&pf) == (G_BYTE_ORDER == G_LITTLE_ENDIAN));
+	remmina_plugin_vnc_pixel_format_update(&pf, 32, 255, 255, 255, 0, 8, 16);
+	g_assert_false(remmina_plugin_vnc_pixel_format_is_native(&pf));
+}
+
+/* Full HD frames, the vector kernels against the generic code */
+static void test_bench(gconstpointer data)
+{
+	const TestFormat *f = data;
+	RemminaPluginVncPixelFormat pf = { 0 };
+	gint w = 1920, h = 1080, frames = 50, i;
+	gint bpp = f->bits_per_pixel / 8;
+	gdouble fast, generic;
+	guchar *src, *dest;
+	GRand *rand;
+	GTimer *timer;
+
+	g_assert_true(remmina_plugin_vnc_pixel_use_kernels(NULL));
+	rand = g_rand_new_with_seed(0x564e43);
+	src = g_malloc(w * h * bpp);
+	dest = g_malloc(w * h * 4);
+	fill_random(rand, src, w * h * bpp);
+	remmina_plugin_vnc_pixel_format_update(&pf, f->bits_per_pixel,
+					       f->max[0], f->max[1], f->max[2],
+					       f->shift[0], f->shift[1], f->shift[2]);
+
+	timer = g_timer_new();
+	for (i = 0; i < frames; i++)
+		remmina_plugin_vnc_pixel_convert(&pf, dest, w * 4, src, w * bpp, w, h);
+	fast = g_timer_elapsed(timer, NULL);
+
+	g_timer_start(timer);
+	for (i = 0; i < frames; i++)
+		reference_convert(f, dest, w * 4, src, w * bpp, w, h);
+	generic = g_timer_elapsed(timer, NULL);
+
+	g_test_message("%s: %s %.1f Mpixel/s, generic %.1f Mpixel/s", f->name,
+		       remmina_plugin_vnc_pixel_get_kernel_name(),
+		       (gdouble)w * h * frames / fast / 1e6, (gdouble)w * h * frames / generic / 1e6);
+	g_test_minimized_result(fast / frames, "%s: %.3f ms per frame", f->name, fast / frames * 1e3);
+
+	g_timer_destroy(timer);
+	g_free(src);
+	g_free(dest);
+	g_rand_free(rand);
+}
+
+int main(int argc, char *argv[])
+{
+	TestCase *tc;
+	gchar *path;
+	gint i, k;
+
+	g_test_init(&argc, &argv, NULL);
+
+	for (i = 0; i < (gint)G_N_ELEMENTS(test_formats); i++) {
+		for (k = 0; k < (gint)G_N_ELEMENTS(test_kernels); k++) {
+			tc = g_new(TestCase, 1);
+			tc->kernels = test_kernels[k];
+			tc->format = &test_formats[i];
+			path = g_strdup_printf("/vnc/pixel/convert/%s/%s", test_kernels[k], test_formats[i].name);
+			g_test_add_data_func_full(path, tc, test_convert, g_free);
+			g_free(path);
+		}
+		if (g_test_perf()) {
+			path = g_strdup_printf("/vnc/pixel/bench/%s", test_formats[i].name);
+			g_test_add_data_func(path, &test_formats[i], test_bench);
+			g_free(path);
+		}
+	}
+	g_test_add_func("/vnc/pixel/unsupported", test_unsupported);
+
+	return g_test_run();
+}
@@ -0,0 +1,78 @@
+#!/bin/bash
+# Kills the VNC server under an open Remmina session, starts it again and
+# checks that the session reconnects by itself.
+#
+# Needs an installed Remmina (the plugins are loaded from the install
+# directory), Xvnc from TigerVNC and xvfb-run.
+#
+#   tests/vnc_reconnect.sh [path/to/remmina]
+set -e
+
+REMMINA=${1:-remmina}
+PORT=5977
+DISPLAY_NUM=77
+
+for cmd in "$REMMINA" Xvnc xvfb-run; do
+    if ! command -v "$cmd" >/dev/null; then
+        echo "$0: $cmd not found, skipping"
+        exit 77
+    fi
+done
+
+TMPDIR=$(mktemp -d)
+SERVER=
+CLIENT=
+cleanup () {
+    [ -n "$CLIENT" ] && kill "$CLIENT" 2>/dev/null
+    [ -n "$SERVER" ] && kill "$SERVER" 2>/dev/null
+    rm -rf "$TMPDIR"
+}
+trap cleanup EXIT
+
+start_server () {
+    Xvnc :$DISPLAY_NUM -rfbport $PORT -SecurityTypes None -localhost >"$TMPDIR/server.log" 2>&1 &
+    SERVER=$!
+    sleep 2
+}
+
+# Waits up to $2 seconds for $1 in the Remmina debug output
+wait_log () {
+    for _ in $(seq "$2"); do
+        if grep -q "$1" "$TMPDIR/remmina.log"; then
+            return 0
+        fi
+        sleep 1
+    done
+    echo "$0: timed out waiting for \"$1\""
+    tail -n 30 "$TMPDIR/remmina.log"
+    exit 1
+}
+
+cat >"$TMPDIR/test.remmina" <<PROFILE
+[remmina]
+name=vnc_reconnect
+protocol=VNC
+server=127.0.0.1:$PORT
+colordepth=32
+quality=9
+reconnect_attempts=5
+PROFILE
+
+start_server
+
+HOME=$TMPDIR XDG_CONFIG_HOME=$TMPDIR/config XDG_DATA_HOME=$TMPDIR/data \
+    G_MESSAGES_DEBUG=all xvfb-run -a "$REMMINA" -c "$TMPDIR/test.remmina" >"$TMPDIR/remmina.log" 2>&1 &
+CLIENT=$!
+wait_log "Client connected" 30
+
+# A crash: the session must notice and wait for the server
+kill -9 "$SERVER"
+wait "$SERVER" 2>/dev/null || true
+SERVER=
+wait_log "Connection lost, reconnecting" 30
+sleep 3
+
+start_server
+wait_log "Reconnected" 60
+
+echo "$0: session reconnected"